@@ -0,0 +1,95 @@
+// benchmarks/compression_bench.cpp
+//
+// Response compression: every available coding (gzip, brotli, zstd) at several
+// levels, on JSON-like payloads of increasing size. Each row compresses with
+// the per-thread reusable context (Http::compress, as the server does) and with
+// a fresh StreamCompressor per call (the old per-response init/teardown), and
+// reports the compression ratio.
+//
+// Usage: compression_bench [iterations-for-1KiB]
+
+#include "oreshnek/http/Compression.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+
+// A list endpoint's body: repetitive keys, varying values.
+std::string payload(std::size_t bytes) {
+    std::string s = "[";
+    for (int i = 0; s.size() < bytes; ++i) {
+        if (i) s += ',';
+        s += R"({"id":)" + std::to_string(i * 7919 % 100003) + R"(,"title":"Video )" + std::to_string(i) +
+             R"(","duration":)" + std::to_string(60 + i % 3600) + R"(,"owner":"user)" +
+             std::to_string(i % 97) + R"(","tags":["hls","1080p","es"],"views":)" +
+             std::to_string(i * 31337 % 1000000) + "}";
+    }
+    s += "]";
+    return s;
+}
+
+template <typename Fn>
+double ns_per_op(int iterations, Fn&& fn) {
+    for (int i = 0; i < std::max(1, iterations / 10); ++i) fn(); // Warm-up
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) fn();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int base_iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    struct Codec {
+        Http::Encoding encoding;
+        std::vector<int> levels;
+    };
+    const std::vector<Codec> codecs = {
+        {Http::Encoding::Gzip, {1, 6, 9}},
+        {Http::Encoding::Brotli, {1, 5, 9, 11}},
+        {Http::Encoding::Zstd, {1, 3, 9, 19}},
+    };
+
+    std::printf("%-6s %5s %8s %11s %11s %9s %7s\n", "coding", "level", "bytes", "reused ns", "fresh ns",
+                "MB/s", "ratio");
+    for (std::size_t size : {std::size_t{1024}, std::size_t{16 * 1024}, std::size_t{256 * 1024}}) {
+        const std::string input = payload(size);
+        for (const Codec& codec : codecs) {
+            if (!Http::encoding_available(codec.encoding)) {
+                std::printf("%-6s (not compiled in)\n", Http::content_coding(codec.encoding));
+                continue;
+            }
+            for (int level : codec.levels) {
+                // Slow settings on big inputs get fewer iterations.
+                const double weight = static_cast<double>(input.size()) / 1024 * (level >= 9 ? 8 : 1);
+                const int iterations = std::max(3, static_cast<int>(base_iterations / weight));
+                std::string out;
+                std::size_t compressed = 0;
+                const double reused = ns_per_op(iterations, [&] {
+                    Http::compress(codec.encoding, input, out, level);
+                    compressed = out.size();
+                });
+                const double fresh = ns_per_op(iterations, [&] {
+                    Http::StreamCompressor compressor;
+                    std::string result;
+                    compressor.begin(codec.encoding, level, input.size());
+                    compressor.write(input, result);
+                    compressor.finish(result);
+                });
+                std::printf("%-6s %5d %8zu %11.0f %11.0f %9.1f %7.3f\n", Http::content_coding(codec.encoding),
+                            level, input.size(), reused, fresh, input.size() / reused * 1e3,
+                            static_cast<double>(compressed) / input.size());
+            }
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
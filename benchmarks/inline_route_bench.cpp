@@ -0,0 +1,141 @@
+// benchmarks/inline_route_bench.cpp
+//
+// The same trivial handler registered twice, once inline (RouteOptions::inline_,
+// run on the event loop) and once on the workers. Each client holds one
+// keep-alive connection and sends its requests one after another; the rows
+// report requests/s over all clients and per-request round-trip percentiles.
+//
+// Usage: inline_route_bench [clients] [requests per client] [workers]
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr int kPort = 18190;
+
+int connect_client() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// One request, then read until the (fixed-size) response is complete.
+bool round_trip(int fd, const std::string& request, std::string& raw) {
+    if (::send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) return false;
+    raw.clear();
+    char buf[1024];
+    for (;;) {
+        const size_t hdr_end = raw.find("\r\n\r\n");
+        if (hdr_end != std::string::npos) {
+            const size_t p = raw.find("Content-Length: ");
+            const long clen = p == std::string::npos ? 0 : std::strtol(raw.c_str() + p + 16, nullptr, 10);
+            if (raw.size() >= hdr_end + 4 + static_cast<size_t>(clen)) return true;
+        }
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        raw.append(buf, static_cast<size_t>(n));
+    }
+}
+
+struct Result {
+    double rate, p50, p99;
+};
+
+Result run(const std::string& path, int clients, long requests) {
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+    std::vector<std::vector<double>> samples(static_cast<size_t>(clients));
+    std::vector<std::thread> threads;
+    const auto t0 = Clock::now();
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            int fd = connect_client();
+            if (fd < 0) return;
+            std::string raw;
+            std::vector<double>& mine = samples[static_cast<size_t>(c)];
+            mine.reserve(static_cast<size_t>(requests));
+            for (long i = 0; i < requests; ++i) {
+                const auto start = Clock::now();
+                if (!round_trip(fd, request, raw)) break;
+                mine.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            }
+            ::close(fd);
+        });
+    }
+    for (auto& t : threads) t.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::vector<double> all;
+    for (const auto& s : samples) all.insert(all.end(), s.begin(), s.end());
+    if (all.empty()) return {0, 0, 0};
+    std::sort(all.begin(), all.end());
+    auto at = [&all](double q) { return all[static_cast<size_t>(q * (all.size() - 1))]; };
+    return {all.size() / seconds, at(0.50), at(0.99)};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int clients = argc > 1 ? std::atoi(argv[1]) : 4;
+    const long requests = argc > 2 ? std::atol(argv[2]) : 20000;
+    const std::size_t workers = argc > 3 ? static_cast<std::size_t>(std::atoi(argv[3]))
+                                         : std::max(2u, std::thread::hardware_concurrency());
+
+    Server::Server server(workers);
+    auto health = [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).text("ok");
+    };
+    Server::RouteOptions inline_route;
+    inline_route.inline_ = true;
+    server.get("/inline", health, inline_route);
+    server.get("/worker", health);
+    if (!server.listen("127.0.0.1", kPort)) {
+        std::fprintf(stderr, "listen failed\n");
+        return 1;
+    }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    run("/inline", clients, requests / 10); // Warm up
+    run("/worker", clients, requests / 10);
+    const Result worker = run("/worker", clients, requests);
+    const Result inlined = run("/inline", clients, requests);
+
+    std::printf("%d clients x %ld requests, %zu workers\n\n", clients, requests, workers);
+    std::printf("%-14s %14s %12s %12s\n", "route", "requests/s", "p50 (us)", "p99 (us)");
+    std::printf("%-14s %14.0f %12.1f %12.1f\n", "worker", worker.rate, worker.p50, worker.p99);
+    std::printf("%-14s %14.0f %12.1f %12.1f\n", "inline", inlined.rate, inlined.p50, inlined.p99);
+    std::printf("%-14s %13.2fx\n", "speedup", inlined.rate / worker.rate);
+
+    server.request_stop();
+    loop.join();
+    return 0;
+}
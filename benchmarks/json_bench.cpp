@@ -0,0 +1,90 @@
+// benchmarks/json_bench.cpp
+//
+// Request-body JSON: nlohmann::json::parse (full DOM) vs. the lazy
+// Http::JsonDocument, on payloads shaped like the framework's typical uploads
+// and registrations. Each iteration parses the body and reads the few fields a
+// handler would actually use.
+//
+// Usage: json_bench [iterations]
+
+#include "oreshnek/http/JsonReader.h"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace Oreshnek;
+
+namespace {
+
+std::string registration_payload() {
+    return R"({"username":"ana.garcia","email":"ana.garcia@example.com",)"
+           R"("password":"correct horse battery staple","display_name":"Ana García",)"
+           R"("accept_terms":true,"newsletter":false,"locale":"es-PE",)"
+           R"("profile":{"bio":"Backend developer. Coffee, climbing and C++.",)"
+           R"("links":["https://example.com/ana","https://git.example.com/ana"],"age":31}})";
+}
+
+std::string upload_payload() {
+    std::string s = R"({"title":"Conference talk 2026","description":"Recorded in 1080p, )"
+                    R"(two speakers, Q&A at the end.","visibility":"public","duration":3721.5,)"
+                    R"("tags":["c++","performance","networking","http","video"],"chapters":[)";
+    for (int i = 0; i < 24; ++i) {
+        if (i) s += ',';
+        s += R"({"start":)" + std::to_string(i * 150) + R"(,"title":"Chapter )" +
+             std::to_string(i + 1) + R"(","thumbnail":"thumbs/)" + std::to_string(i) + R"(.jpg"})";
+    }
+    s += R"(],"owner_id":42})";
+    return s;
+}
+
+template <typename Fn>
+void run(const char* name, std::size_t bytes, int iterations, Fn&& fn) {
+    long long sink = 0;
+    for (int i = 0; i < iterations / 10; ++i) sink += fn(); // Warm-up
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) sink += fn();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    const double ns = secs * 1e9 / iterations;
+    std::printf("%-34s %9.0f ns/op %9.1f MB/s   (sink %lld)\n", name, ns,
+                static_cast<double>(bytes) * iterations / secs / 1e6, sink);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    const std::string reg = registration_payload();
+    const std::string up = upload_payload();
+    std::printf("registration: %zu bytes, upload: %zu bytes, %d iterations\n\n",
+                reg.size(), up.size(), iterations);
+
+    run("registration / nlohmann::parse", reg.size(), iterations, [&] {
+        auto j = nlohmann::json::parse(reg);
+        return static_cast<long long>(j["username"].get_ref<const std::string&>().size() +
+                                      j["email"].get_ref<const std::string&>().size());
+    });
+    run("registration / JsonDocument", reg.size(), iterations, [&] {
+        Http::JsonDocument doc(reg);
+        auto root = doc.root();
+        return static_cast<long long>(root["username"].get_string_view().value_or("").size() +
+                                      root["email"].get_string_view().value_or("").size());
+    });
+
+    run("upload / nlohmann::parse", up.size(), iterations, [&] {
+        auto j = nlohmann::json::parse(up);
+        return static_cast<long long>(j["title"].get_ref<const std::string&>().size()) +
+               j["owner_id"].get<long long>();
+    });
+    run("upload / JsonDocument", up.size(), iterations, [&] {
+        Http::JsonDocument doc(up);
+        auto root = doc.root();
+        return static_cast<long long>(root["title"].get_string_view().value_or("").size()) +
+               root["owner_id"].get_int().value_or(0);
+    });
+    return 0;
+}
@@ -0,0 +1,151 @@
+// benchmarks/thread_pool_bench.cpp
+//
+// Worker pools: the mutex + condition-variable ThreadPool (enqueue, whose
+// future is discarded as the server did) against the WorkStealingPool (post).
+// Throughput rows time N empty-ish tasks from the first post to the last
+// completion: one external producer (the event loop), several producers, and a
+// recursive fan-out posted from inside the pool. The latency row posts small
+// bursts with idle gaps in between, so it includes waking parked workers, and
+// reports post-to-start percentiles.
+//
+// Usage: thread_pool_bench [workers] [tasks]
+
+#include "oreshnek/server/ThreadPool.h"
+#include "oreshnek/server/WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Both pools behind the same call.
+struct OldPool {
+    Server::ThreadPool pool;
+    explicit OldPool(std::size_t n) : pool(n) {}
+    template <typename F>
+    void post(F&& fn) {
+        pool.enqueue(std::forward<F>(fn));
+    }
+};
+
+struct NewPool {
+    Server::WorkStealingPool pool;
+    explicit NewPool(std::size_t n) : pool(n) {}
+    template <typename F>
+    void post(F&& fn) {
+        pool.post(std::forward<F>(fn));
+    }
+};
+
+void wait_for(const std::atomic<long>& counter, long expected) {
+    while (counter.load(std::memory_order_acquire) < expected) std::this_thread::yield();
+}
+
+template <typename Pool>
+double single_producer(std::size_t workers, long tasks) {
+    Pool p(workers);
+    std::atomic<long> done{0};
+    const auto t0 = Clock::now();
+    for (long i = 0; i < tasks; ++i) p.post([&done] { done.fetch_add(1, std::memory_order_release); });
+    wait_for(done, tasks);
+    return tasks / std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+template <typename Pool>
+double many_producers(std::size_t workers, long tasks, int producers) {
+    Pool p(workers);
+    std::atomic<long> done{0};
+    const long each = tasks / producers;
+    const auto t0 = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([&p, &done, each] {
+            for (long j = 0; j < each; ++j) p.post([&done] { done.fetch_add(1, std::memory_order_release); });
+        });
+    }
+    for (auto& t : threads) t.join();
+    wait_for(done, each * producers);
+    return each * producers / std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+template <typename Pool>
+void spawn(Pool& p, std::atomic<long>& done, int depth) {
+    done.fetch_add(1, std::memory_order_release);
+    if (depth == 0) return;
+    p.post([&p, &done, depth] { spawn(p, done, depth - 1); });
+    p.post([&p, &done, depth] { spawn(p, done, depth - 1); });
+}
+
+template <typename Pool>
+double fan_out(std::size_t workers, long tasks) {
+    int depth = 0;
+    while ((2L << (depth + 1)) - 1 <= tasks) ++depth;
+    const long total = (2L << depth) - 1;
+    Pool p(workers);
+    std::atomic<long> done{0};
+    const auto t0 = Clock::now();
+    p.post([&p, &done, depth] { spawn(p, done, depth); });
+    wait_for(done, total);
+    return total / std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+struct Latency {
+    double p50, p99, p999;
+};
+
+template <typename Pool>
+Latency latency(std::size_t workers, long tasks) {
+    Pool p(workers);
+    const long rounds = std::max(1L, tasks / static_cast<long>(workers) / 20);
+    std::vector<double> samples(static_cast<std::size_t>(rounds) * workers);
+    std::atomic<long> done{0};
+    for (long r = 0; r < rounds; ++r) {
+        for (std::size_t w = 0; w < workers; ++w) {
+            double* slot = &samples[static_cast<std::size_t>(r) * workers + w];
+            const auto posted = Clock::now();
+            p.post([slot, posted, &done] {
+                *slot = std::chrono::duration<double, std::micro>(Clock::now() - posted).count();
+                done.fetch_add(1, std::memory_order_release);
+            });
+        }
+        wait_for(done, (r + 1) * static_cast<long>(workers));
+        std::this_thread::sleep_for(std::chrono::microseconds(200)); // Let the workers go idle
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) { return samples[static_cast<std::size_t>(q * (samples.size() - 1))]; };
+    return {at(0.50), at(0.99), at(0.999)};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t workers = argc > 1 ? static_cast<std::size_t>(std::atoi(argv[1]))
+                                         : std::max(2u, std::thread::hardware_concurrency());
+    const long tasks = argc > 2 ? std::atol(argv[2]) : 1000000;
+
+    std::printf("%zu workers, %ld tasks\n\n", workers, tasks);
+    std::printf("%-28s %16s %16s %8s\n", "throughput (tasks/s)", "ThreadPool", "WorkStealing", "speedup");
+    auto row = [](const char* name, double old_rate, double new_rate) {
+        std::printf("%-28s %16.0f %16.0f %7.2fx\n", name, old_rate, new_rate, new_rate / old_rate);
+    };
+    row("1 producer", single_producer<OldPool>(workers, tasks), single_producer<NewPool>(workers, tasks));
+    row("4 producers", many_producers<OldPool>(workers, tasks, 4), many_producers<NewPool>(workers, tasks, 4));
+    row("fan-out from workers", fan_out<OldPool>(workers, tasks), fan_out<NewPool>(workers, tasks));
+
+    const Latency old_lat = latency<OldPool>(workers, tasks);
+    const Latency new_lat = latency<NewPool>(workers, tasks);
+    std::printf("\n%-28s %16s %16s\n", "post-to-start latency (us)", "ThreadPool", "WorkStealing");
+    std::printf("%-28s %16.1f %16.1f\n", "p50", old_lat.p50, new_lat.p50);
+    std::printf("%-28s %16.1f %16.1f\n", "p99", old_lat.p99, new_lat.p99);
+    std::printf("%-28s %16.1f %16.1f\n", "p99.9", old_lat.p999, new_lat.p999);
+    return 0;
+}
@@ -7,13 +7,21 @@
 #include "oreshnek/http/HttpRequest.h"
 #include "oreshnek/http/HttpResponse.h" // This line is crucial for HttpResponse to be known
 #include "oreshnek/http/HttpParser.h"
+#include "oreshnek/http/CannedResponse.h"
+#include "oreshnek/http/ContentNegotiation.h"
+#include "oreshnek/http/JsonReader.h"
+#include "oreshnek/http/JsonWriter.h"
+#include "oreshnek/http/MimeTypes.h"
 
 #include <nlohmann/json.hpp>
 
 #include "oreshnek/net/Connection.h" // This includes Connection.h AFTER HttpResponse.h
 #include "oreshnek/server/Router.h"
 #include "oreshnek/server/Server.h"
+#include "oreshnek/server/StaticFiles.h"
 #include "oreshnek/server/ThreadPool.h"
+#include "oreshnek/server/WorkStealingPool.h"
+#include "oreshnek/server/Bulkhead.h"
 
 // Define the top-level namespace alias for convenience
 namespace Oreshnek {
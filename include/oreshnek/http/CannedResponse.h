@@ -0,0 +1,67 @@
+// oreshnek/include/oreshnek/http/CannedResponse.h
+#ifndef ORESHNEK_HTTP_CANNEDRESPONSE_H
+#define ORESHNEK_HTTP_CANNEDRESPONSE_H
+
+#include "oreshnek/http/HttpEnums.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Oreshnek {
+namespace Http {
+
+// A fully pre-serialized response (status line + headers + body) that never
+// changes after registration. Only the Date value differs per send: it is
+// spliced in from segments() rather than written into the shared bytes, so a
+// canned response can be sent by reference from any thread.
+class CannedResponse {
+public:
+    // Serialize `templ` once. Throws std::invalid_argument for file responses.
+    CannedResponse(const HttpResponse& templ);
+
+    HttpStatus status() const { return status_; }
+    // Whether the response carries "Connection: close".
+    bool closes_connection() const { return closes_; }
+    // Bytes on the wire with or without the body (HEAD).
+    std::size_t size(bool head_only) const { return head_only ? header_len_ : bytes_.size(); }
+
+    // The response as three consecutive pieces: everything before the Date
+    // value, `date` itself, and the rest (the body omitted for HEAD).
+    std::array<std::string_view, 3> segments(std::string_view date, bool head_only) const;
+
+private:
+    HttpStatus status_;
+    std::string bytes_;           // Serialized with a placeholder Date value
+    std::size_t date_offset_ = 0; // Start of the Date value within bytes_
+    std::size_t header_len_ = 0;  // Length of the header block incl. CRLFCRLF
+    bool closes_ = false;
+};
+
+// Status-keyed registry of canned responses for the hot error paths the event
+// loop answers itself (429 rate limit, 503 load shed, 408/504 timeouts) and for
+// the router's 404. Pre-populated with the framework defaults; applications may
+// replace any entry (e.g. an HTML 404) or add new ones. Mutate before run() only:
+// lookups from the event loop and workers are unsynchronized.
+class CannedResponseRegistry {
+public:
+    CannedResponseRegistry();
+
+    // Register (or replace) the canned response for templ.get_status().
+    void set(const HttpResponse& templ);
+
+    // The canned response for `status`, or nullptr if none is registered.
+    const CannedResponse* find(HttpStatus status) const;
+
+private:
+    // Node-based map: entries keep their address for the server's lifetime.
+    std::unordered_map<int, CannedResponse> entries_;
+};
+
+} // namespace Http
+} // namespace Oreshnek
+
+#endif // ORESHNEK_HTTP_CANNEDRESPONSE_H
@@ -2,6 +2,8 @@
 #ifndef ORESHNEK_HTTP_COMPRESSION_H
 #define ORESHNEK_HTTP_COMPRESSION_H
 
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -9,7 +11,61 @@ namespace Oreshnek {
 namespace Http {
 
 // Negotiated content codings.
-enum class Encoding { None, Gzip, Brotli };
+enum class Encoding { None, Gzip, Brotli, Zstd };
+
+// Content-Encoding token for `encoding` ("gzip", "br", "zstd"); nullptr for None.
+const char* content_coding(Encoding encoding);
+
+// Whether a Content-Type is worth compressing (case-insensitive, parameters
+// ignored). An allowlist of textual types: binary payloads (images, video, and
+// the MessagePack / CBOR encodings of JSON) are already dense.
+bool is_compressible_type(std::string_view content_type);
+
+// Whether a coding is compiled in. gzip (zlib) always is; brotli and zstd only
+// when their libraries were found at build time.
+bool encoding_available(Encoding encoding);
+// Default level per coding: gzip 6, brotli 5, zstd 3.
+int default_level(Encoding encoding);
+
+// Incremental compressor for one coding, for bodies produced piecewise (e.g.
+// chunked responses): begin(), any number of write()s, then finish(). The
+// codec state is kept between streams and reset by begin() (deflateReset, a
+// reset zstd context), so a long-lived instance compresses without
+// re-allocating its window and tables. Brotli has no reset call; its encoder is
+// recreated per stream but allocates from a per-thread block cache. Not
+// thread-safe; use one per thread or per response.
+class StreamCompressor {
+public:
+    StreamCompressor();
+    ~StreamCompressor();
+    StreamCompressor(const StreamCompressor&) = delete;
+    StreamCompressor& operator=(const StreamCompressor&) = delete;
+
+    // Start a new stream (abandoning any unfinished one). `total_size`, when
+    // known, is the exact input size (lets brotli / zstd size their buffers).
+    // Returns false if the coding is not available or the level is rejected.
+    bool begin(Encoding encoding, int level, std::size_t total_size = 0);
+    // Compress `input`, appending whatever output is ready to `out`. With
+    // `flush`, everything written so far is emitted (a sync flush), so the
+    // receiver can decode it without waiting for the rest. Returns false on
+    // error (the stream is then unusable until the next begin()).
+    bool write(std::string_view input, std::string& out, bool flush = false);
+    // End the stream, appending the remaining output and trailer.
+    bool finish(std::string& out);
+
+    Encoding encoding() const { return encoding_; }
+
+private:
+    struct Codecs;
+    std::unique_ptr<Codecs> codecs_;
+    Encoding encoding_ = Encoding::None;
+};
+
+// One-shot compression of `input` into `out` (replacing its contents, keeping
+// its capacity) with the calling thread's reusable StreamCompressor. Passing a
+// recycled buffer makes a warm call allocation-free. Returns false if the
+// coding is unavailable or fails.
+bool compress(Encoding encoding, std::string_view input, std::string& out, int level);
 
 // gzip-wrapped DEFLATE (Content-Encoding: gzip) via zlib. Returns an empty
 // string on failure. zlib is always available.
@@ -21,6 +77,11 @@ std::string gzip_compress(std::string_view input, int level = 6);
 bool brotli_available();
 std::string brotli_compress(std::string_view input, int quality = 5);
 
+// Zstandard (Content-Encoding: zstd, RFC 8878). Compiled in only when libzstd
+// is present; returns empty otherwise or on failure.
+bool zstd_available();
+std::string zstd_compress(std::string_view input, int level = 3);
+
 }  // namespace Http
 }  // namespace Oreshnek
 
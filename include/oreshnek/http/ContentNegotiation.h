@@ -0,0 +1,30 @@
+// oreshnek/include/oreshnek/http/ContentNegotiation.h
+#ifndef ORESHNEK_HTTP_CONTENTNEGOTIATION_H
+#define ORESHNEK_HTTP_CONTENTNEGOTIATION_H
+
+#include <optional>
+#include <string_view>
+
+namespace Oreshnek {
+namespace Http {
+
+// Wire encodings of the JSON data model. HttpResponse::json() emits the
+// negotiated one and HttpRequest::json() decodes by Content-Type, so handlers
+// keep working with nlohmann::json regardless of the encoding.
+enum class BodyFormat { Json, MsgPack, Cbor };
+
+// Pick the response format from an Accept header. A binary format is chosen
+// only when the client explicitly prefers it (higher q-value) over JSON; with
+// no Accept header, wildcards only, or a tie, the answer is Json.
+BodyFormat negotiate_body_format(std::optional<std::string_view> accept);
+
+// The format a request body claims to be in (Json for unknown types).
+BodyFormat body_format_from_content_type(std::optional<std::string_view> content_type);
+
+// Canonical media type for a format ("application/json", ...).
+std::string_view content_type_for(BodyFormat format);
+
+} // namespace Http
+} // namespace Oreshnek
+
+#endif // ORESHNEK_HTTP_CONTENTNEGOTIATION_H
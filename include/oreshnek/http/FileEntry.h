@@ -0,0 +1,101 @@
+// oreshnek/include/oreshnek/http/FileEntry.h
+#ifndef ORESHNEK_HTTP_FILEENTRY_H
+#define ORESHNEK_HTTP_FILEENTRY_H
+
+#include "oreshnek/http/Compression.h"
+#include "oreshnek/utils/FileHandle.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Oreshnek {
+namespace Http {
+
+// Precompressed sidecar descriptors handed to FileEntry::from_fd() (-1: none).
+struct FileSidecars {
+    int gzip_fd = -1;
+    int brotli_fd = -1;
+};
+
+// An open regular file plus everything a response needs to describe it: size,
+// mtime, the ETag / Last-Modified strings and the Content-Type, all computed
+// once when the file is opened. Immutable and shared: a file response, the
+// connection streaming it and the server's FileCache all hold the same entry,
+// so a cache hit costs no syscalls and no formatting.
+//
+// Small files can also be held in memory: the contents are read once and, for
+// compressible types, gzip / brotli variants are built at the default levels
+// (on the request that fills the cache, so not the maximum). The strings are
+// never modified after construction, so connections write straight out of them
+// (keeping the entry alive) instead of calling sendfile().
+//
+// Precompressed sidecars ("app.js.br", "app.js.gz" next to "app.js") can be
+// attached when the entry is created: they are sent with sendfile() like the
+// file itself, or become the in-memory variants of a small file (instead of
+// compressing it here).
+struct FileEntry {
+    FileEntry(int fd, int64_t size, int64_t mtime, std::string_view content_type);
+
+    Utils::FileHandle file;
+    int64_t size;
+    int64_t mtime;             // Seconds since the epoch
+    uint64_t device = 0;       // st_dev / st_ino: entries opened separately for
+    uint64_t inode = 0;        // the same file compare equal on these
+    std::string etag;          // Strong validator from size + mtime: "<size>-<mtime>" (hex)
+    std::string last_modified; // IMF-fixdate of mtime
+    std::string content_type;
+
+    // In-memory copy (only when in_memory). A variant is empty when it is not
+    // built (not a compressible type, or not smaller than the original).
+    bool in_memory = false;
+    std::string contents;
+    std::string gzip;
+    std::string brotli;
+    // Sidecar files (only when not in_memory), streamed like `file`.
+    std::shared_ptr<const FileEntry> gzip_file;
+    std::shared_ptr<const FileEntry> brotli_file;
+    // Validators of the variants, with a "-gz" / "-br" suffix: a variant must
+    // never share a strong ETag with the identity body.
+    std::string etag_gzip;
+    std::string etag_brotli;
+
+    // Whether the coding can be served (always true for None).
+    bool has_encoding(Encoding encoding) const;
+    bool has_variants() const { return has_encoding(Encoding::Gzip) || has_encoding(Encoding::Brotli); }
+    // Size of the body sent for a coding.
+    int64_t size_for(Encoding encoding) const;
+    // In-memory body bytes for a coding (contents for None); empty if not built.
+    std::string_view body(Encoding encoding) const;
+    // Sidecar file for a coding (null for None or when there is none).
+    const std::shared_ptr<const FileEntry>& sidecar(Encoding encoding) const;
+    const std::string& etag_for(Encoding encoding) const;
+    // Heap bytes held by the in-memory copy and its variants.
+    std::size_t memory_bytes() const { return contents.size() + gzip.size() + brotli.size(); }
+
+    // Take ownership of `fd` and fstat() it. Returns nullptr (fd closed, errno
+    // set; EISDIR / EINVAL for a directory or special file) unless it is a
+    // regular file. A file of at most `memory_limit` bytes (0: never) is also
+    // read into memory, with its compressed variants. Takes ownership of the
+    // `sidecars` too; one that is not a regular file, or is older than the file
+    // itself (left behind by an edit), is ignored.
+    static std::shared_ptr<const FileEntry> from_fd(int fd, std::string_view content_type,
+                                                    std::size_t memory_limit = 0, FileSidecars sidecars = {});
+    // open(path, O_RDONLY) + from_fd().
+    static std::shared_ptr<const FileEntry> open(const std::string& path, std::string_view content_type,
+                                                 std::size_t memory_limit = 0);
+    // An in-memory entry with no descriptor behind it, for contents read and
+    // replaced often (a live playlist): `etag` (quoted, e.g. a content hash)
+    // stands in for the size/mtime validator, which cannot tell apart two
+    // versions written within the same second. Variants of compressible types
+    // are built at the given levels (a rebuild per change, so not the maximum).
+    static std::shared_ptr<const FileEntry> from_memory(std::string contents, std::string_view content_type,
+                                                        int64_t mtime, std::string etag, int gzip_level = 6,
+                                                        int brotli_quality = 5);
+};
+
+} // namespace Http
+} // namespace Oreshnek
+
+#endif // ORESHNEK_HTTP_FILEENTRY_H
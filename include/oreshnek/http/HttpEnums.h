@@ -18,19 +18,22 @@ enum class HttpStatus {
     ACCEPTED = 202,
     NO_CONTENT = 204,
     PARTIAL_CONTENT = 206,
+    MOVED_PERMANENTLY = 301,
     NOT_MODIFIED = 304,
     BAD_REQUEST = 400,
     UNAUTHORIZED = 401,
     FORBIDDEN = 403,
     NOT_FOUND = 404,
     METHOD_NOT_ALLOWED = 405,
+    REQUEST_TIMEOUT = 408,
     CONFLICT = 409,
     PAYLOAD_TOO_LARGE = 413,
     RANGE_NOT_SATISFIABLE = 416,
     TOO_MANY_REQUESTS = 429,
     INTERNAL_SERVER_ERROR = 500,
     NOT_IMPLEMENTED = 501,
-    SERVICE_UNAVAILABLE = 503
+    SERVICE_UNAVAILABLE = 503,
+    GATEWAY_TIMEOUT = 504
 };
 
 // Utility function to get string representation of HttpMethod
@@ -57,12 +60,14 @@ inline const char* http_status_to_string(HttpStatus status) {
         case HttpStatus::ACCEPTED: return "Accepted";
         case HttpStatus::NO_CONTENT: return "No Content";
         case HttpStatus::PARTIAL_CONTENT: return "Partial Content";
+        case HttpStatus::MOVED_PERMANENTLY: return "Moved Permanently";
         case HttpStatus::NOT_MODIFIED: return "Not Modified";
         case HttpStatus::BAD_REQUEST: return "Bad Request";
         case HttpStatus::UNAUTHORIZED: return "Unauthorized";
         case HttpStatus::FORBIDDEN: return "Forbidden";
         case HttpStatus::NOT_FOUND: return "Not Found";
         case HttpStatus::METHOD_NOT_ALLOWED: return "Method Not Allowed";
+        case HttpStatus::REQUEST_TIMEOUT: return "Request Timeout";
         case HttpStatus::CONFLICT: return "Conflict";
         case HttpStatus::PAYLOAD_TOO_LARGE: return "Payload Too Large";
         case HttpStatus::RANGE_NOT_SATISFIABLE: return "Range Not Satisfiable";
@@ -70,6 +75,7 @@ inline const char* http_status_to_string(HttpStatus status) {
         case HttpStatus::INTERNAL_SERVER_ERROR: return "Internal Server Error";
         case HttpStatus::NOT_IMPLEMENTED: return "Not Implemented";
         case HttpStatus::SERVICE_UNAVAILABLE: return "Service Unavailable";
+        case HttpStatus::GATEWAY_TIMEOUT: return "Gateway Timeout";
     }
     return "Internal Server Error"; // Default for unknown codes
 }
@@ -2,8 +2,13 @@
 #ifndef ORESHNEK_HTTP_HTTPREQUEST_H
 #define ORESHNEK_HTTP_HTTPREQUEST_H
 
+#include "oreshnek/http/ContentNegotiation.h"
 #include "oreshnek/http/HttpEnums.h"
+#include "oreshnek/http/JsonReader.h"
+#include "oreshnek/utils/StringUtil.h"
 #include <nlohmann/json.hpp>
+#include <array>
+#include <cstddef>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -13,20 +18,68 @@
 namespace Oreshnek {
 namespace Http {
 
+// Path parameters captured by the router (e.g. /users/:id), kept in fixed inline
+// slots so matching a route never allocates. Names point at router-owned
+// storage, values into the request path.
+class PathParams {
+public:
+    static constexpr std::size_t kMaxParams = 8;
+
+    struct Entry {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    // Append a capture. Returns false (and stores nothing) when all slots are used.
+    bool push(std::string_view name, std::string_view value) {
+        if (size_ == kMaxParams) return false;
+        slots_[size_++] = Entry{name, value};
+        return true;
+    }
+    // Drop the most recent capture (router backtracking).
+    void pop() { if (size_ > 0) --size_; }
+    void clear() { size_ = 0; }
+    // Repoint the values (views into the path) from old_base to new_base; the
+    // names point into the router and stay.
+    void rebase(const char* old_base, const char* new_base) {
+        for (std::size_t i = 0; i < size_; ++i) {
+            std::string_view& value = slots_[i].value;
+            if (value.data() != nullptr) value = std::string_view(new_base + (value.data() - old_base), value.size());
+        }
+    }
+
+    std::optional<std::string_view> find(std::string_view name) const {
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (slots_[i].name == name) return slots_[i].value;
+        }
+        return std::nullopt;
+    }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Entry* begin() const { return slots_.data(); }
+    const Entry* end() const { return slots_.data() + size_; }
+
+private:
+    std::array<Entry, kMaxParams> slots_{};
+    std::size_t size_ = 0;
+};
+
 class HttpRequest {
 public:
     HttpMethod method_ = HttpMethod::UNKNOWN;
     std::string_view path_;
     std::string_view version_; // E.g., "HTTP/1.1"
 
-    // Headers stored as string_views pointing into the raw buffer
-    std::unordered_map<std::string_view, std::string_view> headers_;
+    // Headers stored as string_views pointing into the raw buffer, keyed
+    // case-insensitively (names are kept as sent).
+    std::unordered_map<std::string_view, std::string_view, Utils::CaseInsensitiveHash, Utils::CaseInsensitiveEqual>
+        headers_;
 
     // Query parameters (e.g., ?key=value)
     std::unordered_map<std::string_view, std::string_view> query_params_;
 
     // Path parameters (e.g., /users/:id) - set by the Router
-    std::unordered_map<std::string_view, std::string_view> path_params_;
+    PathParams path_params_;
 
     // Raw body (points into the raw buffer)
     std::string_view body_;
@@ -58,8 +111,7 @@ public:
     std::string_view path() const { return path_; }
     std::string_view version() const { return version_; }
 
-    // Get header by name (case-insensitive recommended, but for string_view we'll stick to exact match or convert key)
-    // For performance, exact match is better. If case-insensitivity is needed, normalize keys during parsing.
+    // Get header by name, case-insensitively.
     std::optional<std::string_view> header(std::string_view name) const;
 
     // Get query parameter
@@ -68,12 +120,23 @@ public:
     // Get path parameter
     std::optional<std::string_view> param(std::string_view name) const;
 
+    // Whether If-None-Match is "*" or lists `etag` (weak comparison: a "W/"
+    // prefix on either side is ignored). A handler that knows its ETag before
+    // building the body can answer a match with HttpResponse::not_modified().
+    bool if_none_match(std::string_view etag) const;
+
     // Get the raw body as a string_view
     std::string_view body() const { return body_; }
 
-    // Parse JSON body. Will throw if body is not valid JSON.
+    // Parse the body into JSON. A MessagePack or CBOR Content-Type is decoded
+    // from that encoding instead. Will throw if the body is malformed.
     nlohmann::json json() const;
 
+    // Lazy, zero-copy view of the JSON body: validated up front, values decoded
+    // only when read. Never throws (check valid()). The document views body(),
+    // so it must not outlive this request.
+    JsonDocument json_view() const { return JsonDocument(body_); }
+
     // For debugging/logging
     std::string to_string() const;
 
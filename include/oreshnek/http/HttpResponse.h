@@ -2,88 +2,207 @@
 #ifndef ORESHNEK_HTTP_HTTPRESPONSE_H
 #define ORESHNEK_HTTP_HTTPRESPONSE_H
 
+#include "oreshnek/http/ContentNegotiation.h"
+#include "oreshnek/http/FileEntry.h"
 #include "oreshnek/http/HttpEnums.h"
+#include "oreshnek/http/JsonWriter.h"
 #include <nlohmann/json.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint> // For int64_t (file offsets/lengths)
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
-#include <variant> // For std::variant (C++17) to hold different body types
-#include <fstream> // For std::ifstream
-#include <cstdint> // For int64_t (file offsets/lengths)
 
 namespace Oreshnek {
 namespace Http {
 
-// Define a distinct type for file paths to avoid std::variant ambiguity
-struct FilePath {
-    std::string path;
-    // Constructor to allow implicit conversion from std::string
-    FilePath(const std::string& p) : path(p) {}
-    FilePath(std::string&& p) : path(std::move(p)) {}
+// Response headers as a small vector: the first kInline entries live inside the
+// response object itself and only unusually header-heavy responses spill to the
+// heap. Names are matched case-insensitively (HTTP field names are). Clearing
+// keeps the inline strings' capacity, so a recycled response (see
+// HttpResponsePool) re-populates its usual headers without allocating.
+class HeaderList {
+public:
+    static constexpr std::size_t kInline = 12;
+
+    struct Entry {
+        std::string name;
+        std::string value;
+    };
+
+    // Insert or replace `name`.
+    void set(std::string_view name, std::string_view value);
+    // Remove `name` if present. Returns whether it was.
+    bool remove(std::string_view name);
+    // Value of `name`, or nullptr.
+    const std::string* find(std::string_view name) const;
+    bool contains(std::string_view name) const { return find(name) != nullptr; }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Entry& operator[](std::size_t i) const {
+        return i < kInline ? inline_[i] : overflow_[i - kInline];
+    }
+    void clear();
+
+private:
+    Entry& at(std::size_t i) { return i < kInline ? inline_[i] : overflow_[i - kInline]; }
+    std::size_t index_of(std::string_view name) const;
+
+    std::array<Entry, kInline> inline_{};
+    std::vector<Entry> overflow_;
+    std::size_t size_ = 0;
+};
+
+// One part of a multi-range (multipart/byteranges) file body: `text` (the part
+// boundary and headers, or the closing boundary) followed by `length` bytes of
+// the file from `offset`.
+struct FileSegment {
+    std::string text;
+    int64_t offset = 0;
+    int64_t length = 0;
 };
 
+// A response under construction by a handler. Move-only: the body is handed to
+// the connection by move (Connection::set_response_content) and never copied.
+// "Server" and "Connection: keep-alive" are implied unless a handler sets them,
+// and Content-Length is derived from the body at serialization time.
 class HttpResponse {
 private:
     HttpStatus status_ = HttpStatus::OK;
-    std::unordered_map<std::string, std::string> headers_;
-    // Use std::variant to hold either a string body or a file path for streaming
-    std::variant<std::string, FilePath> body_content_; // Stores either direct content or file path
-    bool is_file_response_ = false; // Flag to indicate if content_ is a file path
-
+    HeaderList headers_;
+
+    // Either an in-memory body or an open file to stream with sendfile. The
+    // file is opened when the handler calls file(), so the connection never
+    // re-resolves a path that may have changed in between.
+    std::string body_;
+    std::string file_path_;
+    std::shared_ptr<const FileEntry> file_;
+    bool is_file_response_ = false;
+
+    // Size of the file at file() time (-1 if it could not be opened).
+    int64_t file_size_ = -1;
     // For file responses: byte range to send. file_length_ < 0 means "from
     // file_offset_ to end of file" (resolved by the connection once the file is
     // opened). Set by the framework when honouring a Range request.
     int64_t file_offset_ = 0;
     int64_t file_length_ = -1;
+    // Multi-range file response: the body is these segments instead of one
+    // range. Set by the framework for a Range with several ranges.
+    std::vector<FileSegment> file_segments_;
+    // Which of the entry's bodies is sent (identity, or a precompressed variant
+    // held in memory or as a sidecar file); chosen by the server from
+    // Accept-Encoding.
+    Encoding file_encoding_ = Encoding::None;
     // When true (HEAD requests), headers are sent but the body is suppressed.
     bool head_only_ = false;
+    // Encoding json() emits; set by the server from the
+    // request's Accept header when binary JSON negotiation is enabled.
+    BodyFormat json_format_ = BodyFormat::Json;
+    bool json_negotiated_ = false;
 
 public:
-    HttpResponse(); // Default constructor
+    HttpResponse() = default;
+    HttpResponse(const HttpResponse&) = delete;
+    HttpResponse& operator=(const HttpResponse&) = delete;
+    HttpResponse(HttpResponse&&) noexcept = default;
+    HttpResponse& operator=(HttpResponse&&) noexcept = default;
 
     // Setters
     HttpResponse& status(HttpStatus status);
-    HttpResponse& header(const std::string& name, const std::string& value);
+    HttpResponse& header(std::string_view name, std::string_view value);
+    HttpResponse& remove_header(std::string_view name);
+    // Add `token` to Vary, keeping what it already lists (a middleware's
+    // "Origin", compression's "Accept-Encoding"); no-op if already listed.
+    HttpResponse& vary(std::string_view token);
 
     // Set the body directly with a string
     HttpResponse& body(const std::string& content);
     HttpResponse& body(std::string&& content); // Move overload
 
-    // Set the body to be a file to be streamed
+    // Set the body to be a file to be streamed. Opens and fstat()s the path now;
+    // if that fails the response keeps no file and file_size() is -1.
     HttpResponse& file(const std::string& file_path, const std::string& content_type = "application/octet-stream");
+    // Stream an already-open file, e.g. from a Server::FileCache or a
+    // StaticDirectory. Content-Type comes from the entry. A null entry behaves
+    // like a file that could not be opened.
+    HttpResponse& file(std::shared_ptr<const FileEntry> entry);
 
-    // Convenience methods for common response types
+    // Convenience methods for common response types. json() serializes in the
+    // negotiated format (JSON, MessagePack or CBOR; see set_json_format).
     HttpResponse& json(const nlohmann::json& json_val);
+    // Take a streamed document as the body (its buffer is moved, not copied).
+    // A negotiated MessagePack/CBOR client gets it transcoded instead (parsed
+    // and re-encoded, so no longer copy-free). Throws std::logic_error if the
+    // writer holds an incomplete document.
+    HttpResponse& json(JsonWriter&& writer);
     HttpResponse& text(const std::string& content);
     HttpResponse& html(const std::string& content);
+    // 304 Not Modified carrying `etag`, with no body (headers already set,
+    // e.g. Cache-Control and Vary, are kept).
+    HttpResponse& not_modified(std::string_view etag);
 
     // Getters
     HttpStatus get_status() const { return status_; }
-    const std::unordered_map<std::string, std::string>& get_headers() const { return headers_; }
-    // Get the body as a string. This will *read the file into string* if it's a file response.
-    // Use get_body_variant() for direct access to the underlying storage without reading files.
-    // REMOVED: const std::string& get_body() const; // This method is problematic for large files and streaming
+    const HeaderList& get_headers() const { return headers_; }
+    std::optional<std::string_view> get_header(std::string_view name) const;
 
     // New getter to know if it's a file response
     bool is_file() const { return is_file_response_; }
-    // Get the variant directly for more efficient handling in Connection/Server
-    const std::variant<std::string, FilePath>& get_body_variant() const { return body_content_; }
+    // In-memory body (empty for file responses).
+    const std::string& get_body_string() const { return body_; }
+    // Move the in-memory body out (the response is then left with an empty body).
+    std::string take_body() { return std::move(body_); }
 
-    // Path of a file response (empty if not a file response).
-    const std::string& file_path() const;
+    // Path of a file response (empty if not a file response, or if it was given
+    // as an open descriptor).
+    const std::string& file_path() const { return file_path_; }
+    // Open file of a file response (null if it could not be opened).
+    const std::shared_ptr<const FileEntry>& file_entry() const { return file_; }
 
     // Byte range for a file response.
     int64_t file_offset() const { return file_offset_; }
     int64_t file_length() const { return file_length_; }
+    int64_t file_size() const { return file_size_; }
     void set_file_range(int64_t offset, int64_t length) {
         file_offset_ = offset;
         file_length_ = length;
     }
+    // Multi-range body (replaces the single range); Content-Length follows the
+    // segments. The connection takes them when the response is written.
+    void set_file_segments(std::vector<FileSegment> segments) { file_segments_ = std::move(segments); }
+    const std::vector<FileSegment>& file_segments() const { return file_segments_; }
+    std::vector<FileSegment> take_file_segments() { return std::move(file_segments_); }
+    // Send a precompressed variant of the file entry (ignored if it has none).
+    // file_size() becomes the variant's size; Content-Encoding is the
+    // caller's to set.
+    void set_file_encoding(Encoding encoding);
+    Encoding file_encoding() const { return file_encoding_; }
+
+    // Format json() emits. Marks the response as negotiated, so json() also
+    // adds "Vary: Accept".
+    void set_json_format(BodyFormat format) {
+        json_format_ = format;
+        json_negotiated_ = true;
+    }
+    BodyFormat json_format() const { return json_format_; }
 
     // HEAD support: send headers only, no body.
     bool head_only() const { return head_only_; }
     void set_head_only(bool v) { head_only_ = v; }
 
+    // Content-Length that will be sent: an explicit header wins, otherwise the
+    // body size (or file range). -1 when it cannot be determined.
+    int64_t content_length() const;
+
+    // Append the status line and headers (including Date and the derived
+    // Content-Length) to `out`, reusing its capacity.
+    void serialize_headers(std::string& out) const;
+
     // Build the full HTTP response string (excluding large file body)
     std::string build_headers_string() const;
 
@@ -91,6 +210,39 @@ public:
     void reset();
 };
 
+// Recycles HttpResponse objects so the steady-state request path does not
+// allocate a response (or its header strings) per request. The server keeps one
+// pool per worker thread: the worker acquires, the event loop releases once the
+// response has been handed to the connection, so the lock is effectively
+// uncontended. Thread-safe.
+class HttpResponsePool {
+public:
+    struct Recycler {
+        HttpResponsePool* pool = nullptr;
+        void operator()(HttpResponse* response) const noexcept;
+    };
+    using Handle = std::unique_ptr<HttpResponse, Recycler>;
+
+    explicit HttpResponsePool(std::size_t max_idle = 64) : max_idle_(max_idle) {
+        free_.reserve(max_idle_);
+    }
+    HttpResponsePool(const HttpResponsePool&) = delete;
+    HttpResponsePool& operator=(const HttpResponsePool&) = delete;
+
+    // A reset response, recycled when available.
+    Handle acquire();
+
+    // Responses currently parked in the pool.
+    std::size_t idle() const;
+
+private:
+    void release(HttpResponse* response) noexcept;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<HttpResponse>> free_;
+    std::size_t max_idle_;
+};
+
 } // namespace Http
 } // namespace Oreshnek
 
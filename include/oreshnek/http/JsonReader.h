@@ -0,0 +1,146 @@
+// oreshnek/include/oreshnek/http/JsonReader.h
+#ifndef ORESHNEK_HTTP_JSONREADER_H
+#define ORESHNEK_HTTP_JSONREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Oreshnek {
+namespace Http {
+
+enum class JsonType : std::uint8_t { Invalid, Null, Bool, Number, String, Array, Object };
+
+namespace detail {
+// One entry of the structural index built by JsonDocument. Containers span
+// [start, start + len) of the text and their subtree ends at node `next`;
+// strings cover only the characters between the quotes.
+struct JsonNode {
+    JsonType type;
+    bool escaped;        // String contains backslash escapes
+    std::uint32_t start;
+    std::uint32_t len;
+    std::uint32_t next;  // Index of the first node after this value's subtree
+    std::uint32_t count; // Elements (arrays) or members (objects)
+};
+} // namespace detail
+
+// A lazily-decoded value inside a JsonDocument. Cheap to copy (three words).
+// Nothing is converted until a getter is called: numbers are parsed on
+// get_int()/get_double(), and strings without escapes come back as views into
+// the original text. A default-constructed or missing value (absent key, index
+// out of range) has type Invalid and every getter returns nullopt, so lookups
+// can be chained without checks:
+//
+//   auto doc = req.json_view();
+//   std::string_view name = doc.root()["user"]["name"].get_string_view().value_or("");
+//
+// Values stay valid while the document is alive (moving the document is fine)
+// and the underlying text is unchanged.
+class JsonValue {
+public:
+    JsonValue() = default;
+
+    JsonType type() const { return nodes_ ? node().type : JsonType::Invalid; }
+    explicit operator bool() const { return nodes_ != nullptr; }
+    bool is_null() const { return type() == JsonType::Null; }
+    bool is_object() const { return type() == JsonType::Object; }
+    bool is_array() const { return type() == JsonType::Array; }
+    bool is_string() const { return type() == JsonType::String; }
+    bool is_number() const { return type() == JsonType::Number; }
+
+    // Object member (linear scan over the members, skipping nested values).
+    JsonValue operator[](std::string_view key) const;
+    // Array element (linear skip to the index).
+    JsonValue operator[](std::size_t index) const;
+    // Elements of an array / members of an object; 0 otherwise.
+    std::size_t size() const;
+
+    // The string as a view into the text, when it needs no unescaping.
+    std::optional<std::string_view> get_string_view() const;
+    // The string, unescaped.
+    std::optional<std::string> get_string() const;
+    // The string: a view into the text when possible, otherwise unescaped into
+    // `scratch` and a view of that.
+    std::optional<std::string_view> get_string(std::string& scratch) const;
+    // Integral numbers only (no fraction/exponent, in range).
+    std::optional<std::int64_t> get_int() const;
+    std::optional<double> get_double() const;
+    std::optional<bool> get_bool() const;
+
+    // The value's JSON text, verbatim (strings without their quotes).
+    std::string_view raw() const;
+
+    // Iterates array elements or object members.
+    class Iterator {
+    public:
+        // Member name as it appears in the text (still escaped). Empty for arrays.
+        std::string_view key() const;
+        JsonValue value() const;
+        JsonValue operator*() const { return value(); }
+        Iterator& operator++();
+        bool operator==(const Iterator& o) const { return index_ == o.index_; }
+        bool operator!=(const Iterator& o) const { return index_ != o.index_; }
+
+    private:
+        friend class JsonValue;
+        Iterator(const detail::JsonNode* nodes, const char* text, std::uint32_t index, bool object)
+            : nodes_(nodes), text_(text), index_(index), object_(object) {}
+        const detail::JsonNode* nodes_;
+        const char* text_;
+        std::uint32_t index_;
+        bool object_;
+    };
+    Iterator begin() const;
+    Iterator end() const;
+
+private:
+    friend class JsonDocument;
+    JsonValue(const detail::JsonNode* nodes, const char* text, std::uint32_t index)
+        : nodes_(nodes), text_(text), index_(index) {}
+    const detail::JsonNode& node() const { return nodes_[index_]; }
+    std::string_view text_of(const detail::JsonNode& n) const { return {text_ + n.start, n.len}; }
+
+    const detail::JsonNode* nodes_ = nullptr;
+    const char* text_ = nullptr;
+    std::uint32_t index_ = 0;
+};
+
+// Zero-copy, on-demand JSON reader. Construction validates the whole text
+// (grammar, string escapes, nesting) in one pass and records a flat structural
+// index -- one small node per value, in a single vector -- instead of building a
+// DOM. The text is not copied: the document views it, so it must outlive the
+// document and every JsonValue obtained from it.
+//
+// Invalid input never throws: valid() is false, error() says why and root() is
+// an Invalid value.
+class JsonDocument {
+public:
+    static constexpr std::size_t kMaxDepth = 512;
+
+    explicit JsonDocument(std::string_view text);
+
+    bool valid() const { return error_.empty(); }
+    const std::string& error() const { return error_; }
+    JsonValue root() const;
+
+    // Append the unescaped form of a JSON string body (no quotes) to `out`.
+    // Returns false on a malformed escape.
+    static bool unescape(std::string_view raw, std::string& out);
+
+private:
+    void parse();
+    void fail(const char* what, std::size_t pos);
+
+    std::string_view text_;
+    std::vector<detail::JsonNode> nodes_;
+    std::string error_;
+};
+
+} // namespace Http
+} // namespace Oreshnek
+
+#endif // ORESHNEK_HTTP_JSONREADER_H
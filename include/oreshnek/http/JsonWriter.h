@@ -0,0 +1,96 @@
+// oreshnek/include/oreshnek/http/JsonWriter.h
+#ifndef ORESHNEK_HTTP_JSONWRITER_H
+#define ORESHNEK_HTTP_JSONWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Oreshnek {
+namespace Http {
+
+// Streaming JSON builder that appends straight into its output buffer, without
+// an intermediate DOM. Commas and the key/value separator are inserted
+// automatically; the caller only opens/closes containers and emits keys and
+// values in order:
+//
+//   JsonWriter w;
+//   w.begin_object().key("notes").begin_array();
+//   for (...) w.begin_object().member("id", id).member("title", title).end_object();
+//   w.end_array().end_object();
+//   res.json(std::move(w)); // the buffer becomes the body, no copy
+//
+// Integers and doubles are formatted with std::to_chars (doubles in shortest
+// round-trip form; NaN/Inf become null, as nlohmann::json does). Strings are
+// escaped a word at a time, copying clean runs in bulk; bytes are passed
+// through unvalidated, so callers must supply UTF-8. Misuse (a value where a key
+// is expected, unbalanced end_*) is a programming error: it throws
+// std::logic_error.
+class JsonWriter {
+public:
+    // Maximum container nesting.
+    static constexpr int kMaxDepth = 64;
+
+    JsonWriter() = default;
+    explicit JsonWriter(std::size_t reserve) { out_.reserve(reserve); }
+
+    JsonWriter& begin_object();
+    JsonWriter& end_object();
+    JsonWriter& begin_array();
+    JsonWriter& end_array();
+
+    // Object member name; must be followed by exactly one value or container.
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view s);
+    JsonWriter& value(const char* s) { return value(std::string_view(s)); }
+    JsonWriter& value(const std::string& s) { return value(std::string_view(s)); }
+    JsonWriter& value(bool b);
+    JsonWriter& value(double d);
+    JsonWriter& value(float f) { return value(static_cast<double>(f)); }
+    template <typename Int,
+              std::enable_if_t<std::is_integral_v<Int> && !std::is_same_v<Int, bool>, int> = 0>
+    JsonWriter& value(Int i) {
+        if constexpr (std::is_signed_v<Int>) return write_int(static_cast<std::int64_t>(i));
+        else return write_uint(static_cast<std::uint64_t>(i));
+    }
+    JsonWriter& null();
+    // Append an already-serialized JSON fragment as a value (not validated).
+    JsonWriter& raw(std::string_view json);
+
+    // key(name).value(v) in one call.
+    template <typename T>
+    JsonWriter& member(std::string_view name, const T& v) { return key(name).value(v); }
+
+    // True once a single top-level value has been fully written.
+    bool complete() const { return depth_ == 0 && !out_.empty(); }
+
+    const std::string& str() const { return out_; }
+    // Move the buffer out (the writer is left empty and reusable).
+    std::string take();
+
+    // Append `s` to `out` as a quoted, escaped JSON string.
+    static void append_escaped(std::string& out, std::string_view s);
+
+private:
+    JsonWriter& write_int(std::int64_t i);
+    JsonWriter& write_uint(std::uint64_t u);
+    // Separator bookkeeping before any value or container.
+    void before_value();
+    void open(char c, bool object);
+    void close(char c, bool object);
+
+    std::string out_;
+    int depth_ = 0;
+    // Per-level flags, bit `depth`: container is an object / has an element.
+    std::uint64_t is_object_ = 0;
+    std::uint64_t has_element_ = 0;
+    bool expect_value_ = false; // A key was just written.
+};
+
+} // namespace Http
+} // namespace Oreshnek
+
+#endif // ORESHNEK_HTTP_JSONWRITER_H
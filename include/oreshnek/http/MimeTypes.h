@@ -0,0 +1,17 @@
+// oreshnek/include/oreshnek/http/MimeTypes.h
+#ifndef ORESHNEK_HTTP_MIMETYPES_H
+#define ORESHNEK_HTTP_MIMETYPES_H
+
+#include <string_view>
+
+namespace Oreshnek {
+namespace Http {
+
+// Content-Type for a file name, by extension (case-insensitive). Textual types
+// carry "; charset=utf-8". Unknown extensions map to application/octet-stream.
+std::string_view mime_type(std::string_view path);
+
+} // namespace Http
+} // namespace Oreshnek
+
+#endif // ORESHNEK_HTTP_MIMETYPES_H
@@ -3,9 +3,13 @@
 #define ORESHNEK_NET_CONNECTION_H
 
 #include "oreshnek/http/HttpRequest.h"
-#include "oreshnek/http/HttpResponse.h" // Include this to get FilePath definition
+#include "oreshnek/http/HttpResponse.h"
+#include "oreshnek/http/CannedResponse.h"
+#include "oreshnek/utils/TimeUtil.h"
 #include "oreshnek/http/HttpParser.h"
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <sys/types.h> // For off_t
@@ -20,6 +24,8 @@ public:
     static constexpr size_t READ_BUFFER_SIZE = 1024 * 1024; // 1MB
     // Maximum bytes handed to a single sendfile() call.
     static constexpr size_t FILE_SEND_CHUNK = 256 * 1024;
+    // Size of each buffer an asynchronous file read fills (TLS file bodies).
+    static constexpr size_t FILE_READ_CHUNK = 64 * 1024;
 
     // Sentinel returned by read_data() when the socket has no data right now
     // (EAGAIN/EWOULDBLOCK) but is still open. Distinct from 0 (peer closed).
@@ -36,13 +42,58 @@ public:
     // In-memory string body (JSON/HTML/text). The offset avoids the O(n^2)
     // cost of erasing from the front on each partial write.
     std::string write_body_;
-    size_t write_body_offset_ = 0;
-
-    // File body served with zero-copy sendfile(). file_fd_ >= 0 when active.
-    int file_fd_ = -1;
+    size_t write_body_offset_ = 0; // Into memory_body_
+    // Body bytes written from memory: either write_body_ or (a range of) an
+    // in-memory FileEntry's body or precompressed variant, written in place
+    // while memory_owner_ keeps the entry alive.
+    std::string_view memory_body_;
+    std::shared_ptr<const Http::FileEntry> memory_owner_;
+
+    // Pre-serialized response sent by reference (no copy of its bytes); only the
+    // Date value is held per connection. Active when canned_ != nullptr.
+    const Http::CannedResponse* canned_ = nullptr;
+    std::shared_ptr<const Http::CannedResponse> canned_owner_; // Set for cached (non-registry) responses
+    size_t canned_sent_ = 0;
+    char canned_date_[Utils::kHttpDateLen] = {};
+
+    // File body served with zero-copy sendfile(). Shared with the response (and
+    // any cache) that opened it; non-null when active.
+    std::shared_ptr<const Http::FileEntry> file_;
     off_t file_offset_ = 0;    // Current offset within the file
     off_t file_remaining_ = 0; // Bytes still to send
 
+    // Multi-range (multipart/byteranges) body: pieces written in order after
+    // the headers, each loaded in turn into the state above. A piece is either
+    // in-memory bytes (part framing from segments_, or a slice of an in-memory
+    // entry) or, with `memory` empty, a region of pieces_file_ sent with
+    // sendfile.
+    struct BodyPiece {
+        std::string_view memory;
+        off_t offset = 0;
+        off_t length = 0;
+    };
+    std::vector<Http::FileSegment> segments_; // Owns the framing text
+    std::vector<BodyPiece> pieces_;
+    size_t next_piece_ = 0; // First piece not yet loaded
+    std::shared_ptr<const Http::FileEntry> pieces_file_;
+
+    // TLS file bodies with asynchronous reads (async_file_reads_): an I/O
+    // thread reads the file into one buffer while the event loop encrypts and
+    // sends the other, so the loop never blocks on the disk. While a read is in
+    // flight it owns file_buffers_[1 - file_front_] (allocated once, never
+    // resized afterwards).
+    bool async_file_reads_ = false;
+    std::vector<char> file_buffers_[2];
+    int file_front_ = 0;          // Buffer being sent
+    size_t file_front_sent_ = 0;
+    size_t file_front_len_ = 0;
+    size_t file_back_len_ = 0;    // Bytes read into the other buffer, not yet sent
+    bool file_read_pending_ = false;
+    bool file_read_discard_ = false; // The pending read belongs to a finished response
+    bool file_read_failed_ = false;
+    off_t file_read_offset_ = 0;     // Next file offset to read
+    off_t file_read_remaining_ = 0;  // Bytes of the body still to read
+
     bool head_only_ = false;   // HEAD request: emit headers, suppress body
     bool continue_sent_ = false; // "100 Continue" already sent for current request
 
@@ -93,8 +144,17 @@ public:
     // Returns bytes written, 0 if nothing to write, -1 on error.
     ssize_t write_data();
     
-    // Set the content to be written (either a string or a file path)
-    void set_response_content(const Http::HttpResponse& response); // Add Http:: prefix
+    // Set the content to be written (either a string or a file path). Takes the
+    // response by rvalue: an in-memory body is moved into write_body_, not copied.
+    void set_response_content(Http::HttpResponse&& response);
+
+    // Queue a canned response (status line, headers and body pre-serialized)
+    // with the current Date. The registry entry must outlive the write; if it
+    // asks for "Connection: close" the connection is not kept alive.
+    void set_canned_response(const Http::CannedResponse& canned, bool head_only);
+    // Same, for a response whose lifetime the connection shares (e.g. an entry
+    // of the response cache, which may be evicted mid-write).
+    void set_canned_response(std::shared_ptr<const Http::CannedResponse> canned, bool head_only);
 
     // Try to parse one complete request from the front of read_buffer_ WITHOUT
     // mutating the buffer. On success, current_request_ holds views into
@@ -136,6 +196,35 @@ public:
     
     bool is_open() const { return socket_fd_ >= 0; }
     bool has_data_to_write() const; // Check if there's any pending data (string or file)
+
+    // --- Asynchronous file reads (TLS) ----------------------------------------
+    // A read to run off the event loop: pread(file->file.fd(), buffer, length,
+    // offset). `file` keeps the descriptor open meanwhile.
+    struct FileRead {
+        std::shared_ptr<const Http::FileEntry> file;
+        char* buffer = nullptr;
+        size_t length = 0;
+        off_t offset = 0;
+    };
+    // Whether a read should be started now: a file body is being sent with
+    // async_file_reads_, bytes remain unread and the spare buffer is free.
+    bool wants_file_read() const;
+    // Claim the spare buffer for the next read.
+    FileRead begin_file_read();
+    // The read from begin_file_read() returned `n` (< 0 error, 0 unexpected EOF).
+    void end_file_read(ssize_t n);
+    // Nothing can be sent until the pending read completes.
+    bool waiting_for_file_read() const;
+
+private:
+    // write_data() for a queued canned response.
+    ssize_t write_canned();
+    // Split a multi-range response's segments into pieces and load the first.
+    void set_segments(Http::HttpResponse& response);
+    // Make the next body piece current; false when none is left.
+    bool load_next_piece();
+    // Start reading file_ afresh (async_file_reads_) from file_offset_.
+    void reset_file_reads();
 };
 
 } // namespace Net
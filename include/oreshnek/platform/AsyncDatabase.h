@@ -0,0 +1,59 @@
+// oreshnek/include/oreshnek/platform/AsyncDatabase.h
+//
+// Awaitable front for a database backend, for coroutine handlers:
+//
+//   Platform::AsyncDatabase db(manager, server.scheduler());
+//   SqlResult r = co_await db.query("SELECT * FROM videos WHERE id = ?", {id});
+//
+// The drivers are blocking (sqlite3, libpq), so each call runs on the
+// scheduler's blocking pool and the coroutine resumes on a worker with the
+// result; the worker is free while the query runs. Works with the
+// DatabaseManager and with any concrete backend (SqliteBackend, PgBackend):
+// anything with query()/exec() returning SqlResult.
+#ifndef ORESHNEK_PLATFORM_ASYNC_DATABASE_H
+#define ORESHNEK_PLATFORM_ASYNC_DATABASE_H
+
+#include "oreshnek/platform/SqlResult.h"
+#include "oreshnek/server/CoroutineScheduler.h"
+#include "oreshnek/server/Task.h"
+
+#include <concepts>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace Oreshnek {
+namespace Platform {
+
+template <typename Db>
+concept QueryableDatabase = requires(Db& db, std::string_view sql, const SqlParams& params) {
+    { db.query(sql, params) } -> std::same_as<SqlResult>;
+    { db.exec(sql, params) } -> std::same_as<SqlResult>;
+};
+
+template <QueryableDatabase Db>
+class AsyncDatabase {
+public:
+    // Both must outlive this object and the queries started through it.
+    AsyncDatabase(Db& db, Server::CoroutineScheduler& scheduler) : db_(db), scheduler_(scheduler) {}
+
+    // The statement and its parameters are copied into the coroutine frame:
+    // the caller's buffers may be gone by the time the blocking pool runs it.
+    Server::Task<SqlResult> query(std::string sql, SqlParams params = {}) {
+        auto call = scheduler_.offload([&] { return db_.query(sql, params); });
+        co_return co_await call;
+    }
+    Server::Task<SqlResult> exec(std::string sql, SqlParams params = {}) {
+        auto call = scheduler_.offload([&] { return db_.exec(sql, params); });
+        co_return co_await call;
+    }
+
+private:
+    Db& db_;
+    Server::CoroutineScheduler& scheduler_;
+};
+
+}  // namespace Platform
+}  // namespace Oreshnek
+
+#endif  // ORESHNEK_PLATFORM_ASYNC_DATABASE_H
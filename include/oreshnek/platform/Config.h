@@ -40,6 +40,9 @@ struct TlsConfig {
     std::string cert_file;            // PEM certificate (chain), prefer ORESHNEK_TLS_CERT
     std::string key_file;             // PEM private key, prefer ORESHNEK_TLS_KEY
     std::string min_version = "1.2";  // "1.2" | "1.3"
+    // Threads reading file bodies off the event loop (sendfile() cannot
+    // encrypt); 0 reads them on the event loop.
+    int io_threads = 2;
 };
 
 // Per-IP token-bucket rate limiting. Enabled by default (secure-by-default): a
@@ -63,7 +66,48 @@ struct MetricsConfig {
 struct CompressionConfig {
     bool enabled = true;
     std::size_t min_bytes = 256; // smaller bodies are not worth compressing
-    bool brotli = true;          // prefer brotli when the client accepts it
+    bool brotli = true;          // offer brotli when the client accepts it
+    bool zstd = true;            // offer zstd (preferred over brotli) when compiled in
+    // Bytes of compressed bodies cached by content, so identical responses are
+    // compressed once (0 disables the cache).
+    std::size_t cache_bytes = 16 * 1024 * 1024;
+    // Adapt levels to load: higher when idle, fastest when busy, large bodies
+    // uncompressed when saturated. false keeps the fixed default levels.
+    bool adaptive = true;
+};
+
+// Shared cache for GET responses whose handler sets Cache-Control: max-age
+// (stale-while-revalidate honoured). Hits are answered by the event loop.
+struct ResponseCacheConfig {
+    bool enabled = false;
+    std::size_t max_bytes = 32 * 1024 * 1024; // Total budget (headers + bodies)
+    std::size_t max_entry = 1024 * 1024;      // Larger responses are not cached
+};
+
+// Page-cache hints for files streamed sequentially (video Range requests):
+// prefetch ahead of the sender, drop what large long-tail files left behind.
+struct FileReadaheadConfig {
+    bool enabled = true;
+    std::size_t window = 2 * 1024 * 1024;                 // Bytes prefetched ahead
+    std::size_t drop_behind_min_bytes = 64 * 1024 * 1024; // 0: never drop
+};
+
+// Live HLS origin for the directory a packager writes into: playlists served
+// from memory and reloaded on change, LL-HLS blocking playlist reloads.
+struct HlsConfig {
+    bool enabled = false;
+    std::string prefix = "/hls";
+    std::string dir = "./hls/";
+};
+
+// Bulkhead for the database routes (/api/notes): their own workers and queue,
+// so a slow database cannot take the workers every other route needs.
+struct DbBulkheadConfig {
+    bool enabled = false;
+    std::size_t threads = 4;
+    std::size_t max_queue = 64;       // Requests waiting for a worker
+    std::string shed = "reject";      // reject | drop_oldest (when the queue is full)
+    int max_queue_wait_ms = 0;        // Queued longer -> 503 (0: no limit)
 };
 
 // Runtime configuration, loadable from an external JSON file (see Config::load).
@@ -109,6 +153,24 @@ struct ServerConfig {
     // Response compression.
     CompressionConfig compression;
 
+    // Response cache.
+    ResponseCacheConfig response_cache;
+
+    // Readahead for sequential file streams.
+    FileReadaheadConfig file_readahead;
+
+    // LL-HLS origin.
+    HlsConfig hls;
+
+    // Worker pool isolating the database routes.
+    DbBulkheadConfig db_bulkhead;
+
+    // Serve MessagePack/CBOR instead of JSON to clients that prefer it (Accept).
+    bool binary_json = true;
+
+    // Hash-based ETag / 304 for in-memory responses.
+    bool auto_etag = false;
+
     // CORS (applied by the built-in CORS middleware when enabled).
     bool cors_enabled = false;
     std::string cors_allow_origin = "*";
@@ -0,0 +1,109 @@
+// oreshnek/include/oreshnek/server/Bulkhead.h
+#ifndef ORESHNEK_SERVER_BULKHEAD_H
+#define ORESHNEK_SERVER_BULKHEAD_H
+
+#include "oreshnek/server/Metrics.h"
+#include "oreshnek/server/Router.h"
+#include "oreshnek/server/WorkStealingPool.h"
+#include "oreshnek/http/HttpResponse.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Oreshnek {
+namespace Net { class Connection; }
+namespace Http { class HttpRequest; }
+
+namespace Server {
+
+// What a full bulkhead does with one more request.
+enum class ShedPolicy {
+    RejectNew,  // 503 to the newcomer; the queue keeps its order
+    DropOldest, // 503 to the longest-waiting request; the newcomer takes its place
+};
+
+struct BulkheadOptions {
+    std::size_t threads = 4;
+    // Requests waiting for one of the pool's workers; 0 = none (reject as
+    // soon as every worker is busy).
+    std::size_t max_queue = 64;
+    ShedPolicy shed = ShedPolicy::RejectNew;
+    // A request queued longer than this gets a 503 instead of a worker
+    // (0 = no limit; handler_timeout still bounds it).
+    std::chrono::milliseconds max_queue_wait{0};
+};
+
+// A named worker pool isolating some routes from the rest (RouteOptions::pool):
+// a slow database endpoint can exhaust its bulkhead's workers and queue, never
+// the default pool's. At most `threads` handlers are posted to the pool at a
+// time; further requests wait in the bulkhead's queue, on the event loop and
+// without a worker, and past `max_queue` the shed policy answers one of them
+// 503. Counters and latency go to its Metrics::PoolStats.
+//
+// The queue belongs to the event loop; the pool's workers only update the
+// stats (see Server::dispatch_to_worker).
+class Bulkhead {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // A request admitted to the queue.
+    struct Pending {
+        int fd;
+        std::shared_ptr<Net::Connection> conn;
+        std::shared_ptr<Http::HttpRequest> request;
+        const RouteHandler* route; // Matched by the event loop
+        std::uint64_t flight;      // Single-flight id it leads, or 0
+        Clock::time_point admitted_at;
+    };
+
+    enum class Admission { Run, Queued, Shed };
+
+    Bulkhead(std::string name, BulkheadOptions options, Metrics::PoolStats& stats);
+
+    const std::string& name() const { return name_; }
+    const BulkheadOptions& options() const { return options_; }
+    Metrics::PoolStats& stats() { return stats_; }
+    WorkStealingPool& pool() { return pool_; }
+    // The response pool of worker `index` (WorkStealingPool::current_worker_index()).
+    Http::HttpResponsePool& response_pool(int index);
+
+    // --- Event loop --------------------------------------------------------------
+    // Decide for a new request: Run (post it now; counted as admitted), Queued
+    // (moved into the queue) or Shed (answer it 503). With DropOldest a full
+    // queue evicts its head into `evicted` and queues the newcomer.
+    Admission admit(Pending& pending, std::optional<Pending>& evicted);
+    // Admit background work (a cache refresh) only if a worker is free and
+    // nothing is queued: it never waits and is never shed. Counted as admitted.
+    bool try_admit();
+    // The next queued request that may run now (counted as admitted), if a
+    // worker is free; those that waited past max_queue_wait go to `expired`.
+    std::optional<Pending> next(Clock::time_point now, std::vector<Pending>& expired);
+    // Move the requests that waited past max_queue_wait to `expired`.
+    void expire(Clock::time_point now, std::vector<Pending>& expired);
+    std::size_t queued() const { return queue_.size(); }
+    // Any thread: whether requests are waiting for a worker.
+    bool has_waiting() const { return stats_.waiting.load(std::memory_order_acquire) > 0; }
+
+    void shutdown() { pool_.shutdown(); }
+
+private:
+    bool can_run() const;
+    bool waited_too_long(const Pending& pending, Clock::time_point now) const;
+
+    const std::string name_;
+    const BulkheadOptions options_;
+    Metrics::PoolStats& stats_;
+    std::deque<Pending> queue_;
+    std::vector<std::unique_ptr<Http::HttpResponsePool>> response_pools_;
+    WorkStealingPool pool_; // Last: joined before the rest is destroyed
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_BULKHEAD_H
@@ -0,0 +1,109 @@
+// oreshnek/include/oreshnek/server/CompressionCache.h
+#ifndef ORESHNEK_SERVER_COMPRESSIONCACHE_H
+#define ORESHNEK_SERVER_COMPRESSIONCACHE_H
+
+#include "oreshnek/http/Compression.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Oreshnek {
+namespace Server {
+
+class Metrics;
+
+struct CompressionCacheOptions {
+    // Total bytes held (original + compressed bodies), split evenly across the
+    // shards; least recently used entries are evicted to stay under it.
+    std::size_t max_bytes = 16 * 1024 * 1024;
+    // Bodies larger than this are never cached (nor larger than a shard's share
+    // of max_bytes).
+    std::size_t max_body = 256 * 1024;
+    // Independent LRUs, each with its own lock, selected by body hash.
+    std::size_t shards = 16;
+    // Cache a body only the second time it is compressed, so one-off bodies
+    // (per-user responses, search results) do not churn out the hot ones.
+    bool admit_on_repeat = true;
+};
+
+// Compressed-response cache: maps (body hash, coding, level) to the encoded
+// bytes, so identical response bodies (a hot list endpoint, a manifest) are
+// compressed once instead of on every request. Each entry keeps a copy of the
+// original body and a hit requires a byte-exact match, so a hash collision is a
+// miss, never a wrong response. Thread-safe; a lookup takes one shard lock.
+//
+// Metrics: hits / misses / evictions, the bytes held, and the compression time
+// the hits saved (each entry remembers what compressing it cost).
+class CompressionCache {
+public:
+    explicit CompressionCache(CompressionCacheOptions options = {}, Metrics* metrics = nullptr);
+    ~CompressionCache();
+    CompressionCache(const CompressionCache&) = delete;
+    CompressionCache& operator=(const CompressionCache&) = delete;
+
+    // On a hit, replace `out` with the cached encoding of `body` (keeping its
+    // capacity) and return true.
+    bool find(Http::Encoding encoding, int level, std::string_view body, std::string& out);
+    // Offer the result of compressing `body`; `cost` is how long that took.
+    void insert(Http::Encoding encoding, int level, std::string_view body, std::string_view compressed,
+                std::chrono::nanoseconds cost);
+
+    // Drop every entry.
+    void clear();
+    // Entries currently cached.
+    std::size_t size() const;
+    // Bytes held by all entries.
+    std::size_t memory_bytes() const;
+    const CompressionCacheOptions& options() const { return options_; }
+
+private:
+    struct Key {
+        std::size_t hash;
+        Http::Encoding encoding;
+        int level;
+        bool operator==(const Key& other) const {
+            return hash == other.hash && encoding == other.encoding && level == other.level;
+        }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const {
+            return key.hash ^ (static_cast<std::size_t>(key.encoding) << 8) ^ static_cast<std::size_t>(key.level);
+        }
+    };
+    struct Node {
+        Key key;
+        std::string body;
+        std::string compressed;
+        std::uint64_t cost_ns = 0;
+        std::size_t bytes = 0;
+    };
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Node> lru; // Most recently used first
+        std::unordered_map<Key, std::list<Node>::iterator, KeyHash> index;
+        std::unordered_set<std::size_t> seen; // Admission doorkeeper (hashes compressed once)
+        std::size_t bytes = 0;
+    };
+
+    Shard& shard_for(std::size_t hash) { return *shards_[(hash >> 7) % shards_.size()]; }
+    void erase(Shard& shard, std::list<Node>::iterator it);
+    void publish(std::int64_t delta);
+
+    CompressionCacheOptions options_;
+    Metrics* metrics_;
+    std::size_t shard_budget_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_COMPRESSIONCACHE_H
@@ -0,0 +1,87 @@
+// oreshnek/include/oreshnek/server/CompressionController.h
+#ifndef ORESHNEK_SERVER_COMPRESSIONCONTROLLER_H
+#define ORESHNEK_SERVER_COMPRESSIONCONTROLLER_H
+
+#include "oreshnek/http/Compression.h"
+#include "oreshnek/server/Metrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Oreshnek {
+namespace Server {
+
+class WorkStealingPool;
+
+// How hard the server is working, from the compressor's point of view.
+enum class CompressionTier {
+    Idle,      // Spare CPU: spend it on smaller payloads (gzip 9, brotli 7, zstd 9)
+    Normal,    // Default levels (gzip 6, brotli 5, zstd 3)
+    Busy,      // Fastest levels (1)
+    Saturated, // Fastest levels, and bodies over saturated_max_body go uncompressed
+};
+
+struct CompressionControllerOptions {
+    // How often the tier is re-evaluated.
+    std::chrono::milliseconds interval{100};
+    // Load = (handlers running + queued tasks) / worker threads, all of the
+    // watched pool (the default one; bulkheads are not counted). Below
+    // idle_load the tier is Idle, from busy_load Busy, from saturated_load
+    // Saturated (work is queueing behind every worker).
+    double idle_load = 0.25;
+    double busy_load = 0.75;
+    double saturated_load = 1.0;
+    // Share of the pool's time spent compressing over the last interval above
+    // which the tier is raised one step regardless of load.
+    double max_cpu_share = 0.25;
+    // In the Saturated tier, larger bodies are sent uncompressed.
+    std::size_t saturated_max_body = 64 * 1024;
+};
+
+// Adaptive compression level. Workers ask it for a level before compressing and
+// report how long compressing took; every `interval` one of them re-evaluates
+// the tier from the pool's handlers running (its Metrics::PoolStats), its queue
+// depth and the recent compression time. Raising the tier (more load) happens
+// at once; lowering it goes one step per interval, so a short lull does not
+// flip straight to the slowest levels. Lock-free; the chosen tier and levels
+// are published in Metrics.
+class CompressionController {
+public:
+    // `pool` and `stats` describe the same pool.
+    CompressionController(CompressionControllerOptions options, const WorkStealingPool& pool,
+                          const Metrics::PoolStats& stats, Metrics& metrics);
+
+    // Level to compress `size` bytes with `encoding` at, or -1 to send the
+    // body uncompressed.
+    int level(Http::Encoding encoding, std::size_t size);
+    // Account one compression that took `cost`.
+    void record(std::chrono::nanoseconds cost);
+
+    CompressionTier tier() const { return static_cast<CompressionTier>(tier_.load(std::memory_order_relaxed)); }
+    const CompressionControllerOptions& options() const { return options_; }
+
+    // Tier wanted for a given load and compression CPU share, starting from
+    // `current` (pure; exposed for tests).
+    CompressionTier target(double load, double cpu_share, CompressionTier current) const;
+    // Level of `encoding` in `tier`.
+    static int level_for(CompressionTier tier, Http::Encoding encoding);
+
+private:
+    void update(std::int64_t now_ns);
+    void publish(CompressionTier tier);
+
+    CompressionControllerOptions options_;
+    const WorkStealingPool& pool_;
+    const Metrics::PoolStats& stats_;
+    Metrics& metrics_;
+    std::atomic<int> tier_;
+    std::atomic<std::int64_t> next_update_ns_;
+    std::atomic<std::int64_t> window_start_ns_;
+    std::atomic<std::uint64_t> window_cost_ns_{0}; // Compression time since window_start_ns_
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_COMPRESSIONCONTROLLER_H
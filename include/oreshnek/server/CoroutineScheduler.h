@@ -0,0 +1,172 @@
+// oreshnek/include/oreshnek/server/CoroutineScheduler.h
+#ifndef ORESHNEK_SERVER_COROUTINESCHEDULER_H
+#define ORESHNEK_SERVER_COROUTINESCHEDULER_H
+
+#include "oreshnek/server/Task.h"
+#include "oreshnek/server/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Oreshnek {
+namespace Server {
+
+class Bulkhead;
+class Metrics;
+
+// Suspension points for coroutine handlers (Server::get() with a handler
+// returning Task<void>). A coroutine that awaits one of these gives its worker
+// back; the event loop resumes it on a worker once the wait is over:
+//
+//   co_await server.scheduler().sleep_for(std::chrono::milliseconds(50));
+//   SqlResult r = co_await server.scheduler().offload([&] { return db.query(sql); });
+//   std::optional<std::string> body = co_await server.scheduler().read_file(path);
+//
+// Timers live in the event loop (its wait is bounded by the next deadline).
+// Blocking calls — a database query, a file read, a synchronous client — run
+// on a separate blocking pool, sized for I/O rather than CPU, so a handful of
+// workers serve many requests parked on slow backends; when one finishes, its
+// coroutine is queued for the event loop, which posts the resumption to a
+// worker of the pool the coroutine was running on (its route's bulkhead, or
+// the default pool). Awaitables are thread-safe; take_ready() and wait_time()
+// belong to the event loop.
+class CoroutineScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // `wake` interrupts the event loop's wait (the Server's wakeup pipe).
+    CoroutineScheduler(std::function<void()> wake, std::size_t blocking_threads, Metrics* metrics = nullptr);
+    ~CoroutineScheduler();
+    CoroutineScheduler(const CoroutineScheduler&) = delete;
+    CoroutineScheduler& operator=(const CoroutineScheduler&) = delete;
+
+    // The bulkhead whose coroutine runs on this thread (null: the default
+    // pool), for the duration of a scope. The Server opens one around every
+    // start and resumption; a suspension records it, to resume there.
+    class PoolScope {
+    public:
+        explicit PoolScope(Bulkhead* bulkhead);
+        ~PoolScope();
+        PoolScope(const PoolScope&) = delete;
+        PoolScope& operator=(const PoolScope&) = delete;
+
+    private:
+        Bulkhead* previous_;
+    };
+    static Bulkhead* current_bulkhead();
+
+    // A coroutine to resume, and the bulkhead it runs on (null: the default pool).
+    struct Resumption {
+        std::coroutine_handle<> handle;
+        Bulkhead* bulkhead;
+    };
+
+    // --- Awaitables --------------------------------------------------------------
+    struct SleepAwaiter {
+        CoroutineScheduler* scheduler;
+        Clock::time_point deadline;
+        bool await_ready() const noexcept { return deadline <= Clock::now(); }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler->add_timer(deadline, handle); }
+        void await_resume() const noexcept {}
+    };
+    SleepAwaiter sleep_until(Clock::time_point deadline) { return SleepAwaiter{this, deadline}; }
+    SleepAwaiter sleep_for(Clock::duration delay) { return SleepAwaiter{this, Clock::now() + delay}; }
+
+    // Run `fn` on the blocking pool; the awaiting coroutine resumes (on a
+    // worker) with its result, or its exception. With GCC 12, bind the awaiter
+    // to a local (`auto call = offload(...); co_await call;`) when `fn` captures
+    // non-trivial values: it destroys closure temporaries of a co_await twice.
+    template <typename F>
+    struct OffloadAwaiter {
+        using Result = std::invoke_result_t<F&>;
+        using Stored = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+
+        CoroutineScheduler* scheduler;
+        F fn;
+        std::optional<Stored> result;
+        std::exception_ptr error;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            // The coroutine may be resumed (and this awaiter's frame reused)
+            // before run_blocking() returns: nothing touches `this` after it.
+            scheduler->run_blocking([this, handle, bulkhead = current_bulkhead()] {
+                try {
+                    if constexpr (std::is_void_v<Result>) {
+                        fn();
+                        result.emplace(true);
+                    } else {
+                        result.emplace(fn());
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                scheduler->ready(handle, bulkhead);
+            });
+        }
+        Result await_resume() {
+            if (error) std::rethrow_exception(error);
+            if constexpr (!std::is_void_v<Result>) return std::move(*result);
+        }
+    };
+    template <typename F>
+    OffloadAwaiter<std::decay_t<F>> offload(F&& fn) {
+        return OffloadAwaiter<std::decay_t<F>>{this, std::forward<F>(fn), std::nullopt, nullptr};
+    }
+
+    // The whole file at `path` (nullopt if it cannot be opened or read), read
+    // on the blocking pool.
+    Task<std::optional<std::string>> read_file(std::string path);
+
+    // --- Event loop --------------------------------------------------------------
+    // Move the coroutines to resume now (due timers, finished offloads) to `out`.
+    void take_ready(Clock::time_point now, std::vector<Resumption>& out);
+    // How long the event loop may wait: until the next timer, at most `max`.
+    std::chrono::milliseconds wait_time(Clock::time_point now, std::chrono::milliseconds max) const;
+    // True when no coroutine is waiting on a timer or queued to resume.
+    bool idle() const { return pending_.load(std::memory_order_acquire) == 0; }
+    // Join the blocking pool. Coroutines still suspended are abandoned.
+    void shutdown();
+
+    // Used by the awaiters (any thread). add_timer() is called by the
+    // suspending coroutine and resumes it on current_bulkhead().
+    void add_timer(Clock::time_point deadline, std::coroutine_handle<> handle);
+    void ready(std::coroutine_handle<> handle, Bulkhead* bulkhead);
+    void run_blocking(std::function<void()> job);
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        std::uint64_t sequence; // FIFO among equal deadlines
+        std::coroutine_handle<> handle;
+        Bulkhead* bulkhead;
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    std::function<void()> wake_;
+    Metrics* metrics_;
+    mutable std::mutex mutex_; // Guards timers_, ready_, sequence_
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+    std::vector<Resumption> ready_;
+    std::uint64_t sequence_ = 0;
+    std::atomic<std::size_t> pending_{0}; // timers_ + ready_
+    ThreadPool blocking_;
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_COROUTINESCHEDULER_H
@@ -0,0 +1,71 @@
+// oreshnek/include/oreshnek/server/DeferredResponse.h
+#ifndef ORESHNEK_SERVER_DEFERREDRESPONSE_H
+#define ORESHNEK_SERVER_DEFERREDRESPONSE_H
+
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+#include "oreshnek/net/Connection.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace Oreshnek {
+namespace Server {
+
+class Bulkhead;
+class Server;
+
+// Completion handle for a response a handler did not produce before returning
+// (Server::defer()): a long-poll, a reply that arrives from a downstream, a
+// throttled queue. The worker is released as soon as the handler returns; any
+// thread later fills the response through complete(), which queues it for the
+// event loop like a worker's. Until then the request counts against
+// handler_timeout_sec (504 and close, as for a slow handler) but not against
+// workers_in_flight / max_concurrent_handlers.
+//
+// Copyable; all copies refer to the same response. Complete before the Server
+// is destroyed. If the last copy goes away without complete(), the client gets
+// a 500 rather than waiting for the timeout.
+class DeferredResponse {
+public:
+    DeferredResponse() = default;
+
+    // Fill the response with `fill` (on the calling thread; an exception it
+    // throws becomes a 500) and send it. Thread-safe; only the first call
+    // counts: false if the response was already completed. A response
+    // completed after its connection timed out or closed is dropped.
+    bool complete(const std::function<void(Http::HttpResponse&)>& fill);
+
+    // The deferred request (owning copy; valid as long as this handle).
+    const Http::HttpRequest& request() const { return *state_->request; }
+    bool completed() const { return state_->done.load(std::memory_order_acquire); }
+    explicit operator bool() const { return state_ != nullptr; }
+
+    // What a deferred request needs to be answered later (built by Server::defer()).
+    struct State {
+        Server* server = nullptr;
+        int fd = -1;
+        std::shared_ptr<Net::Connection> conn;
+        std::shared_ptr<Http::HttpRequest> request;
+        Http::HttpResponsePool::Handle response; // The handler's, as of defer(); filled by complete()
+        std::chrono::steady_clock::time_point start;
+        std::uint64_t flight = 0; // Single-flight the request leads (0 if none)
+        Bulkhead* bulkhead = nullptr; // Pool the handler ran on (null: the default pool)
+        bool revalidation = false;    // A response-cache refresh: goes to the cache, not a connection
+        std::atomic<bool> done{false};
+        ~State();
+    };
+
+private:
+    friend class Server;
+    explicit DeferredResponse(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_DEFERREDRESPONSE_H
@@ -0,0 +1,200 @@
+// oreshnek/include/oreshnek/server/FileCache.h
+#ifndef ORESHNEK_SERVER_FILECACHE_H
+#define ORESHNEK_SERVER_FILECACHE_H
+
+#include "oreshnek/http/FileEntry.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Oreshnek {
+namespace Server {
+
+class Metrics;
+
+// Outcome of resolving a file (cached alongside the open file).
+enum class StaticLookup {
+    Found,
+    NotFound,   // Missing, not a regular file, or a hidden dotfile
+    Forbidden,  // "..", a symlink, or an attempt to leave the root
+    Directory,  // A directory requested without a trailing '/'
+};
+
+struct FileCacheOptions {
+    // Entries kept (LRU). Each found file holds its descriptor open while
+    // cached, so keep this well under RLIMIT_NOFILE. 0 disables caching.
+    std::size_t max_entries = 1024;
+    // Lifetime of a found file when its directory could not be watched (no
+    // inotify: macOS, watch limit reached). Bounds how stale a response can be.
+    std::chrono::milliseconds ttl{2000};
+    // Lifetime when the directory is watched with inotify: changes drop the
+    // entry within `inotify_poll`, so this is only a backstop.
+    std::chrono::milliseconds watched_ttl{60000};
+    // Lifetime of a negative result (404 / 403 / redirect).
+    std::chrono::milliseconds negative_ttl{1000};
+    // How often lookups drain pending inotify events (0: on every lookup).
+    std::chrono::milliseconds inotify_poll{50};
+    bool inotify = true;
+    // Files up to this size are held in memory (with precompressed gzip /
+    // brotli variants for textual types) and written from there instead of
+    // with sendfile(). 0 disables it.
+    std::size_t memory_max_file = 64 * 1024;
+    // Total bytes of in-memory copies; least recently used entries are evicted
+    // to stay under it.
+    std::size_t memory_budget = 32 * 1024 * 1024;
+};
+
+// Bounded cache of open files and their metadata, keyed by path, so a repeat
+// file response costs no open()/fstat() and no ETag / Last-Modified formatting.
+// Negative results are cached too (briefly), so a burst of requests for a
+// missing file does not hit the filesystem each time. Small files are kept in
+// memory (see FileCacheOptions::memory_max_file) within a byte budget.
+//
+// Invalidation: on Linux the directory of every cached file is watched with
+// inotify (one watch per directory, removed with its last entry) and pending
+// events are drained by lookups at most every `inotify_poll`; a write, rename, delete or attribute change of
+// a name in the directory drops the entries that depend on that name (a file
+// being written next to cached ones leaves them alone), and a change to the
+// directory itself drops all of them. The watch is added before the loader
+// reads the file, so a change during the load is not missed. Elsewhere, or
+// when a watch cannot be added, entries simply expire after `ttl`. A file
+// replaced by rename is therefore picked up promptly; a descriptor for the old
+// inode stays valid for responses already streaming it. Thread-safe; lookups
+// take one short lock.
+class FileCache {
+    struct Flight; // A load in progress (below)
+
+public:
+    struct Result {
+        StaticLookup status = StaticLookup::NotFound;
+        std::shared_ptr<const Http::FileEntry> file; // Set when Found
+    };
+
+    // Handed to a loader, which calls add() before it opens anything.
+    class Watch {
+    public:
+        Watch() = default; // Watches nothing (an uncached lookup)
+        // Watch `dir` (absolute) from now on: a change to `name` in it, or to
+        // a name extending it ("app.js.gz" for "app.js"), invalidates the
+        // result, even one that lands before it is cached. An empty `name`:
+        // any change in the directory. A later call replaces the earlier one.
+        void add(const std::string& dir, std::string name = {});
+
+    private:
+        friend class FileCache;
+        Watch(FileCache* cache, Flight* flight) : cache_(cache), flight_(flight) {}
+        FileCache* cache_ = nullptr;
+        Flight* flight_ = nullptr;
+    };
+
+    explicit FileCache(FileCacheOptions options = {}, Metrics* metrics = nullptr);
+    ~FileCache();
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    // Cached result for `key`, or `load(watch)` on a miss (called without the
+    // lock). The loader returns the Result to cache; before reading anything
+    // it may name what invalidates it with watch.add() (without, TTL only).
+    // Loads are single-flight per key: concurrent misses wait for the one
+    // load in progress (which may read and compress the file) and share its
+    // result.
+    template <typename Load>
+    Result get(std::string_view key, Load&& load) {
+        Result result;
+        std::shared_ptr<Flight> flight;
+        if (find(key, result, flight)) return result;
+        Watch watch(this, flight.get());
+        try {
+            result = load(watch);
+        } catch (...) {
+            abandon(key, flight);
+            throw;
+        }
+        insert(key, result, flight);
+        return result;
+    }
+
+    // Open `path` through the cache (Content-Type from its extension). Returns
+    // nullptr if it is missing or not a regular file. For handlers serving
+    // files by path, e.g. res.file(cache.open(path)).
+    std::shared_ptr<const Http::FileEntry> open(const std::string& path);
+
+    // Drop every entry.
+    void clear();
+    // Entries currently cached.
+    std::size_t size() const;
+    // Bytes held by in-memory entries.
+    std::size_t memory_bytes() const;
+    // Directories currently watched with inotify.
+    std::size_t watches() const;
+    const FileCacheOptions& options() const { return options_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Node {
+        std::string key;
+        Result result;
+        Clock::time_point expires;
+        int watch = -1; // inotify watch descriptor covering the entry, -1 if none
+        std::string watch_name; // The name in the watched directory it depends on
+        std::size_t bytes = 0; // In-memory copy, counted against memory_budget
+    };
+    // A load in progress; waiters block on flight_cv_ until `done`.
+    struct Flight {
+        Result result;
+        bool done = false;
+        bool failed = false; // The loader threw: waiters retry the lookup
+        int watch = -1;      // Watch::add(), as for Node
+        std::string watch_name;
+        bool stale = false;  // Changed during the load: not cached
+    };
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+
+    // On a miss with no load in progress, registers `flight` for the caller to
+    // complete with insert() (or abandon()) and returns false.
+    bool find(std::string_view key, Result& out, std::shared_ptr<Flight>& flight);
+    void insert(std::string_view key, const Result& result, const std::shared_ptr<Flight>& flight);
+    void watch(Flight& flight, const std::string& dir, std::string name);
+    void abandon(std::string_view key, const std::shared_ptr<Flight>& flight);
+    void land_locked(std::string_view key, Flight& flight);
+    void erase(std::list<Node>::iterator it);
+    void drain_events(Clock::time_point now);
+    // Watch descriptor for `dir`, adding a watch or a user to it (-1: none).
+    int watch_locked(const std::string& dir);
+    // Drop one user of watch `wd`; the last one removes the watch.
+    void unwatch_locked(int wd);
+    void publish_memory();
+
+    FileCacheOptions options_;
+    Metrics* metrics_;
+    mutable std::mutex mutex_;
+    std::list<Node> lru_; // Most recently used first
+    std::unordered_map<std::string, std::list<Node>::iterator, KeyHash, std::equal_to<>> index_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>, KeyHash, std::equal_to<>> flights_;
+    std::condition_variable flight_cv_;
+    std::size_t memory_bytes_ = 0;
+    std::size_t published_bytes_ = 0; // Last value added to Metrics::file_cache_memory_bytes
+    // inotify state (Linux). inotify_fd_ < 0 when unavailable.
+    int inotify_fd_ = -1;
+    struct DirWatch {
+        std::string dir;
+        std::size_t users = 0; // Entries and loads depending on it
+    };
+    std::unordered_map<std::string, int> watches_;  // Directory -> watch descriptor
+    std::unordered_map<int, DirWatch> watch_users_; // Watch descriptor -> directory, users
+    Clock::time_point next_poll_{};
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_FILECACHE_H
@@ -0,0 +1,89 @@
+// oreshnek/include/oreshnek/server/FileReadahead.h
+#ifndef ORESHNEK_SERVER_FILEREADAHEAD_H
+#define ORESHNEK_SERVER_FILEREADAHEAD_H
+
+#include "oreshnek/http/FileEntry.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <sys/types.h> // For off_t
+
+namespace Oreshnek {
+namespace Server {
+
+class Metrics;
+
+struct FileReadaheadOptions {
+    // Bytes prefetched ahead of the position being sent (and past the end of
+    // the current range, where the next one is expected to start).
+    std::size_t window = 2 * 1024 * 1024;
+    // Consecutive ranges of the same file on one connection, each starting
+    // where the previous one ended (within `slack`), before it is treated as
+    // sequential playback. A single body longer than 4 windows is sequential
+    // from its first byte.
+    int sequential_after = 2;
+    std::size_t slack = 256 * 1024;
+    // Files at least this large, streamed by one connection only, have the
+    // pages already sent (a window behind) dropped from the page cache, so a
+    // long-tail video played once does not evict hot files. 0: never drop.
+    std::size_t drop_behind_min_bytes = 64 * 1024 * 1024;
+};
+
+// Page-cache hints for file bodies served by sendfile() (or pread() over TLS).
+// Open files are shared across connections (FileCache), and so is the kernel's
+// per-file readahead state: interleaved viewers of the same video look random
+// to it and each range starts cold. This tracks the access pattern per
+// connection instead and, once it is sequential, keeps a window ahead of the
+// sender prefetched with posix_fadvise(WILLNEED) (which starts the reads
+// asynchronously) and, for large files nobody else is streaming, drops the
+// pages behind it with FADV_DONTNEED.
+//
+// A file is identified by device and inode, so entries opened separately for
+// each request (HttpResponse::file(path)) are one stream as well as those
+// shared by a FileCache. In-memory entries and multi-range bodies are not
+// tracked. Linux only (no-op elsewhere). Event-loop only (no locking).
+class FileReadahead {
+public:
+    explicit FileReadahead(FileReadaheadOptions options = {}, Metrics* metrics = nullptr);
+
+    // A file body of `length` bytes from `offset` of `entry` starts on the
+    // connection with socket `fd`.
+    void start(int fd, const std::shared_ptr<const Http::FileEntry>& entry, off_t offset, off_t length);
+    // The body on `fd` has been sent up to `offset`: extend the prefetched
+    // window and drop what is behind.
+    void advance(int fd, off_t offset);
+    // The connection on `fd` is closed.
+    void forget(int fd);
+
+    // Connections currently streaming sequentially.
+    std::size_t sequential() const;
+    const FileReadaheadOptions& options() const { return options_; }
+
+private:
+    struct Stream {
+        std::shared_ptr<const Http::FileEntry> entry;
+        off_t first = 0;      // Start of the current body
+        off_t end = 0;        // End of the current body
+        int run = 0;          // Consecutive ranges continuing the previous one
+        bool sequential = false;
+        off_t hinted_to = 0;  // Prefetched up to here
+        off_t dropped_to = 0; // Dropped from the page cache up to here
+    };
+
+    void release(Stream& stream);
+
+    FileReadaheadOptions options_;
+    Metrics* metrics_;
+    std::unordered_map<int, Stream> streams_; // By connection fd
+    // Sequential streams per file, by (device, inode): drop-behind only when
+    // there is one.
+    std::map<std::pair<uint64_t, uint64_t>, int> readers_;
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_FILEREADAHEAD_H
@@ -0,0 +1,184 @@
+// oreshnek/include/oreshnek/server/HlsOrigin.h
+#ifndef ORESHNEK_SERVER_HLSORIGIN_H
+#define ORESHNEK_SERVER_HLSORIGIN_H
+
+#include "oreshnek/http/FileEntry.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+#include "oreshnek/net/Connection.h"
+#include "oreshnek/server/Router.h"
+#include "oreshnek/server/StaticFiles.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Oreshnek {
+namespace Server {
+
+class Metrics;
+
+// Options for Server::mount_hls().
+struct HlsOptions {
+    // Cache-Control of a playlist, and of the answer to a blocking reload
+    // (which names a playlist state that never goes away, so it may be cached).
+    std::string playlist_cache_control = "no-cache";
+    std::string blocking_cache_control = "public, max-age=30";
+    // Cache-Control of segments, partial segments and init sections.
+    std::string segment_cache_control = "public, max-age=86400";
+    // Segments and parts up to this size are served from memory, within
+    // `memory_budget` bytes (see FileCacheOptions).
+    std::size_t memory_max_file = 4 * 1024 * 1024;
+    std::size_t memory_budget = 256 * 1024 * 1024;
+    // Longest a blocking reload waits before a 503; 0: three target durations,
+    // as LL-HLS recommends.
+    std::chrono::milliseconds block_timeout{0};
+    // Larger playlists are not loaded.
+    std::size_t max_playlist = 1024 * 1024;
+    // false: rescan the tree every 100 ms instead of watching it with inotify
+    // (for filesystems whose changes inotify does not see, such as NFS).
+    bool inotify = true;
+};
+
+// HLS origin for a directory a packager writes into. Playlists (*.m3u8) are
+// kept in memory, re-read when they change (inotify, drained by the event loop
+// as soon as the packager closes or renames the file; the read, parse and
+// compression happen off the loop), with gzip / brotli variants built once per
+// version and a content-hash ETag. Everything else (segments, partial segments,
+// init sections) is served by a StaticDirectory whose cache holds small files
+// in memory.
+//
+// LL-HLS blocking playlist reload: a playlist request with "_HLS_msn=M"
+// (and optionally "_HLS_part=P") is answered once the playlist holds media
+// sequence number M (or part P of it). Until then the request is parked here by
+// the event loop, holding no worker, and released when the reload that reaches
+// it is seen; after the block timeout it gets a 503. M more than two segments
+// past the playlist's last one is a 400. A playlist with EXT-X-ENDLIST never
+// blocks.
+//
+// serve() and ready() are thread-safe; watch_fd(), collect(), park(),
+// release() and expire() belong to the event loop, and apply() to one I/O
+// thread at a time.
+class HlsOrigin {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // The playlist state a blocking reload waits for: media sequence number
+    // and, if >= 0, part index within it.
+    struct Position {
+        int64_t msn = 0;
+        int64_t part = -1;
+    };
+    enum class Readiness {
+        Ready,   // The playlist has reached the position (or has ended)
+        Wait,    // Not yet
+        Invalid, // Too far ahead: 400
+        Unknown, // No such live playlist
+    };
+    // A parked blocking reload.
+    struct Waiter {
+        int fd = -1;
+        std::shared_ptr<Net::Connection> conn;
+        std::shared_ptr<Http::HttpRequest> request;
+        const RouteHandler* route = nullptr; // Matched before parking
+        std::string playlist; // Relative path
+        Position position;
+        Clock::time_point since;
+        Clock::time_point deadline;
+    };
+    // Playlist work collect() found for apply(): playlists to (re)load, new
+    // directories to watch and scan, or a rescan of the whole tree.
+    struct Reload {
+        std::vector<std::string> playlists; // Relative paths
+        std::vector<std::string> directories;
+        bool rescan = false;
+        bool empty() const { return playlists.empty() && directories.empty() && !rescan; }
+        void merge(Reload&& other);
+    };
+
+    // Throws std::runtime_error if `root` cannot be opened as a directory.
+    explicit HlsOrigin(const std::string& root, HlsOptions options = {}, Metrics* metrics = nullptr);
+    ~HlsOrigin();
+    HlsOrigin(const HlsOrigin&) = delete;
+    HlsOrigin& operator=(const HlsOrigin&) = delete;
+
+    // The position of a blocking reload ("_HLS_msn", "_HLS_part"), if `req` is one.
+    static std::optional<Position> blocking_position(const Http::HttpRequest& req);
+    // Whether playlist `relative` has reached `position`.
+    Readiness ready(std::string_view relative, Position position) const;
+    // When a blocking reload of `relative` arriving at `now` gives up.
+    Clock::time_point block_deadline(std::string_view relative, Clock::time_point now) const;
+
+    // Handler body for a path under the mount (as captured by "*path").
+    void serve(const Http::HttpRequest& req, std::string_view relative, Http::HttpResponse& res) const;
+
+    // --- Event loop -----------------------------------------------------------
+    // Descriptor that becomes readable when something changed (-1 without
+    // inotify: call collect() periodically instead).
+    int watch_fd() const { return inotify_fd_; }
+    // What changed on disk since the last call, from the pending inotify
+    // events (or, without inotify, a rescan every 100 ms). Reads no file.
+    Reload collect(Clock::time_point now);
+    // I/O thread: carry out `reload` (read, parse and compress the playlists);
+    // returns the relative paths of those whose contents changed.
+    std::vector<std::string> apply(const Reload& reload);
+    void park(Waiter waiter);
+    // Parked reloads of the `changed` playlists that can now be answered.
+    std::vector<Waiter> release(const std::vector<std::string>& changed);
+    // Parked reloads whose deadline is before `now`.
+    std::vector<Waiter> expire(Clock::time_point now);
+    std::size_t waiting() const { return waiters_.size(); }
+
+    // Live playlists held in memory.
+    std::size_t playlists() const;
+    const std::string& root() const { return root_; }
+
+private:
+    struct Playlist {
+        std::shared_ptr<const Http::FileEntry> entry;
+        int64_t last_msn = -1;  // Last complete segment
+        int64_t last_part = -1; // Last part of segment last_msn + 1 (-1: none)
+        bool ended = false;     // EXT-X-ENDLIST
+        std::chrono::milliseconds target{0}; // EXT-X-TARGETDURATION
+        int64_t mtime_ns = 0;
+        int64_t size = -1;
+    };
+
+    static void parse(std::string_view text, Playlist& out);
+    Readiness ready_locked(const Playlist& playlist, Position position) const;
+    // (Re)load playlist `relative`; true if its contents changed (or it went
+    // away).
+    bool load(const std::string& relative);
+    // Drop playlist `relative`; true if it was held.
+    bool forget(const std::string& relative);
+    // Watch `relative_dir` and its subdirectories; load the playlists found,
+    // adding their paths to `seen` if given.
+    void add_tree(const std::string& relative_dir, std::vector<std::string>* changed,
+                  std::vector<std::string>* seen = nullptr);
+    // The directory a watch descriptor covers (false if unknown).
+    bool watched_dir(int wd, std::string& relative_dir) const;
+
+    std::string root_;
+    HlsOptions options_;
+    Metrics* metrics_;
+    StaticDirectory files_;
+
+    mutable std::mutex mutex_; // Guards playlists_ and watches_ (workers read, apply() writes)
+    std::unordered_map<std::string, Playlist> playlists_;
+
+    int inotify_fd_ = -1;
+    std::unordered_map<int, std::string> watches_; // Watch descriptor -> relative dir
+    Clock::time_point next_scan_{};                // Without inotify; event loop only
+    std::vector<Waiter> waiters_;                  // Event loop only
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_HLSORIGIN_H
@@ -4,8 +4,12 @@
 
 #include <array>
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Oreshnek {
 namespace Server {
@@ -39,6 +43,126 @@ public:
     // long as it runs: a value pinned at the pool/cap size is the primary signal
     // that handlers are wedged and the process may need recycling.
     std::atomic<int64_t>  workers_in_flight{0};
+    // Responses handlers deferred (Server::defer()) and those not completed
+    // yet (gauge). A deferred request holds no worker, so it is not in
+    // workers_in_flight.
+    std::atomic<uint64_t> deferred_total{0};
+    std::atomic<int64_t>  deferred_pending{0};
+    // Coroutine handlers (CoroutineScheduler): coroutines suspended on a timer
+    // or an offloaded call (gauge), and resumptions posted to workers.
+    std::atomic<int64_t>  coroutines_suspended{0};
+    std::atomic<uint64_t> coroutine_resumes{0};
+    // Inline routes (RouteOptions::inline_): requests run on the event loop,
+    // runs over their route's budget, and routes moved to the workers (gauge).
+    std::atomic<uint64_t> inline_requests{0};
+    std::atomic<uint64_t> inline_overruns{0};
+    std::atomic<int64_t>  inline_demoted_routes{0};
+    // Open-file cache (FileCache): lookups answered from the cache with an open
+    // file or with a cached 404/403, lookups that had to hit the filesystem,
+    // entries dropped because their directory changed (inotify) and entries
+    // evicted by the size bound.
+    std::atomic<uint64_t> file_cache_hits{0};
+    std::atomic<uint64_t> file_cache_negative_hits{0};
+    std::atomic<uint64_t> file_cache_misses{0};
+    std::atomic<uint64_t> file_cache_invalidations{0};
+    std::atomic<uint64_t> file_cache_evictions{0};
+    // Bytes of small files (and their precompressed variants) held in memory
+    // by the file caches (gauge).
+    std::atomic<int64_t>  file_cache_memory_bytes{0};
+    // Compressed-response cache (CompressionCache): lookups that reused an
+    // encoding / had to compress, entries evicted by the byte budget, bytes held
+    // (gauge), and the compression time the hits avoided (nanoseconds).
+    std::atomic<uint64_t> compression_cache_hits{0};
+    std::atomic<uint64_t> compression_cache_misses{0};
+    std::atomic<uint64_t> compression_cache_evictions{0};
+    std::atomic<int64_t>  compression_cache_bytes{0};
+    std::atomic<uint64_t> compression_cache_saved_ns{0};
+    // Response compression: body bytes before / after (the difference is the
+    // saving), time spent compressing (nanoseconds), bodies left uncompressed
+    // because the server was saturated, and the adaptive controller's current
+    // tier (0 idle .. 3 saturated) and levels (gauges).
+    std::atomic<uint64_t> compression_bytes_in{0};
+    std::atomic<uint64_t> compression_bytes_out{0};
+    std::atomic<uint64_t> compression_ns{0};
+    std::atomic<uint64_t> compression_skipped_total{0};
+    std::atomic<int64_t>  compression_tier{1};
+    std::atomic<int64_t>  compression_level_gzip{6};
+    std::atomic<int64_t>  compression_level_brotli{5};
+    std::atomic<int64_t>  compression_level_zstd{3};
+    // Response cache (ResponseCache): requests answered fresh / stale from the
+    // cache, lookups that missed, stale hits that triggered a background
+    // refresh, responses stored, entries evicted and bytes held (gauge).
+    std::atomic<uint64_t> response_cache_hits{0};
+    std::atomic<uint64_t> response_cache_stale_hits{0};
+    std::atomic<uint64_t> response_cache_misses{0};
+    std::atomic<uint64_t> response_cache_revalidations{0};
+    std::atomic<uint64_t> response_cache_stores{0};
+    std::atomic<uint64_t> response_cache_evictions{0};
+    std::atomic<int64_t>  response_cache_bytes{0};
+    // Single-flight (RequestCoalescer): requests that ran the handler for a
+    // flight, requests answered with another request's response, followers
+    // answered 504 because the flight outlived its timeout, followers run on
+    // their own because the response could not be shared, and followers
+    // currently waiting (gauge).
+    std::atomic<uint64_t> coalesce_leaders{0};
+    std::atomic<uint64_t> coalesce_followers{0};
+    std::atomic<uint64_t> coalesce_timeouts{0};
+    std::atomic<uint64_t> coalesce_redispatched{0};
+    std::atomic<int64_t>  coalesce_waiting{0};
+    // File bodies: time the event loop spent in sendfile()/pread() writes
+    // (nanoseconds) and how many write calls that took; a page-cache miss shows
+    // up here as the loop blocking on disk. Readahead (FileReadahead):
+    // connections detected streaming sequentially, those currently doing so
+    // (gauge), WILLNEED hints issued and the bytes they covered, and bytes
+    // dropped behind the sender. Process major faults are read at render time.
+    std::atomic<uint64_t> file_send_ns{0};
+    std::atomic<uint64_t> file_send_calls{0};
+    std::atomic<uint64_t> readahead_streams{0};
+    std::atomic<int64_t>  readahead_active{0};
+    std::atomic<uint64_t> readahead_hints{0};
+    std::atomic<uint64_t> readahead_bytes{0};
+    std::atomic<uint64_t> readahead_dropped_bytes{0};
+    // Asynchronous file reads (TLS bodies read on I/O threads): reads done,
+    // time spent in them (nanoseconds), and writes that found nothing read yet
+    // and had to wait for the disk.
+    std::atomic<uint64_t> async_file_reads{0};
+    std::atomic<uint64_t> async_file_read_ns{0};
+    std::atomic<uint64_t> async_file_read_stalls{0};
+    // LL-HLS origin (HlsOrigin): playlist versions loaded, blocking reloads
+    // parked until the playlist reached the requested position, those answered
+    // 503 because it did not in time, and reloads currently parked (gauge).
+    std::atomic<uint64_t> hls_playlist_reloads{0};
+    std::atomic<uint64_t> hls_blocked{0};
+    std::atomic<uint64_t> hls_block_timeouts{0};
+    std::atomic<int64_t>  hls_waiting{0};
+
+    // One worker pool: the default pool or a bulkhead (Server::add_bulkhead).
+    // Rendered with a pool="<name>" label. `admitted` counts handlers posted to
+    // the pool and not finished (queued in it or running), `running` those
+    // executing on a worker, `waiting` requests the event loop holds until a
+    // worker frees (bulkheads only). Latency runs from admission (queue wait
+    // included) to the handler's return.
+    struct PoolStats {
+        PoolStats(std::string pool_name, std::size_t pool_threads)
+            : name(std::move(pool_name)), threads(pool_threads) {}
+        const std::string name;
+        const std::size_t threads;
+        std::atomic<int64_t>  admitted{0};
+        std::atomic<int64_t>  running{0};
+        std::atomic<int64_t>  waiting{0};
+        std::atomic<uint64_t> shed{0};
+        std::array<std::atomic<uint64_t>, kBuckets.size()> latency_buckets{};
+        std::atomic<uint64_t> latency_count{0};
+        std::atomic<double>   latency_sum{0.0};
+
+        void observe_latency(double seconds);
+    };
+
+    // Register a pool's counters. Before run(): render() walks the list
+    // without locking.
+    PoolStats& add_pool(std::string name, std::size_t threads);
+    // A registered pool by name, or null.
+    const PoolStats* pool(std::string_view name) const;
 
     // Record a response by its numeric status code (buckets it into 2xx..5xx).
     void record_status(int code);
@@ -53,6 +177,7 @@ private:
     std::array<std::atomic<uint64_t>, kBuckets.size()> duration_buckets_{};
     std::atomic<uint64_t> duration_count_{0};
     std::atomic<double>   duration_sum_{0.0};
+    std::vector<std::unique_ptr<PoolStats>> pools_;
 };
 
 }  // namespace Server
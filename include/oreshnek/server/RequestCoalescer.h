@@ -0,0 +1,94 @@
+// oreshnek/include/oreshnek/server/RequestCoalescer.h
+#ifndef ORESHNEK_SERVER_REQUESTCOALESCER_H
+#define ORESHNEK_SERVER_REQUESTCOALESCER_H
+
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/net/Connection.h"
+#include "oreshnek/server/Router.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Oreshnek {
+namespace Server {
+
+// Single-flight for routes registered with RouteOptions::coalesce: while one
+// request (the leader) runs the handler, identical requests arriving on other
+// connections (followers) do not get a worker; they wait here and are answered
+// with the leader's response, serialized once into a shared CannedResponse.
+//
+// Identical means same path, same query (parameters in any order), and the same
+// Accept, Accept-Encoding and RouteOptions::coalesce_vary header values; GET
+// and HEAD share a flight. Requests the response cache would not answer
+// (Authorization, conditional, "no-cache") and requests with a Cookie or Range
+// header always run on their own.
+//
+// Errors and timeouts:
+//  * Followers get the leader's response, 5xx and the router's 404 included:
+//    running a failing handler once more per waiter is the stampede this exists
+//    to prevent.
+//  * Never shared: file responses, and responses meant for the leader's client
+//    only (Set-Cookie, a Connection header, or Cache-Control "private",
+//    "no-store" or "no-cache"). Their followers are dispatched on their own
+//    once the leader finishes.
+//  * A flight lasts at most RouteOptions::coalesce_timeout from the leader's
+//    start (checked by the once-a-second timeout sweep). On expiry its followers
+//    get a 504 and the key is free for a new flight; the leader is still bound
+//    by handler_timeout and keeps its own result.
+//  * The leader's connection closing does not affect the followers.
+//
+// Event-loop only (no locking).
+class RequestCoalescer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // A request waiting on a flight. The owning copy of the request lets it be
+    // dispatched on its own when the leader's response cannot be shared.
+    struct Waiter {
+        int fd = -1;
+        std::shared_ptr<Net::Connection> conn;
+        std::shared_ptr<Http::HttpRequest> request;
+        const RouteHandler* route = nullptr;
+        bool head_only = false;
+        Clock::time_point since;
+    };
+
+    // Flight key for `req` on a route with `options`, or "" when the request
+    // must not be coalesced.
+    static std::string key(const Http::HttpRequest& req, const RouteOptions& options);
+
+    // Queue `waiter` on the running flight for `key`; false if there is none.
+    bool join(const std::string& key, Waiter waiter);
+    // Start a flight for `key`, ending at `deadline`. Returns its id (never 0).
+    std::uint64_t lead(std::string key, Clock::time_point deadline);
+    // End flight `id` and return its waiters (none if it already expired).
+    std::vector<Waiter> complete(std::uint64_t id);
+    // End every flight whose deadline is before `now`, returning their waiters.
+    std::vector<Waiter> expire(Clock::time_point now);
+
+    // Flights running.
+    std::size_t size() const { return flights_.size(); }
+    // Requests waiting on them.
+    std::size_t waiting() const { return waiting_; }
+
+private:
+    struct Flight {
+        std::string key;
+        Clock::time_point deadline;
+        std::vector<Waiter> waiters;
+    };
+
+    std::unordered_map<std::uint64_t, Flight> flights_;
+    std::unordered_map<std::string, std::uint64_t> index_; // key -> flight id
+    std::uint64_t next_id_ = 1;
+    std::size_t waiting_ = 0;
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_REQUESTCOALESCER_H
@@ -0,0 +1,134 @@
+// oreshnek/include/oreshnek/server/ResponseCache.h
+#ifndef ORESHNEK_SERVER_RESPONSECACHE_H
+#define ORESHNEK_SERVER_RESPONSECACHE_H
+
+#include "oreshnek/http/CannedResponse.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Oreshnek {
+namespace Server {
+
+class Metrics;
+
+struct ResponseCacheOptions {
+    // Total bytes of cached responses (headers + body), split evenly across the
+    // shards; least recently used entries are evicted to stay under it.
+    std::size_t max_bytes = 32 * 1024 * 1024;
+    // Larger responses are not cached.
+    std::size_t max_entry = 1024 * 1024;
+    // Independent LRUs, each with its own lock, selected by key hash.
+    std::size_t shards = 16;
+    // Variants (distinct values of the Vary request headers) kept per URL.
+    std::size_t max_variants = 8;
+};
+
+// Shared HTTP response cache for GET handlers, driven by the Cache-Control the
+// handler sets: a 200 (or 203/204/300/301/404/410) string response with
+// "max-age" / "s-maxage" is stored, serialized, under method + path +
+// normalized query (parameters sorted), with one variant per combination of the
+// request headers its Vary lists. "stale-while-revalidate=N" lets an expired
+// entry be served for N more seconds while one request refreshes it.
+//
+// Not stored: "no-store" / "no-cache" / "private", Set-Cookie, "Vary: *", file
+// responses, and responses to requests carrying Authorization unless marked
+// "public". Requests with Authorization, "Cache-Control: no-cache" or a
+// conditional header are not answered from the cache (they reach the handler,
+// whose response is stored as usual).
+//
+// Thread-safe: the event loop looks up, workers store; each shard has its own
+// lock. Entries are handed out as shared CannedResponses, so an eviction never
+// invalidates a response being written.
+class ResponseCache {
+public:
+    enum class Freshness { Miss, Fresh, Stale };
+    struct Hit {
+        Freshness freshness = Freshness::Miss;
+        std::shared_ptr<const Http::CannedResponse> response; // Set unless Miss
+        // True for exactly one stale hit per expiry: the caller owns refreshing
+        // the entry (store() or abandon_revalidation()).
+        bool revalidate = false;
+    };
+
+    explicit ResponseCache(ResponseCacheOptions options = {}, Metrics* metrics = nullptr);
+    ~ResponseCache();
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    // Whether `req` may be answered from the cache (GET/HEAD, no
+    // Authorization, no "no-cache", not conditional).
+    static bool servable(const Http::HttpRequest& req);
+    // Whether `res` may be sent to clients other than the one it was made for:
+    // no Set-Cookie, no Connection header, and no "private" / "no-store" /
+    // "no-cache" in its Cache-Control.
+    static bool shareable(const Http::HttpResponse& res);
+    // "GET <path>?<query, parameters sorted>" (HEAD shares the GET key).
+    static std::string primary_key(const Http::HttpRequest& req);
+
+    // Cached response for `req` (HEAD uses the GET entry).
+    Hit find(const Http::HttpRequest& req);
+    // Store `res` as the response to `req` if both are cacheable; returns
+    // whether it was stored. Call before HEAD body suppression.
+    bool store(const Http::HttpRequest& req, const Http::HttpResponse& res);
+    // Release the refresh claimed by a stale hit whose revalidation produced
+    // nothing cacheable, so a later stale hit tries again.
+    void abandon_revalidation(const Http::HttpRequest& req);
+
+    // Drop every entry.
+    void clear();
+    // URLs currently cached (each may hold several variants).
+    std::size_t size() const;
+    // Bytes held by all entries.
+    std::size_t memory_bytes() const;
+    const ResponseCacheOptions& options() const { return options_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Variant {
+        std::string vary_values; // Request values of the Vary headers, '\n'-joined
+        std::shared_ptr<const Http::CannedResponse> response;
+        Clock::time_point fresh_until;
+        Clock::time_point stale_until;
+        bool revalidating = false;
+        std::size_t bytes = 0;
+    };
+    struct Node {
+        std::string key;
+        std::vector<std::string> vary; // Lower-case header names from Vary
+        std::vector<Variant> variants;
+        std::size_t bytes = 0;
+    };
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Node> lru; // Most recently used first
+        std::unordered_map<std::string, std::list<Node>::iterator, KeyHash, std::equal_to<>> index;
+        std::size_t bytes = 0;
+    };
+
+    Shard& shard_for(std::string_view key);
+    void erase(Shard& shard, std::list<Node>::iterator it);
+    void publish(std::int64_t delta);
+
+    ResponseCacheOptions options_;
+    Metrics* metrics_;
+    std::size_t shard_budget_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_RESPONSECACHE_H
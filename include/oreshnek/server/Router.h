@@ -5,12 +5,14 @@
 #include "oreshnek/http/HttpRequest.h"
 #include "oreshnek/http/HttpResponse.h"
 #include "oreshnek/http/HttpEnums.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <functional>
-#include <string> // Use std::string for map keys to own data
+#include <memory> // For unique_ptr
+#include <string>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
-#include <memory> // For unique_ptr
 
 namespace Oreshnek {
 namespace Server {
@@ -18,62 +20,139 @@ namespace Server {
 // Type alias for route handler function
 using RouteHandler = std::function<void(const Http::HttpRequest&, Http::HttpResponse&)>;
 
-// Forward declaration for RouterNode
-struct RouterNode;
-
-// Represents a node in the routing tree
-struct RouterNode {
-    // CAMBIO: Cambiado de std::string_view a std::string para las claves
-    std::unordered_map<std::string, std::unique_ptr<RouterNode>> children;
-    std::unique_ptr<RouterNode> param_child; // Child for path parameters (e.g., :id)
-    // CAMBIO: Cambiado de std::string_view a std::string para param_name
-    std::string param_name; // Stores the name of the parameter for param_child
-
-    // Handlers for different HTTP methods at this node
-    std::unordered_map<Http::HttpMethod, RouteHandler> handlers;
-
-    RouterNode() = default;
-    RouterNode(const RouterNode&) = delete; // No copy
-    RouterNode& operator=(const RouterNode&) = delete; // No copy assignment
-    RouterNode(RouterNode&&) noexcept = default; // Move
-    RouterNode& operator=(RouterNode&&) noexcept = default; // Move assign
+// Per-route behaviour, given at registration.
+struct RouteOptions {
+    // Single-flight: identical concurrent GET/HEAD requests share one handler
+    // execution (see RequestCoalescer). Only for handlers whose response
+    // depends on nothing but the path, the query and the headers listed below.
+    bool coalesce = false;
+    // How long requests may wait on one execution before getting a 504.
+    std::chrono::milliseconds coalesce_timeout{5000};
+    // Request headers, besides Accept and Accept-Encoding, whose values must
+    // match for two requests to be identical (e.g. "Accept-Language").
+    std::vector<std::string> coalesce_vary;
+    // Bulkhead (Server::add_bulkhead) whose workers run this route; empty
+    // means the default pool.
+    std::string pool;
+    // Run the middlewares and the handler on the event-loop thread, against
+    // the request as parsed in the connection's buffer: no copy, no worker
+    // hop. Only for handlers that take microseconds and never block (e.g.
+    // /health, redirects); every connection waits while one runs. A handler
+    // that defers (or a coroutine, up to its first suspension) is fine: it is
+    // answered later, like on a worker.
+    bool inline_ = false;
+    // A handler run (middlewares included; not the compression or ETag of its
+    // response) slower than this is logged; a route that keeps overrunning is
+    // moved to the workers (see Server::run_inline).
+    std::chrono::microseconds inline_budget{200};
 };
 
-
+// Routes are registered into a mutable radix tree, then freeze() compiles it
+// into a compact read-only form: every node in one contiguous array, edge labels
+// and child first-bytes in one byte arena, handlers in one table. Static text is
+// prefix-compressed byte by byte (across '/' boundaries), so "/api/v1/users" and
+// "/api/v1/videos" share the "/api/v1/" edge.
+//
+// match() does no allocation: it walks the array comparing bytes, returns a
+// pointer into the handler table and writes `:param` captures into the
+// request's inline PathParams slots. Static edges are preferred over a `:param`
+// at the same position, and a `:param` over a `*name` catch-all, with
+// backtracking if a branch dead-ends. A catch-all must be the last segment and
+// captures the rest of the path, slashes included ("/static/*path" matches
+// "/static/css/app.css" with path = "css/app.css", and "/static/" with path = "").
+//
+// A trailing slash is ignored on both routes and requests ("/users/" matches
+// "/users"). Registration after freeze() throws std::logic_error.
 class Router {
-private:
-    std::unique_ptr<RouterNode> root_;
-
-    // Helper to add a route path segment by segment
-    void add_route_recursive(RouterNode* current_node, Http::HttpMethod method,
-                             std::vector<std::string_view>::const_iterator path_segment_it,
-                             std::vector<std::string_view>::const_iterator path_segment_end,
-                             RouteHandler handler);
-
-    // Helper to match a route and extract path parameters
-    bool match_route_recursive(const RouterNode* current_node,
-                               std::vector<std::string_view>::const_iterator path_segment_it,
-                               std::vector<std::string_view>::const_iterator path_segment_end,
-                               Http::HttpMethod method,
-                               // path_params_out puede seguir usando string_view, ya que apuntan a la ruta de la solicitud HTTP actual.
-                               std::unordered_map<std::string_view, std::string_view>& path_params_out,
-                               RouteHandler& matched_handler_out) const;
-
 public:
     Router();
-
-    // Add a route with its handler
-    void add_route(Http::HttpMethod method, std::string_view path, RouteHandler handler);
-
-    // Find a matching route and populate path parameters
-    bool find_route(Http::HttpMethod method, std::string_view path,
-                    std::unordered_map<std::string_view, std::string_view>& path_params_out,
-                    RouteHandler& matched_handler_out) const;
+    ~Router();
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+    // Add a route with its handler. Throws std::runtime_error for a malformed
+    // path (no leading '/', empty ":"/"*" name, a catch-all that is not the last
+    // segment, more than PathParams::kMaxParams parameters) and
+    // std::logic_error once the router is frozen.
+    void add_route(Http::HttpMethod method, std::string_view path, RouteHandler handler,
+                   RouteOptions options = {});
+
+    // Compile the registered routes for lookup. Idempotent. The server freezes
+    // its router when run() starts.
+    void freeze();
+    bool frozen() const { return frozen_; }
+
+    // Find the handler for (method, path), filling `params` (cleared first).
+    // Returns nullptr when nothing matches. Requires freeze() (throws
+    // std::logic_error otherwise). Thread-safe once frozen.
+    const RouteHandler* match(Http::HttpMethod method, std::string_view path,
+                              Http::PathParams& params) const;
+
+    // Options the route of `handler` (a match() result) was registered with.
+    const RouteOptions& options(const RouteHandler* handler) const {
+        return options_[static_cast<std::size_t>(handler - handlers_.data())];
+    }
+    // Whether any route asked for single-flight coalescing.
+    bool any_coalesced() const { return any_coalesced_; }
+    // Whether any route is assigned to a bulkhead.
+    bool any_pooled() const { return any_pooled_; }
+    // Whether any route runs inline on the event loop.
+    bool any_inline() const { return any_inline_; }
+    // Position of `handler` (a match() result) in [0, route_count()).
+    std::size_t route_index(const RouteHandler* handler) const {
+        return static_cast<std::size_t>(handler - handlers_.data());
+    }
+    // The handler at `index` (the inverse of route_index()).
+    const RouteHandler* route_at(std::size_t index) const { return &handlers_[index]; }
+
+    // Number of distinct (method, path) routes registered.
+    std::size_t route_count() const { return handlers_.size(); }
 
 private:
-    // Helper to split a path into segments (e.g., "/api/users/:id" -> ["api", "users", ":id"])
-    // Retorna string_views que apuntan a la cadena original `path` (que debe tener una vida útil suficiente).
-    std::vector<std::string_view> split_path_to_segments(std::string_view path) const;
+    static constexpr std::size_t kMethods = static_cast<std::size_t>(Http::HttpMethod::UNKNOWN) + 1;
+    static constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+
+    // Registration-time tree (discarded by freeze()).
+    struct BuildNode;
+
+    // Compiled node. Static children are stored consecutively from
+    // first_child; their first label bytes sit contiguously at
+    // bytes_[child_keys...], so the next edge is found by a short scan of
+    // child_count bytes (see match_node()).
+    struct Node {
+        std::uint32_t label = 0;       // Edge label: bytes_[label, label + label_len)
+        std::uint32_t label_len = 0;
+        std::uint32_t first_child = kNone;
+        std::uint32_t child_keys = 0;
+        std::uint32_t child_count = 0;
+        std::uint32_t param_child = kNone; // ":name" child, matches one segment
+        std::uint32_t param_name = 0;      // bytes_[param_name, +param_name_len)
+        std::uint32_t param_name_len = 0;
+        std::uint32_t catch_all_child = kNone; // "*name" child, matches the rest
+        std::uint32_t catch_all_name = 0;
+        std::uint32_t catch_all_name_len = 0;
+        std::array<std::int32_t, kMethods> handlers; // Index into handlers_, -1 if none
+    };
+
+    BuildNode* insert_static(BuildNode* node, std::string_view text);
+    std::uint32_t append_bytes(std::string_view text);
+    void flatten(const BuildNode& build, std::uint32_t index);
+    const RouteHandler* match_node(std::uint32_t index, std::string_view rest, std::size_t method,
+                                   Http::PathParams& params) const;
+    const RouteHandler* match_catch_all(const Node& node, std::string_view rest, std::size_t method,
+                                        Http::PathParams& params) const;
+    const RouteHandler* match_path(std::size_t method, std::string_view path,
+                                   Http::PathParams& params) const;
+
+    std::unique_ptr<BuildNode> build_root_;
+    std::vector<Node> nodes_;
+    std::string bytes_;
+    std::vector<RouteHandler> handlers_;
+    std::vector<RouteOptions> options_; // Parallel to handlers_
+    bool any_coalesced_ = false;
+    bool any_pooled_ = false;
+    bool any_inline_ = false;
+    bool frozen_ = false;
 };
 
 } // namespace Server
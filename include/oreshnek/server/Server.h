@@ -4,16 +4,30 @@
 
 #include "oreshnek/server/Router.h"
 #include "oreshnek/server/ThreadPool.h"
+#include "oreshnek/server/WorkStealingPool.h"
+#include "oreshnek/server/Bulkhead.h"
 #include "oreshnek/server/RateLimiter.h"
 #include "oreshnek/server/Metrics.h"
+#include "oreshnek/server/StaticFiles.h"
+#include "oreshnek/server/CompressionCache.h"
+#include "oreshnek/server/CompressionController.h"
+#include "oreshnek/server/ResponseCache.h"
+#include "oreshnek/server/FileReadahead.h"
+#include "oreshnek/server/RequestCoalescer.h"
+#include "oreshnek/server/HlsOrigin.h"
+#include "oreshnek/server/DeferredResponse.h"
+#include "oreshnek/server/CoroutineScheduler.h"
+#include "oreshnek/server/Task.h"
 #include "oreshnek/net/Connection.h"
 #include "oreshnek/http/HttpRequest.h"
 #include "oreshnek/http/HttpResponse.h"
+#include "oreshnek/http/CannedResponse.h"
 
 #include <string>
 #include <unordered_map>
 #include <memory>
 #include <atomic>
+#include <concepts>
 #include <functional>
 #include <mutex>
 #include <queue>
@@ -37,6 +51,15 @@ namespace Server {
 // middleware and ultimately the handler.
 using Middleware = std::function<bool(const Http::HttpRequest&, Http::HttpResponse&)>;
 
+// A route handler written as a coroutine: it may co_await the scheduler's
+// timers and blocking-pool calls (Server::scheduler()) without holding a
+// worker while it waits.
+using CoroutineHandler = std::function<Task<void>(const Http::HttpRequest&, Http::HttpResponse&)>;
+template <typename F>
+concept CoroutineRouteHandler = requires(F& f, const Http::HttpRequest& req, Http::HttpResponse& res) {
+    { f(req, res) } -> std::same_as<Task<void>>;
+};
+
 class Server {
 private:
     int listen_fd_; // Listening socket file descriptor
@@ -54,7 +77,7 @@ private:
     bool draining_ = false;
 
     std::unique_ptr<Router> router_;
-    std::unique_ptr<ThreadPool> thread_pool_;
+    std::unique_ptr<WorkStealingPool> thread_pool_;
     // Non-null when TLS is enabled; shared (read-only) to mint per-connection
     // SSL objects on accept.
     std::unique_ptr<Net::TlsContext> tls_ctx_;
@@ -62,16 +85,78 @@ private:
     std::unique_ptr<TokenBucketLimiter> rate_limiter_;
     // Server metrics (atomic; updated by the event loop and workers).
     Metrics metrics_;
+    // Open-file cache for handlers that serve files by path (see file_cache()).
+    FileCache file_cache_{FileCacheOptions{}, &metrics_};
 
     // Response compression (read-only by workers after setup).
     bool compression_enabled_ = false;
     std::size_t compression_min_bytes_ = 256;
     bool compression_brotli_ = true;
+    bool compression_zstd_ = true;
+    // Non-null when compressed bodies are cached (enable_compression_cache()).
+    std::unique_ptr<CompressionCache> compression_cache_;
+    // Non-null when levels adapt to load (enable_adaptive_compression()).
+    std::unique_ptr<CompressionController> compression_controller_;
+    // Non-null when GET responses are cached (enable_response_cache()).
+    std::unique_ptr<ResponseCache> response_cache_;
+    // Requests waiting on an identical in-flight request, for routes registered
+    // with RouteOptions::coalesce. Touched only by the event loop.
+    RequestCoalescer coalescer_;
+    // Non-null when sequential file streams get page-cache hints
+    // (enable_file_readahead()). Touched only by the event loop.
+    std::unique_ptr<FileReadahead> readahead_;
+    // HLS origins (mount_hls()), by URL prefix. Their playlist watches and
+    // parked blocking reloads belong to the event loop.
+    struct HlsMount {
+        std::string base; // Prefix without the trailing '/'
+        std::shared_ptr<HlsOrigin> origin;
+        // One reload at a time on io_pool_; changes seen meanwhile wait here.
+        bool reloading = false;
+        HlsOrigin::Reload pending;
+    };
+    std::vector<HlsMount> hls_mounts_;
+    // Negotiate MessagePack/CBOR for HttpResponse::json() via Accept.
+    bool binary_json_enabled_ = false;
+    // Hash-based ETags and 304s for string responses (enable_auto_etag()).
+    bool auto_etag_enabled_ = false;
+
+    // Pre-serialized responses for the overload/error hot paths (429, 503, 404,
+    // 408, 504). Populated before run(); read-only afterwards.
+    Http::CannedResponseRegistry canned_;
 
     // Middleware chain, run before the handler in registration order. Populated
     // before run() and only read (never mutated) by worker threads afterwards.
     std::vector<Middleware> middlewares_;
 
+    // One response pool per worker (indexed by WorkStealingPool::current_worker_index).
+    // Declared before completed_ so queued responses are recycled into live pools
+    // during destruction.
+    std::vector<std::unique_ptr<Http::HttpResponsePool>> response_pools_;
+    // Bulkheads (add_bulkhead()), each with its own workers and response pools;
+    // declared before completed_ for the same reason. Their queues belong to
+    // the event loop. default_stats_ counts the routes left on thread_pool_.
+    std::vector<std::unique_ptr<Bulkhead>> bulkheads_;
+    Metrics::PoolStats* default_stats_ = nullptr;
+    // Each route's bulkhead (null: the default pool), by Router::route_index.
+    // Sized in run().
+    std::vector<Bulkhead*> route_bulkheads_;
+
+    // Inline routes (RouteOptions::inline_): responses for the handlers run on
+    // the event loop, and each route's overrun count, by Router::route_index.
+    // Sized in run(); touched only by the event loop.
+    struct InlineRoute {
+        std::uint64_t runs = 0;
+        std::uint64_t last_overrun = 0; // Value of `runs` at the last overrun
+        std::uint32_t overruns = 0;     // Within kInlineStrikeWindow runs of each other
+        bool demoted = false;           // Runs on the workers from now on
+    };
+    // Overruns that demote a route, unless kInlineStrikeWindow runs pass
+    // between two of them (a preempted loop is not a slow handler).
+    static constexpr std::uint32_t kInlineStrikes = 3;
+    static constexpr std::uint64_t kInlineStrikeWindow = 1000;
+    Http::HttpResponsePool inline_responses_;
+    std::vector<InlineRoute> inline_routes_;
+
     // Map of active connections, indexed by their socket FD.
     // Only the event-loop thread mutates this map or the Connection objects.
     // shared_ptr lets an in-flight worker keep a connection alive even if the
@@ -84,11 +169,43 @@ private:
     struct CompletedResponse {
         int fd;
         std::shared_ptr<Net::Connection> conn;
-        Http::HttpResponse response;
+        Http::HttpResponsePool::Handle response;
+        // When set, sent instead of `response` (e.g. the router's 404).
+        const Http::CannedResponse* canned = nullptr;
+        bool head_only = false;
+        // Single-flight the request led (0 if none), and its response
+        // serialized for the followers (null for a file response).
+        std::uint64_t flight = 0;
+        std::shared_ptr<const Http::CannedResponse> shared;
     };
     std::queue<CompletedResponse> completed_;
     std::mutex completed_mutex_; // Protects completed_
 
+    // Asynchronous file reads for TLS connections (enable_async_file_io()):
+    // run on io_pool_, their results queued here for the event loop. Declared
+    // after the queue so the pool is joined before the queue is destroyed.
+    struct FileReadDone {
+        int fd;
+        std::shared_ptr<Net::Connection> conn;
+        ssize_t result; // pread() return value
+    };
+    std::vector<FileReadDone> file_reads_done_;
+    std::mutex file_reads_mutex_; // Protects file_reads_done_
+    // HLS playlist reloads (also on io_pool_): the mount and what changed.
+    struct HlsReloadDone {
+        std::size_t mount; // Index into hls_mounts_
+        std::vector<std::string> changed;
+    };
+    std::vector<HlsReloadDone> hls_reloads_done_;
+    std::mutex hls_reloads_mutex_; // Protects hls_reloads_done_
+    std::unique_ptr<ThreadPool> io_pool_;
+    bool async_file_reads_ = false; // enable_async_file_io(); mount_hls() may start io_pool_ alone
+
+    // Timers and blocking pool for coroutine handlers (scheduler()); its
+    // ready coroutines are posted by the event loop to the pool their route
+    // runs on (thread_pool_ or a bulkhead).
+    std::unique_ptr<CoroutineScheduler> scheduler_;
+
     // Self-pipe used by worker threads to wake the event loop when a response
     // is ready (and by the signal handler to break out of the wait).
     int wakeup_pipe_[2] = {-1, -1};
@@ -131,11 +248,97 @@ public:
     void enable_rate_limit(double requests_per_second, double burst);
 
     // Register a GET route that exposes server metrics in Prometheus text format.
-    void enable_metrics(const std::string& path);
+    // `options` as for get(): e.g. inline_ (rendering takes tens of
+    // microseconds, so give it an inline_budget of about 1 ms).
+    void enable_metrics(const std::string& path, RouteOptions options = {});
 
-    // Enable response compression (gzip/brotli) for compressible text bodies
-    // above `min_bytes`. Call before listen()/run().
-    void enable_compression(std::size_t min_bytes, bool allow_brotli);
+    // Enable response compression (gzip, plus brotli / zstd when compiled in)
+    // for compressible text bodies above `min_bytes`. Call before
+    // listen()/run().
+    void enable_compression(std::size_t min_bytes, bool allow_brotli, bool allow_zstd = true);
+
+    // Cache compressed bodies by content (see CompressionCache), so identical
+    // responses are compressed once. Only used with enable_compression(). Call
+    // before listen()/run().
+    void enable_compression_cache(CompressionCacheOptions options = {});
+
+    // Pick compression levels by load instead of the fixed defaults (see
+    // CompressionController): higher levels when idle, the fastest ones when
+    // busy, and large bodies uncompressed when saturated. Only used with
+    // enable_compression(). Call before listen()/run().
+    void enable_adaptive_compression(CompressionControllerOptions options = {});
+
+    // Cache GET responses whose handler sets "Cache-Control: max-age" (see
+    // ResponseCache). Hits are answered by the event loop without running the
+    // middlewares or the handler, so only cache what any client may see.
+    // Call before listen()/run().
+    void enable_response_cache(ResponseCacheOptions options = {});
+
+    // Read file bodies for TLS connections on `threads` dedicated I/O threads
+    // instead of the event loop: sendfile() cannot encrypt, so those bodies are
+    // read into memory, and a cold pread() there would stall every connection.
+    // Each connection double-buffers: one buffer is encrypted and sent while
+    // the other is filled. Call before listen()/run().
+    void enable_async_file_io(std::size_t threads = 2);
+
+    // Coroutine handlers (a handler returning Task<void>): size the blocking
+    // pool their offloaded calls (database queries, file reads) run on. Called
+    // with the default by the first coroutine route if not before. Call before
+    // listen()/run().
+    void enable_coroutines(std::size_t blocking_threads = 8);
+    // What coroutine handlers co_await (see CoroutineScheduler). Available once
+    // a coroutine route is registered or enable_coroutines() was called.
+    CoroutineScheduler& scheduler();
+
+    // Page-cache hints for file bodies (see FileReadahead): once a connection
+    // reads a file sequentially (e.g. a player's consecutive Range requests on
+    // a video), a window ahead of it is prefetched and, for large files nobody
+    // else is streaming, the pages behind it are dropped. Call before
+    // listen()/run().
+    void enable_file_readahead(FileReadaheadOptions options = {});
+
+    // Conditional GET for in-memory responses: a 200 string response to
+    // GET/HEAD gets a strong ETag hashed from its body (unless the handler set
+    // one) and a matching If-None-Match is answered 304 with no body. The
+    // handler still runs; to skip building the body, check a cheap version
+    // ETag first:
+    //   if (req.if_none_match(etag)) { res.not_modified(etag); return; }
+    // Call before listen()/run().
+    void enable_auto_etag();
+
+    // Let clients opt into MessagePack or CBOR instead of JSON via Accept:
+    // HttpResponse::json() then emits the negotiated encoding (with
+    // "Vary: Accept"). Call before listen()/run().
+    void enable_binary_json();
+
+    // Serve the files under `dir` at `prefix` (GET/HEAD "<prefix>/*path", plus
+    // "<prefix>" itself, which redirects to "<prefix>/"). Lookups are confined to
+    // `dir` by a directory descriptor opened here, so traversal ("..", encoded
+    // or not) and symlinks out of the tree are refused. Open files and their
+    // metadata are cached per mount (StaticOptions::cache). Throws
+    // std::runtime_error if `dir` cannot be opened. Call before listen()/run().
+    void mount_static(const std::string& prefix, const std::string& dir, StaticOptions options = {});
+
+    // Serve the live HLS output a packager writes under `dir` at `prefix`
+    // (GET/HEAD "<prefix>/*path"; see HlsOrigin): playlists from memory,
+    // reloaded on the I/O pool (one thread unless enable_async_file_io()) as
+    // soon as they change, and LL-HLS blocking playlist reloads ("_HLS_msn" /
+    // "_HLS_part") held by the event loop, without a worker, until the
+    // playlist reaches the requested segment or part. Throws
+    // std::runtime_error if `dir` cannot be opened. Call before listen()/run().
+    void mount_hls(const std::string& prefix, const std::string& dir, HlsOptions options = {});
+
+    // Canned (pre-serialized) responses used for 404/408/429/503/504. Replace an
+    // entry to customize the error body, e.g.
+    //   server.canned_responses().set(HttpResponse().status(NOT_FOUND).html(page));
+    // Call before listen()/run().
+    Http::CannedResponseRegistry& canned_responses() { return canned_; }
+
+    // Open-file cache shared by handlers that serve files by path:
+    //   res.file(server.file_cache().open(path));
+    // saves the open()/fstat() and validator formatting on repeat requests.
+    // Static mounts keep their own cache (StaticOptions::cache).
+    FileCache& file_cache() { return file_cache_; }
 
     // Access the live metrics (e.g. for tests).
     const Metrics& metrics() const { return metrics_; }
@@ -145,23 +348,72 @@ public:
     // once the server is running.
     void use(Middleware middleware) { middlewares_.push_back(std::move(middleware)); }
 
-    // Route registration methods
-    void get(const std::string& path, RouteHandler handler) {
-        router_->add_route(Http::HttpMethod::GET, path, std::move(handler));
+    // A named worker pool for the routes registered with RouteOptions::pool
+    // set to `name` (see Bulkhead): they never take the default pool's
+    // workers, nor it theirs. Reported per pool in the metrics. Call before
+    // registering those routes and before listen()/run().
+    void add_bulkhead(const std::string& name, BulkheadOptions options = {});
+
+    // Route registration methods. RouteOptions tune one route, e.g.
+    //   server.get("/api/videos/:id", handler, {.coalesce = true});
+    void get(const std::string& path, RouteHandler handler, RouteOptions options = {}) {
+        add_route(Http::HttpMethod::GET, path, std::move(handler), std::move(options));
+    }
+    void post(const std::string& path, RouteHandler handler, RouteOptions options = {}) {
+        add_route(Http::HttpMethod::POST, path, std::move(handler), std::move(options));
+    }
+    void put(const std::string& path, RouteHandler handler, RouteOptions options = {}) {
+        add_route(Http::HttpMethod::PUT, path, std::move(handler), std::move(options));
     }
-    void post(const std::string& path, RouteHandler handler) {
-        router_->add_route(Http::HttpMethod::POST, path, std::move(handler));
+    void del(const std::string& path, RouteHandler handler, RouteOptions options = {}) {
+        add_route(Http::HttpMethod::DELETE, path, std::move(handler), std::move(options));
     }
-    void put(const std::string& path, RouteHandler handler) {
-        router_->add_route(Http::HttpMethod::PUT, path, std::move(handler));
+    void patch(const std::string& path, RouteHandler handler, RouteOptions options = {}) {
+        add_route(Http::HttpMethod::PATCH, path, std::move(handler), std::move(options));
     }
-    void del(const std::string& path, RouteHandler handler) {
-        router_->add_route(Http::HttpMethod::DELETE, path, std::move(handler));
+    // The same for coroutine handlers, e.g.
+    //   server.get("/slow", [&](const HttpRequest&, HttpResponse& res) -> Task<void> {
+    //       co_await server.scheduler().sleep_for(std::chrono::milliseconds(100));
+    //       res.status(HttpStatus::OK).text("done");
+    //   });
+    // The handler starts on a worker; at its first suspension the worker is
+    // released (the request is deferred, see defer()) and every later part
+    // runs on whichever worker the event loop resumes it on. The request and
+    // the response stay valid until the coroutine finishes; an exception it
+    // throws is a 500.
+    template <CoroutineRouteHandler F>
+    void get(const std::string& path, F handler, RouteOptions options = {}) {
+        get(path, coroutine_route(std::move(handler)), std::move(options));
     }
-    void patch(const std::string& path, RouteHandler handler) {
-        router_->add_route(Http::HttpMethod::PATCH, path, std::move(handler));
+    template <CoroutineRouteHandler F>
+    void post(const std::string& path, F handler, RouteOptions options = {}) {
+        post(path, coroutine_route(std::move(handler)), std::move(options));
+    }
+    template <CoroutineRouteHandler F>
+    void put(const std::string& path, F handler, RouteOptions options = {}) {
+        put(path, coroutine_route(std::move(handler)), std::move(options));
+    }
+    template <CoroutineRouteHandler F>
+    void del(const std::string& path, F handler, RouteOptions options = {}) {
+        del(path, coroutine_route(std::move(handler)), std::move(options));
+    }
+    template <CoroutineRouteHandler F>
+    void patch(const std::string& path, F handler, RouteOptions options = {}) {
+        patch(path, coroutine_route(std::move(handler)), std::move(options));
     }
 
+    // Called by a handler, with its response, to answer later: the handler
+    // returns at once (freeing the worker) and whoever holds the returned
+    // handle fills the response, from any thread, e.g.
+    //   server.get("/events", [&](const HttpRequest&, HttpResponse& res) {
+    //       subscribers.add(server.defer(res));
+    //   });
+    // complete() fills the response as it stood at defer(), so what the
+    // middlewares set (CORS, security headers) is kept; writes to `res` after
+    // defer() are ignored. Throws std::logic_error if not called from the
+    // handler running with `res`, or called twice.
+    DeferredResponse defer(Http::HttpResponse& res);
+
     // Server control
     bool listen(const std::string& host = "0.0.0.0", int port = 8080);
     void run();
@@ -195,6 +447,91 @@ private:
     // Parse the next buffered request (if any) and hand it to a worker. At most
     // one request per connection is in flight at a time to preserve ordering.
     void dispatch_next(int fd, const std::shared_ptr<Net::Connection>& conn);
+    // The route for `request` (GET's for a HEAD without its own), filling its
+    // path parameters; null for none. dispatch_next() matches each request
+    // once and hands the result on with it.
+    const RouteHandler* match_route(Http::HttpRequest& request) const;
+
+    // If `route` (the parsed request's) is inline and not demoted, run it here
+    // on the event loop against the connection's buffer and hand the response
+    // to the connection (or, if the handler deferred, leave it to the
+    // handle); false leaves the request to the workers. A route that
+    // overruns its budget kInlineStrikes times in close succession (see
+    // InlineRoute) is demoted.
+    bool run_inline(int fd, const std::shared_ptr<Net::Connection>& conn, std::size_t consumed,
+                    const RouteHandler* route);
+
+    // Run `request` (matched to `route`) on a worker and queue its response
+    // for the event loop. `flight` is the single-flight it leads (0 if none).
+    // With a bulkhead the request may instead wait in its queue or be shed (503).
+    void dispatch_to_worker(int fd, const std::shared_ptr<Net::Connection>& conn,
+                            std::shared_ptr<Http::HttpRequest> request, const RouteHandler* route,
+                            std::uint64_t flight, Bulkhead* bulkhead);
+    // Post an admitted request to its route's workers; `t_start` is when it
+    // was dispatched.
+    void run_on_worker(int fd, const std::shared_ptr<Net::Connection>& conn,
+                       std::shared_ptr<Http::HttpRequest> request, const RouteHandler* route, std::uint64_t flight,
+                       std::chrono::steady_clock::time_point t_start);
+    // The bulkhead of `route`, or null for the default pool (and no route).
+    Bulkhead* bulkhead_for(const RouteHandler* route) const;
+    // Start the queued requests whose bulkhead has a free worker again, and
+    // shed those that waited past max_queue_wait.
+    void drain_bulkheads();
+    // Answer a request its bulkhead shed with 503 (and its single-flight
+    // followers, if it led one).
+    void shed_pending(Bulkhead::Pending& pending);
+    // Load shedding for the default pool: whether a request for `bulkhead`
+    // (null: the default pool) would exceed max_concurrent_handlers, and the
+    // 503 for one that would. Every dispatch to the default pool checks it.
+    bool default_pool_full(const Bulkhead* bulkhead) const;
+    void shed_default(int fd, const std::shared_ptr<Net::Connection>& conn, bool head);
+
+    // Answer the followers of the single-flight `item` led.
+    void finish_flight(const CompletedResponse& item);
+
+    // Post-process a handler's response (ETag, compression, response cache,
+    // single-flight copy, Range/HEAD) and queue it for the event loop. Worker
+    // or completing thread.
+    void finish_response(int fd, const std::shared_ptr<Net::Connection>& conn, Http::HttpRequest& request,
+                         Http::HttpResponsePool::Handle res_handle, std::chrono::steady_clock::time_point t_start,
+                         std::uint64_t flight);
+    // The post-processing and metrics part of finish_response(); returns the
+    // followers' copy (null unless `flight` and a string body).
+    std::shared_ptr<const Http::CannedResponse> finalize_response(Http::HttpRequest& request,
+                                                                  Http::HttpResponse& res,
+                                                                  std::chrono::steady_clock::time_point t_start,
+                                                                  std::uint64_t flight);
+    // Event loop: hand a finished response to the connection and start writing.
+    void send_response(int fd, const std::shared_ptr<Net::Connection>& conn, Http::HttpResponse& res);
+
+    // Register a route with the router, after checking its bulkhead exists.
+    void add_route(Http::HttpMethod method, const std::string& path, RouteHandler handler,
+                   RouteOptions options);
+
+    // A RouteHandler that runs `handler` as a coroutine answering a deferred
+    // request; and, on the event loop, post the coroutines ready to resume.
+    RouteHandler coroutine_route(CoroutineHandler handler);
+    void resume_coroutines();
+
+    // DeferredResponse::complete(): fill and queue a deferred response once.
+    friend class DeferredResponse;
+    friend struct DeferredResponse::State;
+    bool complete_deferred(DeferredResponse::State& state, const std::function<void(Http::HttpResponse&)>& fill);
+
+    // Run the middleware chain and `route`, the request's matched handler,
+    // into `res` (worker thread). Returns false for a plain 404 (no route,
+    // nothing set by a middleware), which the caller answers with the canned
+    // bytes.
+    bool run_handler(Http::HttpRequest& request, Http::HttpResponse& res, const RouteHandler* route);
+
+    // Refresh a stale response-cache entry on a worker of the route's pool
+    // (called by the event loop on the stale hit that claimed it; a hit is not
+    // matched otherwise, so this matches the route). Skipped, for a later
+    // stale hit to retry, when that pool has no free worker.
+    void revalidate(std::shared_ptr<Http::HttpRequest> request);
+    // Store a revalidation's response in the cache (ETag and compression as
+    // for a client), or release the entry's refresh claim if it cannot be.
+    void finish_revalidation(Http::HttpRequest& request, Http::HttpResponse& res);
 
     // Re-arm a connection's fd in the event multiplexer for the given direction.
     // Returns false (and closes the connection) on failure. read=true arms for
@@ -207,6 +544,21 @@ private:
     void drain_wakeup();        // consume pending wakeup bytes
     void process_completions(); // write out responses queued by workers
 
+    // Start the connection's next file read on io_pool_; and, on the event
+    // loop, take finished reads and resume the connections waiting on them.
+    void submit_file_read(int fd, const std::shared_ptr<Net::Connection>& conn);
+    void process_file_reads();
+
+    // LL-HLS blocking reloads: park the request if its playlist has not
+    // reached the requested position yet (true: parked, nothing else to do);
+    // send the mount's changed playlists to io_pool_ to be reloaded; and, on
+    // the event loop, hand the reloads they satisfy to workers.
+    bool park_hls_reload(int fd, const std::shared_ptr<Net::Connection>& conn, const RouteHandler* route,
+                         std::size_t consumed);
+    void refresh_hls(std::size_t mount);
+    void process_hls_reloads();
+    void resume_hls(std::vector<HlsOrigin::Waiter> waiters);
+
     // Stop accepting new connections (close/deregister the listen socket) at the
     // start of a graceful drain.
     void stop_accepting();
@@ -215,9 +567,9 @@ private:
     // connection still buffering a request past read_timeout gets a 408 first.
     void enforce_timeouts();
 
-    // Best-effort write of a minimal status-only response (TLS-aware) before
-    // closing a timed-out connection.
-    void send_minimal_response(int fd, const char* bytes, size_t len);
+    // Best-effort write of a canned response (TLS-aware) before closing a
+    // timed-out connection.
+    void send_minimal_response(int fd, const Http::CannedResponse& canned);
     // 408: request took too long to arrive. 504: handler exceeded its deadline.
     void send_request_timeout(int fd);
     void send_handler_timeout(int fd);
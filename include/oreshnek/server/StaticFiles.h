@@ -0,0 +1,81 @@
+// oreshnek/include/oreshnek/server/StaticFiles.h
+#ifndef ORESHNEK_SERVER_STATICFILES_H
+#define ORESHNEK_SERVER_STATICFILES_H
+
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+#include "oreshnek/server/FileCache.h"
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Oreshnek {
+namespace Server {
+
+// Options for Server::mount_static().
+struct StaticOptions {
+    // File served for a directory request ("/static/docs/"); empty disables it.
+    std::string index = "index.html";
+    // Cache-Control sent with every file (empty: none). The framework adds
+    // ETag/Last-Modified, so revalidation after max-age is a cheap 304.
+    std::string cache_control = "public, max-age=3600";
+    // Serve names starting with '.' (".env", ".git/config"). Off by default.
+    bool dotfiles = false;
+    // Look for precompressed sidecars next to compressible files ("app.js.br",
+    // "app.js.gz"; see the oreshnek_precompress tool) and send them to clients
+    // that accept the coding. A sidecar older than its file is ignored.
+    bool precompressed = true;
+    // Open-file cache for this mount (max_entries = 0 disables it).
+    FileCacheOptions cache;
+};
+
+// A directory tree served read-only. The root is opened once (O_DIRECTORY) and
+// every lookup resolves relative to that descriptor, never through a path
+// string: on Linux with openat2(RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS), one
+// syscall that the kernel guarantees cannot leave the root; elsewhere (or on
+// kernels before 5.6) by walking the components with openat(O_NOFOLLOW). Symlinks
+// are never followed, so there is no check-then-open window for a link swapped
+// in underneath. The request path is percent-decoded and "." / ".." segments are
+// rejected before any syscall. Results (open files and 404/403s alike) are kept
+// in a FileCache keyed by the request path, so a hot file is served without
+// touching the filesystem. Thread-safe.
+class StaticDirectory {
+public:
+    // Throws std::runtime_error if `root` cannot be opened as a directory.
+    // `metrics` (optional) receives the cache counters.
+    explicit StaticDirectory(const std::string& root, StaticOptions options = {},
+                             Metrics* metrics = nullptr);
+    ~StaticDirectory();
+    StaticDirectory(const StaticDirectory&) = delete;
+    StaticDirectory& operator=(const StaticDirectory&) = delete;
+
+    // Resolve `relative` (as captured by a "*path" route, not yet decoded) and
+    // open it, following `index` for directories. Served from the cache when
+    // possible.
+    FileCache::Result open(std::string_view relative) const;
+
+    // Handler body: a file response for `relative`, or 301 (directory without
+    // trailing '/'), 403 or 404. Range, HEAD and conditional GET are applied by
+    // the server afterwards as for any file response.
+    void serve(const Http::HttpRequest& req, std::string_view relative, Http::HttpResponse& res) const;
+
+    const std::string& root() const { return root_; }
+    const StaticOptions& options() const { return options_; }
+    // Null when caching is disabled.
+    FileCache* cache() const { return cache_.get(); }
+
+private:
+    int open_beneath(const std::string& relative) const;
+    FileCache::Result resolve(std::string_view relative, FileCache::Watch& watch) const;
+
+    std::string root_;
+    std::string watch_root_; // Absolute root for inotify watches
+    StaticOptions options_;
+    int dir_fd_ = -1;
+    std::unique_ptr<FileCache> cache_;
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_STATICFILES_H
@@ -0,0 +1,120 @@
+// oreshnek/include/oreshnek/server/WorkStealingPool.h
+#ifndef ORESHNEK_SERVER_WORKSTEALINGPOOL_H
+#define ORESHNEK_SERVER_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Oreshnek {
+namespace Server {
+
+// A type-erased void() callable with inline storage: callables up to kInline
+// bytes (a lambda capturing a few pointers and shared_ptrs) live inside the
+// item, so posting one costs a single allocation; larger ones go to the heap.
+class WorkItem {
+public:
+    static constexpr std::size_t kInline = 64;
+
+    template <typename F>
+    explicit WorkItem(F&& fn) {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= kInline && alignof(Fn) <= alignof(std::max_align_t)) {
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(fn));
+            invoke_ = [](void* p) { (*static_cast<Fn*>(p))(); };
+            destroy_ = [](void* p) { static_cast<Fn*>(p)->~Fn(); };
+        } else {
+            ::new (static_cast<void*>(storage_)) Fn*(new Fn(std::forward<F>(fn)));
+            invoke_ = [](void* p) { (**static_cast<Fn**>(p))(); };
+            destroy_ = [](void* p) { delete *static_cast<Fn**>(p); };
+        }
+    }
+    ~WorkItem() { destroy_(storage_); }
+    WorkItem(const WorkItem&) = delete;
+    WorkItem& operator=(const WorkItem&) = delete;
+
+    void operator()() { invoke_(storage_); }
+
+private:
+    alignas(std::max_align_t) unsigned char storage_[kInline];
+    void (*invoke_)(void*);
+    void (*destroy_)(void*);
+};
+
+// Worker pool for the request handlers, built for many small tasks posted at
+// high rate:
+//
+// - Each worker owns a Chase–Lev deque: it pushes and pops at the bottom
+//   without locks, and idle workers steal from the top of the others'.
+// - Tasks posted from outside the pool (the event loop) go through a bounded
+//   lock-free MPMC injection queue, with a locked overflow list behind it.
+// - An idle worker spins briefly before parking on a futex, so bursts are
+//   picked up without a wake-up, and parked workers are only woken when work
+//   arrives and someone is asleep.
+// - post() is fire-and-forget: no packaged_task and no future per task.
+//
+// An exception escaping a task is logged and dropped; there is no future to
+// carry it.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(std::size_t threads = std::thread::hardware_concurrency(),
+                              std::size_t injection_capacity = 8192);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Run `fn` on a worker. From one of this pool's workers the task goes to
+    // its own deque (LIFO, cache-warm); from any other thread, to the
+    // injection queue (FIFO). Throws std::runtime_error after shutdown().
+    template <typename F>
+    void post(F&& fn) {
+        submit(new WorkItem(std::forward<F>(fn)));
+    }
+
+    // Stop accepting tasks, let the workers drain what is queued, join them.
+    void shutdown();
+
+    std::size_t size() const { return threads_.size(); }
+
+    // Tasks posted and not yet picked up by a worker (a load signal; racy by
+    // nature, exact only when quiescent).
+    std::size_t queue_depth() const;
+
+    // Tasks taken from another worker's deque since start.
+    std::uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+    // Index [0, size()) of the calling thread within the WorkStealingPool it
+    // belongs to, or -1 on any other thread. Lets callers keep per-worker state
+    // (e.g. response pools) without thread-id lookups.
+    static int current_worker_index();
+
+private:
+    struct Worker;
+    class InjectionQueue;
+
+    void submit(WorkItem* item);
+    static void run_task(WorkItem* item);
+    void run_worker(std::size_t index);
+    WorkItem* find_work(std::size_t index, std::uint64_t& rng);
+    bool has_work() const;
+    void wake_one();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::unique_ptr<InjectionQueue> injection_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint32_t> sleepers_{0};
+    std::atomic<std::uint32_t> wake_epoch_{0}; // Parked workers wait on this
+    std::atomic<std::uint64_t> steals_{0};
+};
+
+} // namespace Server
+} // namespace Oreshnek
+
+#endif // ORESHNEK_SERVER_WORKSTEALINGPOOL_H
@@ -0,0 +1,32 @@
+// oreshnek/include/oreshnek/utils/FileHandle.h
+#ifndef ORESHNEK_UTILS_FILEHANDLE_H
+#define ORESHNEK_UTILS_FILEHANDLE_H
+
+#include <unistd.h> // For close
+
+namespace Oreshnek {
+namespace Utils {
+
+// Owns an open file descriptor and closes it on destruction. File responses
+// hold one through a shared_ptr, so the descriptor a handler opened (or a cache
+// keeps open) stays valid until the connection has finished streaming it.
+// sendfile()/pread() take explicit offsets, so concurrent readers can share it.
+class FileHandle {
+public:
+    explicit FileHandle(int fd) noexcept : fd_(fd) {}
+    ~FileHandle() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    int fd() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+}  // namespace Utils
+}  // namespace Oreshnek
+
+#endif  // ORESHNEK_UTILS_FILEHANDLE_H
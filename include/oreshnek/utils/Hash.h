@@ -0,0 +1,20 @@
+// oreshnek/include/oreshnek/utils/Hash.h
+#ifndef ORESHNEK_UTILS_HASH_H
+#define ORESHNEK_UTILS_HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace Oreshnek {
+namespace Utils {
+
+// Fast non-cryptographic 64-bit hash of `data` (multiply-mix over 8-byte
+// words, several GB/s). Unlike std::hash the value is fixed by this code, so it
+// is the same in every process and build on hosts of the same endianness: safe
+// to put on the wire (ETags). Not for untrusted keys in hash tables.
+std::uint64_t hash64(std::string_view data, std::uint64_t seed = 0);
+
+}  // namespace Utils
+}  // namespace Oreshnek
+
+#endif  // ORESHNEK_UTILS_HASH_H
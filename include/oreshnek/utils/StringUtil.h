@@ -0,0 +1,37 @@
+// oreshnek/include/oreshnek/utils/StringUtil.h
+#ifndef ORESHNEK_UTILS_STRINGUTIL_H
+#define ORESHNEK_UTILS_STRINGUTIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Oreshnek {
+namespace Utils {
+
+// ASCII case-insensitive equality (header names, tokens, media types).
+bool iequals(std::string_view a, std::string_view b);
+
+// `s` without leading and trailing spaces and tabs (HTTP optional whitespace).
+std::string_view trim(std::string_view s);
+
+// Hash and equality for maps keyed by header names, so a lookup in any case
+// is still one probe. The hash folds ASCII letters to lower case (FNV-1a).
+struct CaseInsensitiveHash {
+    std::size_t operator()(std::string_view s) const {
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for (const char c : s) {
+            const unsigned char b = static_cast<unsigned char>(c);
+            h = (h ^ (b >= 'A' && b <= 'Z' ? b | 0x20 : b)) * 0x100000001b3ULL;
+        }
+        return static_cast<std::size_t>(h);
+    }
+};
+struct CaseInsensitiveEqual {
+    bool operator()(std::string_view a, std::string_view b) const { return iequals(a, b); }
+};
+
+}  // namespace Utils
+}  // namespace Oreshnek
+
+#endif  // ORESHNEK_UTILS_STRINGUTIL_H
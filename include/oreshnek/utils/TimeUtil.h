@@ -0,0 +1,28 @@
+// oreshnek/include/oreshnek/utils/TimeUtil.h
+#ifndef ORESHNEK_UTILS_TIMEUTIL_H
+#define ORESHNEK_UTILS_TIMEUTIL_H
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+namespace Oreshnek {
+namespace Utils {
+
+// Length of an IMF-fixdate HTTP date ("Sun, 06 Nov 1994 08:49:37 GMT").
+constexpr std::size_t kHttpDateLen = 29;
+
+// The current time as an IMF-fixdate (RFC 7231 §7.1.1.1), locale-independent
+// and always kHttpDateLen bytes (the canned responses splice it in place). The
+// value changes only once per second, so it is cached per thread; the returned
+// view stays valid until the calling thread asks again in a later second.
+std::string_view http_date_now();
+
+// `t` as an IMF-fixdate, locale-independent (Last-Modified, Expires).
+std::string http_date(std::time_t t);
+
+}  // namespace Utils
+}  // namespace Oreshnek
+
+#endif  // ORESHNEK_UTILS_TIMEUTIL_H
@@ -0,0 +1,69 @@
+// oreshnek/src/http/CannedResponse.cpp
+#include "oreshnek/http/CannedResponse.h"
+#include "oreshnek/utils/StringUtil.h"
+#include "oreshnek/utils/TimeUtil.h"
+
+#include <stdexcept>
+
+namespace Oreshnek {
+namespace Http {
+
+CannedResponse::CannedResponse(const HttpResponse& templ) : status_(templ.get_status()) {
+    if (templ.is_file()) {
+        throw std::invalid_argument("CannedResponse: file responses cannot be canned");
+    }
+    templ.serialize_headers(bytes_);
+    // serialize_headers() always emits the Date line second; remember where its
+    // (fixed-width) value sits so senders can splice in the current date.
+    const std::size_t date = bytes_.find("\r\nDate: ");
+    date_offset_ = date + 8;
+    header_len_ = bytes_.size();
+    bytes_ += templ.get_body_string();
+
+    auto connection = templ.get_header("Connection");
+    closes_ = connection && Utils::iequals(*connection, "close");
+}
+
+std::array<std::string_view, 3> CannedResponse::segments(std::string_view date,
+                                                         bool head_only) const {
+    const std::string_view all(bytes_.data(), size(head_only));
+    return {all.substr(0, date_offset_), date, all.substr(date_offset_ + Utils::kHttpDateLen)};
+}
+
+CannedResponseRegistry::CannedResponseRegistry() {
+    HttpResponse r;
+    r.status(HttpStatus::NOT_FOUND).body(std::string(R"({"error":"Not Found"})"));
+    r.header("Content-Type", "application/json");
+    set(r);
+
+    r.reset();
+    r.status(HttpStatus::TOO_MANY_REQUESTS).body(std::string(R"({"error":"Too Many Requests"})"));
+    r.header("Content-Type", "application/json").header("Retry-After", "1");
+    set(r);
+
+    r.reset();
+    r.status(HttpStatus::SERVICE_UNAVAILABLE).body(std::string(R"({"error":"Service Unavailable"})"));
+    r.header("Content-Type", "application/json").header("Retry-After", "1");
+    set(r);
+
+    // Timeouts close the connection right after the response.
+    r.reset();
+    r.status(HttpStatus::REQUEST_TIMEOUT).header("Connection", "close");
+    set(r);
+
+    r.reset();
+    r.status(HttpStatus::GATEWAY_TIMEOUT).header("Connection", "close");
+    set(r);
+}
+
+void CannedResponseRegistry::set(const HttpResponse& templ) {
+    entries_.insert_or_assign(static_cast<int>(templ.get_status()), CannedResponse(templ));
+}
+
+const CannedResponse* CannedResponseRegistry::find(HttpStatus status) const {
+    auto it = entries_.find(static_cast<int>(status));
+    return it != entries_.end() ? &it->second : nullptr;
+}
+
+} // namespace Http
+} // namespace Oreshnek
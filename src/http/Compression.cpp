@@ -5,33 +5,365 @@
 #ifdef ORESHNEK_HAVE_BROTLI
 #include <brotli/encode.h>
 #endif
+#ifdef ORESHNEK_HAVE_ZSTD
+#include <zstd.h>
+#endif
 
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib> // For malloc, free
+#include <utility>
+#include <vector>
 
 namespace Oreshnek {
 namespace Http {
 
-std::string gzip_compress(std::string_view input, int level) {
-    z_stream zs{};
-    // windowBits 15 + 16 selects the gzip wrapper (instead of raw zlib).
-    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
-        return {};
+const char* content_coding(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::Gzip: return "gzip";
+        case Encoding::Brotli: return "br";
+        case Encoding::Zstd: return "zstd";
+        case Encoding::None: break;
+    }
+    return nullptr;
+}
+
+bool is_compressible_type(std::string_view content_type) {
+    auto starts_with = [content_type](std::string_view prefix) {
+        if (content_type.size() < prefix.size()) return false;
+        for (std::size_t i = 0; i < prefix.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(content_type[i])) != prefix[i]) return false;
+        }
+        return true;
+    };
+    if (starts_with("text/")) return true;
+    static constexpr std::string_view kTypes[] = {
+        "application/json", "application/javascript", "application/xml",
+        "application/x-mpegurl", "application/vnd.apple.mpegurl",
+        "application/dash+xml", "application/manifest+json", "image/svg+xml",
+    };
+    for (std::string_view t : kTypes) {
+        if (starts_with(t)) return true;
+    }
+    return false;
+}
+
+bool encoding_available(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::Gzip: return true;
+        case Encoding::Brotli: return brotli_available();
+        case Encoding::Zstd: return zstd_available();
+        case Encoding::None: break;
+    }
+    return false;
+}
+
+int default_level(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::Gzip: return 6;
+        case Encoding::Brotli: return 5;
+        case Encoding::Zstd: return 3;
+        case Encoding::None: break;
+    }
+    return 0;
+}
+
+namespace {
+// Output is produced straight into the caller's string: grow it, let the codec
+// fill the spare tail, then trim to what was written.
+constexpr std::size_t kMinRoom = 16 * 1024;
+constexpr std::size_t kMaxRoom = 256 * 1024;
+
+std::size_t make_room(std::string& out) {
+    const std::size_t used = out.size();
+    const std::size_t room = std::clamp(out.capacity() - used, kMinRoom, kMaxRoom);
+    out.resize(used + room);
+    return room;
+}
+
+#ifdef ORESHNEK_HAVE_BROTLI
+// Brotli cannot reset an encoder, so every stream creates one. Its allocations
+// (hash tables, ring buffer) have the same sizes stream after stream at a given
+// quality, so freed blocks are kept per thread and handed back on the next
+// request of the same size instead of going through malloc.
+thread_local bool t_block_cache_gone = false; // Set once this thread's cache is destroyed
+
+class BlockCache {
+public:
+    static constexpr std::size_t kMaxBytes = 8 * 1024 * 1024;
+    static constexpr std::size_t kMaxBlocks = 64;
+    static constexpr std::size_t kHeader = alignof(std::max_align_t);
+
+    ~BlockCache() {
+        for (const Block& b : free_) std::free(b.base);
+        t_block_cache_gone = true;
+    }
+
+    void* alloc(std::size_t size) {
+        for (std::size_t i = 0; i < free_.size(); ++i) {
+            if (free_[i].size != size) continue;
+            void* base = free_[i].base;
+            cached_ -= size;
+            free_[i] = free_.back();
+            free_.pop_back();
+            return static_cast<char*>(base) + kHeader;
+        }
+        void* base = std::malloc(kHeader + size);
+        if (base == nullptr) return nullptr;
+        *static_cast<std::size_t*>(base) = size;
+        return static_cast<char*>(base) + kHeader;
+    }
+
+    void release(void* p) {
+        void* base = static_cast<char*>(p) - kHeader;
+        const std::size_t size = *static_cast<std::size_t*>(base);
+        if (cached_ + size > kMaxBytes || free_.size() >= kMaxBlocks) {
+            std::free(base);
+            return;
+        }
+        free_.push_back(Block{base, size});
+        cached_ += size;
+    }
+
+    static void release_any(void* p) {
+        // After this thread's cache is gone (thread exit), blocks go back to
+        // malloc directly; they all carry the same header.
+        if (t_block_cache_gone) std::free(static_cast<char*>(p) - kHeader);
+        else instance().release(p);
+    }
+
+    static BlockCache& instance() {
+        thread_local BlockCache cache;
+        return cache;
+    }
+
+private:
+    struct Block {
+        void* base;
+        std::size_t size;
+    };
+    std::vector<Block> free_;
+    std::size_t cached_ = 0;
+};
+
+void* brotli_alloc(void*, std::size_t size) { return BlockCache::instance().alloc(size); }
+void brotli_free(void*, void* p) {
+    if (p != nullptr) BlockCache::release_any(p);
+}
+#endif
+} // namespace
+
+struct StreamCompressor::Codecs {
+    z_stream zlib{};
+    bool zlib_ready = false;
+    int zlib_level = 0;
+#ifdef ORESHNEK_HAVE_BROTLI
+    BrotliEncoderState* brotli = nullptr;
+#endif
+#ifdef ORESHNEK_HAVE_ZSTD
+    ZSTD_CCtx* zstd = nullptr;
+#endif
+
+    ~Codecs() {
+        if (zlib_ready) deflateEnd(&zlib);
+#ifdef ORESHNEK_HAVE_BROTLI
+        if (brotli != nullptr) BrotliEncoderDestroyInstance(brotli);
+#endif
+#ifdef ORESHNEK_HAVE_ZSTD
+        if (zstd != nullptr) ZSTD_freeCCtx(zstd);
+#endif
+    }
+};
+
+StreamCompressor::StreamCompressor() : codecs_(std::make_unique<Codecs>()) {}
+StreamCompressor::~StreamCompressor() = default;
+
+bool StreamCompressor::begin(Encoding encoding, int level, std::size_t total_size) {
+    Codecs& c = *codecs_;
+    encoding_ = Encoding::None;
+    switch (encoding) {
+        case Encoding::Gzip:
+            if (!c.zlib_ready) {
+                // windowBits 15 + 16 selects the gzip wrapper (instead of raw zlib).
+                if (deflateInit2(&c.zlib, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+                c.zlib_ready = true;
+                c.zlib_level = level;
+            } else {
+                // Keeps the allocated window and hash chains.
+                if (deflateReset(&c.zlib) != Z_OK) return false;
+                if (level != c.zlib_level) {
+                    if (deflateParams(&c.zlib, level, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+                    c.zlib_level = level;
+                }
+            }
+            break;
+        case Encoding::Brotli:
+#ifdef ORESHNEK_HAVE_BROTLI
+            if (c.brotli != nullptr) BrotliEncoderDestroyInstance(c.brotli);
+            c.brotli = BrotliEncoderCreateInstance(brotli_alloc, brotli_free, nullptr);
+            if (c.brotli == nullptr) return false;
+            BrotliEncoderSetParameter(c.brotli, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(level));
+            BrotliEncoderSetParameter(c.brotli, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+            if (total_size > 0 && total_size <= (1u << 30)) {
+                BrotliEncoderSetParameter(c.brotli, BROTLI_PARAM_SIZE_HINT, static_cast<uint32_t>(total_size));
+            }
+            break;
+#else
+            return false;
+#endif
+        case Encoding::Zstd:
+#ifdef ORESHNEK_HAVE_ZSTD
+            if (c.zstd == nullptr && (c.zstd = ZSTD_createCCtx()) == nullptr) return false;
+            ZSTD_CCtx_reset(c.zstd, ZSTD_reset_session_and_parameters);
+            if (ZSTD_isError(ZSTD_CCtx_setParameter(c.zstd, ZSTD_c_compressionLevel, level))) return false;
+            if (total_size > 0) ZSTD_CCtx_setPledgedSrcSize(c.zstd, total_size);
+            break;
+#else
+            return false;
+#endif
+        case Encoding::None:
+            return false;
+    }
+    encoding_ = encoding;
+    return true;
+}
+
+bool StreamCompressor::write(std::string_view input, std::string& out, bool flush) {
+    Codecs& c = *codecs_;
+    switch (encoding_) {
+        case Encoding::Gzip: {
+            c.zlib.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+            c.zlib.avail_in = static_cast<uInt>(input.size());
+            const int mode = flush ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+            do {
+                const std::size_t used = out.size();
+                const std::size_t room = make_room(out);
+                c.zlib.next_out = reinterpret_cast<Bytef*>(out.data() + used);
+                c.zlib.avail_out = static_cast<uInt>(room);
+                const int ret = deflate(&c.zlib, mode);
+                out.resize(used + room - c.zlib.avail_out);
+                if (ret == Z_STREAM_ERROR) return false;
+            } while (c.zlib.avail_out == 0); // Output space left over: input consumed, flush done
+            return true;
+        }
+        case Encoding::Brotli: {
+#ifdef ORESHNEK_HAVE_BROTLI
+            std::size_t avail_in = input.size();
+            const uint8_t* next_in = reinterpret_cast<const uint8_t*>(input.data());
+            const BrotliEncoderOperation op = flush ? BROTLI_OPERATION_FLUSH : BROTLI_OPERATION_PROCESS;
+            for (;;) {
+                const std::size_t used = out.size();
+                const std::size_t room = make_room(out);
+                std::size_t avail_out = room;
+                uint8_t* next_out = reinterpret_cast<uint8_t*>(out.data() + used);
+                const bool ok = BrotliEncoderCompressStream(c.brotli, op, &avail_in, &next_in,
+                                                            &avail_out, &next_out, nullptr);
+                out.resize(used + room - avail_out);
+                if (!ok) return false;
+                if (avail_in == 0 && !BrotliEncoderHasMoreOutput(c.brotli)) return true;
+            }
+#else
+            return false;
+#endif
+        }
+        case Encoding::Zstd: {
+#ifdef ORESHNEK_HAVE_ZSTD
+            ZSTD_inBuffer in{input.data(), input.size(), 0};
+            const ZSTD_EndDirective mode = flush ? ZSTD_e_flush : ZSTD_e_continue;
+            for (;;) {
+                const std::size_t used = out.size();
+                const std::size_t room = make_room(out);
+                ZSTD_outBuffer o{out.data() + used, room, 0};
+                const std::size_t remaining = ZSTD_compressStream2(c.zstd, &o, &in, mode);
+                out.resize(used + o.pos);
+                if (ZSTD_isError(remaining)) return false;
+                if (flush ? remaining == 0 : in.pos == in.size) return true;
+            }
+#else
+            return false;
+#endif
+        }
+        case Encoding::None:
+            break;
+    }
+    return false;
+}
+
+bool StreamCompressor::finish(std::string& out) {
+    Codecs& c = *codecs_;
+    const Encoding encoding = encoding_;
+    encoding_ = Encoding::None;
+    switch (encoding) {
+        case Encoding::Gzip: {
+            c.zlib.next_in = nullptr;
+            c.zlib.avail_in = 0;
+            for (;;) {
+                const std::size_t used = out.size();
+                const std::size_t room = make_room(out);
+                c.zlib.next_out = reinterpret_cast<Bytef*>(out.data() + used);
+                c.zlib.avail_out = static_cast<uInt>(room);
+                const int ret = deflate(&c.zlib, Z_FINISH);
+                out.resize(used + room - c.zlib.avail_out);
+                if (ret == Z_STREAM_END) return true;
+                if (ret != Z_OK && ret != Z_BUF_ERROR) return false;
+            }
+        }
+        case Encoding::Brotli: {
+#ifdef ORESHNEK_HAVE_BROTLI
+            std::size_t avail_in = 0;
+            const uint8_t* next_in = nullptr;
+            bool ok = true;
+            while (ok && !BrotliEncoderIsFinished(c.brotli)) {
+                const std::size_t used = out.size();
+                const std::size_t room = make_room(out);
+                std::size_t avail_out = room;
+                uint8_t* next_out = reinterpret_cast<uint8_t*>(out.data() + used);
+                ok = BrotliEncoderCompressStream(c.brotli, BROTLI_OPERATION_FINISH, &avail_in, &next_in,
+                                                 &avail_out, &next_out, nullptr);
+                out.resize(used + room - avail_out);
+            }
+            // Done with this encoder: its blocks go back to the thread's cache.
+            BrotliEncoderDestroyInstance(c.brotli);
+            c.brotli = nullptr;
+            return ok;
+#else
+            return false;
+#endif
+        }
+        case Encoding::Zstd: {
+#ifdef ORESHNEK_HAVE_ZSTD
+            ZSTD_inBuffer in{nullptr, 0, 0};
+            for (;;) {
+                const std::size_t used = out.size();
+                const std::size_t room = make_room(out);
+                ZSTD_outBuffer o{out.data() + used, room, 0};
+                const std::size_t remaining = ZSTD_compressStream2(c.zstd, &o, &in, ZSTD_e_end);
+                out.resize(used + o.pos);
+                if (ZSTD_isError(remaining)) return false;
+                if (remaining == 0) return true;
+            }
+#else
+            return false;
+#endif
+        }
+        case Encoding::None:
+            break;
     }
-    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
-    zs.avail_in = static_cast<uInt>(input.size());
+    return false;
+}
 
+bool compress(Encoding encoding, std::string_view input, std::string& out, int level) {
+    thread_local StreamCompressor compressor;
+    out.clear();
+    if (!compressor.begin(encoding, level, input.size())) return false;
+    return compressor.write(input, out) && compressor.finish(out);
+}
+
+std::string gzip_compress(std::string_view input, int level) {
     std::string out;
-    char buf[32768];
-    int ret;
-    do {
-        zs.next_out = reinterpret_cast<Bytef*>(buf);
-        zs.avail_out = sizeof(buf);
-        ret = deflate(&zs, Z_FINISH);
-        out.append(buf, sizeof(buf) - zs.avail_out);
-    } while (ret == Z_OK);
-    deflateEnd(&zs);
-
-    if (ret != Z_STREAM_END) return {};
+    if (!compress(Encoding::Gzip, input, out, level)) return {};
     return out;
 }
 
@@ -44,24 +376,24 @@ bool brotli_available() {
 }
 
 std::string brotli_compress(std::string_view input, int quality) {
-#ifdef ORESHNEK_HAVE_BROTLI
-    size_t out_size = BrotliEncoderMaxCompressedSize(input.size());
-    if (out_size == 0) out_size = input.size() + 1024;
-    std::string out(out_size, '\0');
-    size_t encoded_size = out_size;
-    BROTLI_BOOL ok = BrotliEncoderCompress(
-        quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
-        input.size(), reinterpret_cast<const uint8_t*>(input.data()),
-        &encoded_size, reinterpret_cast<uint8_t*>(out.data()));
-    if (!ok) return {};
-    out.resize(encoded_size);
+    std::string out;
+    if (!compress(Encoding::Brotli, input, out, quality)) return {};
     return out;
+}
+
+bool zstd_available() {
+#ifdef ORESHNEK_HAVE_ZSTD
+    return true;
 #else
-    (void)input;
-    (void)quality;
-    return {};
+    return false;
 #endif
 }
 
+std::string zstd_compress(std::string_view input, int level) {
+    std::string out;
+    if (!compress(Encoding::Zstd, input, out, level)) return {};
+    return out;
+}
+
 }  // namespace Http
 }  // namespace Oreshnek
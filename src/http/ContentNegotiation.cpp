@@ -0,0 +1,87 @@
+// oreshnek/src/http/ContentNegotiation.cpp
+#include "oreshnek/http/ContentNegotiation.h"
+#include "oreshnek/utils/StringUtil.h"
+
+#include <charconv> // For std::from_chars
+
+namespace Oreshnek {
+namespace Http {
+
+namespace {
+using Utils::iequals;
+using Utils::trim;
+
+// Media type without parameters, e.g. "application/msgpack".
+std::string_view media_type(std::string_view value) {
+    return trim(value.substr(0, value.find(';')));
+}
+
+std::optional<BodyFormat> format_of(std::string_view type) {
+    if (iequals(type, "application/json")) return BodyFormat::Json;
+    if (iequals(type, "application/msgpack") || iequals(type, "application/x-msgpack") ||
+        iequals(type, "application/vnd.msgpack")) {
+        return BodyFormat::MsgPack;
+    }
+    if (iequals(type, "application/cbor")) return BodyFormat::Cbor;
+    return std::nullopt;
+}
+
+// q-value of one Accept element ("type;q=0.5;..."), 1 when absent.
+double quality(std::string_view element) {
+    std::size_t semi = element.find(';');
+    while (semi != std::string_view::npos) {
+        std::string_view rest = element.substr(semi + 1);
+        const std::size_t next = rest.find(';');
+        std::string_view param = trim(rest.substr(0, next));
+        if (param.size() >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+            double q = 1.0;
+            std::from_chars(param.data() + 2, param.data() + param.size(), q);
+            return q;
+        }
+        semi = next == std::string_view::npos ? next : semi + 1 + next;
+    }
+    return 1.0;
+}
+} // namespace
+
+BodyFormat negotiate_body_format(std::optional<std::string_view> accept) {
+    if (!accept) return BodyFormat::Json;
+    // Best q per format; JSON also inherits wildcard ranges.
+    double q_json = -1, q_msgpack = -1, q_cbor = -1, q_wild = -1;
+    std::string_view rest = *accept;
+    while (!rest.empty()) {
+        const std::size_t comma = rest.find(',');
+        const std::string_view element = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+
+        const std::string_view type = media_type(element);
+        const double q = quality(element);
+        if (type == "*/*" || iequals(type, "application/*")) {
+            if (q > q_wild) q_wild = q;
+        } else if (auto f = format_of(type)) {
+            double& slot = *f == BodyFormat::Json ? q_json : *f == BodyFormat::MsgPack ? q_msgpack : q_cbor;
+            if (q > slot) slot = q;
+        }
+    }
+    if (q_json < 0) q_json = q_wild;
+    if (q_msgpack > 0 && q_msgpack > q_json && q_msgpack >= q_cbor) return BodyFormat::MsgPack;
+    if (q_cbor > 0 && q_cbor > q_json) return BodyFormat::Cbor;
+    return BodyFormat::Json;
+}
+
+BodyFormat body_format_from_content_type(std::optional<std::string_view> content_type) {
+    if (!content_type) return BodyFormat::Json;
+    return format_of(media_type(*content_type)).value_or(BodyFormat::Json);
+}
+
+std::string_view content_type_for(BodyFormat format) {
+    switch (format) {
+        case BodyFormat::MsgPack: return "application/msgpack";
+        case BodyFormat::Cbor: return "application/cbor";
+        case BodyFormat::Json: break;
+    }
+    return "application/json";
+}
+
+} // namespace Http
+} // namespace Oreshnek
@@ -0,0 +1,199 @@
+// oreshnek/src/http/FileEntry.cpp
+#include "oreshnek/http/FileEntry.h"
+#include "oreshnek/utils/TimeUtil.h"
+#include <cerrno>
+#include <cstdio>     // For snprintf
+#include <fcntl.h>    // For open
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close, pread
+
+namespace Oreshnek {
+namespace Http {
+
+FileEntry::FileEntry(int fd, int64_t size_, int64_t mtime_, std::string_view type)
+    : file(fd), size(size_), mtime(mtime_), content_type(type) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "\"%llx-%llx\"", static_cast<unsigned long long>(size),
+                  static_cast<unsigned long long>(mtime));
+    etag = buf;
+    last_modified = Utils::http_date(static_cast<std::time_t>(mtime));
+}
+
+namespace {
+// Read the whole file with pread (the descriptor's offset is left alone).
+bool read_all(int fd, std::string& out, std::size_t size) {
+    out.resize(size);
+    std::size_t done = 0;
+    while (done < size) {
+        const ssize_t n = ::pread(fd, out.data() + done, size - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false; // Error, or truncated underneath us
+        done += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Keep a compressed variant only when it saves something.
+void keep_if_smaller(std::string& variant, std::size_t original) {
+    if (variant.size() >= original) std::string().swap(variant);
+    else variant.shrink_to_fit();
+}
+
+// A sidecar is usable if it is a regular file no older than the original (an
+// edit without re-running the precompressor must not serve stale bytes).
+std::shared_ptr<const FileEntry> open_sidecar(int fd, int64_t original_mtime, std::string_view content_type) {
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_mtime < original_mtime) {
+        ::close(fd);
+        return nullptr;
+    }
+    auto entry = std::make_shared<FileEntry>(fd, static_cast<int64_t>(st.st_size),
+                                             static_cast<int64_t>(st.st_mtime), content_type);
+    entry->device = static_cast<uint64_t>(st.st_dev);
+    entry->inode = static_cast<uint64_t>(st.st_ino);
+    return entry;
+}
+
+// "<size>-<mtime>" -> "<size>-<mtime><suffix>".
+std::string variant_etag(const std::string& etag, const char* suffix) {
+    return etag.substr(0, etag.size() - 1) + suffix + "\"";
+}
+
+// Fill one in-memory variant: from the sidecar when there is one, otherwise by
+// compressing the contents. That runs on the request that misses the cache,
+// and again on every refill, so at the default level: a sidecar is the way to
+// ship maximum-quality variants.
+// Returns the ETag the variant derives from (empty if none was built).
+template <typename Compress>
+std::string load_variant(std::string& out, const std::shared_ptr<const FileEntry>& sidecar,
+                         const std::string& contents, std::size_t memory_limit, bool compressible,
+                         const std::string& etag, Compress&& compress) {
+    if (sidecar && static_cast<std::size_t>(sidecar->size) <= memory_limit &&
+        read_all(sidecar->file.fd(), out, static_cast<std::size_t>(sidecar->size))) {
+        keep_if_smaller(out, contents.size());
+        return out.empty() ? std::string() : sidecar->etag;
+    }
+    if (!compressible) return {};
+    out = compress(contents);
+    keep_if_smaller(out, contents.size());
+    return out.empty() ? std::string() : etag;
+}
+} // namespace
+
+bool FileEntry::has_encoding(Encoding encoding) const {
+    if (encoding == Encoding::None) return true;
+    return in_memory ? !body(encoding).empty() : sidecar(encoding) != nullptr;
+}
+
+int64_t FileEntry::size_for(Encoding encoding) const {
+    if (encoding == Encoding::None) return size;
+    if (in_memory) return static_cast<int64_t>(body(encoding).size());
+    const std::shared_ptr<const FileEntry>& side = sidecar(encoding);
+    return side ? side->size : -1;
+}
+
+std::string_view FileEntry::body(Encoding encoding) const {
+    switch (encoding) {
+        case Encoding::Gzip: return gzip;
+        case Encoding::Brotli: return brotli;
+        case Encoding::Zstd: return {}; // Not precomputed
+        case Encoding::None: break;
+    }
+    return contents;
+}
+
+const std::shared_ptr<const FileEntry>& FileEntry::sidecar(Encoding encoding) const {
+    static const std::shared_ptr<const FileEntry> kNone;
+    switch (encoding) {
+        case Encoding::Gzip: return gzip_file;
+        case Encoding::Brotli: return brotli_file;
+        case Encoding::Zstd:
+        case Encoding::None: break;
+    }
+    return kNone;
+}
+
+const std::string& FileEntry::etag_for(Encoding encoding) const {
+    switch (encoding) {
+        case Encoding::Gzip: return etag_gzip;
+        case Encoding::Brotli: return etag_brotli;
+        case Encoding::Zstd:
+        case Encoding::None: break;
+    }
+    return etag;
+}
+
+std::shared_ptr<const FileEntry> FileEntry::from_fd(int fd, std::string_view content_type,
+                                                    std::size_t memory_limit, FileSidecars sidecars) {
+    struct stat st;
+    int err = 0;
+    if (::fstat(fd, &st) != 0) err = errno;
+    else if (S_ISDIR(st.st_mode)) err = EISDIR;
+    else if (!S_ISREG(st.st_mode)) err = EINVAL;
+    if (err != 0) {
+        ::close(fd);
+        if (sidecars.gzip_fd >= 0) ::close(sidecars.gzip_fd);
+        if (sidecars.brotli_fd >= 0) ::close(sidecars.brotli_fd);
+        errno = err;
+        return nullptr;
+    }
+    auto entry = std::make_shared<FileEntry>(fd, static_cast<int64_t>(st.st_size),
+                                             static_cast<int64_t>(st.st_mtime), content_type);
+    entry->device = static_cast<uint64_t>(st.st_dev);
+    entry->inode = static_cast<uint64_t>(st.st_ino);
+    auto gz = open_sidecar(sidecars.gzip_fd, entry->mtime, content_type);
+    auto br = open_sidecar(sidecars.brotli_fd, entry->mtime, content_type);
+
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    std::string gz_tag, br_tag; // Validators the variants derive from
+    if (size > 0 && size <= memory_limit && read_all(fd, entry->contents, size)) {
+        entry->in_memory = true;
+        const bool compressible = is_compressible_type(content_type);
+        gz_tag = load_variant(entry->gzip, gz, entry->contents, memory_limit, compressible, entry->etag,
+                              [](const std::string& in) { return gzip_compress(in, default_level(Encoding::Gzip)); });
+        br_tag = load_variant(entry->brotli, br, entry->contents, memory_limit, compressible, entry->etag,
+                              [](const std::string& in) { return brotli_compress(in, default_level(Encoding::Brotli)); });
+    } else {
+        std::string().swap(entry->contents);
+        if (gz && gz->size < entry->size) {
+            gz_tag = gz->etag;
+            entry->gzip_file = std::move(gz);
+        }
+        if (br && br->size < entry->size) {
+            br_tag = br->etag;
+            entry->brotli_file = std::move(br);
+        }
+    }
+    if (!gz_tag.empty()) entry->etag_gzip = variant_etag(gz_tag, "-gz");
+    if (!br_tag.empty()) entry->etag_brotli = variant_etag(br_tag, "-br");
+    return entry;
+}
+
+std::shared_ptr<const FileEntry> FileEntry::from_memory(std::string contents, std::string_view content_type,
+                                                      int64_t mtime, std::string etag, int gzip_level,
+                                                      int brotli_quality) {
+    auto entry = std::make_shared<FileEntry>(-1, static_cast<int64_t>(contents.size()), mtime, content_type);
+    entry->etag = std::move(etag);
+    entry->in_memory = true;
+    entry->contents = std::move(contents);
+    if (!entry->contents.empty() && is_compressible_type(content_type)) {
+        entry->gzip = gzip_compress(entry->contents, gzip_level);
+        keep_if_smaller(entry->gzip, entry->contents.size());
+        entry->brotli = brotli_compress(entry->contents, brotli_quality);
+        keep_if_smaller(entry->brotli, entry->contents.size());
+    }
+    if (!entry->gzip.empty()) entry->etag_gzip = variant_etag(entry->etag, "-gz");
+    if (!entry->brotli.empty()) entry->etag_brotli = variant_etag(entry->etag, "-br");
+    return entry;
+}
+
+std::shared_ptr<const FileEntry> FileEntry::open(const std::string& path, std::string_view content_type,
+                                                 std::size_t memory_limit) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    return from_fd(fd, content_type, memory_limit);
+}
+
+} // namespace Http
+} // namespace Oreshnek
@@ -1,6 +1,7 @@
 // oreshnek/src/http/HttpRequest.cpp
 #include "oreshnek/http/HttpRequest.h"
 #include "oreshnek/utils/Logger.h"
+#include "oreshnek/utils/StringUtil.h"
 #include <sstream>
 
 namespace Oreshnek {
@@ -13,9 +14,9 @@ inline std::string_view shift_view(std::string_view v, const char* old_base, con
     return std::string_view(new_base + (v.data() - old_base), v.size());
 }
 // Rebuild a <view,view> map with every key/value repointed.
-inline void shift_map(std::unordered_map<std::string_view, std::string_view>& m,
-                      const char* old_base, const char* new_base) {
-    std::unordered_map<std::string_view, std::string_view> rebuilt;
+template <typename Map>
+inline void shift_map(Map& m, const char* old_base, const char* new_base) {
+    Map rebuilt;
     rebuilt.reserve(m.size());
     for (const auto& [k, v] : m) {
         rebuilt.emplace(shift_view(k, old_base, new_base), shift_view(v, old_base, new_base));
@@ -31,8 +32,9 @@ void HttpRequest::rebase_views(const char* old_base, const char* new_base) {
     body_ = shift_view(body_, old_base, new_base);
     shift_map(headers_, old_base, new_base);
     shift_map(query_params_, old_base, new_base);
-    // path_params_ keys point at Router-owned storage, not the request buffer,
-    // and are only populated after make_owned(); leave them untouched here.
+    // The event loop matches the route on the parsed views, before the owning
+    // copy: the values follow the path (the names are Router-owned).
+    path_params_.rebase(old_base, new_base);
 }
 
 void HttpRequest::make_owned(const char* base, size_t len) {
@@ -73,9 +75,6 @@ void HttpRequest::move_from(HttpRequest&& other) noexcept {
 }
 
 std::optional<std::string_view> HttpRequest::header(std::string_view name) const {
-    // For case-insensitive lookup, consider storing keys in a normalized (e.g., lowercase) format
-    // or using a case-insensitive string_view comparator for the map.
-    // For now, it's a direct lookup.
     auto it = headers_.find(name);
     if (it != headers_.end()) {
         return it->second;
@@ -92,19 +91,39 @@ std::optional<std::string_view> HttpRequest::query(std::string_view name) const
 }
 
 std::optional<std::string_view> HttpRequest::param(std::string_view name) const {
-    auto it = path_params_.find(name);
-    if (it != path_params_.end()) {
-        return it->second;
+    return path_params_.find(name);
+}
+
+bool HttpRequest::if_none_match(std::string_view etag) const {
+    auto header_value = header("If-None-Match");
+    if (!header_value) return false;
+    auto opaque = [](std::string_view tag) {
+        if (tag.size() >= 2 && tag[0] == 'W' && tag[1] == '/') tag.remove_prefix(2);
+        return tag;
+    };
+    etag = opaque(etag);
+    std::string_view list = *header_value;
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        const std::string_view item = Utils::trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        if (item == "*" || opaque(item) == etag) return true;
     }
-    return std::nullopt;
+    return false;
 }
 
 nlohmann::json HttpRequest::json() const {
     if (body_.empty()) {
         throw std::runtime_error("HTTP Request body is empty, cannot parse JSON.");
     }
-    // Check Content-Type header if present
+    // Check Content-Type header if present; binary encodings of the JSON data
+    // model (MessagePack, CBOR) are decoded symmetrically to what json() sends.
     auto content_type_header = header("Content-Type");
+    switch (body_format_from_content_type(content_type_header)) {
+        case BodyFormat::MsgPack: return nlohmann::json::from_msgpack(body_.begin(), body_.end());
+        case BodyFormat::Cbor: return nlohmann::json::from_cbor(body_.begin(), body_.end());
+        case BodyFormat::Json: break;
+    }
     if (content_type_header && content_type_header->find("application/json") == std::string_view::npos) {
         // Log a warning, but still attempt to parse if a body exists.
         ORE_LOG(WARN) << "Attempting to parse JSON from non-JSON Content-Type: " << *content_type_header;
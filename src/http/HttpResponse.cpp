@@ -1,66 +1,184 @@
 // oreshnek/src/http/HttpResponse.cpp
 #include "oreshnek/http/HttpResponse.h"
-#include <sstream>
-#include <ctime>   // For date header
-#include <filesystem> // For file size
-#include <iostream> // For std::cerr
+#include <charconv> // For std::to_chars / from_chars (status, Content-Length)
+#include <cerrno>
+#include <cstring>  // For strerror
+#include <stdexcept>
+#include "oreshnek/utils/Logger.h"
+#include "oreshnek/utils/StringUtil.h"
+#include "oreshnek/utils/TimeUtil.h"
 
 namespace Oreshnek {
 namespace Http {
 
-HttpResponse::HttpResponse() {
-    // Default headers, can be overridden
-    header("Server", "Oreshnek/1.0.0");
-    header("Connection", "keep-alive");
+namespace {
+using Utils::iequals;
+
+void append_int(std::string& out, int64_t v) {
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, static_cast<size_t>(r.ptr - buf));
+}
+} // namespace
+
+// --- HeaderList -------------------------------------------------------------
+
+std::size_t HeaderList::index_of(std::string_view name) const {
+    for (std::size_t i = 0; i < size_; ++i) {
+        if (iequals((*this)[i].name, name)) return i;
+    }
+    return size_;
+}
+
+void HeaderList::set(std::string_view name, std::string_view value) {
+    const std::size_t i = index_of(name);
+    if (i < size_) {
+        at(i).value.assign(value.data(), value.size());
+        return;
+    }
+    if (size_ >= kInline) overflow_.emplace_back();
+    Entry& e = at(size_);
+    e.name.assign(name.data(), name.size());
+    e.value.assign(value.data(), value.size());
+    ++size_;
 }
 
+bool HeaderList::remove(std::string_view name) {
+    const std::size_t i = index_of(name);
+    if (i == size_) return false;
+    // Shift the tail down by swapping, so the inline strings keep their buffers.
+    for (std::size_t j = i; j + 1 < size_; ++j) {
+        std::swap(at(j), at(j + 1));
+    }
+    --size_;
+    if (size_ >= kInline) overflow_.pop_back();
+    return true;
+}
+
+const std::string* HeaderList::find(std::string_view name) const {
+    const std::size_t i = index_of(name);
+    return i < size_ ? &(*this)[i].value : nullptr;
+}
+
+void HeaderList::clear() {
+    // Inline entries are left in place (capacity retained); they are simply
+    // overwritten by the next set().
+    overflow_.clear();
+    size_ = 0;
+}
+
+// --- HttpResponse -----------------------------------------------------------
+
 HttpResponse& HttpResponse::status(HttpStatus status) {
     status_ = status;
     return *this;
 }
 
-HttpResponse& HttpResponse::header(const std::string& name, const std::string& value) {
-    headers_[name] = value;
+HttpResponse& HttpResponse::header(std::string_view name, std::string_view value) {
+    headers_.set(name, value);
     return *this;
 }
 
+HttpResponse& HttpResponse::remove_header(std::string_view name) {
+    headers_.remove(name);
+    return *this;
+}
+
+std::optional<std::string_view> HttpResponse::get_header(std::string_view name) const {
+    if (const std::string* v = headers_.find(name)) return std::string_view(*v);
+    return std::nullopt;
+}
+
 HttpResponse& HttpResponse::body(const std::string& content) {
-    body_content_ = content; // std::string automatically
+    body_.assign(content);
     is_file_response_ = false;
-    header("Content-Length", std::to_string(std::get<std::string>(body_content_).length()));
+    file_path_.clear();
+    file_.reset();
+    // Content-Length is derived from the body when serializing; drop any stale
+    // explicit value so the two can never disagree.
+    headers_.remove("Content-Length");
     return *this;
 }
 
 HttpResponse& HttpResponse::body(std::string&& content) {
-    body_content_ = std::move(content); // std::string automatically
+    body_ = std::move(content);
     is_file_response_ = false;
-    header("Content-Length", std::to_string(std::get<std::string>(body_content_).length()));
+    file_path_.clear();
+    file_.reset();
+    headers_.remove("Content-Length");
     return *this;
 }
 
 HttpResponse& HttpResponse::file(const std::string& file_path, const std::string& content_type) {
-    body_content_ = FilePath(file_path); // Now stores a FilePath object
+    // Open now and record the size; it becomes Content-Length unless a range is
+    // applied.
+    std::shared_ptr<const FileEntry> entry = FileEntry::open(file_path, content_type);
+    if (!entry) {
+        ORE_LOG(WARN) << "Could not open file " << file_path << ": " << std::strerror(errno);
+    }
+    file(std::move(entry));
+    file_path_ = file_path;
+    if (!file_) header("Content-Type", content_type);
+    return *this;
+}
+
+HttpResponse& HttpResponse::file(std::shared_ptr<const FileEntry> entry) {
+    file_path_.clear();
+    body_.clear();
     is_file_response_ = true;
-    header("Content-Type", content_type);
-
-    // Try to get file size for Content-Length header
-    try {
-        std::error_code ec;
-        uintmax_t file_size = std::filesystem::file_size(file_path, ec);
-        if (!ec) {
-            header("Content-Length", std::to_string(file_size));
-        } else {
-            std::cerr << "Warning: Could not get file size for " << file_path << ": " << ec.message() << std::endl;
-            // Content-Length might be omitted, or set to a placeholder, or error response sent.
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error accessing file " << file_path << ": " << e.what() << std::endl;
+    headers_.remove("Content-Length");
+    file_ = std::move(entry);
+    file_encoding_ = Encoding::None;
+    if (file_) {
+        header("Content-Type", file_->content_type);
+        file_size_ = file_->size;
+    } else {
+        file_size_ = -1;
     }
     return *this;
 }
 
+void HttpResponse::set_file_encoding(Encoding encoding) {
+    if (!file_ || !file_->has_encoding(encoding)) return;
+    file_encoding_ = encoding;
+    file_size_ = file_->size_for(encoding);
+}
+
+HttpResponse& HttpResponse::vary(std::string_view token) {
+    const std::optional<std::string_view> current = get_header("Vary");
+    if (!current || current->empty()) return header("Vary", token);
+    // Compare whole comma-separated tokens: "Accept" is not "Accept-Encoding".
+    std::string_view rest = *current;
+    while (!rest.empty()) {
+        const size_t comma = rest.find(',');
+        const std::string_view item = Utils::trim(rest.substr(0, comma));
+        if (item == "*" || iequals(item, token)) return *this;
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+    }
+    std::string merged(*current);
+    merged.append(", ").append(token);
+    return header("Vary", merged);
+}
+
 HttpResponse& HttpResponse::json(const nlohmann::json& json_val) {
-    return body(json_val.dump()).header("Content-Type", "application/json");
+    if (json_negotiated_) vary("Accept");
+    std::string out;
+    switch (json_format_) {
+        case BodyFormat::MsgPack: nlohmann::json::to_msgpack(json_val, out); break;
+        case BodyFormat::Cbor: nlohmann::json::to_cbor(json_val, out); break;
+        case BodyFormat::Json: out = json_val.dump(); break;
+    }
+    return body(std::move(out)).header("Content-Type", content_type_for(json_format_));
+}
+
+HttpResponse& HttpResponse::json(JsonWriter&& writer) {
+    if (!writer.complete()) {
+        throw std::logic_error("HttpResponse::json: incomplete JsonWriter document");
+    }
+    if (json_negotiated_) vary("Accept");
+    if (json_format_ == BodyFormat::Json) return body(writer.take()).header("Content-Type", "application/json");
+    // A binary client: transcode (the zero-copy hand-off is JSON's alone).
+    return json(nlohmann::json::parse(writer.take()));
 }
 
 HttpResponse& HttpResponse::text(const std::string& content) {
@@ -71,71 +189,130 @@ HttpResponse& HttpResponse::html(const std::string& content) {
     return body(content).header("Content-Type", "text/html");
 }
 
-/* REMOVED
-const std::string& HttpResponse::get_body() const {
-    if (is_file_response_) {
-        // This is a potentially expensive operation if the file is large
-        // It reads the entire file into a string.
-        // This method should primarily be used for non-file responses or small files.
-        // For actual file serving, Server/Connection should use the file path directly.
-        const std::string& file_path = std::get<FilePath>(body_content_).path; // Access path member
-        std::ifstream file(file_path, std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open file for get_body(): " + file_path);
-        }
-        std::ostringstream buffer;
-        buffer << file.rdbuf();
-        // Caching this would be an option if this getter is called frequently,
-        // but for a true streaming scenario, this function should be avoided for large files.
-        static std::string file_content_buffer; // Static mutable buffer, not thread-safe if called directly
-        file_content_buffer = buffer.str();
-        return file_content_buffer;
-    }
-    return std::get<std::string>(body_content_);
+HttpResponse& HttpResponse::not_modified(std::string_view etag) {
+    body_.clear();
+    headers_.remove("Content-Length");
+    return status(HttpStatus::NOT_MODIFIED).header("ETag", etag);
 }
-*/
 
-const std::string& HttpResponse::file_path() const {
-    static const std::string empty;
-    if (!is_file_response_ || !std::holds_alternative<FilePath>(body_content_)) {
-        return empty;
+int64_t HttpResponse::content_length() const {
+    if (const std::string* v = headers_.find("Content-Length")) {
+        int64_t n = -1;
+        std::from_chars(v->data(), v->data() + v->size(), n);
+        return n;
+    }
+    if (!is_file_response_) return static_cast<int64_t>(body_.size());
+    if (!file_segments_.empty()) {
+        int64_t total = 0;
+        for (const FileSegment& segment : file_segments_) {
+            total += static_cast<int64_t>(segment.text.size()) + segment.length;
+        }
+        return total;
     }
-    return std::get<FilePath>(body_content_).path;
+    if (file_length_ >= 0) return file_length_;
+    if (file_size_ < 0) return -1;
+    return file_size_ > file_offset_ ? file_size_ - file_offset_ : 0;
 }
 
-std::string HttpResponse::build_headers_string() const {
-    std::ostringstream oss;
+void HttpResponse::serialize_headers(std::string& out) const {
+    const int code = static_cast<int>(status_);
 
     // Status line
-    oss << "HTTP/1.1 " << static_cast<int>(status_) << " " << http_status_to_string(status_) << "\r\n";
-
-    // Headers
-    // Add Date header (RFC 7231, Section 7.1.1.2)
-    char buf[128];
-    time_t now = time(nullptr);
-    struct tm *gmt = gmtime(&now);
-    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", gmt);
-    oss << "Date: " << buf << "\r\n";
-
-    for (const auto& pair : headers_) {
-        oss << pair.first << ": " << pair.second << "\r\n";
+    out.append("HTTP/1.1 ");
+    append_int(out, code);
+    out.push_back(' ');
+    out.append(http_status_to_string(status_));
+    out.append("\r\n");
+
+    // Date header (RFC 7231, Section 7.1.1.2)
+    out.append("Date: ");
+    out.append(Utils::http_date_now());
+    out.append("\r\n");
+
+    // Implied defaults, unless the handler chose its own.
+    if (!headers_.contains("Server")) out.append("Server: Oreshnek/1.0.0\r\n");
+    if (!headers_.contains("Connection")) out.append("Connection: keep-alive\r\n");
+
+    for (std::size_t i = 0; i < headers_.size(); ++i) {
+        const HeaderList::Entry& e = headers_[i];
+        out.append(e.name).append(": ").append(e.value).append("\r\n");
     }
 
-    oss << "\r\n"; // End of headers
-    return oss.str();
+    // 1xx and 204 responses must not carry a Content-Length, and a 304's would
+    // describe the body it omits.
+    if (!headers_.contains("Content-Length") && code >= 200 && code != 204 && code != 304) {
+        const int64_t length = content_length();
+        if (length >= 0) {
+            out.append("Content-Length: ");
+            append_int(out, length);
+            out.append("\r\n");
+        }
+    }
+
+    out.append("\r\n"); // End of headers
+}
+
+std::string HttpResponse::build_headers_string() const {
+    std::string out;
+    out.reserve(256);
+    serialize_headers(out);
+    return out;
 }
 
 void HttpResponse::reset() {
     status_ = HttpStatus::OK;
     headers_.clear();
-    body_content_ = std::string(); // Reset to empty string (assigns to the std::string alternative)
+    // Keep the body buffer for reuse unless a large body was left behind (the
+    // connection normally moves it out), so pooled responses stay small.
+    if (body_.capacity() > 64 * 1024) std::string().swap(body_);
+    else body_.clear();
+    file_path_.clear();
+    file_.reset();
     is_file_response_ = false;
+    file_size_ = -1;
     file_offset_ = 0;
     file_length_ = -1;
+    file_segments_.clear();
+    file_encoding_ = Encoding::None;
     head_only_ = false;
-    // Re-add default headers
-    header("Server", "Oreshnek/1.0.0");
-    header("Connection", "keep-alive");
+    json_format_ = BodyFormat::Json;
+    json_negotiated_ = false;
+}
+
+// --- HttpResponsePool -------------------------------------------------------
+
+void HttpResponsePool::Recycler::operator()(HttpResponse* response) const noexcept {
+    if (pool != nullptr) {
+        pool->release(response);
+    } else {
+        delete response;
+    }
+}
+
+HttpResponsePool::Handle HttpResponsePool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            HttpResponse* r = free_.back().release();
+            free_.pop_back();
+            return Handle(r, Recycler{this});
+        }
+    }
+    return Handle(new HttpResponse(), Recycler{this});
+}
+
+void HttpResponsePool::release(HttpResponse* response) noexcept {
+    std::unique_ptr<HttpResponse> owned(response);
+    owned->reset(); // Outside the lock; keeps header/body capacity.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() < max_idle_) {
+        free_.push_back(std::move(owned));
+    }
+}
+
+std::size_t HttpResponsePool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
 }
 
 } // namespace Http
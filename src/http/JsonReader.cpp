@@ -0,0 +1,414 @@
+// oreshnek/src/http/JsonReader.cpp
+#include "oreshnek/http/JsonReader.h"
+#include "JsonSwar.h"
+
+#include <charconv> // For std::from_chars
+#include <cstring>  // For memcpy, memcmp
+#include <limits>
+
+namespace Oreshnek {
+namespace Http {
+
+using detail::JsonNode;
+
+namespace {
+inline bool is_ws(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool read_hex4(const char* p, unsigned& out) {
+    out = 0;
+    for (int i = 0; i < 4; ++i) {
+        const int v = hex_value(p[i]);
+        if (v < 0) return false;
+        out = (out << 4) | static_cast<unsigned>(v);
+    }
+    return true;
+}
+
+void append_utf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+} // namespace
+
+// --- JsonDocument -----------------------------------------------------------
+
+JsonDocument::JsonDocument(std::string_view text) : text_(text) {
+    if (text_.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        error_ = "JSON text too large";
+        return;
+    }
+    // Rough upper bound on values for typical payloads; avoids regrowth.
+    nodes_.reserve(text_.size() / 8 + 4);
+    parse();
+    if (!valid()) nodes_.clear();
+}
+
+void JsonDocument::fail(const char* what, std::size_t pos) {
+    if (!error_.empty()) return;
+    error_ = what;
+    error_ += " at offset ";
+    error_ += std::to_string(pos);
+}
+
+void JsonDocument::parse() {
+    const char* const base = text_.data();
+    const std::size_t n = text_.size();
+    std::size_t pos = 0;
+
+    enum class Expect { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd };
+    Expect expect = Expect::Value;
+    std::vector<std::uint32_t> open; // Node indices of the open containers
+    bool done = false;
+
+    auto skip_ws = [&] { while (pos < n && is_ws(base[pos])) ++pos; };
+
+    // Scan a string whose opening quote is at `pos`; leaves pos after the
+    // closing quote. Clean 8-byte words are skipped without per-byte checks.
+    auto scan_string = [&](JsonNode& node) -> bool {
+        const std::size_t begin = ++pos;
+        bool escaped = false;
+        for (;;) {
+            while (n - pos >= 8) {
+                std::uint64_t w;
+                std::memcpy(&w, base + pos, sizeof(w));
+                if (detail::word_has_special(w)) break;
+                pos += 8;
+            }
+            if (pos >= n) { fail("unterminated string", begin - 1); return false; }
+            const unsigned char c = static_cast<unsigned char>(base[pos]);
+            if (c == '"') break;
+            if (c < 0x20) { fail("control character in string", pos); return false; }
+            if (c == '\\') {
+                escaped = true;
+                if (pos + 1 >= n) { fail("unterminated string", begin - 1); return false; }
+                const char e = base[pos + 1];
+                if (e == 'u') {
+                    unsigned cp;
+                    if (n - pos < 6 || !read_hex4(base + pos + 2, cp)) {
+                        fail("invalid \\u escape", pos);
+                        return false;
+                    }
+                    pos += 6;
+                } else if (e == '"' || e == '\\' || e == '/' || e == 'b' || e == 'f' ||
+                           e == 'n' || e == 'r' || e == 't') {
+                    pos += 2;
+                } else {
+                    fail("invalid escape", pos);
+                    return false;
+                }
+                continue;
+            }
+            ++pos;
+        }
+        node.type = JsonType::String;
+        node.escaped = escaped;
+        node.start = static_cast<std::uint32_t>(begin);
+        node.len = static_cast<std::uint32_t>(pos - begin);
+        ++pos; // Closing quote
+        return true;
+    };
+
+    auto scan_number = [&](JsonNode& node) -> bool {
+        const std::size_t begin = pos;
+        if (base[pos] == '-') ++pos;
+        if (pos < n && base[pos] == '0') {
+            ++pos;
+        } else if (pos < n && is_digit(base[pos])) {
+            while (pos < n && is_digit(base[pos])) ++pos;
+        } else {
+            fail("invalid number", begin);
+            return false;
+        }
+        if (pos < n && base[pos] == '.') {
+            ++pos;
+            if (pos >= n || !is_digit(base[pos])) { fail("invalid number", begin); return false; }
+            while (pos < n && is_digit(base[pos])) ++pos;
+        }
+        if (pos < n && (base[pos] == 'e' || base[pos] == 'E')) {
+            ++pos;
+            if (pos < n && (base[pos] == '+' || base[pos] == '-')) ++pos;
+            if (pos >= n || !is_digit(base[pos])) { fail("invalid number", begin); return false; }
+            while (pos < n && is_digit(base[pos])) ++pos;
+        }
+        node.type = JsonType::Number;
+        node.start = static_cast<std::uint32_t>(begin);
+        node.len = static_cast<std::uint32_t>(pos - begin);
+        return true;
+    };
+
+    auto scan_literal = [&](JsonNode& node, std::string_view word, JsonType type) -> bool {
+        if (text_.compare(pos, word.size(), word) != 0) { fail("invalid literal", pos); return false; }
+        node.type = type;
+        node.start = static_cast<std::uint32_t>(pos);
+        node.len = static_cast<std::uint32_t>(word.size());
+        pos += word.size();
+        return true;
+    };
+
+    auto after_value = [&] {
+        if (open.empty()) done = true;
+        else expect = Expect::CommaOrEnd;
+    };
+
+    auto close = [&](char c) -> bool {
+        JsonNode& node = nodes_[open.back()];
+        if ((c == '}') != (node.type == JsonType::Object)) { fail("mismatched bracket", pos); return false; }
+        ++pos;
+        node.len = static_cast<std::uint32_t>(pos - node.start);
+        node.next = static_cast<std::uint32_t>(nodes_.size());
+        open.pop_back();
+        after_value();
+        return true;
+    };
+
+    while (!done) {
+        skip_ws();
+        if (pos >= n) { fail("unexpected end of input", pos); return; }
+        const char c = base[pos];
+        switch (expect) {
+            case Expect::ValueOrEnd:
+                if (c == ']') { if (!close(c)) return; break; }
+                [[fallthrough]];
+            case Expect::Value: {
+                if (!open.empty() && nodes_[open.back()].type == JsonType::Array) {
+                    ++nodes_[open.back()].count;
+                }
+                const std::uint32_t index = static_cast<std::uint32_t>(nodes_.size());
+                nodes_.push_back(JsonNode{JsonType::Invalid, false, 0, 0, index + 1, 0});
+                JsonNode& node = nodes_.back();
+                if (c == '{' || c == '[') {
+                    if (open.size() >= kMaxDepth) { fail("nesting too deep", pos); return; }
+                    node.type = c == '{' ? JsonType::Object : JsonType::Array;
+                    node.start = static_cast<std::uint32_t>(pos);
+                    open.push_back(index);
+                    ++pos;
+                    expect = c == '{' ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+                    break;
+                }
+                bool ok;
+                if (c == '"') ok = scan_string(node);
+                else if (c == '-' || is_digit(c)) ok = scan_number(node);
+                else if (c == 't') ok = scan_literal(node, "true", JsonType::Bool);
+                else if (c == 'f') ok = scan_literal(node, "false", JsonType::Bool);
+                else if (c == 'n') ok = scan_literal(node, "null", JsonType::Null);
+                else { fail("unexpected character", pos); return; }
+                if (!ok) return;
+                after_value();
+                break;
+            }
+            case Expect::KeyOrEnd:
+                if (c == '}') { if (!close(c)) return; break; }
+                [[fallthrough]];
+            case Expect::Key: {
+                if (c != '"') { fail("expected object key", pos); return; }
+                ++nodes_[open.back()].count;
+                const std::uint32_t index = static_cast<std::uint32_t>(nodes_.size());
+                nodes_.push_back(JsonNode{JsonType::Invalid, false, 0, 0, index + 1, 0});
+                if (!scan_string(nodes_.back())) return;
+                expect = Expect::Colon;
+                break;
+            }
+            case Expect::Colon:
+                if (c != ':') { fail("expected ':'", pos); return; }
+                ++pos;
+                expect = Expect::Value;
+                break;
+            case Expect::CommaOrEnd:
+                if (c == ',') {
+                    ++pos;
+                    expect = nodes_[open.back()].type == JsonType::Object ? Expect::Key : Expect::Value;
+                } else if (c == '}' || c == ']') {
+                    if (!close(c)) return;
+                } else {
+                    fail("expected ',' or closing bracket", pos);
+                    return;
+                }
+                break;
+        }
+    }
+    skip_ws();
+    if (pos != n) fail("trailing characters", pos);
+}
+
+JsonValue JsonDocument::root() const {
+    if (nodes_.empty()) return {};
+    return JsonValue(nodes_.data(), text_.data(), 0);
+}
+
+bool JsonDocument::unescape(std::string_view raw, std::string& out) {
+    out.reserve(out.size() + raw.size());
+    std::size_t i = 0;
+    while (i < raw.size()) {
+        const std::size_t bs = raw.find('\\', i);
+        if (bs == std::string_view::npos) {
+            out.append(raw.substr(i));
+            break;
+        }
+        out.append(raw.substr(i, bs - i));
+        if (bs + 1 >= raw.size()) return false;
+        const char e = raw[bs + 1];
+        i = bs + 2;
+        switch (e) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                unsigned cp;
+                if (raw.size() - i < 4 || !read_hex4(raw.data() + i, cp)) return false;
+                i += 4;
+                // Combine a UTF-16 surrogate pair; a lone surrogate becomes U+FFFD.
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    unsigned lo;
+                    if (raw.size() - i >= 6 && raw[i] == '\\' && raw[i + 1] == 'u' &&
+                        read_hex4(raw.data() + i + 2, lo) && lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        i += 6;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// --- JsonValue --------------------------------------------------------------
+
+JsonValue JsonValue::operator[](std::string_view key) const {
+    if (type() != JsonType::Object) return {};
+    const JsonNode& obj = node();
+    std::string scratch;
+    for (std::uint32_t i = index_ + 1; i < obj.next; i = nodes_[i + 1].next) {
+        const JsonNode& k = nodes_[i];
+        bool match;
+        if (!k.escaped) {
+            match = k.len == key.size() && std::memcmp(text_ + k.start, key.data(), key.size()) == 0;
+        } else {
+            scratch.clear();
+            match = JsonDocument::unescape(text_of(k), scratch) && scratch == key;
+        }
+        if (match) return JsonValue(nodes_, text_, i + 1);
+    }
+    return {};
+}
+
+JsonValue JsonValue::operator[](std::size_t index) const {
+    if (type() != JsonType::Array || index >= node().count) return {};
+    std::uint32_t i = index_ + 1;
+    for (std::size_t k = 0; k < index; ++k) i = nodes_[i].next;
+    return JsonValue(nodes_, text_, i);
+}
+
+std::size_t JsonValue::size() const {
+    const JsonType t = type();
+    return (t == JsonType::Array || t == JsonType::Object) ? node().count : 0;
+}
+
+std::optional<std::string_view> JsonValue::get_string_view() const {
+    if (type() != JsonType::String || node().escaped) return std::nullopt;
+    return text_of(node());
+}
+
+std::optional<std::string> JsonValue::get_string() const {
+    if (type() != JsonType::String) return std::nullopt;
+    std::string out;
+    if (!JsonDocument::unescape(text_of(node()), out)) return std::nullopt;
+    return out;
+}
+
+std::optional<std::string_view> JsonValue::get_string(std::string& scratch) const {
+    if (type() != JsonType::String) return std::nullopt;
+    if (!node().escaped) return text_of(node());
+    scratch.clear();
+    if (!JsonDocument::unescape(text_of(node()), scratch)) return std::nullopt;
+    return std::string_view(scratch);
+}
+
+std::optional<std::int64_t> JsonValue::get_int() const {
+    if (type() != JsonType::Number) return std::nullopt;
+    const std::string_view s = text_of(node());
+    std::int64_t v = 0;
+    auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (r.ec != std::errc() || r.ptr != s.data() + s.size()) return std::nullopt;
+    return v;
+}
+
+std::optional<double> JsonValue::get_double() const {
+    if (type() != JsonType::Number) return std::nullopt;
+    const std::string_view s = text_of(node());
+    double v = 0;
+    auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (r.ec != std::errc() || r.ptr != s.data() + s.size()) return std::nullopt;
+    return v;
+}
+
+std::optional<bool> JsonValue::get_bool() const {
+    if (type() != JsonType::Bool) return std::nullopt;
+    return text_[node().start] == 't';
+}
+
+std::string_view JsonValue::raw() const {
+    if (!nodes_) return {};
+    return text_of(node());
+}
+
+JsonValue::Iterator JsonValue::begin() const {
+    const JsonType t = type();
+    if (t != JsonType::Array && t != JsonType::Object) return end();
+    return Iterator(nodes_, text_, index_ + 1, t == JsonType::Object);
+}
+
+JsonValue::Iterator JsonValue::end() const {
+    return Iterator(nodes_, text_, nodes_ ? node().next : 0, type() == JsonType::Object);
+}
+
+std::string_view JsonValue::Iterator::key() const {
+    if (!object_) return {};
+    const JsonNode& k = nodes_[index_];
+    return {text_ + k.start, k.len};
+}
+
+JsonValue JsonValue::Iterator::value() const {
+    return JsonValue(nodes_, text_, object_ ? index_ + 1 : index_);
+}
+
+JsonValue::Iterator& JsonValue::Iterator::operator++() {
+    index_ = object_ ? nodes_[index_ + 1].next : nodes_[index_].next;
+    return *this;
+}
+
+} // namespace Http
+} // namespace Oreshnek
@@ -0,0 +1,31 @@
+// oreshnek/src/http/JsonSwar.h
+// Internal to JsonWriter.cpp and JsonReader.cpp (not installed).
+#ifndef ORESHNEK_HTTP_JSONSWAR_H
+#define ORESHNEK_HTTP_JSONSWAR_H
+
+#include <cstdint>
+
+namespace Oreshnek {
+namespace Http {
+namespace detail {
+
+// Eight string bytes at a time in a 64-bit word (SWAR).
+constexpr std::uint64_t kOnes = 0x0101010101010101ULL;
+constexpr std::uint64_t kHighs = 0x8080808080808080ULL;
+
+// Non-zero iff some byte of `w` is zero.
+inline std::uint64_t has_zero_byte(std::uint64_t w) { return (w - kOnes) & ~w & kHighs; }
+
+// Whether any of the 8 bytes is special inside a JSON string: '"', '\\' or a
+// control character (escaped by the writer, ends or complicates a string for
+// the reader).
+inline bool word_has_special(std::uint64_t w) {
+    const std::uint64_t control = (w - kOnes * 0x20) & ~w & kHighs; // byte < 0x20
+    return (control | has_zero_byte(w ^ (kOnes * '"')) | has_zero_byte(w ^ (kOnes * '\\'))) != 0;
+}
+
+} // namespace detail
+} // namespace Http
+} // namespace Oreshnek
+
+#endif // ORESHNEK_HTTP_JSONSWAR_H
@@ -0,0 +1,176 @@
+// oreshnek/src/http/JsonWriter.cpp
+#include "oreshnek/http/JsonWriter.h"
+#include "JsonSwar.h"
+
+#include <charconv> // For std::to_chars
+#include <cmath>    // For std::isfinite
+#include <cstring>  // For memcpy
+#include <stdexcept>
+
+namespace Oreshnek {
+namespace Http {
+
+namespace {
+inline bool byte_needs_escape(unsigned char c) { return c < 0x20 || c == '"' || c == '\\'; }
+
+void append_escape(std::string& out, unsigned char c) {
+    switch (c) {
+        case '"': out.append("\\\""); return;
+        case '\\': out.append("\\\\"); return;
+        case '\b': out.append("\\b"); return;
+        case '\f': out.append("\\f"); return;
+        case '\n': out.append("\\n"); return;
+        case '\r': out.append("\\r"); return;
+        case '\t': out.append("\\t"); return;
+        default: {
+            static const char kHex[] = "0123456789abcdef";
+            const char esc[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+            out.append(esc, sizeof(esc));
+        }
+    }
+}
+} // namespace
+
+void JsonWriter::append_escaped(std::string& out, std::string_view s) {
+    out.push_back('"');
+    const char* p = s.data();
+    const char* end = p + s.size();
+    const char* run = p; // Start of the pending clean run.
+    while (p < end) {
+        // Skip clean 8-byte words without looking at individual bytes.
+        if (end - p >= 8) {
+            std::uint64_t w;
+            std::memcpy(&w, p, sizeof(w));
+            if (!detail::word_has_special(w)) {
+                p += 8;
+                continue;
+            }
+        }
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (byte_needs_escape(c)) {
+            out.append(run, static_cast<std::size_t>(p - run));
+            append_escape(out, c);
+            run = p + 1;
+        }
+        ++p;
+    }
+    out.append(run, static_cast<std::size_t>(end - run));
+    out.push_back('"');
+}
+
+void JsonWriter::before_value() {
+    if (depth_ == 0) {
+        if (!out_.empty()) throw std::logic_error("JsonWriter: more than one top-level value");
+        return;
+    }
+    const std::uint64_t bit = 1ULL << (depth_ - 1);
+    if (is_object_ & bit) {
+        if (!expect_value_) throw std::logic_error("JsonWriter: object value without a key");
+        expect_value_ = false;
+        return;
+    }
+    if (has_element_ & bit) out_.push_back(',');
+    has_element_ |= bit;
+}
+
+void JsonWriter::open(char c, bool object) {
+    before_value();
+    if (depth_ >= kMaxDepth) throw std::logic_error("JsonWriter: nesting too deep");
+    ++depth_;
+    const std::uint64_t bit = 1ULL << (depth_ - 1);
+    if (object) is_object_ |= bit;
+    else is_object_ &= ~bit;
+    has_element_ &= ~bit;
+    out_.push_back(c);
+}
+
+void JsonWriter::close(char c, bool object) {
+    if (depth_ == 0 || expect_value_ ||
+        static_cast<bool>(is_object_ & (1ULL << (depth_ - 1))) != object) {
+        throw std::logic_error("JsonWriter: unbalanced end_object/end_array");
+    }
+    --depth_;
+    out_.push_back(c);
+}
+
+JsonWriter& JsonWriter::begin_object() { open('{', true); return *this; }
+JsonWriter& JsonWriter::end_object() { close('}', true); return *this; }
+JsonWriter& JsonWriter::begin_array() { open('[', false); return *this; }
+JsonWriter& JsonWriter::end_array() { close(']', false); return *this; }
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    const std::uint64_t bit = depth_ > 0 ? 1ULL << (depth_ - 1) : 0;
+    if (!(is_object_ & bit) || expect_value_) {
+        throw std::logic_error("JsonWriter: key outside an object");
+    }
+    if (has_element_ & bit) out_.push_back(',');
+    has_element_ |= bit;
+    append_escaped(out_, name);
+    out_.push_back(':');
+    expect_value_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view s) {
+    before_value();
+    append_escaped(out_, s);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+    before_value();
+    out_.append(b ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double d) {
+    before_value();
+    if (!std::isfinite(d)) {
+        out_.append("null");
+        return *this;
+    }
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), d);
+    out_.append(buf, static_cast<std::size_t>(r.ptr - buf));
+    return *this;
+}
+
+JsonWriter& JsonWriter::write_int(std::int64_t i) {
+    before_value();
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), i);
+    out_.append(buf, static_cast<std::size_t>(r.ptr - buf));
+    return *this;
+}
+
+JsonWriter& JsonWriter::write_uint(std::uint64_t u) {
+    before_value();
+    char buf[24];
+    auto r = std::to_chars(buf, buf + sizeof(buf), u);
+    out_.append(buf, static_cast<std::size_t>(r.ptr - buf));
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    before_value();
+    out_.append("null");
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+    before_value();
+    out_.append(json);
+    return *this;
+}
+
+std::string JsonWriter::take() {
+    std::string out = std::move(out_);
+    out_.clear();
+    depth_ = 0;
+    is_object_ = has_element_ = 0;
+    expect_value_ = false;
+    return out;
+}
+
+} // namespace Http
+} // namespace Oreshnek
@@ -0,0 +1,69 @@
+// oreshnek/src/http/MimeTypes.cpp
+#include "oreshnek/http/MimeTypes.h"
+#include "oreshnek/utils/StringUtil.h"
+
+namespace Oreshnek {
+namespace Http {
+
+namespace {
+struct MimeEntry {
+    std::string_view extension;
+    std::string_view type;
+};
+
+constexpr MimeEntry kMimeTypes[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "application/javascript; charset=utf-8"},
+    {"mjs", "application/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"webmanifest", "application/manifest+json"},
+    {"xml", "application/xml"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"csv", "text/csv; charset=utf-8"},
+    {"md", "text/markdown; charset=utf-8"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"zip", "application/zip"},
+    {"mp4", "video/mp4"},
+    {"m4s", "video/iso.segment"},
+    {"webm", "video/webm"},
+    {"ts", "video/mp2t"},
+    {"m3u8", "application/vnd.apple.mpegurl"},
+    {"mpd", "application/dash+xml"},
+    {"mp3", "audio/mpeg"},
+    {"m4a", "audio/mp4"},
+    {"ogg", "audio/ogg"},
+    {"vtt", "text/vtt; charset=utf-8"},
+};
+} // namespace
+
+std::string_view mime_type(std::string_view path) {
+    const std::size_t slash = path.find_last_of('/');
+    const std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    const std::size_t dot = name.find_last_of('.');
+    if (dot != std::string_view::npos && dot + 1 < name.size()) {
+        const std::string_view ext = name.substr(dot + 1);
+        for (const MimeEntry& entry : kMimeTypes) {
+            if (Utils::iequals(ext, entry.extension)) return entry.type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+} // namespace Http
+} // namespace Oreshnek
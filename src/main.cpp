@@ -13,10 +13,10 @@
 #include "oreshnek/platform/DatabaseManager.h" // Generic SQL gateway
 #include "oreshnek/utils/Logger.h"             // Structured logging
 
+#include <chrono>
 #include <csignal>
 #include <filesystem>
 #include <iostream>
-#include <optional>
 #include <string>
 
 // Global server instance for signal handling.
@@ -28,28 +28,6 @@ void signal_handler(int /*signal*/) {
     if (g_server) g_server->request_stop();
 }
 
-// Safely resolve a user-supplied relative path inside base_dir, rejecting any
-// path that escapes it via "..", absolute paths or symlinks (directory
-// traversal). Returns std::nullopt if the path escapes base_dir.
-std::optional<std::string> resolve_within_dir(const std::string& base_dir,
-                                              const std::string& relative) {
-    namespace fs = std::filesystem;
-    std::error_code ec;
-    fs::path base = fs::weakly_canonical(fs::absolute(base_dir), ec);
-    if (ec) return std::nullopt;
-    fs::path target = fs::weakly_canonical(fs::absolute(base_dir) / relative, ec);
-    if (ec) return std::nullopt;
-
-    const std::string base_str = base.string();
-    const std::string target_str = target.string();
-    if (target_str.compare(0, base_str.size(), base_str) != 0) return std::nullopt;
-    if (target_str.size() > base_str.size() &&
-        target_str[base_str.size()] != static_cast<char>(fs::path::preferred_separator)) {
-        return std::nullopt;
-    }
-    return target_str;
-}
-
 int main(int argc, char** argv) {
     // Writing to a socket whose peer has closed would otherwise raise SIGPIPE and
     // terminate the process; ignore it and rely on send()/EPIPE error handling.
@@ -101,6 +79,9 @@ int main(int argc, char** argv) {
                 return 1;
             }
             server.enable_tls(config.tls.cert_file, config.tls.key_file, config.tls.min_version);
+            if (config.tls.io_threads > 0) {
+                server.enable_async_file_io(static_cast<std::size_t>(config.tls.io_threads));
+            }
         }
         if (config.rate_limit.enabled) {
             server.enable_rate_limit(config.rate_limit.requests_per_second, config.rate_limit.burst);
@@ -109,7 +90,46 @@ int main(int argc, char** argv) {
             server.enable_metrics(config.metrics.path);
         }
         if (config.compression.enabled) {
-            server.enable_compression(config.compression.min_bytes, config.compression.brotli);
+            server.enable_compression(config.compression.min_bytes, config.compression.brotli,
+                                      config.compression.zstd);
+            if (config.compression.cache_bytes > 0) {
+                Oreshnek::Server::CompressionCacheOptions cache;
+                cache.max_bytes = config.compression.cache_bytes;
+                server.enable_compression_cache(cache);
+            }
+            if (config.compression.adaptive) {
+                server.enable_adaptive_compression();
+            }
+        }
+        if (config.response_cache.enabled) {
+            Oreshnek::Server::ResponseCacheOptions cache;
+            cache.max_bytes = config.response_cache.max_bytes;
+            cache.max_entry = config.response_cache.max_entry;
+            server.enable_response_cache(cache);
+        }
+        if (config.file_readahead.enabled) {
+            Oreshnek::Server::FileReadaheadOptions readahead;
+            readahead.window = config.file_readahead.window;
+            readahead.drop_behind_min_bytes = config.file_readahead.drop_behind_min_bytes;
+            server.enable_file_readahead(readahead);
+        }
+        if (config.binary_json) {
+            server.enable_binary_json();
+        }
+        if (config.auto_etag) {
+            server.enable_auto_etag();
+        }
+        // Database routes run on their own pool when the bulkhead is enabled.
+        Oreshnek::Server::RouteOptions db_route;
+        if (config.db_bulkhead.enabled) {
+            Oreshnek::Server::BulkheadOptions bulkhead;
+            bulkhead.threads = config.db_bulkhead.threads;
+            bulkhead.max_queue = config.db_bulkhead.max_queue;
+            bulkhead.shed = config.db_bulkhead.shed == "drop_oldest" ? Oreshnek::Server::ShedPolicy::DropOldest
+                                                                    : Oreshnek::Server::ShedPolicy::RejectNew;
+            bulkhead.max_queue_wait = std::chrono::milliseconds(config.db_bulkhead.max_queue_wait_ms);
+            server.add_bulkhead("db", bulkhead);
+            db_route.pool = "db";
         }
         g_server = &server;
 
@@ -130,9 +150,12 @@ int main(int argc, char** argv) {
                 {{"name", "Oreshnek"}, {"message", "general-purpose C++20 web framework"}});
         });
 
+        // Trivial: answered on the event loop, without a worker.
+        Oreshnek::Server::RouteOptions inline_route;
+        inline_route.inline_ = true;
         server.get("/health", [](const Oreshnek::HttpRequest& /*req*/, Oreshnek::HttpResponse& res) {
             res.status(Oreshnek::Http::HttpStatus::OK).json({{"status", "ok"}});
-        });
+        }, inline_route);
 
         // Create a note.
         server.post("/api/notes", [&db](const Oreshnek::HttpRequest& req, Oreshnek::HttpResponse& res) {
@@ -153,20 +176,25 @@ int main(int argc, char** argv) {
                 return;
             }
             res.status(Oreshnek::Http::HttpStatus::CREATED).json({{"id", r.last_insert_id}});
-        });
+        }, db_route);
 
         // List notes.
         server.get("/api/notes", [&db](const Oreshnek::HttpRequest& /*req*/, Oreshnek::HttpResponse& res) {
             auto r = db.query("SELECT id, title, body, created_at FROM notes ORDER BY id DESC LIMIT 100;");
-            nlohmann::json arr = nlohmann::json::array();
+            // Stream the rows straight into the body: no intermediate JSON DOM.
+            Oreshnek::Http::JsonWriter w(256 + r.row_count() * 128);
+            w.begin_object().key("notes").begin_array();
             for (std::size_t i = 0; i < r.row_count(); ++i) {
-                arr.push_back({{"id", r.integer(i, 0)},
-                               {"title", std::string(r.text(i, 1))},
-                               {"body", std::string(r.text(i, 2))},
-                               {"created_at", std::string(r.text(i, 3))}});
+                w.begin_object()
+                 .member("id", r.integer(i, 0))
+                 .member("title", r.text(i, 1))
+                 .member("body", r.text(i, 2))
+                 .member("created_at", r.text(i, 3))
+                 .end_object();
             }
-            res.status(Oreshnek::Http::HttpStatus::OK).json({{"notes", arr}});
-        });
+            w.end_array().end_object();
+            res.status(Oreshnek::Http::HttpStatus::OK).json(std::move(w));
+        }, db_route);
 
         // Fetch one note by id.
         server.get("/api/notes/:id", [&db](const Oreshnek::HttpRequest& req, Oreshnek::HttpResponse& res) {
@@ -181,41 +209,18 @@ int main(int argc, char** argv) {
                  {"title", std::string(r.text(0, 1))},
                  {"body", std::string(r.text(0, 2))},
                  {"created_at", std::string(r.text(0, 3))}});
-        });
+        }, db_route);
 
-        // Serve static files (zero-copy sendfile + ETag/Last-Modified handled by
-        // the framework). Path is canonicalized to prevent directory traversal.
-        server.get("/static/:file_path", [&config](const Oreshnek::HttpRequest& req,
-                                                    Oreshnek::HttpResponse& res) {
-            std::optional<std::string_view> file_path_opt = req.param("file_path");
-            if (!file_path_opt) {
-                res.status(Oreshnek::Http::HttpStatus::BAD_REQUEST).text("Missing file path");
-                return;
-            }
-            std::string relative_path = std::string(*file_path_opt);
-            std::optional<std::string> resolved =
-                resolve_within_dir(config.static_dir, relative_path);
-            if (!resolved) {
-                res.status(Oreshnek::Http::HttpStatus::FORBIDDEN).text("Forbidden");
-                return;
-            }
-            if (!std::filesystem::exists(*resolved) || std::filesystem::is_directory(*resolved)) {
-                res.status(Oreshnek::Http::HttpStatus::NOT_FOUND).text("File not found");
-                return;
-            }
+        // Serve static files (zero-copy sendfile + ETag/Last-Modified/Range
+        // handled by the framework). Lookups are confined to static_dir by a
+        // directory descriptor, so traversal and symlinks out of it are refused.
+        server.mount_static("/static", config.static_dir);
 
-            std::string content_type = "application/octet-stream";
-            if (relative_path.ends_with(".css")) content_type = "text/css";
-            else if (relative_path.ends_with(".js")) content_type = "application/javascript";
-            else if (relative_path.ends_with(".png")) content_type = "image/png";
-            else if (relative_path.ends_with(".jpg") || relative_path.ends_with(".jpeg")) content_type = "image/jpeg";
-            else if (relative_path.ends_with(".html") || relative_path.ends_with(".htm")) content_type = "text/html";
-
-            res.status(Oreshnek::Http::HttpStatus::OK).file(*resolved, content_type);
-            // Let the browser cache static assets; the framework adds ETag/
-            // Last-Modified so revalidation is a cheap 304.
-            res.header("Cache-Control", "public, max-age=3600");
-        });
+        // Live HLS output of a packager (LL-HLS blocking playlist reloads wait
+        // in the event loop for the playlist to advance).
+        if (config.hls.enabled) {
+            server.mount_hls(config.hls.prefix, config.hls.dir);
+        }
 
         if (!server.listen(config.host, config.port)) {
             std::cerr << "Failed to start server" << std::endl;
@@ -1,9 +1,8 @@
 // oreshnek/src/net/Connection.cpp
 #include "oreshnek/net/Connection.h"
 #include <unistd.h> // For close, read, write
-#include <sys/socket.h> // For recv, send
-#include <sys/stat.h>   // For fstat
-#include <fcntl.h>      // For open
+#include <sys/socket.h> // For recv, send, sendmsg
+#include <sys/uio.h>    // For iovec
 #include <errno.h>    // For errno
 #include <cstring>    // For strerror
 #include <algorithm>  // For std::min
@@ -53,17 +52,31 @@ void Connection::reset() {
 }
 
 void Connection::clear_response_state() {
+    canned_ = nullptr;
+    canned_owner_.reset();
+    canned_sent_ = 0;
     headers_sent_ = false;
     raw_headers_to_send_.clear();
     write_body_.clear();
     write_body_offset_ = 0;
+    memory_body_ = {};
+    memory_owner_.reset();
     head_only_ = false;
-    if (file_fd_ >= 0) {
-        close(file_fd_);
-        file_fd_ = -1;
-    }
+    file_.reset();
     file_offset_ = 0;
     file_remaining_ = 0;
+    segments_.clear();
+    pieces_.clear();
+    next_piece_ = 0;
+    pieces_file_.reset();
+    // A read still in flight keeps filling its buffer; its result is dropped.
+    file_read_discard_ = file_read_pending_;
+    file_front_sent_ = 0;
+    file_front_len_ = 0;
+    file_back_len_ = 0;
+    file_read_failed_ = false;
+    file_read_offset_ = 0;
+    file_read_remaining_ = 0;
 }
 
 int Connection::continue_tls_handshake() {
@@ -147,6 +160,8 @@ ssize_t Connection::write_data() {
 
     // TLS path: sendfile() cannot encrypt, so file bodies are read into a buffer
     // and written through SSL_write like any other body.
+    if (canned_ != nullptr) return write_canned();
+
     if (ssl_ != nullptr) {
         ssize_t sent = 0;
         if (!headers_sent_) {
@@ -164,62 +179,111 @@ ssize_t Connection::write_data() {
         }
         if (head_only_) { update_activity(); return sent; }
 
-        if (file_fd_ >= 0) {
-            char buf[16384];
-            while (file_remaining_ > 0) {
-                size_t want = std::min<size_t>(static_cast<size_t>(file_remaining_), sizeof(buf));
-                ssize_t r = pread(file_fd_, buf, want, file_offset_);
-                if (r <= 0) break; // Unexpected EOF (file shrank); stop.
-                int n = SSL_write(ssl_, buf, static_cast<int>(r));
+        // A multi-range body is several pieces; anything else is one.
+        do {
+            if (file_ && async_file_reads_) {
+                // Send what the I/O thread has read; never touch the disk here.
+                while (file_remaining_ > 0) {
+                    if (file_front_sent_ == file_front_len_) {
+                        if (file_read_failed_) {
+                            ORE_LOG(ERROR) << "File read failed for TLS socket " << socket_fd_;
+                            return -1;
+                        }
+                        if (file_back_len_ == 0) break; // Waiting on the disk
+                        file_front_ = 1 - file_front_;
+                        file_front_len_ = file_back_len_;
+                        file_front_sent_ = 0;
+                        file_back_len_ = 0;
+                    }
+                    int n = SSL_write(ssl_, file_buffers_[file_front_].data() + file_front_sent_,
+                                      static_cast<int>(file_front_len_ - file_front_sent_));
+                    if (n > 0) {
+                        file_front_sent_ += static_cast<size_t>(n);
+                        file_offset_ += n;
+                        file_remaining_ -= n;
+                        sent += n;
+                        continue;
+                    }
+                    int err = SSL_get_error(ssl_, n);
+                    if (err == SSL_ERROR_WANT_WRITE) { tls_want_ = TlsWant::Write; return sent; }
+                    if (err == SSL_ERROR_WANT_READ)  { tls_want_ = TlsWant::Read;  return sent; }
+                    ORE_LOG(ERROR) << "SSL_write (file) error on socket " << socket_fd_;
+                    return -1;
+                }
+                if (file_remaining_ > 0) break;
+                file_.reset();
+            } else if (file_) {
+                char buf[16384];
+                while (file_remaining_ > 0) {
+                    size_t want = std::min<size_t>(static_cast<size_t>(file_remaining_), sizeof(buf));
+                    ssize_t r = pread(file_->file.fd(), buf, want, file_offset_);
+                    if (r <= 0) break; // Unexpected EOF (file shrank); stop.
+                    int n = SSL_write(ssl_, buf, static_cast<int>(r));
+                    if (n > 0) {
+                        file_offset_ += n;
+                        file_remaining_ -= n;
+                        sent += n;
+                        continue;
+                    }
+                    int err = SSL_get_error(ssl_, n);
+                    if (err == SSL_ERROR_WANT_WRITE) { tls_want_ = TlsWant::Write; return sent; }
+                    if (err == SSL_ERROR_WANT_READ)  { tls_want_ = TlsWant::Read;  return sent; }
+                    ORE_LOG(ERROR) << "SSL_write (file) error on socket " << socket_fd_;
+                    return -1;
+                }
+                if (file_remaining_ > 0) break; // EOF: stop here
+                file_.reset();
+            } else if (write_body_offset_ < memory_body_.size()) {
+                int n = SSL_write(ssl_, memory_body_.data() + write_body_offset_,
+                                  static_cast<int>(std::min<size_t>(memory_body_.size() - write_body_offset_, INT_MAX)));
                 if (n > 0) {
-                    file_offset_ += n;
-                    file_remaining_ -= n;
+                    write_body_offset_ += static_cast<size_t>(n);
                     sent += n;
-                    continue;
+                } else {
+                    int err = SSL_get_error(ssl_, n);
+                    if (err == SSL_ERROR_WANT_WRITE) { tls_want_ = TlsWant::Write; return sent; }
+                    if (err == SSL_ERROR_WANT_READ)  { tls_want_ = TlsWant::Read;  return sent; }
+                    ORE_LOG(ERROR) << "SSL_write (body) error on socket " << socket_fd_;
+                    return -1;
                 }
-                int err = SSL_get_error(ssl_, n);
-                if (err == SSL_ERROR_WANT_WRITE) { tls_want_ = TlsWant::Write; return sent; }
-                if (err == SSL_ERROR_WANT_READ)  { tls_want_ = TlsWant::Read;  return sent; }
-                ORE_LOG(ERROR) << "SSL_write (file) error on socket " << socket_fd_;
-                return -1;
-            }
-            if (file_remaining_ <= 0 && file_fd_ >= 0) { close(file_fd_); file_fd_ = -1; }
-            update_activity();
-            return sent;
-        }
-
-        if (write_body_offset_ < write_body_.size()) {
-            int n = SSL_write(ssl_, write_body_.data() + write_body_offset_,
-                              static_cast<int>(std::min<size_t>(write_body_.size() - write_body_offset_, INT_MAX)));
-            if (n > 0) {
-                write_body_offset_ += static_cast<size_t>(n);
-                sent += n;
-            } else {
-                int err = SSL_get_error(ssl_, n);
-                if (err == SSL_ERROR_WANT_WRITE) { tls_want_ = TlsWant::Write; return sent; }
-                if (err == SSL_ERROR_WANT_READ)  { tls_want_ = TlsWant::Read;  return sent; }
-                ORE_LOG(ERROR) << "SSL_write (body) error on socket " << socket_fd_;
-                return -1;
+                if (write_body_offset_ < memory_body_.size()) break;
             }
-        }
+        } while (load_next_piece());
         update_activity();
         return sent;
     }
 
     ssize_t bytes_sent_in_call = 0;
 
-    // 1) Send headers first.
+    // 1) Send headers first, gathered with an in-memory body (if any) so a
+    //    small response leaves in a single syscall.
     if (!headers_sent_) {
+        iovec iov[2];
+        int iovcnt = 0;
         if (!raw_headers_to_send_.empty()) {
-            ssize_t n = send(socket_fd_, raw_headers_to_send_.c_str(),
-                             raw_headers_to_send_.length(), MSG_NOSIGNAL);
+            iov[iovcnt].iov_base = raw_headers_to_send_.data();
+            iov[iovcnt].iov_len = raw_headers_to_send_.size();
+            ++iovcnt;
+        }
+        if (iovcnt > 0 && !head_only_ && write_body_offset_ < memory_body_.size()) {
+            iov[iovcnt].iov_base = const_cast<char*>(memory_body_.data() + write_body_offset_);
+            iov[iovcnt].iov_len = memory_body_.size() - write_body_offset_;
+            ++iovcnt;
+        }
+        if (iovcnt > 0) {
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(iovcnt);
+            ssize_t n = sendmsg(socket_fd_, &msg, MSG_NOSIGNAL);
             if (n < 0) {
                 if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
                 ORE_LOG(ERROR) << "Error sending headers to socket " << socket_fd_ << ": " << strerror(errno);
                 return -1;
             }
             bytes_sent_in_call += n;
-            raw_headers_to_send_.erase(0, n);
+            const size_t header_part = std::min(static_cast<size_t>(n), raw_headers_to_send_.size());
+            raw_headers_to_send_.erase(0, header_part);
+            write_body_offset_ += static_cast<size_t>(n) - header_part;
         }
         if (!raw_headers_to_send_.empty()) {
             return bytes_sent_in_call; // Headers not fully flushed yet.
@@ -233,76 +297,152 @@ ssize_t Connection::write_data() {
         return bytes_sent_in_call;
     }
 
-    // 2) Send a file body with zero-copy sendfile().
-    if (file_fd_ >= 0) {
-        while (file_remaining_ > 0) {
-            size_t count = static_cast<size_t>(
-                std::min<off_t>(file_remaining_, static_cast<off_t>(FILE_SEND_CHUNK)));
+    // 2) Send the body: a file region with zero-copy sendfile(), or in-memory
+    //    bytes (tracking an offset, no front-erase). A multi-range body is a
+    //    sequence of both, loaded one piece at a time.
+    do {
+        if (file_) {
+            while (file_remaining_ > 0) {
+                size_t count = static_cast<size_t>(
+                    std::min<off_t>(file_remaining_, static_cast<off_t>(FILE_SEND_CHUNK)));
 #ifdef __linux__
-            off_t off = file_offset_;
-            ssize_t n = ::sendfile(socket_fd_, file_fd_, &off, count);
-            if (n > 0) {
-                file_offset_ = off;
-                file_remaining_ -= n;
-                bytes_sent_in_call += n;
-                continue;
-            }
-            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return bytes_sent_in_call;
-            if (n == 0) break; // Unexpected EOF (file shrank); stop.
-            ORE_LOG(ERROR) << "sendfile error on socket " << socket_fd_ << ": " << strerror(errno);
-            return -1;
+                off_t off = file_offset_;
+                ssize_t n = ::sendfile(socket_fd_, file_->file.fd(), &off, count);
+                if (n > 0) {
+                    file_offset_ = off;
+                    file_remaining_ -= n;
+                    bytes_sent_in_call += n;
+                    continue;
+                }
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return bytes_sent_in_call;
+                if (n == 0) break; // Unexpected EOF (file shrank); stop.
+                ORE_LOG(ERROR) << "sendfile error on socket " << socket_fd_ << ": " << strerror(errno);
+                return -1;
 #elif defined(__APPLE__)
-            off_t len = static_cast<off_t>(count);
-            int r = ::sendfile(file_fd_, socket_fd_, file_offset_, &len, nullptr, 0);
-            if (len > 0) {
-                file_offset_ += len;
-                file_remaining_ -= len;
-                bytes_sent_in_call += len;
+                off_t len = static_cast<off_t>(count);
+                int r = ::sendfile(file_->file.fd(), socket_fd_, file_offset_, &len, nullptr, 0);
+                if (len > 0) {
+                    file_offset_ += len;
+                    file_remaining_ -= len;
+                    bytes_sent_in_call += len;
+                }
+                if (r == 0) {
+                    if (len == 0) break; // Nothing more could be read.
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return bytes_sent_in_call;
+                ORE_LOG(ERROR) << "sendfile error on socket " << socket_fd_ << ": " << strerror(errno);
+                return -1;
+#endif
             }
-            if (r == 0) {
-                if (len == 0) break; // Nothing more could be read.
-                continue;
+            if (file_remaining_ > 0) break; // EOF: stop here
+            file_.reset();
+        } else if (write_body_offset_ < memory_body_.size()) {
+            ssize_t n = send(socket_fd_, memory_body_.data() + write_body_offset_,
+                             memory_body_.size() - write_body_offset_, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return bytes_sent_in_call;
+                ORE_LOG(ERROR) << "Error writing body to socket " << socket_fd_ << ": " << strerror(errno);
+                return -1;
             }
-            if (errno == EAGAIN || errno == EWOULDBLOCK) return bytes_sent_in_call;
-            ORE_LOG(ERROR) << "sendfile error on socket " << socket_fd_ << ": " << strerror(errno);
-            return -1;
-#endif
+            write_body_offset_ += static_cast<size_t>(n);
+            bytes_sent_in_call += n;
+            if (write_body_offset_ < memory_body_.size()) break; // Socket buffer full
         }
-        if (file_remaining_ <= 0 && file_fd_ >= 0) {
-            close(file_fd_);
-            file_fd_ = -1;
+    } while (load_next_piece());
+
+    update_activity();
+    return bytes_sent_in_call;
+}
+
+ssize_t Connection::write_canned() {
+    const auto parts = canned_->segments(std::string_view(canned_date_, sizeof(canned_date_)),
+                                         head_only_);
+    const size_t total = canned_->size(head_only_);
+    ssize_t sent = 0;
+    while (canned_sent_ < total) {
+        // Gather whatever is left of the three pieces into one vectored write.
+        iovec iov[3];
+        int iovcnt = 0;
+        size_t skip = canned_sent_;
+        for (const std::string_view& part : parts) {
+            if (skip >= part.size()) { skip -= part.size(); continue; }
+            iov[iovcnt].iov_base = const_cast<char*>(part.data() + skip);
+            iov[iovcnt].iov_len = part.size() - skip;
+            ++iovcnt;
+            skip = 0;
         }
-        update_activity();
-        return bytes_sent_in_call;
-    }
 
-    // 3) Send an in-memory string body (tracking an offset, no front-erase).
-    if (write_body_offset_ < write_body_.size()) {
-        ssize_t n = send(socket_fd_, write_body_.data() + write_body_offset_,
-                         write_body_.size() - write_body_offset_, MSG_NOSIGNAL);
-        if (n < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) return bytes_sent_in_call;
-            ORE_LOG(ERROR) << "Error writing body to socket " << socket_fd_ << ": " << strerror(errno);
-            return -1;
+        ssize_t n;
+        if (ssl_ != nullptr) {
+            // SSL_write takes one buffer; send the pieces in turn.
+            n = SSL_write(ssl_, iov[0].iov_base,
+                          static_cast<int>(std::min<size_t>(iov[0].iov_len, INT_MAX)));
+            if (n <= 0) {
+                int err = SSL_get_error(ssl_, static_cast<int>(n));
+                if (err == SSL_ERROR_WANT_WRITE) { tls_want_ = TlsWant::Write; return sent; }
+                if (err == SSL_ERROR_WANT_READ)  { tls_want_ = TlsWant::Read;  return sent; }
+                ORE_LOG(ERROR) << "SSL_write (canned) error on socket " << socket_fd_;
+                return -1;
+            }
+        } else {
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(iovcnt);
+            n = sendmsg(socket_fd_, &msg, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return sent;
+                ORE_LOG(ERROR) << "Error sending response to socket " << socket_fd_ << ": " << strerror(errno);
+                return -1;
+            }
         }
-        write_body_offset_ += static_cast<size_t>(n);
-        bytes_sent_in_call += n;
+        canned_sent_ += static_cast<size_t>(n);
+        sent += n;
     }
-
     update_activity();
-    return bytes_sent_in_call;
+    return sent;
 }
 
-void Connection::set_response_content(const Http::HttpResponse& response) {
+void Connection::set_canned_response(const Http::CannedResponse& canned, bool head_only) {
     clear_response_state();
-    raw_headers_to_send_ = response.build_headers_string();
+    canned_ = &canned;
+    head_only_ = head_only;
+    const std::string_view date = Utils::http_date_now();
+    std::memcpy(canned_date_, date.data(), std::min(date.size(), sizeof(canned_date_)));
+    if (canned.closes_connection()) keep_alive_ = false;
+}
+
+void Connection::set_canned_response(std::shared_ptr<const Http::CannedResponse> canned, bool head_only) {
+    set_canned_response(*canned, head_only);
+    canned_owner_ = std::move(canned);
+}
+
+void Connection::set_response_content(Http::HttpResponse&& response) {
+    clear_response_state();
+    // Serialize into the connection's own buffer so its capacity is reused
+    // across keep-alive responses.
+    response.serialize_headers(raw_headers_to_send_);
     head_only_ = response.head_only();
 
-    if (response.is_file()) {
-        const std::string& path = response.file_path();
-        file_fd_ = ::open(path.c_str(), O_RDONLY);
-        if (file_fd_ < 0) {
-            ORE_LOG(ERROR) << "Error opening file for response: " << path << ": " << strerror(errno);
+    if (response.is_file() && !response.file_segments().empty()) {
+        set_segments(response);
+    } else if (response.is_file() && response.file_entry() && response.file_entry()->in_memory) {
+        // Small cached file: written straight from the shared entry (no
+        // sendfile, no copy), in the coding the server selected.
+        memory_owner_ = response.file_entry();
+        const std::string_view body = memory_owner_->body(response.file_encoding());
+        const size_t offset = std::min(static_cast<size_t>(response.file_offset()), body.size());
+        size_t length = body.size() - offset;
+        if (response.file_length() >= 0) length = std::min(length, static_cast<size_t>(response.file_length()));
+        memory_body_ = body.substr(offset, length);
+    } else if (response.is_file()) {
+        // A precompressed .gz / .br sidecar is streamed instead of the file.
+        const std::shared_ptr<const Http::FileEntry>& entry = response.file_entry();
+        file_ = entry && response.file_encoding() != Http::Encoding::None
+                    ? entry->sidecar(response.file_encoding())
+                    : entry;
+        if (!file_) {
+            ORE_LOG(ERROR) << "File response without an open file: " << response.file_path();
             file_remaining_ = 0;
             return;
         }
@@ -310,20 +450,102 @@ void Connection::set_response_content(const Http::HttpResponse& response) {
         off_t length = static_cast<off_t>(response.file_length());
         if (length < 0) {
             // Whole file from the given offset: derive the size.
-            struct stat st;
-            if (fstat(file_fd_, &st) == 0) {
-                length = st.st_size - file_offset_;
-                if (length < 0) length = 0;
-            } else {
-                length = 0;
-            }
+            length = static_cast<off_t>(response.file_size()) - file_offset_;
+            if (length < 0) length = 0;
         }
         file_remaining_ = length;
+        reset_file_reads();
     } else {
-        write_body_ = std::get<std::string>(response.get_body_variant());
+        write_body_ = response.take_body();
+        memory_body_ = write_body_;
+    }
+}
+
+
+void Connection::set_segments(Http::HttpResponse& response) {
+    const std::shared_ptr<const Http::FileEntry>& entry = response.file_entry();
+    if (!entry) {
+        ORE_LOG(ERROR) << "Multi-range response without an open file: " << response.file_path();
+        return;
+    }
+    segments_ = response.take_file_segments();
+    const std::string_view memory = entry->in_memory ? entry->body(Http::Encoding::None) : std::string_view();
+    if (entry->in_memory) memory_owner_ = entry;
+    else pieces_file_ = entry;
+    pieces_.reserve(segments_.size() * 2);
+    for (const Http::FileSegment& segment : segments_) {
+        if (!segment.text.empty()) pieces_.push_back(BodyPiece{segment.text, 0, 0});
+        if (segment.length <= 0) continue;
+        if (entry->in_memory) {
+            const size_t offset = std::min(static_cast<size_t>(segment.offset), memory.size());
+            pieces_.push_back(BodyPiece{memory.substr(offset, static_cast<size_t>(segment.length)), 0, 0});
+        } else {
+            pieces_.push_back(BodyPiece{{}, static_cast<off_t>(segment.offset), static_cast<off_t>(segment.length)});
+        }
+    }
+    load_next_piece(); // The first framing goes out with the headers
+}
+
+bool Connection::load_next_piece() {
+    if (next_piece_ >= pieces_.size()) return false;
+    const BodyPiece& piece = pieces_[next_piece_++];
+    memory_body_ = piece.memory;
+    write_body_offset_ = 0;
+    if (piece.memory.empty()) {
+        file_ = pieces_file_;
+        file_offset_ = piece.offset;
+        file_remaining_ = piece.length;
+        reset_file_reads();
     }
+    return true;
+}
+
+void Connection::reset_file_reads() {
+    file_front_sent_ = 0;
+    file_front_len_ = 0;
+    file_back_len_ = 0;
+    file_read_failed_ = false;
+    file_read_offset_ = file_offset_;
+    file_read_remaining_ = file_remaining_;
 }
 
+bool Connection::wants_file_read() const {
+    return async_file_reads_ && file_ && !head_only_ && !file_read_pending_ && !file_read_failed_ &&
+           file_back_len_ == 0 && file_read_remaining_ > 0;
+}
+
+Connection::FileRead Connection::begin_file_read() {
+    for (std::vector<char>& buffer : file_buffers_) {
+        if (buffer.empty()) buffer.resize(FILE_READ_CHUNK);
+    }
+    file_read_pending_ = true;
+    FileRead read;
+    read.file = file_;
+    read.buffer = file_buffers_[1 - file_front_].data();
+    read.length = static_cast<size_t>(std::min<off_t>(file_read_remaining_, static_cast<off_t>(FILE_READ_CHUNK)));
+    read.offset = file_read_offset_;
+    return read;
+}
+
+void Connection::end_file_read(ssize_t n) {
+    file_read_pending_ = false;
+    if (file_read_discard_) {
+        file_read_discard_ = false;
+        return;
+    }
+    if (n <= 0) {
+        file_read_failed_ = true; // Error, or the file shrank under us
+        return;
+    }
+    file_back_len_ = static_cast<size_t>(n);
+    file_read_offset_ += n;
+    file_read_remaining_ -= n;
+}
+
+bool Connection::waiting_for_file_read() const {
+    return async_file_reads_ && file_ && file_remaining_ > 0 && file_front_sent_ == file_front_len_ &&
+           file_back_len_ == 0 && file_read_pending_;
+}
 
 bool Connection::parse_next(size_t& consumed) {
     consumed = 0;
@@ -382,10 +604,8 @@ void Connection::maybe_send_100_continue() {
 }
 
 void Connection::close_connection() {
-    if (file_fd_ >= 0) {
-        close(file_fd_);
-        file_fd_ = -1;
-    }
+    file_.reset();
+    memory_owner_.reset();
     if (ssl_ != nullptr) {
         // Best-effort close_notify; SSL_set_fd uses BIO_NOCLOSE so SSL_free does
         // not close the socket (we close it ourselves below).
@@ -401,10 +621,12 @@ void Connection::close_connection() {
 }
 
 bool Connection::has_data_to_write() const {
+    if (canned_ != nullptr) return canned_sent_ < canned_->size(head_only_);
     if (!raw_headers_to_send_.empty()) return true; // Headers still pending.
     if (head_only_) return false;                   // HEAD: no body.
-    if (file_fd_ >= 0 && file_remaining_ > 0) return true;
-    return write_body_offset_ < write_body_.size();
+    if (file_ && file_remaining_ > 0) return true;
+    if (next_piece_ < pieces_.size()) return true;  // Multi-range pieces left
+    return write_body_offset_ < memory_body_.size();
 }
 
 } // namespace Net
@@ -96,6 +96,7 @@ ServerConfig Config::load(const std::string& path) {
                 assign_if_present(*tls, "cert_file", cfg.tls.cert_file);
                 assign_if_present(*tls, "key_file", cfg.tls.key_file);
                 assign_if_present(*tls, "min_version", cfg.tls.min_version);
+                assign_if_present(*tls, "io_threads", cfg.tls.io_threads);
             }
 
             if (auto rl = config.find("rate_limit"); rl != config.end() && rl->is_object()) {
@@ -113,8 +114,39 @@ ServerConfig Config::load(const std::string& path) {
                 assign_if_present(*cz, "enabled", cfg.compression.enabled);
                 assign_if_present(*cz, "min_bytes", cfg.compression.min_bytes);
                 assign_if_present(*cz, "brotli", cfg.compression.brotli);
+                assign_if_present(*cz, "zstd", cfg.compression.zstd);
+                assign_if_present(*cz, "cache_bytes", cfg.compression.cache_bytes);
+                assign_if_present(*cz, "adaptive", cfg.compression.adaptive);
             }
 
+            if (auto rc = config.find("response_cache"); rc != config.end() && rc->is_object()) {
+                assign_if_present(*rc, "enabled", cfg.response_cache.enabled);
+                assign_if_present(*rc, "max_bytes", cfg.response_cache.max_bytes);
+                assign_if_present(*rc, "max_entry", cfg.response_cache.max_entry);
+            }
+
+            if (auto fr = config.find("file_readahead"); fr != config.end() && fr->is_object()) {
+                assign_if_present(*fr, "enabled", cfg.file_readahead.enabled);
+                assign_if_present(*fr, "window", cfg.file_readahead.window);
+                assign_if_present(*fr, "drop_behind_min_bytes", cfg.file_readahead.drop_behind_min_bytes);
+            }
+
+            if (auto hl = config.find("hls"); hl != config.end() && hl->is_object()) {
+                assign_if_present(*hl, "enabled", cfg.hls.enabled);
+                assign_if_present(*hl, "prefix", cfg.hls.prefix);
+                assign_if_present(*hl, "dir", cfg.hls.dir);
+            }
+
+            if (auto bh = config.find("db_bulkhead"); bh != config.end() && bh->is_object()) {
+                assign_if_present(*bh, "enabled", cfg.db_bulkhead.enabled);
+                assign_if_present(*bh, "threads", cfg.db_bulkhead.threads);
+                assign_if_present(*bh, "max_queue", cfg.db_bulkhead.max_queue);
+                assign_if_present(*bh, "shed", cfg.db_bulkhead.shed);
+                assign_if_present(*bh, "max_queue_wait_ms", cfg.db_bulkhead.max_queue_wait_ms);
+            }
+
+            assign_if_present(config, "binary_json", cfg.binary_json);
+            assign_if_present(config, "auto_etag", cfg.auto_etag);
             assign_if_present(config, "cors_enabled", cfg.cors_enabled);
             assign_if_present(config, "cors_allow_origin", cfg.cors_allow_origin);
 
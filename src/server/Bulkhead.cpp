@@ -0,0 +1,78 @@
+// oreshnek/src/server/Bulkhead.cpp
+#include "oreshnek/server/Bulkhead.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/net/Connection.h"
+
+namespace Oreshnek {
+namespace Server {
+
+Bulkhead::Bulkhead(std::string name, BulkheadOptions options, Metrics::PoolStats& stats)
+    : name_(std::move(name)), options_(options), stats_(stats), pool_(options.threads) {
+    response_pools_.reserve(pool_.size());
+    for (std::size_t i = 0; i < pool_.size(); ++i) {
+        response_pools_.push_back(std::make_unique<Http::HttpResponsePool>());
+    }
+}
+
+Http::HttpResponsePool& Bulkhead::response_pool(int index) {
+    const bool own = index >= 0 && static_cast<std::size_t>(index) < response_pools_.size();
+    return *response_pools_[own ? static_cast<std::size_t>(index) : 0];
+}
+
+bool Bulkhead::can_run() const {
+    return stats_.admitted.load(std::memory_order_relaxed) < static_cast<int64_t>(pool_.size());
+}
+
+bool Bulkhead::waited_too_long(const Pending& pending, Clock::time_point now) const {
+    return options_.max_queue_wait.count() > 0 && now - pending.admitted_at > options_.max_queue_wait;
+}
+
+Bulkhead::Admission Bulkhead::admit(Pending& pending, std::optional<Pending>& evicted) {
+    // Requests already waiting go first.
+    if (queue_.empty() && can_run()) {
+        stats_.admitted.fetch_add(1, std::memory_order_relaxed);
+        return Admission::Run;
+    }
+    if (queue_.size() >= options_.max_queue) {
+        if (options_.shed != ShedPolicy::DropOldest || queue_.empty()) {
+            stats_.shed.fetch_add(1, std::memory_order_relaxed);
+            return Admission::Shed;
+        }
+        evicted = std::move(queue_.front());
+        queue_.pop_front();
+        stats_.shed.fetch_add(1, std::memory_order_relaxed);
+        stats_.waiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+    queue_.push_back(std::move(pending));
+    stats_.waiting.fetch_add(1, std::memory_order_release);
+    return Admission::Queued;
+}
+
+bool Bulkhead::try_admit() {
+    if (!queue_.empty() || !can_run()) return false;
+    stats_.admitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::optional<Bulkhead::Pending> Bulkhead::next(Clock::time_point now, std::vector<Pending>& expired) {
+    expire(now, expired);
+    if (queue_.empty() || !can_run()) return std::nullopt;
+    std::optional<Pending> pending(std::move(queue_.front()));
+    queue_.pop_front();
+    stats_.waiting.fetch_sub(1, std::memory_order_relaxed);
+    stats_.admitted.fetch_add(1, std::memory_order_relaxed);
+    return pending;
+}
+
+void Bulkhead::expire(Clock::time_point now, std::vector<Pending>& expired) {
+    // FIFO: the head has waited longest.
+    while (!queue_.empty() && waited_too_long(queue_.front(), now)) {
+        expired.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+        stats_.waiting.fetch_sub(1, std::memory_order_relaxed);
+        stats_.shed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -0,0 +1,131 @@
+// oreshnek/src/server/CompressionCache.cpp
+#include "oreshnek/server/CompressionCache.h"
+#include "oreshnek/server/Metrics.h"
+#include <algorithm>
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+// Per-shard doorkeeper size; it is simply reset when full.
+constexpr std::size_t kSeenMax = 1024;
+// Bookkeeping per entry (list node, index slot, string headers), counted
+// against the budget so many tiny entries cannot exceed it.
+constexpr std::size_t kNodeOverhead = 160;
+
+void bump(Metrics* metrics, std::atomic<uint64_t> Metrics::*counter, uint64_t n = 1) {
+    if (metrics != nullptr && n > 0) (metrics->*counter).fetch_add(n, std::memory_order_relaxed);
+}
+
+std::size_t body_hash(std::string_view body) {
+    return std::hash<std::string_view>{}(body);
+}
+} // namespace
+
+CompressionCache::CompressionCache(CompressionCacheOptions options, Metrics* metrics)
+    : options_(options), metrics_(metrics) {
+    const std::size_t shards = std::max<std::size_t>(1, options_.shards);
+    shard_budget_ = options_.max_bytes / shards;
+    shards_.reserve(shards);
+    for (std::size_t i = 0; i < shards; ++i) shards_.push_back(std::make_unique<Shard>());
+}
+
+CompressionCache::~CompressionCache() {
+    clear(); // Take this cache's bytes back out of the shared gauge
+}
+
+bool CompressionCache::find(Http::Encoding encoding, int level, std::string_view body, std::string& out) {
+    if (body.size() > options_.max_body || body.size() > shard_budget_) return false;
+    const Key key{body_hash(body), encoding, level};
+    Shard& shard = shard_for(key.hash);
+    std::uint64_t saved = 0;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end() || it->second->body != body) {
+            bump(metrics_, &Metrics::compression_cache_misses);
+            return false;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        out.assign(it->second->compressed);
+        saved = it->second->cost_ns;
+    }
+    bump(metrics_, &Metrics::compression_cache_hits);
+    bump(metrics_, &Metrics::compression_cache_saved_ns, saved);
+    return true;
+}
+
+void CompressionCache::insert(Http::Encoding encoding, int level, std::string_view body,
+                              std::string_view compressed, std::chrono::nanoseconds cost) {
+    const std::size_t bytes = body.size() + compressed.size() + kNodeOverhead;
+    if (body.size() > options_.max_body || bytes > shard_budget_) return;
+    const Key key{body_hash(body), encoding, level};
+    Shard& shard = shard_for(key.hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (options_.admit_on_repeat) {
+        // First sighting: remember the hash only. The doorkeeper ignores the
+        // coding, so a body seen once in gzip is admitted on its first br miss.
+        if (shard.seen.insert(key.hash).second) {
+            if (shard.seen.size() > kSeenMax) shard.seen.clear();
+            return;
+        }
+    }
+    const std::int64_t before = static_cast<std::int64_t>(shard.bytes);
+    if (auto it = shard.index.find(key); it != shard.index.end()) erase(shard, it->second); // Race or collision
+
+    shard.lru.push_front(Node{key, std::string(body), std::string(compressed),
+                              static_cast<std::uint64_t>(std::max<std::int64_t>(0, cost.count())), bytes});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += bytes;
+    uint64_t evicted = 0;
+    while (shard.bytes > shard_budget_) {
+        erase(shard, std::prev(shard.lru.end()));
+        ++evicted;
+    }
+    bump(metrics_, &Metrics::compression_cache_evictions, evicted);
+    publish(static_cast<std::int64_t>(shard.bytes) - before);
+}
+
+void CompressionCache::erase(Shard& shard, std::list<Node>::iterator it) {
+    shard.bytes -= it->bytes;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+void CompressionCache::publish(std::int64_t delta) {
+    if (metrics_ != nullptr && delta != 0) {
+        metrics_->compression_cache_bytes.fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+void CompressionCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        publish(-static_cast<std::int64_t>(shard->bytes));
+        shard->index.clear();
+        shard->lru.clear();
+        shard->seen.clear();
+        shard->bytes = 0;
+    }
+}
+
+std::size_t CompressionCache::size() const {
+    std::size_t n = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        n += shard->lru.size();
+    }
+    return n;
+}
+
+std::size_t CompressionCache::memory_bytes() const {
+    std::size_t n = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        n += shard->bytes;
+    }
+    return n;
+}
+
+} // namespace Server
+} // namespace Oreshnek
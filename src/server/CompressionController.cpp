@@ -0,0 +1,113 @@
+// oreshnek/src/server/CompressionController.cpp
+#include "oreshnek/server/CompressionController.h"
+#include "oreshnek/server/Metrics.h"
+#include "oreshnek/server/WorkStealingPool.h"
+#include <algorithm>
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+CompressionController::CompressionController(CompressionControllerOptions options, const WorkStealingPool& pool,
+                                             const Metrics::PoolStats& stats, Metrics& metrics)
+    : options_(options), pool_(pool), stats_(stats), metrics_(metrics),
+      tier_(static_cast<int>(CompressionTier::Normal)) {
+    const std::int64_t now = now_ns();
+    window_start_ns_.store(now, std::memory_order_relaxed);
+    next_update_ns_.store(now + std::chrono::nanoseconds(options_.interval).count(), std::memory_order_relaxed);
+    publish(CompressionTier::Normal);
+}
+
+int CompressionController::level(Http::Encoding encoding, std::size_t size) {
+    const std::int64_t now = now_ns();
+    std::int64_t due = next_update_ns_.load(std::memory_order_relaxed);
+    // One caller per interval wins the CAS and re-evaluates; the rest go on
+    // with the current tier.
+    if (now >= due && next_update_ns_.compare_exchange_strong(
+                          due, now + std::chrono::nanoseconds(options_.interval).count(),
+                          std::memory_order_relaxed)) {
+        update(now);
+    }
+    const CompressionTier t = tier();
+    if (t == CompressionTier::Saturated && size > options_.saturated_max_body) {
+        metrics_.compression_skipped_total.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    return level_for(t, encoding);
+}
+
+void CompressionController::record(std::chrono::nanoseconds cost) {
+    window_cost_ns_.fetch_add(static_cast<std::uint64_t>(std::max<std::int64_t>(0, cost.count())),
+                              std::memory_order_relaxed);
+}
+
+CompressionTier CompressionController::target(double load, double cpu_share, CompressionTier current) const {
+    int wanted = static_cast<int>(CompressionTier::Normal);
+    if (load >= options_.saturated_load) wanted = static_cast<int>(CompressionTier::Saturated);
+    else if (load >= options_.busy_load) wanted = static_cast<int>(CompressionTier::Busy);
+    else if (load < options_.idle_load) wanted = static_cast<int>(CompressionTier::Idle);
+
+    const int cur = static_cast<int>(current);
+    // Compression itself eating the CPU: back off a step even if the load
+    // figure looks fine (few, large bodies at a slow level).
+    if (cpu_share > options_.max_cpu_share) {
+        wanted = std::max(wanted, std::min(cur + 1, static_cast<int>(CompressionTier::Saturated)));
+    }
+    if (wanted < cur) wanted = cur - 1; // Relax one step per interval
+    return static_cast<CompressionTier>(wanted);
+}
+
+int CompressionController::level_for(CompressionTier tier, Http::Encoding encoding) {
+    switch (tier) {
+    case CompressionTier::Idle:
+        switch (encoding) {
+        case Http::Encoding::Gzip: return 9;
+        case Http::Encoding::Brotli: return 7; // 9+ costs several times more for ~1%
+        case Http::Encoding::Zstd: return 9;
+        case Http::Encoding::None: return 0;
+        }
+        return 0;
+    case CompressionTier::Normal:
+        return Http::default_level(encoding);
+    case CompressionTier::Busy:
+    case CompressionTier::Saturated:
+        return encoding == Http::Encoding::None ? 0 : 1;
+    }
+    return Http::default_level(encoding);
+}
+
+void CompressionController::update(std::int64_t now) {
+    const std::int64_t start = window_start_ns_.exchange(now, std::memory_order_relaxed);
+    const std::uint64_t cost = window_cost_ns_.exchange(0, std::memory_order_relaxed);
+    const double workers = static_cast<double>(std::max<std::size_t>(1, pool_.size()));
+    const double elapsed = static_cast<double>(std::max<std::int64_t>(1, now - start));
+
+    // This pool's own handlers: a busy bulkhead does not slow compression
+    // down while the default pool has room.
+    const double running =
+        static_cast<double>(std::max<std::int64_t>(0, stats_.running.load(std::memory_order_relaxed)));
+    const double load = (running + static_cast<double>(pool_.queue_depth())) / workers;
+    const double cpu_share = static_cast<double>(cost) / (elapsed * workers);
+
+    const CompressionTier next = target(load, cpu_share, tier());
+    if (next != tier()) {
+        tier_.store(static_cast<int>(next), std::memory_order_relaxed);
+        publish(next);
+    }
+}
+
+void CompressionController::publish(CompressionTier tier) {
+    metrics_.compression_tier.store(static_cast<int64_t>(tier), std::memory_order_relaxed);
+    metrics_.compression_level_gzip.store(level_for(tier, Http::Encoding::Gzip), std::memory_order_relaxed);
+    metrics_.compression_level_brotli.store(level_for(tier, Http::Encoding::Brotli), std::memory_order_relaxed);
+    metrics_.compression_level_zstd.store(level_for(tier, Http::Encoding::Zstd), std::memory_order_relaxed);
+}
+
+} // namespace Server
+} // namespace Oreshnek
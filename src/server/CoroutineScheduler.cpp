@@ -0,0 +1,117 @@
+// oreshnek/src/server/CoroutineScheduler.cpp
+#include "oreshnek/server/CoroutineScheduler.h"
+#include "oreshnek/server/Metrics.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+thread_local Bulkhead* t_bulkhead = nullptr;
+} // namespace
+
+CoroutineScheduler::PoolScope::PoolScope(Bulkhead* bulkhead) : previous_(t_bulkhead) { t_bulkhead = bulkhead; }
+
+CoroutineScheduler::PoolScope::~PoolScope() { t_bulkhead = previous_; }
+
+Bulkhead* CoroutineScheduler::current_bulkhead() { return t_bulkhead; }
+
+CoroutineScheduler::CoroutineScheduler(std::function<void()> wake, std::size_t blocking_threads, Metrics* metrics)
+    : wake_(std::move(wake)), metrics_(metrics), blocking_(blocking_threads) {}
+
+CoroutineScheduler::~CoroutineScheduler() { shutdown(); }
+
+void CoroutineScheduler::shutdown() { blocking_.shutdown(); }
+
+void CoroutineScheduler::add_timer(Clock::time_point deadline, std::coroutine_handle<> handle) {
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        earliest = timers_.empty() || deadline < timers_.top().deadline;
+        timers_.push(Timer{deadline, sequence_++, handle, t_bulkhead});
+        pending_.fetch_add(1, std::memory_order_release);
+    }
+    if (metrics_) metrics_->coroutines_suspended.fetch_add(1, std::memory_order_relaxed);
+    // The loop may be sleeping past the new deadline.
+    if (earliest) wake_();
+}
+
+void CoroutineScheduler::ready(std::coroutine_handle<> handle, Bulkhead* bulkhead) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(Resumption{handle, bulkhead});
+        pending_.fetch_add(1, std::memory_order_release);
+    }
+    wake_();
+}
+
+void CoroutineScheduler::run_blocking(std::function<void()> job) {
+    if (metrics_) metrics_->coroutines_suspended.fetch_add(1, std::memory_order_relaxed);
+    blocking_.enqueue(std::move(job));
+}
+
+void CoroutineScheduler::take_ready(Clock::time_point now, std::vector<Resumption>& out) {
+    if (idle()) return;
+    std::size_t taken;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::size_t before = out.size();
+        out.insert(out.end(), ready_.begin(), ready_.end());
+        ready_.clear();
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            out.push_back(Resumption{timers_.top().handle, timers_.top().bulkhead});
+            timers_.pop();
+        }
+        taken = out.size() - before;
+        pending_.fetch_sub(taken, std::memory_order_release);
+    }
+    if (metrics_ && taken > 0) {
+        metrics_->coroutines_suspended.fetch_sub(static_cast<int64_t>(taken), std::memory_order_relaxed);
+        metrics_->coroutine_resumes.fetch_add(taken, std::memory_order_relaxed);
+    }
+}
+
+std::chrono::milliseconds CoroutineScheduler::wait_time(Clock::time_point now, std::chrono::milliseconds max) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready_.empty()) return std::chrono::milliseconds(0);
+    if (timers_.empty()) return max;
+    const Clock::time_point deadline = timers_.top().deadline;
+    if (deadline <= now) return std::chrono::milliseconds(0);
+    // Round up: waking a little late costs less than an extra empty iteration.
+    const auto wait = std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+    return wait < max ? wait : max;
+}
+
+Task<std::optional<std::string>> CoroutineScheduler::read_file(std::string path) {
+    // The awaiter is a named local: GCC 12 destroys closure temporaries of a
+    // co_await operand twice. `path` lives in this frame while it is suspended.
+    auto read = offload([&path]() -> std::optional<std::string> {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return std::nullopt;
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return std::nullopt;
+        }
+        std::string contents(static_cast<std::size_t>(st.st_size), '\0');
+        std::size_t got = 0;
+        while (got < contents.size()) {
+            const ssize_t n = ::pread(fd, contents.data() + got, contents.size() - got, static_cast<off_t>(got));
+            if (n < 0) {
+                ::close(fd);
+                return std::nullopt;
+            }
+            if (n == 0) break;
+            got += static_cast<std::size_t>(n);
+        }
+        ::close(fd);
+        contents.resize(got);
+        return contents;
+    });
+    co_return co_await read;
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -0,0 +1,24 @@
+// oreshnek/src/server/DeferredResponse.cpp
+#include "oreshnek/server/DeferredResponse.h"
+#include "oreshnek/server/Server.h"
+
+namespace Oreshnek {
+namespace Server {
+
+bool DeferredResponse::complete(const std::function<void(Http::HttpResponse&)>& fill) {
+    if (!state_) return false;
+    return state_->server->complete_deferred(*state_, fill);
+}
+
+DeferredResponse::State::~State() {
+    // Every handle is gone and nobody answered: do not leave the client
+    // waiting for the handler timeout.
+    if (server != nullptr && !done.load(std::memory_order_acquire)) {
+        server->complete_deferred(*this, [](Http::HttpResponse& res) {
+            res.status(Http::HttpStatus::INTERNAL_SERVER_ERROR).text("Deferred response abandoned");
+        });
+    }
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -0,0 +1,306 @@
+// oreshnek/src/server/FileCache.cpp
+#include "oreshnek/server/FileCache.h"
+#include "oreshnek/http/MimeTypes.h"
+#include "oreshnek/server/Metrics.h"
+#include "oreshnek/utils/Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring> // For strerror
+#include <string_view>
+#include <unordered_map>
+#include <unistd.h> // For read, close
+#include <vector>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+#ifdef __linux__
+// Anything that can change what a cached entry describes. Reads by this
+// process (IN_ACCESS / IN_OPEN / IN_CLOSE_NOWRITE) are deliberately excluded.
+constexpr uint32_t kWatchMask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                                IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+
+// Whether a change to `changed` (a name in a watched directory; empty: the
+// directory itself) can affect an entry depending on `name` there (empty: on
+// the whole directory). Names extending `name` cover its sidecars.
+bool affects(std::string_view changed, std::string_view name) {
+    if (changed.empty() || name.empty() || changed == name) return true;
+    return changed.size() > name.size() && changed.compare(0, name.size(), name) == 0 &&
+           changed[name.size()] == '.';
+}
+
+void bump(Metrics* metrics, std::atomic<uint64_t> Metrics::*counter, uint64_t n = 1) {
+    if (metrics != nullptr && n > 0) (metrics->*counter).fetch_add(n, std::memory_order_relaxed);
+}
+} // namespace
+
+FileCache::FileCache(FileCacheOptions options, Metrics* metrics)
+    : options_(options), metrics_(metrics) {
+#ifdef __linux__
+    if (options_.inotify && options_.max_entries > 0) {
+        inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0) {
+            ORE_LOG(WARN) << "FileCache: inotify unavailable (" << std::strerror(errno)
+                          << "); entries expire after " << options_.ttl.count() << " ms";
+        }
+    }
+#endif
+}
+
+FileCache::~FileCache() {
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+}
+
+bool FileCache::find(std::string_view key, Result& out, std::shared_ptr<Flight>& flight) {
+    if (options_.max_entries == 0) return false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        const Clock::time_point now = Clock::now();
+        if (inotify_fd_ >= 0 && now >= next_poll_) drain_events(now);
+
+        auto it = index_.find(key);
+        if (it != index_.end() && now >= it->second->expires) {
+            erase(it->second);
+            it = index_.end();
+        }
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            out = it->second->result;
+            bump(metrics_, out.status == StaticLookup::Found ? &Metrics::file_cache_hits
+                                                             : &Metrics::file_cache_negative_hits);
+            return true;
+        }
+        auto pending = flights_.find(key);
+        if (pending == flights_.end()) break;
+        // Someone else is loading it: wait and share the result.
+        const std::shared_ptr<Flight> other = pending->second;
+        flight_cv_.wait(lock, [&other] { return other->done; });
+        if (!other->failed) {
+            out = other->result;
+            bump(metrics_, out.status == StaticLookup::Found ? &Metrics::file_cache_hits
+                                                             : &Metrics::file_cache_negative_hits);
+            return true;
+        }
+    }
+    bump(metrics_, &Metrics::file_cache_misses);
+    flight = std::make_shared<Flight>();
+    flights_.emplace(std::string(key), flight);
+    return false;
+}
+
+void FileCache::Watch::add(const std::string& dir, std::string name) {
+    if (cache_ != nullptr && flight_ != nullptr) cache_->watch(*flight_, dir, std::move(name));
+}
+
+void FileCache::watch(Flight& flight, const std::string& dir, std::string name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unwatch_locked(flight.watch); // Only the last add() counts
+    flight.watch = inotify_fd_ >= 0 ? watch_locked(dir) : -1;
+    flight.watch_name = std::move(name);
+}
+
+void FileCache::insert(std::string_view key, const Result& result, const std::shared_ptr<Flight>& flight) {
+    if (options_.max_entries == 0 || !flight) return;
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    flight->result = result;
+    land_locked(key, *flight);
+    if (auto it = index_.find(key); it != index_.end()) erase(it->second); // Lost a race; refresh
+    // The file changed while it was being loaded: the waiters share this
+    // result, but the next lookup loads it again.
+    if (flight->stale) {
+        unwatch_locked(flight->watch);
+        flight->watch = -1;
+        return;
+    }
+
+    const int watch = flight->watch;
+    flight->watch = -1; // The entry holds the watch now
+    std::chrono::milliseconds ttl = options_.negative_ttl;
+    if (result.status == StaticLookup::Found) ttl = watch >= 0 ? options_.watched_ttl : options_.ttl;
+
+    const std::size_t bytes = result.file && result.file->in_memory ? result.file->memory_bytes() : 0;
+    lru_.push_front(Node{std::string(key), result, now + ttl, watch, std::move(flight->watch_name), bytes});
+    index_.emplace(lru_.front().key, lru_.begin());
+    memory_bytes_ += bytes;
+    uint64_t evicted = 0;
+    // The new entry itself is evicted last: a single file over the budget is
+    // still served from memory until something else displaces it.
+    while (lru_.size() > options_.max_entries ||
+           (memory_bytes_ > options_.memory_budget && lru_.size() > 1)) {
+        erase(std::prev(lru_.end()));
+        ++evicted;
+    }
+    bump(metrics_, &Metrics::file_cache_evictions, evicted);
+    publish_memory();
+}
+
+void FileCache::abandon(std::string_view key, const std::shared_ptr<Flight>& flight) {
+    if (!flight) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    flight->failed = true;
+    unwatch_locked(flight->watch);
+    flight->watch = -1;
+    land_locked(key, *flight);
+}
+
+void FileCache::land_locked(std::string_view key, Flight& flight) {
+    flight.done = true;
+    if (auto it = flights_.find(key); it != flights_.end() && it->second.get() == &flight) flights_.erase(it);
+    flight_cv_.notify_all();
+}
+
+void FileCache::erase(std::list<Node>::iterator it) {
+    memory_bytes_ -= it->bytes;
+    unwatch_locked(it->watch);
+    index_.erase(index_.find(std::string_view(it->key)));
+    lru_.erase(it);
+}
+
+void FileCache::publish_memory() {
+    if (metrics_ == nullptr) return;
+    // Several caches (one per mount plus the server's) share the gauge: publish
+    // the change since this cache last reported.
+    const int64_t delta = static_cast<int64_t>(memory_bytes_) - static_cast<int64_t>(published_bytes_);
+    if (delta != 0) metrics_->file_cache_memory_bytes.fetch_add(delta, std::memory_order_relaxed);
+    published_bytes_ = memory_bytes_;
+}
+
+int FileCache::watch_locked(const std::string& dir) {
+#ifdef __linux__
+    if (auto it = watches_.find(dir); it != watches_.end()) {
+        ++watch_users_[it->second].users;
+        return it->second;
+    }
+    // One watch per directory, held by the entries and loads in it: never more
+    // than there are of those. (The load asking has not evicted anything yet.)
+    if (watches_.size() >= options_.max_entries + flights_.size()) return -1;
+    const int wd = ::inotify_add_watch(inotify_fd_, dir.c_str(), kWatchMask);
+    if (wd < 0) {
+        ORE_LOG(DEBUG) << "FileCache: cannot watch " << dir << ": " << std::strerror(errno);
+        return -1;
+    }
+    watches_.emplace(dir, wd);
+    watch_users_[wd] = DirWatch{dir, 1};
+    return wd;
+#else
+    (void)dir;
+    return -1;
+#endif
+}
+
+void FileCache::unwatch_locked(int wd) {
+#ifdef __linux__
+    auto it = watch_users_.find(wd);
+    if (it == watch_users_.end() || --it->second.users > 0) return; // -1, or a watch already gone
+    ::inotify_rm_watch(inotify_fd_, wd);
+    watches_.erase(it->second.dir);
+    watch_users_.erase(it);
+#else
+    (void)wd;
+#endif
+}
+
+void FileCache::drain_events(Clock::time_point now) {
+#ifdef __linux__
+    next_poll_ = now + options_.inotify_poll;
+    // Watch descriptor -> names changed in its directory ("" for the
+    // directory itself).
+    std::unordered_map<int, std::vector<std::string>> changed;
+    bool overflow = false;
+    alignas(struct inotify_event) char buf[4096];
+    for (;;) {
+        const ssize_t n = ::read(inotify_fd_, buf, sizeof(buf));
+        if (n <= 0) break; // EAGAIN: drained
+        for (ssize_t off = 0; off < n;) {
+            const auto* ev = reinterpret_cast<const struct inotify_event*>(buf + off);
+            off += static_cast<ssize_t>(sizeof(struct inotify_event) + ev->len);
+            if (ev->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            const std::string_view name = ev->len > 0 ? std::string_view(ev->name) : std::string_view();
+            std::vector<std::string>& names = changed[ev->wd];
+            if (std::find(names.begin(), names.end(), name) == names.end()) names.emplace_back(name);
+            if (ev->mask & IN_IGNORED) { // Directory gone or unmounted: the watch is dead
+                if (auto it = watch_users_.find(ev->wd); it != watch_users_.end()) {
+                    watches_.erase(it->second.dir);
+                    watch_users_.erase(it);
+                }
+            }
+        }
+    }
+    if (!overflow && changed.empty()) return;
+
+    auto stale = [&](int watch, const std::string& name) {
+        if (overflow) return true;
+        if (watch < 0) return false;
+        auto it = changed.find(watch);
+        if (it == changed.end()) return false;
+        return std::any_of(it->second.begin(), it->second.end(),
+                           [&name](const std::string& changed_name) { return affects(changed_name, name); });
+    };
+    for (auto& pending : flights_) {
+        if (stale(pending.second->watch, pending.second->watch_name)) pending.second->stale = true;
+    }
+    uint64_t dropped = 0;
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        if (stale(it->watch, it->watch_name)) {
+            auto next = std::next(it);
+            erase(it);
+            it = next;
+            ++dropped;
+        } else {
+            ++it;
+        }
+    }
+    bump(metrics_, &Metrics::file_cache_invalidations, dropped);
+    publish_memory();
+#else
+    (void)now;
+#endif
+}
+
+std::shared_ptr<const Http::FileEntry> FileCache::open(const std::string& path) {
+    return get(path, [this, &path](Watch& watch) {
+        const std::size_t slash = path.find_last_of('/');
+        watch.add(slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash),
+                  slash == std::string::npos ? path : path.substr(slash + 1));
+        Result result;
+        result.file = Http::FileEntry::open(path, Http::mime_type(path), options_.memory_max_file);
+        result.status = result.file ? StaticLookup::Found : StaticLookup::NotFound;
+        return result;
+    }).file;
+}
+
+void FileCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Node& node : lru_) unwatch_locked(node.watch);
+    index_.clear();
+    lru_.clear();
+    memory_bytes_ = 0;
+    publish_memory();
+}
+
+std::size_t FileCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
+std::size_t FileCache::memory_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_bytes_;
+}
+
+std::size_t FileCache::watches() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return watches_.size();
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -0,0 +1,134 @@
+// oreshnek/src/server/FileReadahead.cpp
+#include "oreshnek/server/FileReadahead.h"
+#include "oreshnek/server/Metrics.h"
+#include <algorithm>
+#include <fcntl.h> // For posix_fadvise
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+// posix_fadvise() where there is one; the hints are best effort either way.
+bool advise(int fd, off_t offset, off_t length, int advice) {
+#ifdef __linux__
+    return ::posix_fadvise(fd, offset, length, advice) == 0;
+#else
+    (void)fd;
+    (void)offset;
+    (void)length;
+    (void)advice;
+    return false;
+#endif
+}
+
+#ifdef __linux__
+constexpr int kWillNeed = POSIX_FADV_WILLNEED;
+constexpr int kDontNeed = POSIX_FADV_DONTNEED;
+#else
+constexpr int kWillNeed = 0;
+constexpr int kDontNeed = 0;
+#endif
+
+bool same_file(const Http::FileEntry& a, const Http::FileEntry& b) {
+    return a.device == b.device && a.inode == b.inode && a.etag == b.etag;
+}
+
+std::pair<uint64_t, uint64_t> file_id(const Http::FileEntry& entry) { return {entry.device, entry.inode}; }
+} // namespace
+
+FileReadahead::FileReadahead(FileReadaheadOptions options, Metrics* metrics)
+    : options_(options), metrics_(metrics) {}
+
+void FileReadahead::start(int fd, const std::shared_ptr<const Http::FileEntry>& entry, off_t offset,
+                          off_t length) {
+    if (!entry || entry->in_memory) {
+        forget(fd);
+        return;
+    }
+    Stream& s = streams_[fd];
+    const bool continues = s.entry && same_file(*s.entry, *entry) && offset >= s.first &&
+                           offset <= s.end + static_cast<off_t>(options_.slack);
+    if (!continues) {
+        release(s);
+        s = Stream{};
+    }
+    s.entry = entry; // The descriptor the hints go to
+    ++s.run;
+    s.first = offset;
+    s.end = offset + length;
+
+    const bool long_body = length > 4 * static_cast<off_t>(options_.window);
+    if (!s.sequential && (s.run >= options_.sequential_after || long_body)) {
+        s.sequential = true;
+        s.hinted_to = offset;
+        s.dropped_to = offset;
+        ++readers_[file_id(*entry)];
+        if (metrics_) {
+            metrics_->readahead_streams.fetch_add(1, std::memory_order_relaxed);
+            metrics_->readahead_active.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    s.hinted_to = std::max(s.hinted_to, offset);
+    advance(fd, offset);
+}
+
+void FileReadahead::advance(int fd, off_t offset) {
+    auto it = streams_.find(fd);
+    if (it == streams_.end() || !it->second.sequential) return;
+    Stream& s = it->second;
+    const off_t window = static_cast<off_t>(options_.window);
+    const int file = s.entry->file.fd();
+
+    // Keep [offset, offset + window) and the start of the next range in flight:
+    // re-hint once half of the prefetched window has been sent.
+    const off_t limit = std::min<off_t>(s.entry->size, s.end + window);
+    if (s.hinted_to < limit && offset + window / 2 >= s.hinted_to) {
+        const off_t from = std::max(s.hinted_to, offset);
+        const off_t length = std::min(window, limit - from);
+        if (length > 0 && advise(file, from, length, kWillNeed) && metrics_) {
+            metrics_->readahead_hints.fetch_add(1, std::memory_order_relaxed);
+            metrics_->readahead_bytes.fetch_add(static_cast<uint64_t>(length), std::memory_order_relaxed);
+        }
+        s.hinted_to = from + length;
+    }
+
+    // Drop behind: only for large files this connection alone is streaming (a
+    // second viewer may be just behind us), and a window back so a small seek
+    // backwards is still a hit.
+    if (options_.drop_behind_min_bytes == 0 || s.entry->size < static_cast<int64_t>(options_.drop_behind_min_bytes))
+        return;
+    auto readers = readers_.find(file_id(*s.entry));
+    if (readers == readers_.end() || readers->second != 1) return;
+    const off_t drop_to = offset - window;
+    if (drop_to > s.dropped_to) {
+        if (advise(file, s.dropped_to, drop_to - s.dropped_to, kDontNeed) && metrics_) {
+            metrics_->readahead_dropped_bytes.fetch_add(static_cast<uint64_t>(drop_to - s.dropped_to),
+                                                        std::memory_order_relaxed);
+        }
+        s.dropped_to = drop_to;
+    }
+}
+
+void FileReadahead::forget(int fd) {
+    auto it = streams_.find(fd);
+    if (it == streams_.end()) return;
+    release(it->second);
+    streams_.erase(it);
+}
+
+std::size_t FileReadahead::sequential() const {
+    std::size_t n = 0;
+    for (const auto& [entry, readers] : readers_) n += static_cast<std::size_t>(readers);
+    return n;
+}
+
+void FileReadahead::release(Stream& stream) {
+    if (!stream.sequential) return;
+    stream.sequential = false;
+    auto it = readers_.find(file_id(*stream.entry));
+    if (it != readers_.end() && --it->second <= 0) readers_.erase(it);
+    if (metrics_) metrics_->readahead_active.fetch_sub(1, std::memory_order_relaxed);
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -0,0 +1,418 @@
+// oreshnek/src/server/HlsOrigin.cpp
+#include "oreshnek/server/HlsOrigin.h"
+#include "oreshnek/server/Metrics.h"
+#include "oreshnek/http/MimeTypes.h"
+#include "oreshnek/utils/Hash.h"
+#include "oreshnek/utils/Logger.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+constexpr std::chrono::milliseconds kScanInterval{100}; // Without inotify
+constexpr std::chrono::seconds kDefaultTarget{6};        // Playlist without EXT-X-TARGETDURATION
+
+#ifdef __linux__
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE;
+#endif
+
+bool is_playlist(std::string_view path) {
+    return path.size() > 5 && path.substr(path.size() - 5) == ".m3u8";
+}
+
+std::string join(const std::string& dir, std::string_view name) {
+    return dir.empty() ? std::string(name) : dir + "/" + std::string(name);
+}
+
+bool parse_int(std::string_view text, int64_t& out) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, out);
+    return ec == std::errc() && ptr == end;
+}
+
+bool starts_with(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && s.substr(0, prefix.size()) == prefix;
+}
+
+int64_t mtime_ns(const struct stat& st) {
+#ifdef __APPLE__
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+StaticOptions segment_options(const HlsOptions& options) {
+    StaticOptions out;
+    out.index = "";
+    out.cache_control = options.segment_cache_control;
+    out.precompressed = false;
+    out.cache.memory_max_file = options.memory_max_file;
+    out.cache.memory_budget = options.memory_budget;
+    // A part the client asks for just before the packager writes it must not
+    // be remembered as a 404.
+    out.cache.negative_ttl = std::chrono::milliseconds(0);
+    return out;
+}
+} // namespace
+
+HlsOrigin::HlsOrigin(const std::string& root, HlsOptions options, Metrics* metrics)
+    : options_(std::move(options)), metrics_(metrics), files_(root, segment_options(options_), metrics) {
+    std::error_code ec;
+    root_ = std::filesystem::absolute(root, ec).lexically_normal().string();
+    while (root_.size() > 1 && root_.back() == '/') root_.pop_back();
+#ifdef __linux__
+    if (options_.inotify) {
+        inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0) ORE_LOG(WARN) << "HLS: inotify unavailable, polling " << root_;
+    }
+#endif
+    add_tree("", nullptr);
+}
+
+HlsOrigin::~HlsOrigin() {
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+}
+
+std::optional<HlsOrigin::Position> HlsOrigin::blocking_position(const Http::HttpRequest& req) {
+    const auto msn = req.query("_HLS_msn");
+    if (!msn) return std::nullopt;
+    Position position;
+    // A malformed value is a blocking request all the same, answered with a 400.
+    if (!parse_int(*msn, position.msn) || position.msn < 0) return Position{-1, -1};
+    if (const auto part = req.query("_HLS_part")) {
+        if (!parse_int(*part, position.part) || position.part < 0) return Position{-1, -1};
+    }
+    return position;
+}
+
+HlsOrigin::Readiness HlsOrigin::ready(std::string_view relative, Position position) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = playlists_.find(std::string(relative));
+    if (it == playlists_.end()) return Readiness::Unknown;
+    return ready_locked(it->second, position);
+}
+
+HlsOrigin::Readiness HlsOrigin::ready_locked(const Playlist& playlist, Position position) const {
+    if (position.msn < 0) return Readiness::Invalid;
+    if (playlist.ended) return Readiness::Ready;
+    if (position.msn > playlist.last_msn + 2) return Readiness::Invalid;
+    if (position.msn <= playlist.last_msn) return Readiness::Ready;
+    // The segment after the last complete one is being written: its parts so far.
+    if (position.part >= 0 && position.msn == playlist.last_msn + 1 && position.part <= playlist.last_part)
+        return Readiness::Ready;
+    return Readiness::Wait;
+}
+
+HlsOrigin::Clock::time_point HlsOrigin::block_deadline(std::string_view relative, Clock::time_point now) const {
+    if (options_.block_timeout.count() > 0) return now + options_.block_timeout;
+    std::chrono::milliseconds target = kDefaultTarget;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = playlists_.find(std::string(relative));
+        if (it != playlists_.end() && it->second.target.count() > 0) target = it->second.target;
+    }
+    return now + 3 * target;
+}
+
+void HlsOrigin::serve(const Http::HttpRequest& req, std::string_view relative, Http::HttpResponse& res) const {
+    if (!is_playlist(relative)) {
+        files_.serve(req, relative, res);
+        return;
+    }
+    const std::optional<Position> position = blocking_position(req);
+    std::shared_ptr<const Http::FileEntry> entry;
+    Readiness readiness = Readiness::Ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = playlists_.find(std::string(relative));
+        if (it != playlists_.end()) {
+            entry = it->second.entry;
+            if (position) readiness = ready_locked(it->second, *position);
+        }
+    }
+    if (!entry) {
+        // Not loaded (too large, or not there): the directory answers.
+        files_.serve(req, relative, res);
+        return;
+    }
+    if (readiness == Readiness::Invalid) {
+        res.status(Http::HttpStatus::BAD_REQUEST).text("_HLS_msn is beyond the playlist");
+        return;
+    }
+    if (readiness == Readiness::Wait) {
+        // Only reached after the block timeout: the packager has stalled.
+        res.status(Http::HttpStatus::SERVICE_UNAVAILABLE)
+            .header("Retry-After", "1")
+            .text("Playlist did not reach _HLS_msn in time");
+        return;
+    }
+    res.status(Http::HttpStatus::OK).file(entry);
+    const std::string& cache_control = position ? options_.blocking_cache_control : options_.playlist_cache_control;
+    if (!cache_control.empty()) res.header("Cache-Control", cache_control);
+}
+
+void HlsOrigin::Reload::merge(Reload&& other) {
+    playlists.insert(playlists.end(), std::make_move_iterator(other.playlists.begin()),
+                     std::make_move_iterator(other.playlists.end()));
+    directories.insert(directories.end(), std::make_move_iterator(other.directories.begin()),
+                       std::make_move_iterator(other.directories.end()));
+    rescan = rescan || other.rescan;
+}
+
+HlsOrigin::Reload HlsOrigin::collect(Clock::time_point now) {
+    Reload reload;
+    if (inotify_fd_ < 0) {
+        if (now < next_scan_) return reload;
+        next_scan_ = now + kScanInterval;
+        reload.rescan = true; // load() skips files whose size and mtime are unchanged
+        return reload;
+    }
+#ifdef __linux__
+    alignas(struct inotify_event) char buf[8192];
+    std::string relative_dir;
+    for (;;) {
+        const ssize_t n = ::read(inotify_fd_, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n;) {
+            const auto* ev = reinterpret_cast<const struct inotify_event*>(buf + i);
+            i += static_cast<ssize_t>(sizeof(struct inotify_event) + ev->len);
+            if (ev->mask & IN_Q_OVERFLOW) {
+                ORE_LOG(WARN) << "HLS: inotify queue overflow, rescanning " << root_;
+                reload.rescan = true;
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                watches_.erase(ev->wd);
+                continue;
+            }
+            if (ev->len == 0 || !watched_dir(ev->wd, relative_dir)) continue;
+            const std::string_view name(ev->name);
+            if (name.empty() || name[0] == '.') continue; // Packagers' temporary files
+            std::string relative = join(relative_dir, name);
+            if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) reload.directories.push_back(std::move(relative));
+                continue;
+            }
+            // A playlist that was deleted or moved away fails to load: forgotten.
+            if (is_playlist(name) && (ev->mask & (IN_DELETE | IN_MOVED_FROM | IN_CLOSE_WRITE | IN_MOVED_TO))) {
+                reload.playlists.push_back(std::move(relative));
+            }
+        }
+    }
+#endif
+    return reload;
+}
+
+std::vector<std::string> HlsOrigin::apply(const Reload& reload) {
+    std::vector<std::string> changed;
+    if (reload.rescan) {
+        // Mark and sweep: a playlist the scan did not find was deleted while
+        // nothing was watching (polling, or events lost to a queue overflow).
+        std::vector<std::string> seen;
+        add_tree("", &changed, &seen);
+        std::sort(seen.begin(), seen.end());
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = playlists_.begin(); it != playlists_.end();) {
+            if (std::binary_search(seen.begin(), seen.end(), it->first)) {
+                ++it;
+                continue;
+            }
+            changed.push_back(it->first);
+            it = playlists_.erase(it);
+        }
+    } else {
+        for (const std::string& dir : reload.directories) add_tree(dir, &changed);
+        std::vector<std::string> playlists = reload.playlists;
+        std::sort(playlists.begin(), playlists.end());
+        playlists.erase(std::unique(playlists.begin(), playlists.end()), playlists.end());
+        for (const std::string& relative : playlists) {
+            if (load(relative)) changed.push_back(relative);
+        }
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+bool HlsOrigin::watched_dir(int wd, std::string& relative_dir) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = watches_.find(wd);
+    if (it == watches_.end()) return false;
+    relative_dir = it->second;
+    return true;
+}
+
+void HlsOrigin::park(Waiter waiter) { waiters_.push_back(std::move(waiter)); }
+
+std::vector<HlsOrigin::Waiter> HlsOrigin::release(const std::vector<std::string>& changed) {
+    std::vector<Waiter> out;
+    if (changed.empty() || waiters_.empty()) return out;
+    std::vector<Waiter> keep;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Waiter& waiter : waiters_) {
+        if (std::find(changed.begin(), changed.end(), waiter.playlist) == changed.end()) {
+            keep.push_back(std::move(waiter));
+            continue;
+        }
+        auto it = playlists_.find(waiter.playlist);
+        // A playlist that went away is answered by the worker (404).
+        if (it == playlists_.end() || ready_locked(it->second, waiter.position) != Readiness::Wait) {
+            out.push_back(std::move(waiter));
+        } else {
+            keep.push_back(std::move(waiter));
+        }
+    }
+    waiters_.swap(keep);
+    return out;
+}
+
+std::vector<HlsOrigin::Waiter> HlsOrigin::expire(Clock::time_point now) {
+    std::vector<Waiter> out;
+    auto expired = std::stable_partition(waiters_.begin(), waiters_.end(),
+                                         [now](const Waiter& w) { return w.deadline >= now; });
+    std::move(expired, waiters_.end(), std::back_inserter(out));
+    waiters_.erase(expired, waiters_.end());
+    return out;
+}
+
+std::size_t HlsOrigin::playlists() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return playlists_.size();
+}
+
+void HlsOrigin::parse(std::string_view text, Playlist& out) {
+    int64_t sequence = 0;
+    int64_t segments = 0;
+    int64_t parts = 0; // Of the segment being written
+    while (!text.empty()) {
+        const size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text = eol == std::string_view::npos ? std::string_view() : text.substr(eol + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        if (line[0] != '#') {
+            ++segments; // A URI line closes a segment
+            parts = 0;
+        } else if (starts_with(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            parse_int(line.substr(22), sequence);
+        } else if (starts_with(line, "#EXT-X-TARGETDURATION:")) {
+            int64_t seconds = 0;
+            if (parse_int(line.substr(22), seconds)) out.target = std::chrono::seconds(seconds);
+        } else if (starts_with(line, "#EXT-X-PART:")) {
+            ++parts;
+        } else if (starts_with(line, "#EXT-X-ENDLIST")) {
+            out.ended = true;
+        }
+    }
+    out.last_msn = sequence + segments - 1;
+    out.last_part = parts - 1;
+}
+
+bool HlsOrigin::load(const std::string& relative) {
+    const std::string path = root_ + "/" + relative;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) return forget(relative);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        static_cast<std::size_t>(st.st_size) > options_.max_playlist) {
+        ::close(fd);
+        return forget(relative);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = playlists_.find(relative);
+        if (it != playlists_.end() && it->second.mtime_ns == mtime_ns(st) && it->second.size == st.st_size) {
+            ::close(fd);
+            return false;
+        }
+    }
+
+    std::string contents(static_cast<size_t>(st.st_size), '\0');
+    size_t got = 0;
+    while (got < contents.size()) {
+        const ssize_t n = ::pread(fd, contents.data() + got, contents.size() - got, static_cast<off_t>(got));
+        if (n <= 0) break;
+        got += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    contents.resize(got);
+
+    Playlist playlist;
+    parse(contents, playlist);
+    playlist.mtime_ns = mtime_ns(st);
+    playlist.size = st.st_size;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = playlists_.find(relative);
+        if (it != playlists_.end() && it->second.entry->contents == contents) {
+            it->second.mtime_ns = playlist.mtime_ns; // Touched, not changed
+            it->second.size = playlist.size;
+            return false;
+        }
+    }
+    // Two versions written within a second share size/mtime validators often
+    // enough: the ETag is a hash of the contents.
+    char etag[24];
+    std::snprintf(etag, sizeof(etag), "\"%016llx\"", static_cast<unsigned long long>(Utils::hash64(contents)));
+    playlist.entry = Http::FileEntry::from_memory(std::move(contents), Http::mime_type(relative),
+                                                  static_cast<int64_t>(st.st_mtime), etag);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        playlists_[relative] = std::move(playlist);
+    }
+    if (metrics_) metrics_->hls_playlist_reloads.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool HlsOrigin::forget(const std::string& relative) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return playlists_.erase(relative) != 0;
+}
+
+void HlsOrigin::add_tree(const std::string& relative_dir, std::vector<std::string>* changed,
+                         std::vector<std::string>* seen) {
+    const std::string dir = relative_dir.empty() ? root_ : root_ + "/" + relative_dir;
+#ifdef __linux__
+    if (inotify_fd_ >= 0) {
+        const int wd = ::inotify_add_watch(inotify_fd_, dir.c_str(), kWatchMask | IN_ONLYDIR | IN_DONT_FOLLOW);
+        if (wd >= 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            watches_[wd] = relative_dir;
+        } else {
+            ORE_LOG(WARN) << "HLS: cannot watch " << dir << " (inotify watch limit?)";
+        }
+    }
+#endif
+    std::error_code ec;
+    for (const auto& item : std::filesystem::directory_iterator(dir, ec)) {
+        const std::string name = item.path().filename().string();
+        if (name.empty() || name[0] == '.') continue;
+        const std::string relative = join(relative_dir, name);
+        if (item.is_symlink(ec)) continue;
+        if (item.is_directory(ec)) {
+            add_tree(relative, changed, seen);
+        } else if (is_playlist(name)) {
+            if (seen != nullptr) seen->push_back(relative);
+            if (load(relative) && changed != nullptr) changed->push_back(relative);
+        }
+    }
+}
+
+} // namespace Server
+} // namespace Oreshnek
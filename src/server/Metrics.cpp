@@ -2,6 +2,7 @@
 #include "oreshnek/server/Metrics.h"
 
 #include <sstream>
+#include <sys/resource.h> // For getrusage (major faults)
 
 namespace Oreshnek {
 namespace Server {
@@ -13,6 +14,30 @@ void Metrics::record_status(int code) {
     else if (code >= 500) responses_5xx.fetch_add(1, std::memory_order_relaxed);
 }
 
+Metrics::PoolStats& Metrics::add_pool(std::string name, std::size_t threads) {
+    pools_.push_back(std::make_unique<PoolStats>(std::move(name), threads));
+    return *pools_.back();
+}
+
+const Metrics::PoolStats* Metrics::pool(std::string_view name) const {
+    for (const auto& pool : pools_) {
+        if (pool->name == name) return pool.get();
+    }
+    return nullptr;
+}
+
+void Metrics::PoolStats::observe_latency(double seconds) {
+    for (size_t i = 0; i < kBuckets.size(); ++i) {
+        if (seconds <= kBuckets[i]) {
+            latency_buckets[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    latency_count.fetch_add(1, std::memory_order_relaxed);
+    double cur = latency_sum.load(std::memory_order_relaxed);
+    while (!latency_sum.compare_exchange_weak(cur, cur + seconds, std::memory_order_relaxed)) {
+    }
+}
+
 void Metrics::observe_duration(double seconds) {
     for (size_t i = 0; i < kBuckets.size(); ++i) {
         if (seconds <= kBuckets[i]) {
@@ -53,6 +78,147 @@ std::string Metrics::render() const {
     counter("oreshnek_load_shed_total", "Requests rejected with 503 due to the in-flight handler cap.",
             load_shed_total.load(std::memory_order_relaxed));
 
+    o << "# HELP oreshnek_file_cache_lookups_total Open-file cache lookups by result.\n"
+      << "# TYPE oreshnek_file_cache_lookups_total counter\n"
+      << "oreshnek_file_cache_lookups_total{result=\"hit\"} "
+      << file_cache_hits.load(std::memory_order_relaxed) << '\n'
+      << "oreshnek_file_cache_lookups_total{result=\"negative_hit\"} "
+      << file_cache_negative_hits.load(std::memory_order_relaxed) << '\n'
+      << "oreshnek_file_cache_lookups_total{result=\"miss\"} "
+      << file_cache_misses.load(std::memory_order_relaxed) << '\n';
+    counter("oreshnek_file_cache_invalidations_total", "Open-file cache entries dropped after a change on disk.",
+            file_cache_invalidations.load(std::memory_order_relaxed));
+    counter("oreshnek_file_cache_evictions_total", "Open-file cache entries evicted by the size bound.",
+            file_cache_evictions.load(std::memory_order_relaxed));
+
+    o << "# HELP oreshnek_file_cache_memory_bytes Bytes of small files held in memory by the file caches.\n"
+      << "# TYPE oreshnek_file_cache_memory_bytes gauge\n"
+      << "oreshnek_file_cache_memory_bytes " << file_cache_memory_bytes.load(std::memory_order_relaxed) << '\n';
+
+    const uint64_t cc_hits = compression_cache_hits.load(std::memory_order_relaxed);
+    const uint64_t cc_misses = compression_cache_misses.load(std::memory_order_relaxed);
+    o << "# HELP oreshnek_compression_cache_lookups_total Compressed-response cache lookups by result.\n"
+      << "# TYPE oreshnek_compression_cache_lookups_total counter\n"
+      << "oreshnek_compression_cache_lookups_total{result=\"hit\"} " << cc_hits << '\n'
+      << "oreshnek_compression_cache_lookups_total{result=\"miss\"} " << cc_misses << '\n';
+    o << "# HELP oreshnek_compression_cache_hit_ratio Share of compressed-response cache lookups that hit.\n"
+      << "# TYPE oreshnek_compression_cache_hit_ratio gauge\n"
+      << "oreshnek_compression_cache_hit_ratio "
+      << (cc_hits + cc_misses > 0 ? static_cast<double>(cc_hits) / static_cast<double>(cc_hits + cc_misses) : 0.0)
+      << '\n';
+    counter("oreshnek_compression_cache_evictions_total", "Compressed-response cache entries evicted by the byte budget.",
+            compression_cache_evictions.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_compression_cache_bytes Bytes held by the compressed-response cache.\n"
+      << "# TYPE oreshnek_compression_cache_bytes gauge\n"
+      << "oreshnek_compression_cache_bytes " << compression_cache_bytes.load(std::memory_order_relaxed) << '\n';
+    o << "# HELP oreshnek_compression_cache_saved_cpu_seconds_total Compression time avoided by cache hits.\n"
+      << "# TYPE oreshnek_compression_cache_saved_cpu_seconds_total counter\n"
+      << "oreshnek_compression_cache_saved_cpu_seconds_total "
+      << static_cast<double>(compression_cache_saved_ns.load(std::memory_order_relaxed)) / 1e9 << '\n';
+
+    const uint64_t c_in = compression_bytes_in.load(std::memory_order_relaxed);
+    const uint64_t c_out = compression_bytes_out.load(std::memory_order_relaxed);
+    o << "# HELP oreshnek_compression_bytes_total Compressed response bodies, before and after compression.\n"
+      << "# TYPE oreshnek_compression_bytes_total counter\n"
+      << "oreshnek_compression_bytes_total{stage=\"in\"} " << c_in << '\n'
+      << "oreshnek_compression_bytes_total{stage=\"out\"} " << c_out << '\n';
+    counter("oreshnek_compression_saved_bytes_total", "Response bytes saved by compression.",
+            c_in > c_out ? c_in - c_out : 0);
+    o << "# HELP oreshnek_compression_cpu_seconds_total Time spent compressing response bodies.\n"
+      << "# TYPE oreshnek_compression_cpu_seconds_total counter\n"
+      << "oreshnek_compression_cpu_seconds_total "
+      << static_cast<double>(compression_ns.load(std::memory_order_relaxed)) / 1e9 << '\n';
+    counter("oreshnek_compression_skipped_total", "Bodies sent uncompressed because the server was saturated.",
+            compression_skipped_total.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_compression_tier Adaptive compression tier (0 idle, 1 normal, 2 busy, 3 saturated).\n"
+      << "# TYPE oreshnek_compression_tier gauge\n"
+      << "oreshnek_compression_tier " << compression_tier.load(std::memory_order_relaxed) << '\n';
+    o << "# HELP oreshnek_compression_level Compression level currently used per coding.\n"
+      << "# TYPE oreshnek_compression_level gauge\n"
+      << "oreshnek_compression_level{coding=\"gzip\"} " << compression_level_gzip.load(std::memory_order_relaxed) << '\n'
+      << "oreshnek_compression_level{coding=\"br\"} " << compression_level_brotli.load(std::memory_order_relaxed) << '\n'
+      << "oreshnek_compression_level{coding=\"zstd\"} " << compression_level_zstd.load(std::memory_order_relaxed)
+      << '\n';
+
+    o << "# HELP oreshnek_response_cache_lookups_total Response cache lookups by result.\n"
+      << "# TYPE oreshnek_response_cache_lookups_total counter\n"
+      << "oreshnek_response_cache_lookups_total{result=\"hit\"} "
+      << response_cache_hits.load(std::memory_order_relaxed) << '\n'
+      << "oreshnek_response_cache_lookups_total{result=\"stale\"} "
+      << response_cache_stale_hits.load(std::memory_order_relaxed) << '\n'
+      << "oreshnek_response_cache_lookups_total{result=\"miss\"} "
+      << response_cache_misses.load(std::memory_order_relaxed) << '\n';
+    counter("oreshnek_response_cache_revalidations_total", "Background refreshes of stale cached responses.",
+            response_cache_revalidations.load(std::memory_order_relaxed));
+    counter("oreshnek_response_cache_stores_total", "Responses stored in the response cache.",
+            response_cache_stores.load(std::memory_order_relaxed));
+    counter("oreshnek_response_cache_evictions_total", "Response cache entries evicted by the byte budget.",
+            response_cache_evictions.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_response_cache_bytes Bytes held by the response cache.\n"
+      << "# TYPE oreshnek_response_cache_bytes gauge\n"
+      << "oreshnek_response_cache_bytes " << response_cache_bytes.load(std::memory_order_relaxed) << '\n';
+
+    const uint64_t cf_leaders = coalesce_leaders.load(std::memory_order_relaxed);
+    const uint64_t cf_followers = coalesce_followers.load(std::memory_order_relaxed);
+    o << "# HELP oreshnek_coalesced_requests_total Requests on single-flight routes by role.\n"
+      << "# TYPE oreshnek_coalesced_requests_total counter\n"
+      << "oreshnek_coalesced_requests_total{role=\"leader\"} " << cf_leaders << '\n'
+      << "oreshnek_coalesced_requests_total{role=\"follower\"} " << cf_followers << '\n';
+    o << "# HELP oreshnek_coalesce_ratio Share of single-flight requests answered without running the handler.\n"
+      << "# TYPE oreshnek_coalesce_ratio gauge\n"
+      << "oreshnek_coalesce_ratio "
+      << (cf_leaders + cf_followers > 0
+              ? static_cast<double>(cf_followers) / static_cast<double>(cf_leaders + cf_followers)
+              : 0.0)
+      << '\n';
+    counter("oreshnek_coalesce_timeouts_total", "Coalesced requests answered 504 after waiting too long.",
+            coalesce_timeouts.load(std::memory_order_relaxed));
+    counter("oreshnek_coalesce_redispatched_total", "Coalesced requests run on their own (unshareable response).",
+            coalesce_redispatched.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_coalesce_waiting Requests waiting on an in-flight identical request.\n"
+      << "# TYPE oreshnek_coalesce_waiting gauge\n"
+      << "oreshnek_coalesce_waiting " << coalesce_waiting.load(std::memory_order_relaxed) << '\n';
+
+    o << "# HELP oreshnek_file_send_seconds_total Event-loop time spent writing file bodies.\n"
+      << "# TYPE oreshnek_file_send_seconds_total counter\n"
+      << "oreshnek_file_send_seconds_total "
+      << static_cast<double>(file_send_ns.load(std::memory_order_relaxed)) / 1e9 << '\n';
+    counter("oreshnek_file_send_calls_total", "Write calls that sent file-body bytes.",
+            file_send_calls.load(std::memory_order_relaxed));
+    counter("oreshnek_readahead_streams_total", "Connections detected streaming a file sequentially.",
+            readahead_streams.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_readahead_active Connections currently streaming a file sequentially.\n"
+      << "# TYPE oreshnek_readahead_active gauge\n"
+      << "oreshnek_readahead_active " << readahead_active.load(std::memory_order_relaxed) << '\n';
+    counter("oreshnek_readahead_hints_total", "Readahead (WILLNEED) hints issued for file bodies.",
+            readahead_hints.load(std::memory_order_relaxed));
+    counter("oreshnek_readahead_bytes_total", "File bytes covered by readahead hints.",
+            readahead_bytes.load(std::memory_order_relaxed));
+    counter("oreshnek_readahead_dropped_bytes_total", "File bytes dropped from the page cache behind the sender.",
+            readahead_dropped_bytes.load(std::memory_order_relaxed));
+    counter("oreshnek_async_file_reads_total", "File reads done on I/O threads for TLS bodies.",
+            async_file_reads.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_async_file_read_seconds_total Time I/O threads spent reading file bodies.\n"
+      << "# TYPE oreshnek_async_file_read_seconds_total counter\n"
+      << "oreshnek_async_file_read_seconds_total "
+      << static_cast<double>(async_file_read_ns.load(std::memory_order_relaxed)) / 1e9 << '\n';
+    counter("oreshnek_async_file_read_stalls_total", "TLS file writes that waited for a read to complete.",
+            async_file_read_stalls.load(std::memory_order_relaxed));
+    counter("oreshnek_hls_playlist_reloads_total", "HLS playlist versions loaded into memory.",
+            hls_playlist_reloads.load(std::memory_order_relaxed));
+    counter("oreshnek_hls_blocked_total", "HLS blocking playlist reloads parked until the playlist advanced.",
+            hls_blocked.load(std::memory_order_relaxed));
+    counter("oreshnek_hls_block_timeouts_total", "HLS blocking playlist reloads answered 503 after the block timeout.",
+            hls_block_timeouts.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_hls_waiting HLS blocking playlist reloads currently parked.\n"
+      << "# TYPE oreshnek_hls_waiting gauge\n"
+      << "oreshnek_hls_waiting " << hls_waiting.load(std::memory_order_relaxed) << '\n';
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        counter("oreshnek_process_major_faults_total", "Page faults that required disk I/O.",
+                static_cast<uint64_t>(usage.ru_majflt));
+    }
+
     o << "# HELP oreshnek_connections_active Currently open connections.\n"
       << "# TYPE oreshnek_connections_active gauge\n"
       << "oreshnek_connections_active " << connections_active.load(std::memory_order_relaxed) << '\n';
@@ -61,6 +227,60 @@ std::string Metrics::render() const {
       << "# TYPE oreshnek_workers_in_flight gauge\n"
       << "oreshnek_workers_in_flight " << workers_in_flight.load(std::memory_order_relaxed) << '\n';
 
+    counter("oreshnek_deferred_responses_total", "Responses deferred by their handler.",
+            deferred_total.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_deferred_pending Deferred responses not completed yet.\n"
+      << "# TYPE oreshnek_deferred_pending gauge\n"
+      << "oreshnek_deferred_pending " << deferred_pending.load(std::memory_order_relaxed) << '\n';
+    o << "# HELP oreshnek_coroutines_suspended Coroutine handlers waiting on a timer or a blocking call.\n"
+      << "# TYPE oreshnek_coroutines_suspended gauge\n"
+      << "oreshnek_coroutines_suspended " << coroutines_suspended.load(std::memory_order_relaxed) << '\n';
+    counter("oreshnek_coroutine_resumes_total", "Coroutine handler resumptions posted to workers.",
+            coroutine_resumes.load(std::memory_order_relaxed));
+    counter("oreshnek_inline_requests_total", "Requests handled on the event loop (inline routes).",
+            inline_requests.load(std::memory_order_relaxed));
+    counter("oreshnek_inline_overruns_total", "Inline runs slower than their route's budget.",
+            inline_overruns.load(std::memory_order_relaxed));
+    o << "# HELP oreshnek_inline_demoted_routes Inline routes moved to the workers for overrunning.\n"
+      << "# TYPE oreshnek_inline_demoted_routes gauge\n"
+      << "oreshnek_inline_demoted_routes " << inline_demoted_routes.load(std::memory_order_relaxed) << '\n';
+
+    // Worker pools, one series per pool.
+    if (!pools_.empty()) {
+        auto per_pool = [&](const char* name, const char* help, const char* type, auto value) {
+            o << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+            for (const auto& pool : pools_) {
+                o << name << "{pool=\"" << pool->name << "\"} " << value(*pool) << '\n';
+            }
+        };
+        per_pool("oreshnek_pool_threads", "Worker threads of the pool.", "gauge",
+                 [](const PoolStats& p) { return p.threads; });
+        per_pool("oreshnek_pool_in_flight", "Handlers running on the pool's workers.", "gauge",
+                 [](const PoolStats& p) { return p.running.load(std::memory_order_relaxed); });
+        per_pool("oreshnek_pool_queue_depth", "Requests admitted to the pool and waiting for a worker.", "gauge",
+                 [](const PoolStats& p) {
+                     const int64_t queued = p.admitted.load(std::memory_order_relaxed) -
+                                            p.running.load(std::memory_order_relaxed);
+                     return p.waiting.load(std::memory_order_relaxed) + (queued > 0 ? queued : 0);
+                 });
+        per_pool("oreshnek_pool_shed_total", "Requests answered 503 by the pool's admission limits.", "counter",
+                 [](const PoolStats& p) { return p.shed.load(std::memory_order_relaxed); });
+        o << "# HELP oreshnek_pool_latency_seconds Admission to handler return, queue wait included.\n"
+          << "# TYPE oreshnek_pool_latency_seconds histogram\n";
+        for (const auto& pool : pools_) {
+            const std::string label = "pool=\"" + pool->name + "\"";
+            for (size_t i = 0; i < kBuckets.size(); ++i) {
+                o << "oreshnek_pool_latency_seconds_bucket{" << label << ",le=\"" << kBuckets[i] << "\"} "
+                  << pool->latency_buckets[i].load(std::memory_order_relaxed) << '\n';
+            }
+            const uint64_t n = pool->latency_count.load(std::memory_order_relaxed);
+            o << "oreshnek_pool_latency_seconds_bucket{" << label << ",le=\"+Inf\"} " << n << '\n'
+              << "oreshnek_pool_latency_seconds_sum{" << label << "} "
+              << pool->latency_sum.load(std::memory_order_relaxed) << '\n'
+              << "oreshnek_pool_latency_seconds_count{" << label << "} " << n << '\n';
+        }
+    }
+
     // Histogram: cumulative buckets, then sum and count.
     o << "# HELP oreshnek_request_duration_seconds Request processing duration.\n"
       << "# TYPE oreshnek_request_duration_seconds histogram\n";
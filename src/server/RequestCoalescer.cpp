@@ -0,0 +1,66 @@
+// oreshnek/src/server/RequestCoalescer.cpp
+#include "oreshnek/server/RequestCoalescer.h"
+#include "oreshnek/server/ResponseCache.h"
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+void append_header(std::string& key, const Http::HttpRequest& req, std::string_view name) {
+    key.push_back('\n');
+    if (auto v = req.header(name)) key.append(*v);
+}
+} // namespace
+
+std::string RequestCoalescer::key(const Http::HttpRequest& req, const RouteOptions& options) {
+    if (!options.coalesce || !ResponseCache::servable(req)) return {};
+    if (req.header("Cookie") || req.header("Range")) return {};
+    std::string key = ResponseCache::primary_key(req);
+    append_header(key, req, "Accept");
+    append_header(key, req, "Accept-Encoding");
+    for (const std::string& name : options.coalesce_vary) append_header(key, req, name);
+    return key;
+}
+
+bool RequestCoalescer::join(const std::string& key, Waiter waiter) {
+    auto it = index_.find(key);
+    if (it == index_.end()) return false;
+    flights_[it->second].waiters.push_back(std::move(waiter));
+    ++waiting_;
+    return true;
+}
+
+std::uint64_t RequestCoalescer::lead(std::string key, Clock::time_point deadline) {
+    const std::uint64_t id = next_id_++;
+    index_[key] = id;
+    flights_.emplace(id, Flight{std::move(key), deadline, {}});
+    return id;
+}
+
+std::vector<RequestCoalescer::Waiter> RequestCoalescer::complete(std::uint64_t id) {
+    auto it = flights_.find(id);
+    if (it == flights_.end()) return {};
+    std::vector<Waiter> waiters = std::move(it->second.waiters);
+    index_.erase(it->second.key);
+    flights_.erase(it);
+    waiting_ -= waiters.size();
+    return waiters;
+}
+
+std::vector<RequestCoalescer::Waiter> RequestCoalescer::expire(Clock::time_point now) {
+    std::vector<Waiter> expired;
+    for (auto it = flights_.begin(); it != flights_.end();) {
+        if (it->second.deadline >= now) {
+            ++it;
+            continue;
+        }
+        for (Waiter& waiter : it->second.waiters) expired.push_back(std::move(waiter));
+        index_.erase(it->second.key);
+        it = flights_.erase(it);
+    }
+    waiting_ -= expired.size();
+    return expired;
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -0,0 +1,317 @@
+// oreshnek/src/server/ResponseCache.cpp
+#include "oreshnek/server/ResponseCache.h"
+#include "oreshnek/server/Metrics.h"
+#include "oreshnek/utils/StringUtil.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>   // For strtol
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+constexpr std::size_t kNodeOverhead = 256; // Bookkeeping per URL, counted against the budget
+
+void bump(Metrics* metrics, std::atomic<uint64_t> Metrics::*counter) {
+    if (metrics != nullptr) (metrics->*counter).fetch_add(1, std::memory_order_relaxed);
+}
+
+using Utils::iequals;
+using Utils::trim;
+
+// Call `fn(name, value)` for each comma-separated "name[=value]" item.
+template <typename Fn>
+void for_each_directive(std::string_view list, Fn&& fn) {
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        const std::string_view item = trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        if (item.empty()) continue;
+        const std::size_t eq = item.find('=');
+        std::string_view value = eq == std::string_view::npos ? std::string_view() : trim(item.substr(eq + 1));
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') value = value.substr(1, value.size() - 2);
+        fn(trim(item.substr(0, eq)), value);
+    }
+}
+
+long seconds(std::string_view value) {
+    if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0]))) return -1;
+    return std::strtol(std::string(value).c_str(), nullptr, 10);
+}
+
+// What the handler's Cache-Control allows a shared cache to do.
+struct Policy {
+    long max_age = -1;
+    long stale_while_revalidate = 0;
+    bool is_public = false;
+    bool forbidden = false; // no-store / no-cache / private
+};
+
+Policy parse_cache_control(std::string_view header) {
+    Policy p;
+    long s_maxage = -1;
+    for_each_directive(header, [&](std::string_view name, std::string_view value) {
+        if (iequals(name, "max-age")) p.max_age = seconds(value);
+        else if (iequals(name, "s-maxage")) s_maxage = seconds(value);
+        else if (iequals(name, "stale-while-revalidate")) p.stale_while_revalidate = std::max(0L, seconds(value));
+        else if (iequals(name, "public")) p.is_public = true;
+        else if (iequals(name, "no-store") || iequals(name, "no-cache") || iequals(name, "private")) {
+            p.forbidden = true;
+        }
+    });
+    if (s_maxage >= 0) p.max_age = s_maxage; // The shared-cache lifetime wins
+    return p;
+}
+
+bool cacheable_status(Http::HttpStatus status) {
+    switch (static_cast<int>(status)) {
+    case 200: case 203: case 204: case 300: case 301: case 404: case 410:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::string vary_values(const Http::HttpRequest& req, const std::vector<std::string>& vary) {
+    std::string values;
+    for (const std::string& name : vary) {
+        if (auto v = req.header(name)) values.append(*v);
+        values.push_back('\n');
+    }
+    return values;
+}
+} // namespace
+
+ResponseCache::ResponseCache(ResponseCacheOptions options, Metrics* metrics)
+    : options_(options), metrics_(metrics) {
+    const std::size_t shards = std::max<std::size_t>(1, options_.shards);
+    shard_budget_ = options_.max_bytes / shards;
+    shards_.reserve(shards);
+    for (std::size_t i = 0; i < shards; ++i) shards_.push_back(std::make_unique<Shard>());
+}
+
+ResponseCache::~ResponseCache() {
+    clear(); // Take this cache's bytes back out of the shared gauge
+}
+
+ResponseCache::Shard& ResponseCache::shard_for(std::string_view key) {
+    return *shards_[std::hash<std::string_view>{}(key) % shards_.size()];
+}
+
+bool ResponseCache::servable(const Http::HttpRequest& req) {
+    const Http::HttpMethod method = req.method();
+    if (method != Http::HttpMethod::GET && method != Http::HttpMethod::HEAD) return false;
+    if (req.header("Authorization") || req.header("If-None-Match") ||
+        req.header("If-Modified-Since")) {
+        return false;
+    }
+    bool no_cache = false;
+    if (auto cc = req.header("Cache-Control")) {
+        for_each_directive(*cc, [&](std::string_view name, std::string_view) {
+            no_cache = no_cache || iequals(name, "no-cache") || iequals(name, "no-store");
+        });
+    }
+    if (auto pragma = req.header("Pragma")) no_cache = no_cache || iequals(trim(*pragma), "no-cache");
+    return !no_cache;
+}
+
+bool ResponseCache::shareable(const Http::HttpResponse& res) {
+    if (res.get_header("Set-Cookie") || res.get_header("Connection")) return false;
+    const auto cc = res.get_header("Cache-Control");
+    return !cc || !parse_cache_control(*cc).forbidden;
+}
+
+// "GET /path?a=1&b=2": the query is re-serialized with its parameters sorted, so
+// "?b=2&a=1" shares the entry.
+std::string ResponseCache::primary_key(const Http::HttpRequest& req) {
+    std::vector<std::pair<std::string_view, std::string_view>> params(req.query_params_.begin(),
+                                                                      req.query_params_.end());
+    std::sort(params.begin(), params.end());
+    std::string key = "GET ";
+    key.append(req.path());
+    char sep = '?';
+    for (const auto& [name, value] : params) {
+        key.push_back(sep);
+        key.append(name).push_back('=');
+        key.append(value);
+        sep = '&';
+    }
+    return key;
+}
+
+ResponseCache::Hit ResponseCache::find(const Http::HttpRequest& req) {
+    Hit hit;
+    const std::string key = primary_key(req);
+    Shard& shard = shard_for(key);
+    const Clock::time_point now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const std::int64_t before = static_cast<std::int64_t>(shard.bytes);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            Node& node = *it->second;
+            const std::string values = vary_values(req, node.vary);
+            for (auto v = node.variants.begin(); v != node.variants.end(); ++v) {
+                if (v->vary_values != values) continue;
+                if (now >= v->stale_until) { // Expired for good
+                    node.bytes -= v->bytes;
+                    shard.bytes -= v->bytes;
+                    node.variants.erase(v);
+                    if (node.variants.empty()) erase(shard, it->second);
+                    break;
+                }
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                hit.response = v->response;
+                if (now < v->fresh_until) {
+                    hit.freshness = Freshness::Fresh;
+                } else {
+                    hit.freshness = Freshness::Stale;
+                    hit.revalidate = !v->revalidating;
+                    v->revalidating = true;
+                }
+                break;
+            }
+        }
+        publish(static_cast<std::int64_t>(shard.bytes) - before);
+    }
+    switch (hit.freshness) {
+    case Freshness::Fresh: bump(metrics_, &Metrics::response_cache_hits); break;
+    case Freshness::Stale: bump(metrics_, &Metrics::response_cache_stale_hits); break;
+    case Freshness::Miss: bump(metrics_, &Metrics::response_cache_misses); break;
+    }
+    if (hit.revalidate) bump(metrics_, &Metrics::response_cache_revalidations);
+    return hit;
+}
+
+bool ResponseCache::store(const Http::HttpRequest& req, const Http::HttpResponse& res) {
+    if (req.method() != Http::HttpMethod::GET || res.is_file() || !cacheable_status(res.get_status())) {
+        return false;
+    }
+    const auto cc = res.get_header("Cache-Control");
+    if (!cc || !shareable(res)) return false;
+    const Policy policy = parse_cache_control(*cc);
+    if (policy.max_age <= 0) return false;
+    if (req.header("Authorization") && !policy.is_public) return false;
+
+    std::vector<std::string> vary;
+    bool vary_any = false;
+    if (auto v = res.get_header("Vary")) {
+        for_each_directive(*v, [&](std::string_view name, std::string_view) {
+            if (name == "*") vary_any = true;
+            std::string lower(name);
+            for (char& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            if (std::find(vary.begin(), vary.end(), lower) == vary.end()) vary.push_back(std::move(lower));
+        });
+    }
+    if (vary_any) return false;
+    if (res.get_body_string().size() > options_.max_entry) return false;
+
+    auto response = std::make_shared<const Http::CannedResponse>(res);
+    const std::size_t bytes = response->size(false);
+    if (bytes + kNodeOverhead > shard_budget_) return false;
+
+    const Clock::time_point now = Clock::now();
+    Variant variant;
+    variant.vary_values = vary_values(req, vary);
+    variant.response = std::move(response);
+    variant.fresh_until = now + std::chrono::seconds(policy.max_age);
+    variant.stale_until = variant.fresh_until + std::chrono::seconds(policy.stale_while_revalidate);
+    variant.bytes = bytes + variant.vary_values.size();
+
+    const std::string key = primary_key(req);
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const std::int64_t before = static_cast<std::int64_t>(shard.bytes);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        shard.lru.push_front(Node{key, vary, {}, kNodeOverhead});
+        it = shard.index.emplace(shard.lru.front().key, shard.lru.begin()).first;
+        shard.bytes += kNodeOverhead;
+    } else {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    }
+    Node& node = *it->second;
+    if (node.vary != vary) { // The handler changed its Vary: old variants are keyed differently
+        shard.bytes -= node.bytes - kNodeOverhead;
+        node.bytes = kNodeOverhead;
+        node.variants.clear();
+        node.vary = std::move(vary);
+    }
+    auto existing = std::find_if(node.variants.begin(), node.variants.end(),
+                                 [&](const Variant& v) { return v.vary_values == variant.vary_values; });
+    if (existing != node.variants.end()) {
+        node.bytes -= existing->bytes;
+        shard.bytes -= existing->bytes;
+        node.variants.erase(existing);
+    } else if (node.variants.size() >= std::max<std::size_t>(1, options_.max_variants)) {
+        node.bytes -= node.variants.front().bytes; // Oldest variant makes room
+        shard.bytes -= node.variants.front().bytes;
+        node.variants.erase(node.variants.begin());
+    }
+    node.bytes += variant.bytes;
+    shard.bytes += variant.bytes;
+    node.variants.push_back(std::move(variant));
+
+    while (shard.bytes > shard_budget_ && shard.lru.size() > 1) {
+        erase(shard, std::prev(shard.lru.end()));
+        bump(metrics_, &Metrics::response_cache_evictions);
+    }
+    publish(static_cast<std::int64_t>(shard.bytes) - before);
+    bump(metrics_, &Metrics::response_cache_stores);
+    return true;
+}
+
+void ResponseCache::abandon_revalidation(const Http::HttpRequest& req) {
+    const std::string key = primary_key(req);
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return;
+    const std::string values = vary_values(req, it->second->vary);
+    for (Variant& v : it->second->variants) {
+        if (v.vary_values == values) v.revalidating = false;
+    }
+}
+
+void ResponseCache::erase(Shard& shard, std::list<Node>::iterator it) {
+    shard.bytes -= it->bytes;
+    shard.index.erase(shard.index.find(std::string_view(it->key)));
+    shard.lru.erase(it);
+}
+
+void ResponseCache::publish(std::int64_t delta) {
+    if (metrics_ != nullptr && delta != 0) {
+        metrics_->response_cache_bytes.fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+void ResponseCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        publish(-static_cast<std::int64_t>(shard->bytes));
+        shard->index.clear();
+        shard->lru.clear();
+        shard->bytes = 0;
+    }
+}
+
+std::size_t ResponseCache::size() const {
+    std::size_t n = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        n += shard->lru.size();
+    }
+    return n;
+}
+
+std::size_t ResponseCache::memory_bytes() const {
+    std::size_t n = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        n += shard->bytes;
+    }
+    return n;
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -1,161 +1,283 @@
 // oreshnek/src/server/Router.cpp
 #include "oreshnek/server/Router.h"
-#include <sstream> // For splitting paths
-#include <iostream> // For debugging
+#include "oreshnek/utils/Logger.h"
+#include <algorithm>
+#include <cstring>   // For memcmp
+#include <limits>
+#include <stdexcept>
 
 namespace Oreshnek {
 namespace Server {
 
-Router::Router() : root_(std::make_unique<RouterNode>()) {}
+struct Router::BuildNode {
+    std::string prefix; // Edge label from the parent
+    std::vector<std::unique_ptr<BuildNode>> children; // Distinct first bytes
+    std::unique_ptr<BuildNode> param;
+    std::string param_name;
+    std::unique_ptr<BuildNode> catch_all;
+    std::string catch_all_name;
+    std::array<std::int32_t, kMethods> handlers;
 
-void Router::add_route(Http::HttpMethod method, std::string_view path, RouteHandler handler) {
-    if (path.empty() || path[0] != '/') {
-        throw std::runtime_error("Invalid route path: Must start with '/'");
-    }
+    BuildNode() { handlers.fill(-1); }
+};
 
-    // Handle root path separately to avoid issues with empty segments
-    if (path == "/") {
-        // root_ es inicializado en el constructor, esta verificación es principalmente para robustez.
-        if (!root_) {
-            root_ = std::make_unique<RouterNode>();
+Router::Router() : build_root_(std::make_unique<BuildNode>()) {}
+Router::~Router() = default;
+
+Router::BuildNode* Router::insert_static(BuildNode* node, std::string_view text) {
+    while (!text.empty()) {
+        BuildNode* next = nullptr;
+        for (auto& child : node->children) {
+            if (child->prefix[0] == text[0]) { next = child.get(); break; }
+        }
+        if (next == nullptr) {
+            node->children.push_back(std::make_unique<BuildNode>());
+            node->children.back()->prefix = std::string(text);
+            return node->children.back().get();
         }
-        root_->handlers[method] = std::move(handler);
-        return;
+        // Longest common prefix of the edge and the remaining text.
+        std::size_t common = 0;
+        const std::size_t limit = std::min(next->prefix.size(), text.size());
+        while (common < limit && next->prefix[common] == text[common]) ++common;
+        if (common < next->prefix.size()) {
+            // Split the edge: parent -> mid(common) -> next(rest).
+            auto mid = std::make_unique<BuildNode>();
+            mid->prefix = next->prefix.substr(0, common);
+            for (auto& child : node->children) {
+                if (child.get() == next) {
+                    std::unique_ptr<BuildNode> old = std::move(child);
+                    old->prefix.erase(0, common);
+                    mid->children.push_back(std::move(old));
+                    child = std::move(mid);
+                    next = child.get();
+                    break;
+                }
+            }
+        }
+        node = next;
+        text.remove_prefix(common);
     }
-
-    // `path` aquí es un std::string_view que apunta a la std::string pasada desde Server::get.
-    // Los segmentos resultantes de split_path_to_segments apuntarán a los datos subyacentes de `path`, lo cual es correcto.
-    std::vector<std::string_view> segments = split_path_to_segments(path.substr(1)); // Remove leading '/'
-    add_route_recursive(root_.get(), method, segments.begin(), segments.end(), std::move(handler));
+    return node;
 }
 
-void Router::add_route_recursive(RouterNode* current_node, Http::HttpMethod method,
-                                 std::vector<std::string_view>::const_iterator path_segment_it,
-                                 std::vector<std::string_view>::const_iterator path_segment_end,
-                                 RouteHandler handler) {
-    if (!current_node) {
-        // Este error crítico indica que add_route_recursive fue llamada con un puntero nulo,
-        // lo cual no debería ocurrir si la lógica de construcción de nodos es correcta.
-        std::cerr << "CRITICAL ERROR: add_route_recursive called with null current_node." << std::endl;
-        return;
+void Router::add_route(Http::HttpMethod method, std::string_view path, RouteHandler handler,
+                       RouteOptions options) {
+    if (frozen_) {
+        throw std::logic_error("Router: cannot add routes after freeze()");
     }
-
-
-    if (path_segment_it == path_segment_end) {
-        // Al final de la ruta, registra el manejador aquí.
-        current_node->handlers[method] = std::move(handler);
-        return;
+    if (path.empty() || path[0] != '/') {
+        throw std::runtime_error("Invalid route path: Must start with '/'");
+    }
+    if (method == Http::HttpMethod::UNKNOWN) {
+        throw std::runtime_error("Invalid route method");
     }
 
-    std::string_view segment_view = *path_segment_it; // Vista temporal para el segmento actual
-
-    if (segment_view.length() > 0 && segment_view[0] == ':') {
-        // Esto es un parámetro de ruta
-        if (!current_node->param_child) {
-            current_node->param_child = std::make_unique<RouterNode>();
-            // CAMBIO: Almacena el nombre del parámetro como std::string para poseer los datos.
-            current_node->param_name = std::string(segment_view.substr(1)); 
-        } else if (current_node->param_name != segment_view.substr(1)) { // La comparación con string_view está bien.
-             std::cerr << "Warning: Route segment '" << segment_view << "' has conflicting parameter name '"
-                       << current_node->param_name << "' vs '" << segment_view.substr(1) << "'" << std::endl;
+    // Walk the path one segment at a time: static text (with its separators) is
+    // accumulated and inserted as one radix edge; ":name" segments become param
+    // nodes and a final "*name" a catch-all node. Empty segments ("//",
+    // trailing '/') are dropped.
+    BuildNode* node = build_root_.get();
+    std::string pending = "/";
+    std::size_t params = 0;
+    std::size_t pos = 1;
+    bool first = true;
+    while (pos <= path.size()) {
+        std::size_t end = path.find('/', pos);
+        if (end == std::string_view::npos) end = path.size();
+        const std::string_view segment = path.substr(pos, end - pos);
+        pos = end + 1;
+        if (segment.empty()) continue;
+        if (!first) pending += '/';
+        first = false;
+        if (segment[0] == '*') {
+            const std::string_view name = segment.substr(1);
+            if (name.empty()) throw std::runtime_error("Invalid route path: empty catch-all name");
+            if (path.find_first_not_of('/', end) != std::string_view::npos) {
+                throw std::runtime_error("Invalid route path: catch-all must be the last segment");
+            }
+            if (++params > Http::PathParams::kMaxParams) {
+                throw std::runtime_error("Invalid route path: too many parameters");
+            }
+            node = insert_static(node, pending);
+            pending.clear();
+            if (!node->catch_all) {
+                node->catch_all = std::make_unique<BuildNode>();
+                node->catch_all_name = std::string(name);
+            } else if (node->catch_all_name != name) {
+                ORE_LOG(WARN) << "Route '" << path << "' names catch-all '" << name
+                              << "' but an earlier route uses '" << node->catch_all_name
+                              << "' at the same position; keeping '" << node->catch_all_name << "'";
+            }
+            node = node->catch_all.get();
+            break;
         }
-        add_route_recursive(current_node->param_child.get(), method, ++path_segment_it, path_segment_end, std::move(handler));
-    } else {
-        // Segmento de ruta regular
-        // CAMBIO: Convierte a std::string para la clave del mapa, asegurando la propiedad de los datos.
-        std::string segment_key(segment_view); 
-        
-        if (!current_node->children.count(segment_key)) {
-            current_node->children[segment_key] = std::make_unique<RouterNode>();
+        if (segment[0] == ':') {
+            const std::string_view name = segment.substr(1);
+            if (name.empty()) throw std::runtime_error("Invalid route path: empty parameter name");
+            if (++params > Http::PathParams::kMaxParams) {
+                throw std::runtime_error("Invalid route path: too many parameters");
+            }
+            node = insert_static(node, pending);
+            pending.clear();
+            if (!node->param) {
+                node->param = std::make_unique<BuildNode>();
+                node->param_name = std::string(name);
+            } else if (node->param_name != name) {
+                ORE_LOG(WARN) << "Route '" << path << "' names parameter '" << name
+                              << "' but an earlier route uses '" << node->param_name
+                              << "' at the same position; keeping '" << node->param_name << "'";
+            }
+            node = node->param.get();
+        } else {
+            pending += segment;
         }
-        add_route_recursive(current_node->children[segment_key].get(), method, ++path_segment_it, path_segment_end, std::move(handler));
     }
-}
+    node = insert_static(node, pending);
 
-bool Router::find_route(Http::HttpMethod method, std::string_view path,
-                        std::unordered_map<std::string_view, std::string_view>& path_params_out,
-                        RouteHandler& matched_handler_out) const {
-    if (path.empty() || path[0] != '/') {
-        return false; // Invalid path
+    any_coalesced_ = any_coalesced_ || options.coalesce;
+    any_pooled_ = any_pooled_ || !options.pool.empty();
+    any_inline_ = any_inline_ || options.inline_;
+    std::int32_t& slot = node->handlers[static_cast<std::size_t>(method)];
+    if (slot >= 0) {
+        handlers_[static_cast<std::size_t>(slot)] = std::move(handler); // Re-registration replaces
+        options_[static_cast<std::size_t>(slot)] = std::move(options);
+    } else {
+        slot = static_cast<std::int32_t>(handlers_.size());
+        handlers_.push_back(std::move(handler));
+        options_.push_back(std::move(options));
     }
+}
 
-    // Handle root path directly
-    if (path == "/") {
-        if (!root_) return false;
-        auto it = root_->handlers.find(method);
-        if (it != root_->handlers.end()) {
-            matched_handler_out = it->second;
-            return true;
+std::uint32_t Router::append_bytes(std::string_view text) {
+    const std::uint32_t offset = static_cast<std::uint32_t>(bytes_.size());
+    bytes_.append(text);
+    return offset;
+}
+
+void Router::flatten(const BuildNode& build, std::uint32_t index) {
+    {
+        Node& node = nodes_[index];
+        node.label = append_bytes(build.prefix);
+        node.label_len = static_cast<std::uint32_t>(build.prefix.size());
+        node.handlers = build.handlers;
+        node.child_count = static_cast<std::uint32_t>(build.children.size());
+        node.child_keys = static_cast<std::uint32_t>(bytes_.size());
+        for (const auto& child : build.children) bytes_.push_back(child->prefix[0]);
+        if (build.param) {
+            node.param_name = append_bytes(build.param_name);
+            node.param_name_len = static_cast<std::uint32_t>(build.param_name.size());
+        }
+        if (build.catch_all) {
+            node.catch_all_name = append_bytes(build.catch_all_name);
+            node.catch_all_name_len = static_cast<std::uint32_t>(build.catch_all_name.size());
         }
-        return false;
     }
-
-    std::vector<std::string_view> segments = split_path_to_segments(path.substr(1)); // Remove leading '/'
-    return match_route_recursive(root_.get(), segments.begin(), segments.end(), method, path_params_out, matched_handler_out);
+    // Reserve the children as one consecutive block, then fill them in (nodes_
+    // may reallocate, so the parent is re-indexed rather than referenced).
+    if (!build.children.empty()) {
+        const std::uint32_t first = static_cast<std::uint32_t>(nodes_.size());
+        nodes_[index].first_child = first;
+        nodes_.resize(nodes_.size() + build.children.size());
+        for (std::size_t i = 0; i < build.children.size(); ++i) {
+            flatten(*build.children[i], first + static_cast<std::uint32_t>(i));
+        }
+    }
+    if (build.param) {
+        const std::uint32_t param = static_cast<std::uint32_t>(nodes_.size());
+        nodes_[index].param_child = param;
+        nodes_.emplace_back();
+        flatten(*build.param, param);
+    }
+    if (build.catch_all) {
+        const std::uint32_t catch_all = static_cast<std::uint32_t>(nodes_.size());
+        nodes_[index].catch_all_child = catch_all;
+        nodes_.emplace_back();
+        flatten(*build.catch_all, catch_all);
+    }
 }
 
-bool Router::match_route_recursive(const RouterNode* current_node,
-                                   std::vector<std::string_view>::const_iterator path_segment_it,
-                                   std::vector<std::string_view>::const_iterator path_segment_end,
-                                   Http::HttpMethod method,
-                                   std::unordered_map<std::string_view, std::string_view>& path_params_out,
-                                   RouteHandler& matched_handler_out) const {
-    if (!current_node) {
-        return false;
-    }
-
-    if (path_segment_it == path_segment_end) {
-        auto it = current_node->handlers.find(method);
-        if (it != current_node->handlers.end()) {
-            matched_handler_out = it->second;
-            return true;
-        }
-        return false;
+void Router::freeze() {
+    if (frozen_) return;
+    nodes_.clear();
+    bytes_.clear();
+    nodes_.emplace_back();
+    flatten(*build_root_, 0);
+    nodes_.shrink_to_fit();
+    bytes_.shrink_to_fit();
+    if (bytes_.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Router: route table too large");
     }
+    build_root_.reset();
+    frozen_ = true;
+}
 
-    std::string_view segment_view = *path_segment_it; // Segmento actual de la ruta de la solicitud entrante
+const RouteHandler* Router::match_node(std::uint32_t index, std::string_view rest, std::size_t method,
+                                       Http::PathParams& params) const {
+    const Node& node = nodes_[index];
+    if (rest.size() < node.label_len ||
+        std::memcmp(rest.data(), bytes_.data() + node.label, node.label_len) != 0) {
+        return nullptr;
+    }
+    rest.remove_prefix(node.label_len);
+    if (rest.empty()) {
+        const std::int32_t h = node.handlers[method];
+        if (h >= 0) return &handlers_[static_cast<std::size_t>(h)];
+        return match_catch_all(node, rest, method, params);
+    }
 
-    // Intenta hacer coincidir un segmento estático
-    // CAMBIO: Necesita convertir std::string_view a std::string para buscar en el mapa con claves std::string.
-    std::string segment_match_key(segment_view);
-    auto static_child_it = current_node->children.find(segment_match_key);
-    if (static_child_it != current_node->children.end()) {
-        if (match_route_recursive(static_child_it->second.get(), ++path_segment_it, path_segment_end, method, path_params_out, matched_handler_out)) {
-            return true;
-        }
+    // Static edge first (at most one child can start with this byte). Fan-out
+    // is small in practice, so a plain scan beats a memchr call.
+    const char* keys = bytes_.data() + node.child_keys;
+    for (std::uint32_t i = 0; i < node.child_count; ++i) {
+        if (keys[i] != rest[0]) continue;
+        if (const RouteHandler* h = match_node(node.first_child + i, rest, method, params)) return h;
+        break;
     }
 
-    // Si la coincidencia estática falla, intenta coincidir con un segmento de parámetro
-    if (current_node->param_child) {
-        // param_name es ahora std::string, así que úsalo como clave.
-        // El valor sigue siendo string_view de la ruta de la solicitud, lo cual es correcto para path_params_out.
-        path_params_out[current_node->param_name] = segment_view; 
-        if (match_route_recursive(current_node->param_child.get(), ++path_segment_it, path_segment_end, method, path_params_out, matched_handler_out)) {
-            return true;
+    // Then the parameter, which captures up to the next '/'.
+    if (node.param_child != kNone) {
+        const std::string_view value = rest.substr(0, rest.find('/'));
+        if (!value.empty() &&
+            params.push(std::string_view(bytes_.data() + node.param_name, node.param_name_len), value)) {
+            rest.remove_prefix(value.size());
+            if (const RouteHandler* h = match_node(node.param_child, rest, method, params)) return h;
+            params.pop();
         }
-        // Si la ruta del parámetro no coincide, elimínalo de params_out para el backtracking.
-        path_params_out.erase(current_node->param_name);
     }
+    return match_catch_all(node, rest, method, params);
+}
 
-    return false;
+const RouteHandler* Router::match_catch_all(const Node& node, std::string_view rest, std::size_t method,
+                                            Http::PathParams& params) const {
+    if (node.catch_all_child == kNone) return nullptr;
+    const std::int32_t h = nodes_[node.catch_all_child].handlers[method];
+    if (h < 0 ||
+        !params.push(std::string_view(bytes_.data() + node.catch_all_name, node.catch_all_name_len), rest)) {
+        return nullptr;
+    }
+    return &handlers_[static_cast<std::size_t>(h)];
 }
 
-std::vector<std::string_view> Router::split_path_to_segments(std::string_view path) const {
-    std::vector<std::string_view> segments;
-    size_t start = 0;
-    size_t end = path.find('/');
+const RouteHandler* Router::match_path(std::size_t method, std::string_view path,
+                                       Http::PathParams& params) const {
+    params.clear();
+    return match_node(0, path, method, params);
+}
 
-    while (end != std::string_view::npos) {
-        if (end > start) {
-            segments.push_back(path.substr(start, end - start));
-        }
-        start = end + 1;
-        end = path.find('/', start);
+const RouteHandler* Router::match(Http::HttpMethod method, std::string_view path,
+                                  Http::PathParams& params) const {
+    if (!frozen_) {
+        throw std::logic_error("Router: match() before freeze()");
     }
-    if (start < path.length()) { // Add the last segment if any
-        segments.push_back(path.substr(start));
+    if (path.empty() || path[0] != '/' || method == Http::HttpMethod::UNKNOWN) return nullptr;
+    const std::size_t m = static_cast<std::size_t>(method);
+    if (const RouteHandler* h = match_path(m, path, params)) return h;
+    // Routes are registered without a trailing slash; tolerate one on requests.
+    if (path.size() > 1 && path.back() == '/') {
+        return match_path(m, path.substr(0, path.size() - 1), params);
     }
-    return segments;
+    params.clear();
+    return nullptr;
 }
 
 } // namespace Server
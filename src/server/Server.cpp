@@ -2,11 +2,16 @@
 #include "oreshnek/server/Server.h"
 #include "oreshnek/net/TlsContext.h"
 #include "oreshnek/http/Compression.h"
+#include "oreshnek/server/StaticFiles.h"
+#include "oreshnek/utils/Hash.h"
 #include "oreshnek/utils/Logger.h"
+#include "oreshnek/utils/StringUtil.h"
+#include "oreshnek/utils/TimeUtil.h"
 #include <iostream>
 #include <fcntl.h>    // For fcntl
 #include <unistd.h>   // For close, pipe, read, write
-#include <sys/socket.h> // For socket, bind, listen, accept
+#include <sys/socket.h> // For socket, bind, listen, accept, sendmsg
+#include <sys/uio.h>    // For iovec (canned timeout responses)
 #include <netinet/in.h> // For sockaddr_in
 #include <arpa/inet.h>  // For inet_ntoa
 #include <errno.h>    // For errno
@@ -15,9 +20,12 @@
 #include <cstdlib>    // For atof (Accept-Encoding q-values)
 #include <cctype>     // For tolower / isalnum
 #include <ctime>      // For gmtime_r / strptime / timegm
-#include <variant>    // For std::holds_alternative / std::get (response body)
 #include <vector>     // For cleanup_expired_connections
 #include <utility>    // For std::swap
+#include <algorithm>  // For std::sort (Range)
+#include <charconv>   // For std::from_chars (Range)
+#include <optional>   // For negotiate_encoding
+#include <stdexcept>  // For std::logic_error (defer)
 
 // Platform specific includes
 #ifdef __linux__
@@ -26,7 +34,6 @@
 #elif __APPLE__
 #include <sys/event.h>
 #endif
-#include <sys/stat.h> // For stat (to get file size and check existence)
 #include <string>
 
 // Avoid SIGPIPE when writing a timeout response to a half-closed peer. No-op on
@@ -39,18 +46,49 @@ namespace Oreshnek {
 namespace Server {
 
 namespace {
-// Format a time_t as an RFC 1123 HTTP date (locale-independent).
-std::string http_date(time_t t) {
-    static const char* kDays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
-    static const char* kMonths[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
-                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
-    struct tm tm{};
-    gmtime_r(&t, &tm);
-    char buf[40];
-    std::snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT",
-                  kDays[tm.tm_wday], tm.tm_mday, kMonths[tm.tm_mon], tm.tm_year + 1900,
-                  tm.tm_hour, tm.tm_min, tm.tm_sec);
-    return buf;
+// The request a worker (or an inline run) is handling, for Server::defer().
+struct HandlerContext {
+    int fd;
+    const std::shared_ptr<Net::Connection>* conn;
+    const std::shared_ptr<Http::HttpRequest>* request; // Null inline: conn's current_request_
+    const Http::HttpResponse* response;
+    std::chrono::steady_clock::time_point start;
+    std::uint64_t flight;
+    bool deferred;
+    std::size_t consumed;      // Inline: the request's bytes in conn's read buffer
+    const RouteHandler* route; // Matched by the event loop (null: none)
+    Bulkhead* bulkhead;        // The pool running the handler (null: default, or inline)
+    bool revalidation;         // A response-cache refresh (no connection)
+};
+thread_local HandlerContext* t_handler = nullptr;
+
+// A coroutine nobody awaits: starts at once and frees its own frame at the end.
+struct DetachedCoroutine {
+    struct promise_type {
+        DetachedCoroutine get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+// Run a coroutine handler to the end, then answer its deferred request. The
+// frame owns what the handler references across suspensions: the request (in
+// the handle), the response (the worker's, with what the middlewares set) and
+// the handler object itself.
+DetachedCoroutine run_coroutine(std::shared_ptr<const CoroutineHandler> handler, DeferredResponse deferred,
+                                Http::HttpResponse response) {
+    std::exception_ptr error;
+    try {
+        co_await (*handler)(deferred.request(), response);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    deferred.complete([&](Http::HttpResponse& out) {
+        out = std::move(response); // A 500 for `error` keeps the middleware headers
+        if (error) std::rethrow_exception(error);
+    });
 }
 
 // Parse an RFC 1123 HTTP date; (time_t)-1 on failure.
@@ -62,12 +100,120 @@ time_t parse_http_date(const std::string& s) {
     return static_cast<time_t>(-1);
 }
 
-// Strong validator from size + mtime: "<size>-<mtime>".
-std::string make_etag(const struct stat& st) {
-    char buf[64];
-    std::snprintf(buf, sizeof(buf), "\"%llx-%llx\"",
-                  static_cast<unsigned long long>(st.st_size),
-                  static_cast<unsigned long long>(st.st_mtime));
+// Token-aware Accept-Encoding check that honours an explicit "q=0" refusal.
+bool accepts_encoding(const std::string& ae_lower, const std::string& token) {
+    size_t p = 0;
+    while ((p = ae_lower.find(token, p)) != std::string::npos) {
+        const size_t end = p + token.size();
+        const bool lb = (p == 0) || !std::isalnum(static_cast<unsigned char>(ae_lower[p - 1]));
+        const bool rb = (end == ae_lower.size()) ||
+                        !std::isalnum(static_cast<unsigned char>(ae_lower[end]));
+        if (lb && rb) {
+            const size_t comma = ae_lower.find(',', end);
+            const size_t q = ae_lower.find("q=", end);
+            if (q != std::string::npos && (comma == std::string::npos || q < comma)) {
+                if (std::atof(ae_lower.c_str() + q + 2) == 0.0) { p = end; continue; }
+            }
+            return true;
+        }
+        p = end;
+    }
+    return false;
+}
+
+// An inclusive byte range [first, last].
+struct ByteRange {
+    off_t first;
+    off_t last;
+};
+
+// More ranges than this in one Range header and it is ignored (the full body
+// is sent): many small or overlapping ranges turn one request into a lot of
+// framing and seeks for the server.
+constexpr std::size_t kMaxRanges = 16;
+
+// The ranges of a "bytes=" Range header against a body of `size` bytes, in the
+// order requested, with overlapping and adjacent ones merged (a merged range
+// takes the place of its first member). Returns false when the
+// header is to be ignored (another unit, malformed, or over kMaxRanges);
+// true with `ranges` empty when none of them is satisfiable (416).
+bool parse_ranges(std::string_view spec, off_t size, std::vector<ByteRange>& ranges) {
+    constexpr std::string_view kPrefix = "bytes=";
+    if (spec.substr(0, kPrefix.size()) != kPrefix) return false;
+    spec.remove_prefix(kPrefix.size());
+    std::size_t count = 0;
+    while (!spec.empty()) {
+        const std::size_t comma = spec.find(',');
+        const std::string_view item = Utils::trim(spec.substr(0, comma));
+        spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+        if (item.empty()) continue;
+        if (++count > kMaxRanges) return false;
+
+        const std::size_t dash = item.find('-');
+        if (dash == std::string_view::npos) return false;
+        const std::string_view s_first = item.substr(0, dash);
+        const std::string_view s_last = item.substr(dash + 1);
+        off_t first = 0;
+        off_t last = 0;
+        auto number = [](std::string_view digits, off_t& out) {
+            const auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), out);
+            return ec == std::errc() && ptr == digits.data() + digits.size() && out >= 0;
+        };
+        if (s_first.empty()) {
+            off_t suffix = 0; // "-N": the final N bytes
+            if (s_last.empty() || !number(s_last, suffix)) return false;
+            if (suffix == 0 || size == 0) continue; // Unsatisfiable
+            first = suffix >= size ? 0 : size - suffix;
+            last = size - 1;
+        } else {
+            if (!number(s_first, first)) return false;
+            if (s_last.empty()) {
+                last = size - 1;
+            } else {
+                if (!number(s_last, last) || last < first) return false;
+                if (last >= size) last = size - 1;
+            }
+            if (first >= size) continue; // Unsatisfiable
+        }
+        ranges.push_back(ByteRange{first, last});
+    }
+    if (count == 0) return false;
+
+    // Merge in offset order, remembering each group's first position in the
+    // request; then put the groups back in request order.
+    std::size_t order[kMaxRanges];
+    for (std::size_t i = 0; i < ranges.size(); ++i) order[i] = i;
+    std::sort(order, order + ranges.size(),
+              [&ranges](std::size_t a, std::size_t b) { return ranges[a].first < ranges[b].first; });
+    struct Group {
+        ByteRange range;
+        std::size_t position;
+    };
+    Group groups[kMaxRanges];
+    std::size_t merged = 0;
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        const ByteRange& r = ranges[order[i]];
+        if (merged > 0 && r.first <= groups[merged - 1].range.last + 1) {
+            Group& g = groups[merged - 1];
+            g.range.last = std::max(g.range.last, r.last);
+            g.position = std::min(g.position, order[i]);
+        } else {
+            groups[merged++] = Group{r, order[i]};
+        }
+    }
+    std::sort(groups, groups + merged, [](const Group& a, const Group& b) { return a.position < b.position; });
+    ranges.resize(merged);
+    for (std::size_t i = 0; i < merged; ++i) ranges[i] = groups[i].range;
+    return true;
+}
+
+// A multipart boundary for one response: unlikely to occur in the file (a
+// hash of its validator and a per-thread counter).
+std::string multipart_boundary(std::string_view etag) {
+    thread_local std::uint64_t counter = 0;
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "oreshnek-%016llx",
+                  static_cast<unsigned long long>(Utils::hash64(etag, ++counter)));
     return buf;
 }
 
@@ -75,179 +221,231 @@ std::string make_etag(const struct stat& st) {
 //  * HEAD requests: suppress the body (headers only).
 //  * File responses: advertise Accept-Ranges, set cache validators (ETag /
 //    Last-Modified) and answer a matching conditional GET with 304; and, if the
-//    request carries a single byte Range, switch to 206 Partial Content (or 416).
-// Only a single range is supported; multi-range requests fall back to 200.
+//    request carries a byte Range, switch to 206 Partial Content (or 416): one
+//    range is sent as is, several as multipart/byteranges.
+//  * File entries with precompressed variants (in memory, or .br / .gz
+//    sidecar files): send the brotli or gzip body when the client accepts it
+//    (never for a Range request: ranges address the identity bytes), with its
+//    own ETag. Independent of enable_compression(): the variants already
+//    exist, so serving them costs nothing.
 void apply_http_semantics(const Http::HttpRequest& req, Http::HttpResponse& res) {
     if (req.method() == Http::HttpMethod::HEAD) {
         res.set_head_only(true);
     }
     if (!res.is_file()) return;
 
-    struct stat st;
-    if (::stat(res.file_path().c_str(), &st) != 0) return; // handler already validated existence
-    const off_t size = st.st_size;
+    // Size, mtime and the validator strings were computed when the file was
+    // opened (once per FileCache entry for cached files).
+    const std::shared_ptr<const Http::FileEntry>& file = res.file_entry();
+    if (!file) return;
+    if (file->has_variants()) {
+        res.vary("Accept-Encoding");
+        auto accept = req.header("Accept-Encoding");
+        if (accept && !req.header("Range") && !res.get_header("Content-Encoding")) {
+            std::string ae(*accept);
+            for (char& c : ae) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            Http::Encoding encoding = Http::Encoding::None;
+            if (file->has_encoding(Http::Encoding::Brotli) && accepts_encoding(ae, "br")) {
+                encoding = Http::Encoding::Brotli;
+            } else if (file->has_encoding(Http::Encoding::Gzip) && accepts_encoding(ae, "gzip")) {
+                encoding = Http::Encoding::Gzip;
+            }
+            if (encoding != Http::Encoding::None) {
+                res.set_file_encoding(encoding);
+                res.header("Content-Encoding", Http::content_coding(encoding));
+            }
+        }
+    }
+    const off_t size = static_cast<off_t>(res.file_size());
+    const time_t mtime = static_cast<time_t>(file->mtime);
+    const std::string& etag = file->etag_for(res.file_encoding());
     res.header("Accept-Ranges", "bytes");
 
     // Cache validators so browsers/proxies can revalidate cheaply instead of
     // re-downloading the body on every refresh.
-    const std::string etag = make_etag(st);
     res.header("ETag", etag);
-    res.header("Last-Modified", http_date(st.st_mtime));
+    res.header("Last-Modified", file->last_modified);
 
     // Conditional GET -> 304 Not Modified (no body). If-None-Match takes
     // precedence over If-Modified-Since (RFC 7232).
     const bool safe_method = req.method() == Http::HttpMethod::GET ||
                              req.method() == Http::HttpMethod::HEAD;
     bool not_modified = false;
-    if (auto inm = req.header("If-None-Match")) {
-        not_modified = (*inm == "*") || (inm->find(etag) != std::string_view::npos);
+    if (req.header("If-None-Match")) {
+        not_modified = req.if_none_match(etag);
     } else if (auto ims = req.header("If-Modified-Since")) {
         const time_t since = parse_http_date(std::string(*ims));
-        not_modified = (since != static_cast<time_t>(-1)) && (st.st_mtime <= since);
+        not_modified = (since != static_cast<time_t>(-1)) && (mtime <= since);
     }
     if (safe_method && not_modified) {
         res.status(Http::HttpStatus::NOT_MODIFIED);
-        res.header("Content-Length", "0");
         res.set_head_only(true);   // 304 carries no body
         res.set_file_range(0, 0);  // do not stream the file
         return;
     }
 
     auto range_hdr = req.header("Range");
-    if (!range_hdr) {
-        res.set_file_range(0, size);
-        return;
-    }
-
-    // Only "bytes=START-END" single ranges are supported.
-    std::string spec(*range_hdr);
-    const std::string prefix = "bytes=";
-    if (spec.rfind(prefix, 0) != 0 || spec.find(',') != std::string::npos) {
-        res.set_file_range(0, size);
-        return;
-    }
-    std::string r = spec.substr(prefix.size());
-    auto dash = r.find('-');
-    if (dash == std::string::npos) {
+    std::vector<ByteRange> ranges;
+    if (!range_hdr || !parse_ranges(*range_hdr, size, ranges)) {
         res.set_file_range(0, size);
         return;
     }
-
-    const std::string s_start = r.substr(0, dash);
-    const std::string s_end = r.substr(dash + 1);
-    off_t start = 0, end = size - 1;
-    bool ok = (size > 0);
-    try {
-        if (!s_start.empty()) {
-            start = std::stoll(s_start);
-            if (!s_end.empty()) end = std::stoll(s_end);
-        } else if (!s_end.empty()) {
-            off_t n = std::stoll(s_end); // suffix: final N bytes
-            if (n <= 0) ok = false;
-            else start = (n >= size) ? 0 : size - n;
-        } else {
-            ok = false; // "bytes=-"
-        }
-    } catch (const std::exception&) {
-        ok = false;
-    }
-    if (ok) {
-        if (end >= size) end = size - 1;
-        if (start < 0 || start > end) ok = false;
-    }
-
-    if (!ok) {
+    if (ranges.empty()) {
         res.status(Http::HttpStatus::RANGE_NOT_SATISFIABLE);
         res.header("Content-Range", "bytes */" + std::to_string(size));
-        res.header("Content-Length", "0");
         res.set_head_only(true);
         res.set_file_range(0, 0);
         return;
     }
 
-    const off_t length = end - start + 1;
     res.status(Http::HttpStatus::PARTIAL_CONTENT);
-    res.header("Content-Range",
-               "bytes " + std::to_string(start) + "-" + std::to_string(end) + "/" + std::to_string(size));
-    res.header("Content-Length", std::to_string(length));
-    res.set_file_range(start, length);
-}
-
-// Whether a (lowercased) content type is worth compressing.
-bool is_compressible_type(const std::string& ct_lower) {
-    if (ct_lower.rfind("text/", 0) == 0) return true;
-    static const char* kTypes[] = {
-        "application/json", "application/javascript", "application/xml",
-        "application/x-mpegurl", "application/vnd.apple.mpegurl",
-        "application/dash+xml", "application/manifest+json", "image/svg+xml",
-    };
-    for (const char* t : kTypes) {
-        if (ct_lower.rfind(t, 0) == 0) return true;
+    if (ranges.size() == 1) {
+        const ByteRange& range = ranges.front();
+        res.header("Content-Range", "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) +
+                                        "/" + std::to_string(size));
+        res.set_file_range(range.first, range.last - range.first + 1); // Content-Length follows the range
+        return;
     }
-    return false;
-}
 
-// Token-aware Accept-Encoding check that honours an explicit "q=0" refusal.
-bool accepts_encoding(const std::string& ae_lower, const std::string& token) {
-    size_t p = 0;
-    while ((p = ae_lower.find(token, p)) != std::string::npos) {
-        const size_t end = p + token.size();
-        const bool lb = (p == 0) || !std::isalnum(static_cast<unsigned char>(ae_lower[p - 1]));
-        const bool rb = (end == ae_lower.size()) ||
-                        !std::isalnum(static_cast<unsigned char>(ae_lower[end]));
-        if (lb && rb) {
-            const size_t comma = ae_lower.find(',', end);
-            const size_t q = ae_lower.find("q=", end);
-            if (q != std::string::npos && (comma == std::string::npos || q < comma)) {
-                if (std::atof(ae_lower.c_str() + q + 2) == 0.0) { p = end; continue; }
-            }
-            return true;
-        }
-        p = end;
+    // Several ranges: multipart/byteranges. Each part's framing is a small
+    // string; the bytes themselves stay in the file (sendfile, or the
+    // in-memory entry) and are interleaved by the connection.
+    const std::string boundary = multipart_boundary(etag);
+    const std::string part_type = "\r\nContent-Type: " +
+                                  std::string(res.get_header("Content-Type").value_or("application/octet-stream")) +
+                                  "\r\nContent-Range: bytes ";
+    const std::string total = "/" + std::to_string(size) + "\r\n\r\n";
+    std::vector<Http::FileSegment> segments;
+    segments.reserve(ranges.size() + 1);
+    for (const ByteRange& range : ranges) {
+        Http::FileSegment segment;
+        segment.text.reserve(boundary.size() + part_type.size() + total.size() + 48);
+        if (!segments.empty()) segment.text.append("\r\n");
+        segment.text.append("--").append(boundary).append(part_type);
+        segment.text.append(std::to_string(range.first)).append("-").append(std::to_string(range.last));
+        segment.text.append(total);
+        segment.offset = range.first;
+        segment.length = range.last - range.first + 1;
+        segments.push_back(std::move(segment));
     }
-    return false;
+    segments.push_back(Http::FileSegment{"\r\n--" + boundary + "--\r\n", 0, 0});
+    res.header("Content-Type", "multipart/byteranges; boundary=" + boundary);
+    res.set_file_segments(std::move(segments));
 }
 
-// Compress a string-body response in place when the client accepts it and the
-// content is compressible and worth it. Never touches file responses, so
-// sendfile and (crucially) video bytes are left untouched.
-void maybe_compress(const Http::HttpRequest& req, Http::HttpResponse& res,
-                    std::size_t min_bytes, bool allow_brotli) {
-    if (res.is_file() || res.head_only()) return;
-    if (!std::holds_alternative<std::string>(res.get_body_variant())) return;
-
-    const auto& headers = res.get_headers();
-    if (headers.find("Content-Encoding") != headers.end()) return; // already encoded
-
-    const std::string& body = std::get<std::string>(res.get_body_variant());
-    if (body.size() < min_bytes) return;
+// What maybe_compress() needs from the server (its compression settings).
+struct CompressionSetup {
+    std::size_t min_bytes;
+    bool allow_brotli;
+    bool allow_zstd;
+    CompressionCache* cache;                // Optional
+    CompressionController* controller;      // Optional; fixed default levels without it
+    Metrics& metrics;
+};
+
+// Whether maybe_compress() considers `res` at all: a compressible string body
+// of at least min_bytes, not yet encoded. Its representation then depends on
+// Accept-Encoding, whatever this client sent.
+bool compression_eligible(const Http::HttpResponse& res, const CompressionSetup& setup) {
+    if (res.is_file() || res.head_only()) return false;
+    if (res.get_header("Content-Encoding")) return false; // already encoded
+    if (res.get_body_string().size() < setup.min_bytes) return false;
+    return Http::is_compressible_type(res.get_header("Content-Type").value_or(""));
+}
 
-    auto ct_it = headers.find("Content-Type");
-    std::string ct = ct_it != headers.end() ? ct_it->second : "";
-    for (char& c : ct) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-    if (!is_compressible_type(ct)) return;
+// The encoding maybe_compress() would give `res`: it is eligible and the
+// client accepts one.
+std::optional<Http::Encoding> negotiate_encoding(const Http::HttpRequest& req, const Http::HttpResponse& res,
+                                                 const CompressionSetup& setup) {
+    if (!compression_eligible(res, setup)) return std::nullopt;
 
     auto accept = req.header("Accept-Encoding");
-    if (!accept) return;
+    if (!accept) return std::nullopt;
     std::string ae(*accept);
     for (char& c : ae) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
 
-    std::string encoded;
-    const char* coding = nullptr;
-    if (allow_brotli && accepts_encoding(ae, "br")) {
-        encoded = Http::brotli_compress(body);
-        coding = "br";
-    } else if (accepts_encoding(ae, "gzip")) {
-        encoded = Http::gzip_compress(body);
-        coding = "gzip";
+    if (setup.allow_zstd && accepts_encoding(ae, "zstd")) return Http::Encoding::Zstd;
+    if (setup.allow_brotli && accepts_encoding(ae, "br")) return Http::Encoding::Brotli;
+    if (accepts_encoding(ae, "gzip")) return Http::Encoding::Gzip;
+    return std::nullopt;
+}
+
+// enable_auto_etag(): a 200 string response to GET/HEAD gets a strong ETag, a
+// hash of the body as the handler produced it (before compression), unless the
+// handler set its own; a matching If-None-Match turns it into a 304. The 304
+// carries the Vary and validator the 200 would have (RFC 9110 §15.4.5): Vary
+// when the body is eligible for compression (`compression` set), and the weak
+// ETag when it would also have been compressed.
+void apply_string_etag(const Http::HttpRequest& req, Http::HttpResponse& res, const CompressionSetup* compression) {
+    const Http::HttpMethod method = req.method();
+    if (method != Http::HttpMethod::GET && method != Http::HttpMethod::HEAD) return;
+    if (res.is_file() || res.get_status() != Http::HttpStatus::OK) return;
+    std::string etag;
+    if (auto own = res.get_header("ETag")) {
+        etag = *own;
     } else {
-        return;
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "\"%016llx\"",
+                      static_cast<unsigned long long>(Utils::hash64(res.get_body_string())));
+        etag = buf;
+        res.header("ETag", etag);
     }
-    if (encoded.empty() || encoded.size() >= body.size()) return; // no gain / failed
+    if (!req.if_none_match(etag)) return;
+    if (compression != nullptr && compression_eligible(res, *compression)) {
+        res.vary("Accept-Encoding");
+        if (negotiate_encoding(req, res, *compression) && etag.rfind("W/", 0) != 0) etag.insert(0, "W/");
+    }
+    res.not_modified(etag);
+}
 
-    res.body(std::move(encoded));            // updates Content-Length
-    res.header("Content-Encoding", coding);
-    res.header("Vary", "Accept-Encoding");
+// Compress a string-body response in place when the client accepts it and the
+// content is compressible and worth it. Never touches file responses, so
+// sendfile and (crucially) video bytes are left untouched. Server preference is
+// zstd (fastest at a comparable ratio), then brotli, then gzip. Any eligible
+// response gets "Vary: Accept-Encoding", encoded or not: a cache must keep the
+// identity variant apart from the encoded ones.
+//
+// The output goes into a per-thread buffer that then trades places with the
+// response body: the uncompressed body's allocation becomes the next call's
+// output buffer, so in steady state compression allocates nothing (the codec
+// contexts are per-thread and reset, see Http::compress).
+void maybe_compress(const Http::HttpRequest& req, Http::HttpResponse& res, const CompressionSetup& setup) {
+    if (!compression_eligible(res, setup)) return;
+    res.vary("Accept-Encoding");
+    const std::optional<Http::Encoding> negotiated = negotiate_encoding(req, res, setup);
+    if (!negotiated) return;
+    const Http::Encoding encoding = *negotiated;
+    const std::string& body = res.get_body_string();
+
+    const int level = setup.controller != nullptr ? setup.controller->level(encoding, body.size())
+                                                  : Http::default_level(encoding);
+    if (level < 0) return; // Saturated: not worth the CPU for this body
+
+    thread_local std::string encoded;
+    if (setup.cache == nullptr || !setup.cache->find(encoding, level, body, encoded)) {
+        const auto t0 = std::chrono::steady_clock::now();
+        const bool ok = Http::compress(encoding, body, encoded, level);
+        const auto cost = std::chrono::steady_clock::now() - t0;
+        setup.metrics.compression_ns.fetch_add(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count()),
+            std::memory_order_relaxed);
+        if (setup.controller != nullptr) setup.controller->record(cost);
+        if (!ok || encoded.size() >= body.size()) return; // failed / no gain
+        if (setup.cache != nullptr) setup.cache->insert(encoding, level, body, encoded, cost);
+    }
+    setup.metrics.compression_bytes_in.fetch_add(body.size(), std::memory_order_relaxed);
+    setup.metrics.compression_bytes_out.fetch_add(encoded.size(), std::memory_order_relaxed);
+    std::string original = res.take_body();
+    res.body(std::move(encoded)); // Content-Length follows the new body
+    encoded = std::move(original);
+    encoded.clear();
+    if (encoded.capacity() > 1024 * 1024) std::string().swap(encoded); // Do not pin a huge body per thread
+    res.header("Content-Encoding", Http::content_coding(encoding));
+    // A strong ETag names the identity bytes; the encoded body keeps it only as
+    // a weak validator (If-None-Match compares weakly, so it still matches).
+    if (auto etag = res.get_header("ETag"); etag && etag->rfind("W/", 0) != 0) {
+        res.header("ETag", "W/" + std::string(*etag));
+    }
 }
 }  // namespace
 
@@ -260,7 +458,12 @@ Server::Server(size_t worker_threads)
 #endif
       running_(false) {
     router_ = std::make_unique<Router>();
-    thread_pool_ = std::make_unique<ThreadPool>(worker_threads);
+    thread_pool_ = std::make_unique<WorkStealingPool>(worker_threads);
+    response_pools_.reserve(thread_pool_->size());
+    for (size_t i = 0; i < thread_pool_->size(); ++i) {
+        response_pools_.push_back(std::make_unique<Http::HttpResponsePool>());
+    }
+    default_stats_ = &metrics_.add_pool("default", thread_pool_->size());
 }
 
 Server::~Server() {
@@ -279,23 +482,163 @@ void Server::enable_rate_limit(double requests_per_second, double burst) {
                   << " req/s per IP (burst " << burst << ")";
 }
 
-void Server::enable_metrics(const std::string& path) {
-    router_->add_route(Http::HttpMethod::GET, path,
-                       [this](const Http::HttpRequest&, Http::HttpResponse& res) {
-                           res.status(Http::HttpStatus::OK).body(metrics_.render());
-                           res.header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
-                       });
-    ORE_LOG(INFO) << "Metrics exposed at GET " << path;
+void Server::enable_metrics(const std::string& path, RouteOptions options) {
+    const bool inline_route = options.inline_;
+    get(path,
+        [this](const Http::HttpRequest&, Http::HttpResponse& res) {
+            res.status(Http::HttpStatus::OK).body(metrics_.render());
+            res.header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+        },
+        std::move(options));
+    ORE_LOG(INFO) << "Metrics exposed at GET " << path << (inline_route ? " (inline)" : "");
 }
 
-void Server::enable_compression(std::size_t min_bytes, bool allow_brotli) {
+void Server::enable_compression(std::size_t min_bytes, bool allow_brotli, bool allow_zstd) {
     compression_enabled_ = true;
     compression_min_bytes_ = min_bytes;
     compression_brotli_ = allow_brotli && Http::brotli_available();
-    ORE_LOG(INFO) << "Response compression enabled (min " << min_bytes << " bytes, brotli "
+    compression_zstd_ = allow_zstd && Http::zstd_available();
+    ORE_LOG(INFO) << "Response compression enabled (min " << min_bytes << " bytes, zstd "
+                  << (compression_zstd_ ? "on" : "off") << ", brotli "
                   << (compression_brotli_ ? "on" : "off") << ", gzip on)";
 }
 
+void Server::enable_compression_cache(CompressionCacheOptions options) {
+    compression_cache_ = std::make_unique<CompressionCache>(options, &metrics_);
+    ORE_LOG(INFO) << "Compressed-response cache enabled (" << options.max_bytes << " bytes, bodies up to "
+                  << options.max_body << " bytes)";
+}
+
+void Server::enable_adaptive_compression(CompressionControllerOptions options) {
+    compression_controller_ = std::make_unique<CompressionController>(options, *thread_pool_, *default_stats_, metrics_);
+    ORE_LOG(INFO) << "Adaptive compression enabled (re-evaluated every " << options.interval.count()
+                  << " ms; saturated above load " << options.saturated_load << ")";
+}
+
+void Server::enable_response_cache(ResponseCacheOptions options) {
+    response_cache_ = std::make_unique<ResponseCache>(options, &metrics_);
+    ORE_LOG(INFO) << "Response cache enabled (" << options.max_bytes << " bytes in " << options.shards
+                  << " shards, responses up to " << options.max_entry << " bytes)";
+}
+
+void Server::enable_async_file_io(std::size_t threads) {
+    if (threads == 0) return;
+    io_pool_ = std::make_unique<ThreadPool>(threads); // Also runs HLS reloads (mount_hls())
+    async_file_reads_ = true;
+    ORE_LOG(INFO) << "Asynchronous file reads enabled for TLS (" << threads << " I/O threads)";
+}
+
+void Server::enable_coroutines(std::size_t blocking_threads) {
+    if (scheduler_) return;
+    scheduler_ = std::make_unique<CoroutineScheduler>([this] { notify_event_loop(); }, blocking_threads, &metrics_);
+    ORE_LOG(INFO) << "Coroutine handlers enabled (" << blocking_threads << " blocking threads)";
+}
+
+CoroutineScheduler& Server::scheduler() {
+    if (!scheduler_) enable_coroutines();
+    return *scheduler_;
+}
+
+void Server::add_bulkhead(const std::string& name, BulkheadOptions options) {
+    if (name.empty() || name == "default" || std::any_of(bulkheads_.begin(), bulkheads_.end(),
+                                                          [&name](const auto& b) { return b->name() == name; })) {
+        throw std::invalid_argument("Server::add_bulkhead: invalid or duplicate pool name '" + name + "'");
+    }
+    if (options.threads == 0) options.threads = 1;
+    Metrics::PoolStats& stats = metrics_.add_pool(name, options.threads);
+    bulkheads_.push_back(std::make_unique<Bulkhead>(name, options, stats));
+    ORE_LOG(INFO) << "Bulkhead '" << name << "' enabled (" << options.threads << " threads, queue "
+                  << options.max_queue << ", "
+                  << (options.shed == ShedPolicy::DropOldest ? "drop oldest" : "reject new") << ")";
+}
+
+void Server::add_route(Http::HttpMethod method, const std::string& path, RouteHandler handler,
+                       RouteOptions options) {
+    if (!options.pool.empty() && std::none_of(bulkheads_.begin(), bulkheads_.end(),
+                                              [&options](const auto& b) { return b->name() == options.pool; })) {
+        throw std::invalid_argument("Route " + path + ": unknown bulkhead '" + options.pool +
+                                    "' (call add_bulkhead() first)");
+    }
+    if (options.inline_ && (options.coalesce || !options.pool.empty())) {
+        throw std::invalid_argument("Route " + path + ": an inline route cannot coalesce or use a bulkhead");
+    }
+    router_->add_route(method, path, std::move(handler), std::move(options));
+}
+
+RouteHandler Server::coroutine_route(CoroutineHandler handler) {
+    if (!scheduler_) enable_coroutines(); // Before run(): workers only read it
+    auto shared = std::make_shared<const CoroutineHandler>(std::move(handler));
+    return [this, shared](const Http::HttpRequest&, Http::HttpResponse& res) {
+        // The coroutine frame keeps the response itself; defer() only needs `res`
+        // to tie the handle to this handler.
+        Http::HttpResponse response = std::move(res);
+        DeferredResponse deferred = defer(res);
+        CoroutineScheduler::PoolScope scope(deferred.state_->bulkhead);
+        run_coroutine(shared, std::move(deferred), std::move(response));
+    };
+}
+
+void Server::resume_coroutines() {
+    if (!scheduler_ || scheduler_->idle()) return;
+    std::vector<CoroutineScheduler::Resumption> ready;
+    scheduler_->take_ready(std::chrono::steady_clock::now(), ready);
+    for (const CoroutineScheduler::Resumption& next : ready) {
+        // Back on the pool the coroutine's route runs on: a bulkhead route's
+        // continuations never take a default worker.
+        auto resume = [handle = next.handle, bulkhead = next.bulkhead] {
+            CoroutineScheduler::PoolScope scope(bulkhead);
+            handle.resume();
+        };
+        if (next.bulkhead) {
+            next.bulkhead->pool().post(resume);
+        } else {
+            thread_pool_->post(resume);
+        }
+    }
+}
+
+void Server::enable_file_readahead(FileReadaheadOptions options) {
+    readahead_ = std::make_unique<FileReadahead>(options, &metrics_);
+    ORE_LOG(INFO) << "File readahead enabled (window " << options.window << " bytes)";
+}
+
+void Server::enable_auto_etag() {
+    auto_etag_enabled_ = true;
+    ORE_LOG(INFO) << "Automatic ETags enabled for in-memory responses";
+}
+
+void Server::enable_binary_json() {
+    binary_json_enabled_ = true;
+    ORE_LOG(INFO) << "JSON format negotiation enabled (application/msgpack, application/cbor)";
+}
+
+void Server::mount_static(const std::string& prefix, const std::string& dir, StaticOptions options) {
+    auto directory = std::make_shared<const StaticDirectory>(dir, std::move(options), &metrics_);
+    std::string base = prefix;
+    while (!base.empty() && base.back() == '/') base.pop_back();
+    RouteHandler handler = [directory](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        directory->serve(req, req.param("path").value_or(""), res);
+    };
+    get(base + "/*path", handler);
+    if (!base.empty()) get(base, std::move(handler));
+    ORE_LOG(INFO) << "Serving " << dir << " at " << (base.empty() ? "/" : base) << "/";
+}
+
+void Server::mount_hls(const std::string& prefix, const std::string& dir, HlsOptions options) {
+    auto origin = std::make_shared<HlsOrigin>(dir, std::move(options), &metrics_);
+    std::string base = prefix;
+    while (!base.empty() && base.back() == '/') base.pop_back();
+    get(base + "/*path", [origin](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        origin->serve(req, req.param("path").value_or(""), res);
+    });
+    hls_mounts_.push_back(HlsMount{base, origin, false, {}});
+    // Playlist reloads (read, parse, compress) stay off the event loop.
+    if (!io_pool_) io_pool_ = std::make_unique<ThreadPool>(1);
+    ORE_LOG(INFO) << "HLS origin for " << dir << " at " << (base.empty() ? "/" : base) << "/ ("
+                  << origin->playlists() << " playlist(s)"
+                  << (origin->watch_fd() >= 0 ? ", watched" : ", polled") << ")";
+}
+
 void Server::set_non_blocking(int fd) {
     int flags = fcntl(fd, F_GETFL, 0);
     if (flags == -1) {
@@ -484,6 +827,9 @@ void Server::process_completions() {
         CompletedResponse item = std::move(ready.front());
         ready.pop();
 
+        // Followers are answered even if the leader's own connection is gone.
+        if (item.flight != 0) finish_flight(item);
+
         // Verify the connection is still the live owner of this fd (guard
         // against close + fd reuse while the worker was running).
         auto it = connections_.find(item.fd);
@@ -494,8 +840,89 @@ void Server::process_completions() {
         // The worker finished: leave the handler-timeout window, enter the write
         // phase (now governed by write_timeout).
         item.conn->worker_in_flight_ = false;
-        item.conn->set_response_content(item.response);
-        rearm(item.fd, /*read=*/false); // Closes the connection on failure.
+        if (item.canned != nullptr) {
+            item.conn->set_canned_response(*item.canned, item.head_only);
+            rearm(item.fd, /*read=*/false); // Closes the connection on failure.
+        } else {
+            send_response(item.fd, item.conn, *item.response);
+        }
+    }
+}
+
+void Server::send_response(int fd, const std::shared_ptr<Net::Connection>& conn, Http::HttpResponse& res) {
+    conn->set_response_content(std::move(res));
+    if (readahead_ && conn->file_ && conn->pieces_.empty() && !conn->head_only_) {
+        readahead_->start(fd, conn->file_, conn->file_offset_, conn->file_remaining_);
+    }
+    // The first read overlaps with sending the headers.
+    if (conn->wants_file_read()) submit_file_read(fd, conn);
+    rearm(fd, /*read=*/false); // Closes the connection on failure.
+}
+
+void Server::finish_flight(const CompletedResponse& item) {
+    std::vector<RequestCoalescer::Waiter> waiters = coalescer_.complete(item.flight);
+    metrics_.coalesce_waiting.store(static_cast<int64_t>(coalescer_.waiting()), std::memory_order_relaxed);
+    const auto now = std::chrono::steady_clock::now();
+    for (RequestCoalescer::Waiter& waiter : waiters) {
+        auto it = connections_.find(waiter.fd);
+        if (it == connections_.end() || it->second != waiter.conn || !waiter.conn->is_open()) continue;
+        if (item.shared == nullptr && item.canned == nullptr) {
+            // A file or client-specific response cannot be shared: run this
+            // one on its own.
+            metrics_.coalesce_redispatched.fetch_add(1, std::memory_order_relaxed);
+            Bulkhead* bulkhead = bulkhead_for(waiter.route);
+            if (default_pool_full(bulkhead)) {
+                shed_default(waiter.fd, waiter.conn, waiter.head_only);
+            } else {
+                dispatch_to_worker(waiter.fd, waiter.conn, std::move(waiter.request), waiter.route, 0, bulkhead);
+            }
+            continue;
+        }
+        const Http::CannedResponse& response = item.shared ? *item.shared : *item.canned;
+        metrics_.record_status(static_cast<int>(response.status()));
+        metrics_.observe_duration(std::chrono::duration<double>(now - waiter.since).count());
+        if (item.shared) {
+            waiter.conn->set_canned_response(item.shared, waiter.head_only);
+        } else {
+            waiter.conn->set_canned_response(response, waiter.head_only);
+        }
+        rearm(waiter.fd, /*read=*/false);
+    }
+}
+
+void Server::submit_file_read(int fd, const std::shared_ptr<Net::Connection>& conn) {
+    Net::Connection::FileRead read = conn->begin_file_read();
+    io_pool_->enqueue([this, fd, conn, read = std::move(read)] {
+        const auto started = std::chrono::steady_clock::now();
+        ssize_t n;
+        do {
+            n = ::pread(read.file->file.fd(), read.buffer, read.length, read.offset);
+        } while (n < 0 && errno == EINTR);
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        metrics_.async_file_reads.fetch_add(1, std::memory_order_relaxed);
+        metrics_.async_file_read_ns.fetch_add(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+            std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(file_reads_mutex_);
+            file_reads_done_.push_back(FileReadDone{fd, conn, n});
+        }
+        notify_event_loop();
+    });
+}
+
+void Server::process_file_reads() {
+    std::vector<FileReadDone> done;
+    {
+        std::lock_guard<std::mutex> lock(file_reads_mutex_);
+        std::swap(done, file_reads_done_);
+    }
+    for (FileReadDone& item : done) {
+        const bool stalled = item.conn->waiting_for_file_read();
+        item.conn->end_file_read(item.result);
+        auto it = connections_.find(item.fd);
+        if (it == connections_.end() || it->second != item.conn || !item.conn->is_open()) continue;
+        if (stalled) handle_write_ready(item.fd);
     }
 }
 
@@ -528,14 +955,53 @@ void Server::run() {
 #elif __APPLE__
     struct kevent events[MAX_EVENTS];
 #endif
+    // Compile the route table; workers only ever read it from here on.
+    router_->freeze();
+    inline_routes_.assign(router_->route_count(), InlineRoute{});
+    route_bulkheads_.assign(router_->route_count(), nullptr);
+    for (std::size_t i = 0; router_->any_pooled() && i < route_bulkheads_.size(); ++i) {
+        const std::string& pool = router_->options(router_->route_at(i)).pool;
+        for (const auto& bulkhead : bulkheads_) {
+            if (!pool.empty() && bulkhead->name() == pool) route_bulkheads_[i] = bulkhead.get();
+        }
+    }
     auto last_cleanup = std::chrono::steady_clock::now();
     draining_ = false;
     std::chrono::steady_clock::time_point drain_deadline;
 
+    // HLS playlist watches wake the loop like the wakeup pipe (level-triggered:
+    // collect() drains them). Mounts without one are rescanned every 100 ms.
+    bool hls_polling = false;
+    for (const HlsMount& mount : hls_mounts_) {
+        bool watched = false;
+#ifdef __linux__
+        if (mount.origin->watch_fd() >= 0) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = mount.origin->watch_fd();
+            watched = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, mount.origin->watch_fd(), &event) == 0;
+            if (!watched) ORE_LOG(ERROR) << "Failed to add HLS watch to epoll: " << strerror(errno);
+        }
+#endif
+        if (!watched) hls_polling = true;
+    }
+    auto hls_watching = [this](int fd) -> std::size_t {
+        for (std::size_t i = 0; i < hls_mounts_.size(); ++i) {
+            if (hls_mounts_[i].origin->watch_fd() == fd) return i;
+        }
+        return hls_mounts_.size();
+    };
+
     while (running_.load(std::memory_order_relaxed)) {
         // While draining we poll more frequently so the grace deadline and the
-        // "all connections drained" condition are observed promptly.
-        const int wait_ms = draining_ ? 100 : 1000;
+        // "all connections drained" condition are observed promptly (and so are
+        // polled HLS playlists).
+        int wait_ms = draining_ || hls_polling ? 100 : 1000;
+        // Coroutine timers: wake for the next deadline.
+        if (scheduler_) {
+            wait_ms = static_cast<int>(
+                scheduler_->wait_time(std::chrono::steady_clock::now(), std::chrono::milliseconds(wait_ms)).count());
+        }
 #ifdef __linux__
         int num_events = epoll_wait(epoll_fd_, events, MAX_EVENTS, wait_ms);
 #elif __APPLE__
@@ -561,8 +1027,14 @@ void Server::run() {
             if (fd == wakeup_pipe_[0]) {
                 drain_wakeup();
                 process_completions();
+                drain_bulkheads();
+                process_file_reads();
+                process_hls_reloads();
+                resume_coroutines();
             } else if (fd == listen_fd_) {
                 if (flags & EPOLLIN) handle_new_connection();
+            } else if (std::size_t mount = hls_watching(fd); mount < hls_mounts_.size()) {
+                refresh_hls(mount);
             } else {
                 if ((flags & EPOLLERR) || (flags & EPOLLHUP)) {
                     close_connection(fd);
@@ -579,6 +1051,10 @@ void Server::run() {
             if (fd == wakeup_pipe_[0]) {
                 drain_wakeup();
                 process_completions();
+                drain_bulkheads();
+                process_file_reads();
+                process_hls_reloads();
+                resume_coroutines();
             } else if (fd == listen_fd_) {
                 if (filter == EVFILT_READ) handle_new_connection();
             } else {
@@ -592,6 +1068,11 @@ void Server::run() {
 #endif
         }
 
+        if (hls_polling) {
+            for (std::size_t mount = 0; mount < hls_mounts_.size(); ++mount) refresh_hls(mount);
+        }
+        resume_coroutines(); // Due timers
+
         auto now = std::chrono::steady_clock::now();
 
         // Transition into graceful drain on the first observed stop request.
@@ -650,9 +1131,18 @@ void Server::stop() {
     // never started it) before this completes. We only touch state here that is
     // not concurrently used once the loop has exited and workers are joined.
     request_stop();
+    if (scheduler_) {
+        scheduler_->shutdown(); // Finishes the offloaded calls in progress.
+    }
     if (thread_pool_) {
         thread_pool_->shutdown(); // Joins worker threads.
     }
+    for (auto& bulkhead : bulkheads_) {
+        bulkhead->shutdown();
+    }
+    if (io_pool_) {
+        io_pool_->shutdown(); // Joins the I/O threads (they notify the loop too).
+    }
 
     // Cover the "run() was never started" path; no-ops if run() already cleaned up.
     connections_.clear();
@@ -719,6 +1209,7 @@ void Server::handle_new_connection() {
                 continue;
             }
             conn->set_ssl(ssl); // Handshake is driven lazily on the first event.
+            conn->async_file_reads_ = async_file_reads_;
         }
         connections_[client_fd] = std::move(conn);
         metrics_.connections_accepted.fetch_add(1, std::memory_order_relaxed);
@@ -730,6 +1221,192 @@ void Server::handle_new_connection() {
     }
 }
 
+const RouteHandler* Server::match_route(Http::HttpRequest& request) const {
+    // HEAD reuses the GET handler; the body is stripped later.
+    const RouteHandler* route = router_->match(request.method(), request.path(), request.path_params_);
+    if (route == nullptr && request.method() == Http::HttpMethod::HEAD) {
+        route = router_->match(Http::HttpMethod::GET, request.path(), request.path_params_);
+    }
+    return route;
+}
+
+bool Server::run_handler(Http::HttpRequest& request, Http::HttpResponse& res, const RouteHandler* route) {
+    if (binary_json_enabled_) {
+        res.set_json_format(Http::negotiate_body_format(request.header("Accept")));
+    }
+
+    // Run the middleware chain first. Any middleware may short-circuit (return
+    // false) with a response already populated (auth rejection, CORS preflight,
+    // ...), in which case the handler is skipped.
+    for (const auto& mw : middlewares_) {
+        try {
+            if (!mw(request, res)) return true;
+        } catch (const std::exception& e) {
+            ORE_LOG(ERROR) << "Middleware exception: " << e.what();
+            nlohmann::json err;
+            err["error"] = "Server error";
+            res.status(Http::HttpStatus::INTERNAL_SERVER_ERROR).json(err);
+            return true;
+        }
+    }
+
+    if (route != nullptr) {
+        try {
+            (*route)(request, res);
+        } catch (const std::exception& e) {
+            ORE_LOG(ERROR) << "Handler exception: " << e.what();
+            nlohmann::json err;
+            err["error"] = "Server error";
+            res.status(Http::HttpStatus::INTERNAL_SERVER_ERROR).json(err);
+        }
+        return true;
+    }
+    // Plain 404 (canned bytes) unless a middleware already decorated the
+    // response (e.g. CORS headers).
+    if (res.get_headers().empty()) return false;
+    nlohmann::json err;
+    err["error"] = "Not Found";
+    res.status(Http::HttpStatus::NOT_FOUND).json(err);
+    return true;
+}
+
+void Server::revalidate(std::shared_ptr<Http::HttpRequest> request) {
+    // The refresh runs the full pipeline like a client request would, on a
+    // worker of the route's pool, and counts as in flight there; its result
+    // (now, or when a deferred handler completes) only goes to the cache. It is
+    // scheduled ahead of load shedding, so it only takes a worker that is free
+    // right now: the stale entry keeps being served meanwhile.
+    request->method_ = Http::HttpMethod::GET; // A HEAD hit refreshes the GET entry
+    const RouteHandler* route = match_route(*request);
+    Bulkhead* bulkhead = bulkhead_for(route);
+    if (bulkhead ? !bulkhead->try_admit() : default_pool_full(nullptr)) {
+        response_cache_->abandon_revalidation(*request);
+        return;
+    }
+    Metrics::PoolStats& stats = bulkhead ? bulkhead->stats() : *default_stats_;
+    if (bulkhead == nullptr) stats.admitted.fetch_add(1, std::memory_order_relaxed);
+    metrics_.workers_in_flight.fetch_add(1, std::memory_order_relaxed);
+    auto task = [this, route, bulkhead, &stats, request]() {
+        struct InFlightGuard {
+            Server& server;
+            Bulkhead* bulkhead;
+            Metrics::PoolStats& stats;
+            ~InFlightGuard() {
+                stats.running.fetch_sub(1, std::memory_order_relaxed);
+                stats.admitted.fetch_sub(1, std::memory_order_relaxed);
+                server.metrics_.workers_in_flight.fetch_sub(1, std::memory_order_relaxed);
+                if (bulkhead && bulkhead->has_waiting()) server.notify_event_loop();
+            }
+        } in_flight_guard{*this, bulkhead, stats};
+        stats.running.fetch_add(1, std::memory_order_relaxed);
+        const int worker = WorkStealingPool::current_worker_index();
+        Http::HttpResponsePool::Handle res_handle =
+            bulkhead ? bulkhead->response_pool(worker).acquire()
+                     : response_pools_[worker >= 0 ? static_cast<size_t>(worker) : 0]->acquire();
+        Http::HttpResponse& res = *res_handle;
+        const std::shared_ptr<Net::Connection> no_conn;
+        HandlerContext context{-1, &no_conn, &request, &res, std::chrono::steady_clock::now(), 0, false, 0,
+                               route, bulkhead, true};
+        t_handler = &context;
+        const bool handled = run_handler(*request, res, route);
+        t_handler = nullptr;
+        if (context.deferred) return; // complete_deferred() finishes it
+        if (handled) {
+            finish_revalidation(*request, res);
+        } else {
+            response_cache_->abandon_revalidation(*request);
+        }
+    };
+    if (bulkhead) {
+        bulkhead->pool().post(std::move(task));
+    } else {
+        thread_pool_->post(std::move(task));
+    }
+}
+
+void Server::finish_revalidation(Http::HttpRequest& request, Http::HttpResponse& res) {
+    const CompressionSetup compression{compression_min_bytes_, compression_brotli_, compression_zstd_,
+                                       compression_cache_.get(), compression_controller_.get(), metrics_};
+    if (auto_etag_enabled_) apply_string_etag(request, res, compression_enabled_ ? &compression : nullptr);
+    if (compression_enabled_) maybe_compress(request, res, compression);
+    if (!response_cache_->store(request, res)) response_cache_->abandon_revalidation(request);
+}
+
+bool Server::park_hls_reload(int fd, const std::shared_ptr<Net::Connection>& conn, const RouteHandler* route,
+                             std::size_t consumed) {
+    const std::string_view path = conn->current_request_.path();
+    const Http::HttpMethod method = conn->current_request_.method();
+    if (method != Http::HttpMethod::GET && method != Http::HttpMethod::HEAD) return false;
+    const std::optional<HlsOrigin::Position> position = HlsOrigin::blocking_position(conn->current_request_);
+    if (!position) return false;
+    for (HlsMount& mount : hls_mounts_) {
+        const std::string& base = mount.base;
+        if (path.size() <= base.size() + 1 || path.compare(0, base.size(), base) != 0 || path[base.size()] != '/')
+            continue;
+        std::string relative(path.substr(base.size() + 1));
+        // Anything but Wait (ready, too far ahead, unknown) is the handler's.
+        if (mount.origin->ready(relative, *position) != HlsOrigin::Readiness::Wait) return false;
+
+        auto request = std::make_shared<Http::HttpRequest>(std::move(conn->current_request_));
+        request->make_owned(conn->read_buffer_.data(), consumed);
+        conn->consume(consumed);
+        conn->processing_ = true;
+        const auto now = std::chrono::steady_clock::now();
+        const auto deadline = mount.origin->block_deadline(relative, now);
+        mount.origin->park(HlsOrigin::Waiter{fd, conn, std::move(request), route, std::move(relative), *position,
+                                             now, deadline});
+        metrics_.hls_blocked.fetch_add(1, std::memory_order_relaxed);
+        metrics_.hls_waiting.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void Server::refresh_hls(std::size_t mount) {
+    HlsMount& hls = hls_mounts_[mount];
+    hls.pending.merge(hls.origin->collect(std::chrono::steady_clock::now()));
+    if (hls.reloading || hls.pending.empty()) return;
+    hls.reloading = true;
+    io_pool_->enqueue([this, mount, origin = hls.origin, reload = std::exchange(hls.pending, {})] {
+        std::vector<std::string> changed = origin->apply(reload);
+        {
+            std::lock_guard<std::mutex> lock(hls_reloads_mutex_);
+            hls_reloads_done_.push_back(HlsReloadDone{mount, std::move(changed)});
+        }
+        notify_event_loop();
+    });
+}
+
+void Server::process_hls_reloads() {
+    std::vector<HlsReloadDone> done;
+    {
+        std::lock_guard<std::mutex> lock(hls_reloads_mutex_);
+        std::swap(done, hls_reloads_done_);
+    }
+    for (HlsReloadDone& item : done) {
+        HlsMount& hls = hls_mounts_[item.mount];
+        hls.reloading = false;
+        if (!item.changed.empty() && hls.origin->waiting() > 0) resume_hls(hls.origin->release(item.changed));
+        refresh_hls(item.mount); // Whatever changed during the reload
+    }
+}
+
+void Server::resume_hls(std::vector<HlsOrigin::Waiter> waiters) {
+    for (HlsOrigin::Waiter& waiter : waiters) {
+        metrics_.hls_waiting.fetch_sub(1, std::memory_order_relaxed);
+        auto it = connections_.find(waiter.fd);
+        if (it == connections_.end() || it->second != waiter.conn || !waiter.conn->is_open()) continue;
+        // Parked ahead of load shedding: one playlist update may release many
+        // viewers at once, each admitted (or shed) like a new request.
+        Bulkhead* bulkhead = bulkhead_for(waiter.route);
+        if (default_pool_full(bulkhead)) {
+            shed_default(waiter.fd, waiter.conn, waiter.request->method() == Http::HttpMethod::HEAD);
+        } else {
+            dispatch_to_worker(waiter.fd, waiter.conn, std::move(waiter.request), waiter.route, 0, bulkhead);
+        }
+    }
+}
+
 void Server::dispatch_next(int fd, const std::shared_ptr<Net::Connection>& conn) {
     if (conn->processing_) return; // A request is already in flight; wait for it.
 
@@ -737,137 +1414,111 @@ void Server::dispatch_next(int fd, const std::shared_ptr<Net::Connection>& conn)
     if (conn->parse_next(consumed)) {
         metrics_.requests_total.fetch_add(1, std::memory_order_relaxed);
 
+        const bool head = conn->current_request_.method() == Http::HttpMethod::HEAD;
+
         // Rate limit per client IP before doing the owning copy or spawning a
-        // worker: a throttled request is answered with 429 directly here.
+        // worker: a throttled request is answered with 429 directly here, from
+        // the pre-serialized bytes (no allocation on the overload path).
         if (rate_limiter_ && !rate_limiter_->allow(conn->client_ip_)) {
             conn->consume(consumed);
             conn->processing_ = true;
             metrics_.rate_limited_total.fetch_add(1, std::memory_order_relaxed);
             metrics_.record_status(429);
-            Http::HttpResponse res;
-            nlohmann::json err;
-            err["error"] = "Too Many Requests";
-            res.status(Http::HttpStatus::TOO_MANY_REQUESTS).json(err);
-            res.header("Retry-After", "1");
-            conn->set_response_content(res);
+            conn->set_canned_response(*canned_.find(Http::HttpStatus::TOO_MANY_REQUESTS), head);
             rearm(fd, /*read=*/false);
             return;
         }
 
+        // Response cache: a hit is written from here, without a thread-pool
+        // hop (and ahead of load shedding, since it costs no worker). A stale
+        // hit is still served; the first one also schedules a refresh.
+        if (response_cache_ && ResponseCache::servable(conn->current_request_)) {
+            const auto t_lookup = std::chrono::steady_clock::now();
+            ResponseCache::Hit hit = response_cache_->find(conn->current_request_);
+            if (hit.response) {
+                if (hit.revalidate) {
+                    auto request = std::make_shared<Http::HttpRequest>(conn->current_request_);
+                    request->make_owned(conn->read_buffer_.data(), consumed);
+                    revalidate(std::move(request));
+                }
+                conn->consume(consumed);
+                conn->processing_ = true;
+                metrics_.record_status(static_cast<int>(hit.response->status()));
+                metrics_.observe_duration(
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - t_lookup).count());
+                conn->set_canned_response(std::move(hit.response), head);
+                rearm(fd, /*read=*/false);
+                return;
+            }
+        }
+
+        // The one route lookup: the route and its path parameters (in the
+        // request) go along with it from here on.
+        const RouteHandler* route = match_route(conn->current_request_);
+
+        // LL-HLS blocking playlist reload: until the playlist reaches the
+        // requested position the request waits here, without a worker.
+        if (!hls_mounts_.empty() && park_hls_reload(fd, conn, route, consumed)) return;
+
+        // Inline route: answered right here, from the parsed views.
+        if (router_->any_inline() && run_inline(fd, conn, consumed, route)) return;
+
+        // Single-flight: on a coalescing route, an identical request already
+        // running answers this one too; it waits here without a worker. (A
+        // follower skips the middlewares and the handler, like a cache hit.)
+        std::shared_ptr<Http::HttpRequest> request;
+        std::string flight_key;
+        std::chrono::milliseconds flight_timeout{0};
+        const Http::HttpMethod method = conn->current_request_.method();
+        if (router_->any_coalesced() && route != nullptr &&
+            (method == Http::HttpMethod::GET || method == Http::HttpMethod::HEAD)) {
+            const RouteOptions& options = router_->options(route);
+            flight_key = RequestCoalescer::key(conn->current_request_, options);
+            flight_timeout = options.coalesce_timeout;
+            if (!flight_key.empty()) {
+                request = std::make_shared<Http::HttpRequest>(std::move(conn->current_request_));
+                request->make_owned(conn->read_buffer_.data(), consumed);
+                if (coalescer_.join(flight_key, RequestCoalescer::Waiter{fd, conn, request, route, head,
+                                                                         std::chrono::steady_clock::now()})) {
+                    conn->consume(consumed);
+                    conn->processing_ = true;
+                    metrics_.coalesce_followers.fetch_add(1, std::memory_order_relaxed);
+                    metrics_.coalesce_waiting.store(static_cast<int64_t>(coalescer_.waiting()),
+                                                    std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+
         // Load shedding: if the configured number of handlers is already in
         // flight, reject immediately with 503 instead of queuing another task.
         // A hung handler holds a worker forever, so without this the pool queue
         // would grow unbounded and the server would stall silently; failing fast
-        // keeps it responsive and lets a load balancer route away.
-        if (settings_.max_concurrent_handlers > 0 &&
-            metrics_.workers_in_flight.load(std::memory_order_relaxed) >=
-                settings_.max_concurrent_handlers) {
+        // keeps it responsive and lets a load balancer route away. Bulkhead
+        // routes are bounded by their own pool instead (dispatch_to_worker).
+        Bulkhead* bulkhead = bulkhead_for(route);
+        if (default_pool_full(bulkhead)) {
             conn->consume(consumed);
             conn->processing_ = true;
-            metrics_.load_shed_total.fetch_add(1, std::memory_order_relaxed);
-            metrics_.record_status(503);
-            Http::HttpResponse res;
-            nlohmann::json err;
-            err["error"] = "Service Unavailable";
-            res.status(Http::HttpStatus::SERVICE_UNAVAILABLE).json(err);
-            res.header("Retry-After", "1");
-            conn->set_response_content(res);
-            rearm(fd, /*read=*/false);
+            shed_default(fd, conn, head);
             return;
         }
 
         // Take an owning copy of the request so it can safely outlive the
         // socket buffer and be handed to a worker thread.
-        auto request = std::make_shared<Http::HttpRequest>(std::move(conn->current_request_));
-        request->make_owned(conn->read_buffer_.data(), consumed);
+        if (!request) {
+            request = std::make_shared<Http::HttpRequest>(std::move(conn->current_request_));
+            request->make_owned(conn->read_buffer_.data(), consumed);
+        }
         conn->consume(consumed);
         conn->processing_ = true;
-        conn->worker_in_flight_ = true;
-        const auto t_start = std::chrono::steady_clock::now();
-        conn->processing_since_ = t_start;
 
-        // Count this handler as in flight before it is queued; the worker's guard
-        // (below) decrements it on completion. A hung handler never decrements,
-        // which is intentional — the gauge then reflects the wedged worker.
-        metrics_.workers_in_flight.fetch_add(1, std::memory_order_relaxed);
-        thread_pool_->enqueue([this, fd, conn, request, t_start]() {
-            // Ensure the in-flight gauge is decremented however the handler exits
-            // (normal return or exception); a truly stuck handler never reaches
-            // this scope exit, so it stays counted, as intended.
-            struct InFlightGuard {
-                Metrics& m;
-                ~InFlightGuard() { m.workers_in_flight.fetch_sub(1, std::memory_order_relaxed); }
-            } in_flight_guard{metrics_};
-
-            Http::HttpResponse res;
-            RouteHandler handler;
-            std::unordered_map<std::string_view, std::string_view> path_params;
-
-            // Run the middleware chain first. Any middleware may short-circuit
-            // (return false) with a response already populated (auth rejection,
-            // CORS preflight, ...), in which case the handler is skipped.
-            bool proceed = true;
-            for (const auto& mw : middlewares_) {
-                try {
-                    if (!mw(*request, res)) { proceed = false; break; }
-                } catch (const std::exception& e) {
-                    ORE_LOG(ERROR) << "Middleware exception: " << e.what();
-                    nlohmann::json err;
-                    err["error"] = "Server error";
-                    res.status(Http::HttpStatus::INTERNAL_SERVER_ERROR).json(err);
-                    proceed = false;
-                    break;
-                }
-            }
-
-            // HEAD reuses the GET handler; the body is stripped later.
-            Http::HttpMethod method = request->method();
-            bool found = proceed &&
-                         router_->find_route(method, request->path(), path_params, handler);
-            if (proceed && !found && method == Http::HttpMethod::HEAD) {
-                found = router_->find_route(Http::HttpMethod::GET, request->path(), path_params, handler);
-            }
-
-            if (!proceed) {
-                // A middleware already produced the response; fall through to the
-                // semantics/completion handling below.
-            } else if (found) {
-                request->path_params_ = std::move(path_params);
-                try {
-                    handler(*request, res);
-                } catch (const std::exception& e) {
-                    ORE_LOG(ERROR) << "Handler exception: " << e.what();
-                    nlohmann::json err;
-                    err["error"] = "Server error";
-                    res.status(Http::HttpStatus::INTERNAL_SERVER_ERROR).json(err);
-                }
-            } else {
-                nlohmann::json err;
-                err["error"] = "Not Found";
-                res.status(Http::HttpStatus::NOT_FOUND).json(err);
-            }
-
-            // Compress the (string) body if negotiated, before HEAD suppression
-            // so Content-Length matches what an equivalent GET would send.
-            if (compression_enabled_) {
-                maybe_compress(*request, res, compression_min_bytes_, compression_brotli_);
-            }
-
-            // Apply request-driven response semantics (Range for file responses,
-            // HEAD body suppression) before handing the response back.
-            apply_http_semantics(*request, res);
-
-            // Record metrics for this request (atomic; safe off the loop thread).
-            metrics_.record_status(static_cast<int>(res.get_status()));
-            metrics_.observe_duration(
-                std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
-
-            {
-                std::lock_guard<std::mutex> lock(completed_mutex_);
-                completed_.push(CompletedResponse{fd, conn, std::move(res)});
-            }
-            notify_event_loop();
-        });
+        std::uint64_t flight = 0;
+        if (!flight_key.empty()) {
+            flight = coalescer_.lead(std::move(flight_key), std::chrono::steady_clock::now() + flight_timeout);
+            metrics_.coalesce_leaders.fetch_add(1, std::memory_order_relaxed);
+        }
+        dispatch_to_worker(fd, conn, std::move(request), route, flight, bulkhead);
         return;
     }
 
@@ -885,6 +1536,329 @@ void Server::dispatch_next(int fd, const std::shared_ptr<Net::Connection>& conn)
     rearm(fd, want_read);
 }
 
+bool Server::run_inline(int fd, const std::shared_ptr<Net::Connection>& conn, std::size_t consumed,
+                        const RouteHandler* route) {
+    if (route == nullptr || !router_->options(route).inline_) return false;
+    InlineRoute& state = inline_routes_[router_->route_index(route)];
+    if (state.demoted) return false;
+
+    // The request still points into the read buffer: everything that reads
+    // it happens before consume().
+    const auto t_start = std::chrono::steady_clock::now();
+    Http::HttpResponsePool::Handle res_handle = inline_responses_.acquire();
+    Http::HttpRequest& request = conn->current_request_;
+    Http::HttpResponse& res = *res_handle;
+    HandlerContext context{fd, &conn, nullptr, &res, t_start, 0, false, consumed, route, nullptr, false};
+    t_handler = &context;
+    run_handler(request, res, route);
+    t_handler = nullptr;
+    // The budget covers the handler (and middlewares) only: ETag hashing and
+    // compression in finalize_response() cost the same on a worker.
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t_start);
+    if (!context.deferred) finalize_response(request, res, t_start, 0);
+    metrics_.inline_requests.fetch_add(1, std::memory_order_relaxed);
+    ++state.runs;
+
+    // Safety net: the loop stalls while an inline handler runs, so a route
+    // that keeps overrunning its budget goes back to the workers.
+    const std::chrono::microseconds budget = router_->options(route).inline_budget;
+    if (elapsed > budget) {
+        metrics_.inline_overruns.fetch_add(1, std::memory_order_relaxed);
+        if (state.runs - state.last_overrun > kInlineStrikeWindow) state.overruns = 0;
+        state.last_overrun = state.runs;
+        if (++state.overruns < kInlineStrikes) {
+            ORE_LOG(WARN) << "Inline route " << request.path() << " took " << elapsed.count()
+                          << "us on the event loop (budget " << budget.count() << "us)";
+        } else {
+            state.demoted = true;
+            metrics_.inline_demoted_routes.fetch_add(1, std::memory_order_relaxed);
+            ORE_LOG(WARN) << "Inline route " << request.path() << " overran its " << budget.count() << "us budget "
+                          << state.overruns << " times; running it on workers from now on";
+        }
+    }
+
+    conn->consume(consumed);
+    conn->processing_ = true;
+    if (context.deferred) {
+        // Answered through process_completions() like a deferred worker
+        // request, within the handler-timeout window meanwhile.
+        conn->worker_in_flight_ = true;
+        conn->processing_since_ = t_start;
+        return true;
+    }
+    send_response(fd, conn, res);
+    return true;
+}
+
+void Server::dispatch_to_worker(int fd, const std::shared_ptr<Net::Connection>& conn,
+                                std::shared_ptr<Http::HttpRequest> request, const RouteHandler* route,
+                                std::uint64_t flight, Bulkhead* bulkhead) {
+    conn->worker_in_flight_ = true;
+    const auto t_start = std::chrono::steady_clock::now();
+    conn->processing_since_ = t_start;
+    if (bulkhead == nullptr) {
+        default_stats_->admitted.fetch_add(1, std::memory_order_relaxed);
+        run_on_worker(fd, conn, std::move(request), route, flight, t_start);
+        return;
+    }
+
+    // Bulkhead: run now if one of its workers is free, else wait in its queue
+    // (still inside the handler-timeout window) or be shed.
+    Bulkhead::Pending pending{fd, conn, std::move(request), route, flight, t_start};
+    std::optional<Bulkhead::Pending> evicted;
+    switch (bulkhead->admit(pending, evicted)) {
+    case Bulkhead::Admission::Run:
+        run_on_worker(fd, conn, std::move(pending.request), route, flight, t_start);
+        break;
+    case Bulkhead::Admission::Queued:
+        if (evicted) shed_pending(*evicted);
+        break;
+    case Bulkhead::Admission::Shed:
+        shed_pending(pending);
+        break;
+    }
+}
+
+void Server::run_on_worker(int fd, const std::shared_ptr<Net::Connection>& conn,
+                           std::shared_ptr<Http::HttpRequest> request, const RouteHandler* route,
+                           std::uint64_t flight, std::chrono::steady_clock::time_point t_start) {
+    // The task names its route by index (-1: none), its bulkhead's too: an int
+    // packs next to `fd`, so the closure still fits the pool's inline task
+    // storage (no allocation).
+    const int index = route ? static_cast<int>(router_->route_index(route)) : -1;
+
+    // Count this handler as in flight before it is queued; the worker's guard
+    // (below) decrements it on completion. A hung handler never decrements,
+    // which is intentional — the gauge then reflects the wedged worker (and
+    // keeps its pool's slot taken).
+    metrics_.workers_in_flight.fetch_add(1, std::memory_order_relaxed);
+    auto task = [this, fd, index, conn, request, t_start, flight]() {
+        const RouteHandler* route = index >= 0 ? router_->route_at(static_cast<size_t>(index)) : nullptr;
+        Bulkhead* bulkhead = bulkhead_for(route);
+        Metrics::PoolStats& stats = bulkhead ? bulkhead->stats() : *default_stats_;
+        // Ensure the in-flight gauges are decremented however the handler exits
+        // (normal return or exception); a truly stuck handler never reaches
+        // this scope exit, so it stays counted, as intended.
+        struct InFlightGuard {
+            Server& server;
+            Bulkhead* bulkhead;
+            Metrics::PoolStats& stats;
+            std::chrono::steady_clock::time_point start;
+            ~InFlightGuard() {
+                stats.observe_latency(
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                stats.running.fetch_sub(1, std::memory_order_relaxed);
+                stats.admitted.fetch_sub(1, std::memory_order_relaxed);
+                server.metrics_.workers_in_flight.fetch_sub(1, std::memory_order_relaxed);
+                // A worker is free: the event loop starts the next queued request.
+                if (bulkhead && bulkhead->has_waiting()) server.notify_event_loop();
+            }
+        } in_flight_guard{*this, bulkhead, stats, t_start};
+        stats.running.fetch_add(1, std::memory_order_relaxed);
+
+        // Responses come from this worker's pool and return to it once the
+        // event loop has handed the body to the connection.
+        const int worker = WorkStealingPool::current_worker_index();
+        Http::HttpResponsePool::Handle res_handle =
+            bulkhead ? bulkhead->response_pool(worker).acquire()
+                     : response_pools_[worker >= 0 ? static_cast<size_t>(worker) : 0]->acquire();
+        Http::HttpResponse& res = *res_handle;
+        HandlerContext context{fd, &conn, &request, &res, t_start, flight, false, 0, route, bulkhead, false};
+        t_handler = &context;
+        const bool handled = run_handler(*request, res, route);
+        t_handler = nullptr;
+        // Deferred: the handle's holder answers (complete_deferred()); the
+        // connection stays in the handler-timeout window meanwhile.
+        if (context.deferred) return;
+        if (!handled) {
+            // Plain 404: send the canned bytes.
+            metrics_.record_status(404);
+            metrics_.observe_duration(
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+            {
+                std::lock_guard<std::mutex> lock(completed_mutex_);
+                completed_.push(CompletedResponse{fd, conn, std::move(res_handle),
+                                                  canned_.find(Http::HttpStatus::NOT_FOUND),
+                                                  request->method() == Http::HttpMethod::HEAD, flight, nullptr});
+            }
+            notify_event_loop();
+            return;
+        }
+        finish_response(fd, conn, *request, std::move(res_handle), t_start, flight);
+    };
+    static_assert(sizeof(task) <= WorkItem::kInline, "worker task no longer fits inline");
+    if (Bulkhead* bulkhead = bulkhead_for(route)) {
+        bulkhead->pool().post(std::move(task));
+    } else {
+        thread_pool_->post(std::move(task));
+    }
+}
+
+Bulkhead* Server::bulkhead_for(const RouteHandler* route) const {
+    return route ? route_bulkheads_[router_->route_index(route)] : nullptr;
+}
+
+void Server::drain_bulkheads() {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<Bulkhead::Pending> expired;
+    for (auto& bulkhead : bulkheads_) {
+        if (bulkhead->queued() == 0) continue;
+        while (std::optional<Bulkhead::Pending> pending = bulkhead->next(now, expired)) {
+            auto it = connections_.find(pending->fd);
+            if (it == connections_.end() || it->second != pending->conn || !pending->conn->is_open()) {
+                // Closed while queued (e.g. handler timeout): give the slot back.
+                bulkhead->stats().admitted.fetch_sub(1, std::memory_order_relaxed);
+                if (pending->flight != 0) shed_pending(*pending); // Its followers still wait
+                continue;
+            }
+            run_on_worker(pending->fd, pending->conn, std::move(pending->request), pending->route, pending->flight,
+                          pending->admitted_at);
+        }
+        for (Bulkhead::Pending& pending : expired) shed_pending(pending);
+        expired.clear();
+    }
+}
+
+bool Server::default_pool_full(const Bulkhead* bulkhead) const {
+    return bulkhead == nullptr && settings_.max_concurrent_handlers > 0 &&
+           default_stats_->admitted.load(std::memory_order_relaxed) >=
+               static_cast<int64_t>(settings_.max_concurrent_handlers);
+}
+
+void Server::shed_default(int fd, const std::shared_ptr<Net::Connection>& conn, bool head) {
+    metrics_.load_shed_total.fetch_add(1, std::memory_order_relaxed);
+    default_stats_->shed.fetch_add(1, std::memory_order_relaxed);
+    metrics_.record_status(503);
+    conn->set_canned_response(*canned_.find(Http::HttpStatus::SERVICE_UNAVAILABLE), head);
+    rearm(fd, /*read=*/false);
+}
+
+void Server::shed_pending(Bulkhead::Pending& pending) {
+    const Http::CannedResponse& canned = *canned_.find(Http::HttpStatus::SERVICE_UNAVAILABLE);
+    const bool head = pending.request->method() == Http::HttpMethod::HEAD;
+    if (pending.flight != 0) {
+        finish_flight(CompletedResponse{pending.fd, pending.conn, {}, &canned, head, pending.flight, nullptr});
+    }
+    auto it = connections_.find(pending.fd);
+    if (it == connections_.end() || it->second != pending.conn || !pending.conn->is_open()) return;
+    metrics_.load_shed_total.fetch_add(1, std::memory_order_relaxed);
+    metrics_.record_status(503);
+    pending.conn->worker_in_flight_ = false;
+    pending.conn->set_canned_response(canned, head);
+    rearm(pending.fd, /*read=*/false);
+}
+
+DeferredResponse Server::defer(Http::HttpResponse& res) {
+    HandlerContext* context = t_handler;
+    if (context == nullptr || context->response != &res || context->deferred) {
+        throw std::logic_error("Server::defer() must be called once, by the handler running with this response");
+    }
+    context->deferred = true;
+    auto state = std::make_shared<DeferredResponse::State>();
+    state->server = this;
+    state->fd = context->fd;
+    state->conn = *context->conn;
+    if (context->request != nullptr) {
+        state->request = *context->request;
+    } else {
+        // Inline run: the request is views into the read buffer, consumed once
+        // the handler returns. Own the bytes (the path parameters move along).
+        const Net::Connection& conn = **context->conn;
+        auto request = std::make_shared<Http::HttpRequest>(conn.current_request_);
+        request->make_owned(conn.read_buffer_.data(), context->consumed);
+        state->request = std::move(request);
+    }
+    state->start = context->start;
+    state->flight = context->flight;
+    state->bulkhead = context->bulkhead;
+    state->revalidation = context->revalidation;
+    // Take over the handler's response (middleware headers, body format); the
+    // handler is left a reset one that nothing reads.
+    const int worker = WorkStealingPool::current_worker_index();
+    const bool own_worker = worker >= 0 && static_cast<size_t>(worker) < response_pools_.size();
+    state->response = context->bulkhead
+                          ? context->bulkhead->response_pool(worker).acquire()
+                          : response_pools_[own_worker ? static_cast<size_t>(worker) : 0]->acquire();
+    std::swap(*state->response, res);
+    metrics_.deferred_total.fetch_add(1, std::memory_order_relaxed);
+    metrics_.deferred_pending.fetch_add(1, std::memory_order_relaxed);
+    return DeferredResponse(std::move(state));
+}
+
+bool Server::complete_deferred(DeferredResponse::State& state,
+                               const std::function<void(Http::HttpResponse&)>& fill) {
+    if (state.done.exchange(true, std::memory_order_acq_rel)) return false;
+    metrics_.deferred_pending.fetch_sub(1, std::memory_order_relaxed);
+
+    // Filled on top of the handler's response: what the middlewares set stays.
+    Http::HttpResponsePool::Handle res_handle = std::move(state.response);
+    Http::HttpResponse& res = *res_handle;
+    try {
+        fill(res);
+    } catch (const std::exception& e) {
+        ORE_LOG(ERROR) << "Deferred response exception: " << e.what();
+        nlohmann::json err;
+        err["error"] = "Server error";
+        res.status(Http::HttpStatus::INTERNAL_SERVER_ERROR).json(err);
+    } catch (...) {
+        ORE_LOG(ERROR) << "Deferred response exception (unknown type)";
+        nlohmann::json err;
+        err["error"] = "Server error";
+        res.status(Http::HttpStatus::INTERNAL_SERVER_ERROR).json(err);
+    }
+    if (state.revalidation) {
+        finish_revalidation(*state.request, res);
+        return true;
+    }
+    finish_response(state.fd, state.conn, *state.request, std::move(res_handle), state.start, state.flight);
+    return true;
+}
+
+void Server::finish_response(int fd, const std::shared_ptr<Net::Connection>& conn, Http::HttpRequest& request,
+                             Http::HttpResponsePool::Handle res_handle,
+                             std::chrono::steady_clock::time_point t_start, std::uint64_t flight) {
+    std::shared_ptr<const Http::CannedResponse> shared = finalize_response(request, *res_handle, t_start, flight);
+    {
+        std::lock_guard<std::mutex> lock(completed_mutex_);
+        completed_.push(CompletedResponse{fd, conn, std::move(res_handle), nullptr, false, flight,
+                                          std::move(shared)});
+    }
+    notify_event_loop();
+}
+
+std::shared_ptr<const Http::CannedResponse> Server::finalize_response(Http::HttpRequest& request,
+                                                                      Http::HttpResponse& res,
+                                                                      std::chrono::steady_clock::time_point t_start,
+                                                                      std::uint64_t flight) {
+    // Validate (and possibly answer 304) on the identity body, then
+    // compress the (string) body if negotiated, before HEAD suppression
+    // so Content-Length matches what an equivalent GET would send.
+    const CompressionSetup compression{compression_min_bytes_, compression_brotli_, compression_zstd_,
+                                       compression_cache_.get(), compression_controller_.get(), metrics_};
+    if (auto_etag_enabled_) apply_string_etag(request, res, compression_enabled_ ? &compression : nullptr);
+    if (compression_enabled_) maybe_compress(request, res, compression);
+    // Keep it for later requests if the handler allowed it (encoded, as
+    // sent: Vary covers the negotiation).
+    if (response_cache_) response_cache_->store(request, res);
+    // Followers of this request's flight get the same bytes, shared, unless
+    // the response is meant for this client only.
+    std::shared_ptr<const Http::CannedResponse> shared;
+    if (flight != 0 && !res.is_file() && ResponseCache::shareable(res)) {
+        shared = std::make_shared<const Http::CannedResponse>(res);
+    }
+
+    // Apply request-driven response semantics (Range for file responses,
+    // HEAD body suppression) before handing the response back.
+    apply_http_semantics(request, res);
+
+    // Record metrics for this request (atomic; safe off the loop thread).
+    metrics_.record_status(static_cast<int>(res.get_status()));
+    metrics_.observe_duration(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    return shared;
+}
+
 bool Server::drive_tls_handshake(int fd, const std::shared_ptr<Net::Connection>& conn) {
     int r = conn->continue_tls_handshake();
     if (r == 1) return true; // Handshake complete; caller proceeds with I/O.
@@ -944,13 +1918,34 @@ void Server::handle_write_ready(int fd) {
         return;
     }
 
+    // File bodies are timed: a page-cache miss blocks the loop in sendfile().
+    const bool file_body = conn->file_ != nullptr && !conn->head_only_;
+    const auto write_started = file_body ? std::chrono::steady_clock::now()
+                                         : std::chrono::steady_clock::time_point{};
     ssize_t bytes_written = conn->write_data();
+    if (file_body) {
+        const auto elapsed = std::chrono::steady_clock::now() - write_started;
+        metrics_.file_send_ns.fetch_add(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+            std::memory_order_relaxed);
+        metrics_.file_send_calls.fetch_add(1, std::memory_order_relaxed);
+        if (readahead_ && bytes_written > 0) readahead_->advance(fd, conn->file_offset_);
+    }
     if (bytes_written < 0) {
         close_connection(fd);
         return;
     }
 
+    // Keep the spare buffer of an asynchronous file read filling.
+    if (conn->wants_file_read()) submit_file_read(fd, conn);
+
     if (conn->has_data_to_write()) {
+        if (conn->waiting_for_file_read()) {
+            // Nothing to send until the disk answers; the read's completion
+            // resumes the write (process_file_reads()).
+            metrics_.async_file_read_stalls.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
         rearm(fd, /*read=*/false); // More to send.
         return;
     }
@@ -982,6 +1977,7 @@ void Server::close_connection(int fd) {
 
     std::shared_ptr<Net::Connection> conn = std::move(it->second);
     connections_.erase(it);
+    if (readahead_) readahead_->forget(fd);
     metrics_.connections_active.fetch_sub(1, std::memory_order_relaxed);
     // Close the socket now. If a worker still holds a shared_ptr, the object
     // stays alive but its fd is already closed (is_open() == false), so the
@@ -1002,34 +1998,68 @@ void Server::stop_accepting() {
     listen_fd_ = -1;
 }
 
-void Server::send_minimal_response(int fd, const char* bytes, size_t len) {
+void Server::send_minimal_response(int fd, const Http::CannedResponse& canned) {
     auto it = connections_.find(fd);
     if (it == connections_.end() || !it->second->is_open()) return;
     const auto& conn = it->second;
+    const auto parts = canned.segments(Utils::http_date_now(), /*head_only=*/false);
     if (conn->uses_tls()) {
         // Only meaningful once the TLS session exists; otherwise just close.
         if (conn->tls_handshake_done()) {
-            SSL_write(conn->ssl_, bytes, static_cast<int>(len)); // best-effort over TLS
+            for (const std::string_view& part : parts) { // best-effort over TLS
+                if (SSL_write(conn->ssl_, part.data(), static_cast<int>(part.size())) <= 0) break;
+            }
         }
     } else {
-        ::send(conn->socket_fd_, bytes, len, MSG_NOSIGNAL); // best-effort
+        iovec iov[3];
+        for (size_t i = 0; i < parts.size(); ++i) {
+            iov[i].iov_base = const_cast<char*>(parts[i].data());
+            iov[i].iov_len = parts[i].size();
+        }
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = parts.size();
+        ::sendmsg(conn->socket_fd_, &msg, MSG_NOSIGNAL); // best-effort
     }
 }
 
 void Server::send_request_timeout(int fd) {
-    static const char k408[] =
-        "HTTP/1.1 408 Request Timeout\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
-    send_minimal_response(fd, k408, sizeof(k408) - 1);
+    send_minimal_response(fd, *canned_.find(Http::HttpStatus::REQUEST_TIMEOUT));
 }
 
 void Server::send_handler_timeout(int fd) {
-    static const char k504[] =
-        "HTTP/1.1 504 Gateway Timeout\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
-    send_minimal_response(fd, k504, sizeof(k504) - 1);
+    send_minimal_response(fd, *canned_.find(Http::HttpStatus::GATEWAY_TIMEOUT));
 }
 
 void Server::enforce_timeouts() {
     const auto now = std::chrono::steady_clock::now();
+
+    // Single-flight followers whose flight outlived its timeout: 504 (no
+    // worker holds them, so nothing else needs tearing down).
+    if (coalescer_.size() > 0) {
+        for (RequestCoalescer::Waiter& waiter : coalescer_.expire(now)) {
+            auto it = connections_.find(waiter.fd);
+            if (it == connections_.end() || it->second != waiter.conn || !waiter.conn->is_open()) continue;
+            metrics_.coalesce_timeouts.fetch_add(1, std::memory_order_relaxed);
+            metrics_.record_status(504);
+            waiter.conn->set_canned_response(*canned_.find(Http::HttpStatus::GATEWAY_TIMEOUT), waiter.head_only);
+            rearm(waiter.fd, /*read=*/false);
+        }
+        metrics_.coalesce_waiting.store(static_cast<int64_t>(coalescer_.waiting()), std::memory_order_relaxed);
+    }
+
+    // Bulkhead requests queued past max_queue_wait: 503.
+    drain_bulkheads();
+
+    // LL-HLS blocking reloads the playlist did not satisfy in time: the worker
+    // answers 503 (or the playlist, if it has just caught up).
+    for (HlsMount& mount : hls_mounts_) {
+        if (mount.origin->waiting() == 0) continue;
+        std::vector<HlsOrigin::Waiter> expired = mount.origin->expire(now);
+        metrics_.hls_block_timeouts.fetch_add(expired.size(), std::memory_order_relaxed);
+        resume_hls(std::move(expired));
+    }
+
     // Collect first, mutate after: close_connection() erases from connections_.
     std::vector<int> read_timeouts;     // -> 408
     std::vector<int> handler_timeouts;  // -> 504
@@ -0,0 +1,245 @@
+// oreshnek/src/server/StaticFiles.cpp
+#include "oreshnek/server/StaticFiles.h"
+#include "oreshnek/http/Compression.h"
+#include "oreshnek/http/MimeTypes.h"
+#include "oreshnek/utils/Logger.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>    // For realpath, free
+#include <cstring>    // For strerror
+#include <fcntl.h>    // For openat, O_* flags
+#include <stdexcept>
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close
+#ifdef __linux__
+#include <linux/openat2.h> // For struct open_how, RESOLVE_*
+#include <sys/syscall.h>   // For SYS_openat2
+#endif
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+// Flags for the file itself: O_NONBLOCK so a FIFO planted in the tree cannot
+// block the worker in open() (it is then rejected as not a regular file).
+constexpr int kFileFlags = O_RDONLY | O_NONBLOCK | O_CLOEXEC | O_NOFOLLOW;
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Percent-decode `relative` and rebuild it from its non-empty segments.
+// Rejects "." / ".." (Forbidden), and NUL bytes, malformed escapes and (unless
+// allowed) dotfiles (NotFound).
+StaticLookup normalize(std::string_view relative, bool dotfiles, std::string& out) {
+    std::string decoded;
+    decoded.reserve(relative.size());
+    for (std::size_t i = 0; i < relative.size(); ++i) {
+        char c = relative[i];
+        if (c == '%') {
+            const int hi = i + 2 < relative.size() ? hex_value(relative[i + 1]) : -1;
+            const int lo = hi >= 0 ? hex_value(relative[i + 2]) : -1;
+            if (lo < 0) return StaticLookup::NotFound;
+            c = static_cast<char>(hi * 16 + lo);
+            i += 2;
+        }
+        if (c == '\0') return StaticLookup::NotFound;
+        decoded.push_back(c);
+    }
+
+    out.clear();
+    std::size_t pos = 0;
+    while (pos <= decoded.size()) {
+        std::size_t end = decoded.find('/', pos);
+        if (end == std::string::npos) end = decoded.size();
+        const std::string_view segment(decoded.data() + pos, end - pos);
+        pos = end + 1;
+        if (segment.empty()) continue;
+        if (segment == "." || segment == "..") return StaticLookup::Forbidden;
+        if (segment[0] == '.' && !dotfiles) return StaticLookup::NotFound;
+        if (!out.empty()) out += '/';
+        out += segment;
+    }
+    return StaticLookup::Found;
+}
+
+StaticLookup lookup_error(int err, const std::string& root, const std::string& relative) {
+    switch (err) {
+        case ENOENT:
+        case ENOTDIR:
+        case ENAMETOOLONG:
+            return StaticLookup::NotFound;
+        case ELOOP:  // A symlink (O_NOFOLLOW / RESOLVE_NO_SYMLINKS)
+        case EXDEV:  // Resolution would leave the root (RESOLVE_BENEATH)
+        case EACCES:
+        case EPERM:
+            return StaticLookup::Forbidden;
+        default:
+            ORE_LOG(WARN) << "Static file '" << relative << "' under " << root << ": " << std::strerror(err);
+            return StaticLookup::NotFound;
+    }
+}
+
+#ifdef __linux__
+// Set once openat2() reports ENOSYS (kernel < 5.6 or a seccomp filter).
+std::atomic<bool> g_openat2_unavailable{false};
+#endif
+} // namespace
+
+StaticDirectory::StaticDirectory(const std::string& root, StaticOptions options, Metrics* metrics)
+    : root_(root), options_(std::move(options)) {
+    dir_fd_ = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd_ < 0) {
+        throw std::runtime_error("Cannot open static directory '" + root + "': " + std::strerror(errno));
+    }
+    // inotify watches take paths; resolve the root once so they do not depend
+    // on the working directory at lookup time.
+    if (char* real = ::realpath(root.c_str(), nullptr)) {
+        watch_root_ = real;
+        std::free(real);
+    } else {
+        watch_root_ = root;
+    }
+    if (options_.cache.max_entries > 0) cache_ = std::make_unique<FileCache>(options_.cache, metrics);
+}
+
+StaticDirectory::~StaticDirectory() {
+    if (dir_fd_ >= 0) ::close(dir_fd_);
+}
+
+int StaticDirectory::open_beneath(const std::string& relative) const {
+    if (relative.empty()) return ::openat(dir_fd_, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+#ifdef __linux__
+    if (!g_openat2_unavailable.load(std::memory_order_relaxed)) {
+        struct open_how how = {};
+        how.flags = kFileFlags;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS | RESOLVE_NO_MAGICLINKS;
+        const long fd = ::syscall(SYS_openat2, dir_fd_, relative.c_str(), &how, sizeof(how));
+        if (fd >= 0 || errno != ENOSYS) return static_cast<int>(fd);
+        g_openat2_unavailable.store(true, std::memory_order_relaxed);
+    }
+#endif
+
+    // Portable fallback: one openat(O_NOFOLLOW) per component. Segments are
+    // already free of "." and "..", so refusing symlinks keeps the walk inside.
+    // Intermediate components use the file flags too (no O_DIRECTORY, which
+    // would report a symlink as ENOTDIR); a non-directory fails the next step.
+    int dir = dir_fd_;
+    std::size_t pos = 0;
+    for (;;) {
+        const std::size_t slash = relative.find('/', pos);
+        const std::string segment = relative.substr(pos, slash == std::string::npos ? std::string::npos : slash - pos);
+        const bool last = slash == std::string::npos;
+        const int next = ::openat(dir, segment.c_str(), kFileFlags);
+        const int err = errno;
+        if (dir != dir_fd_) ::close(dir);
+        if (next < 0 || last) {
+            errno = err;
+            return next;
+        }
+        dir = next;
+        pos = slash + 1;
+    }
+}
+
+FileCache::Result StaticDirectory::open(std::string_view relative) const {
+    if (!cache_) {
+        FileCache::Watch none;
+        return resolve(relative, none);
+    }
+    return cache_->get(relative, [&](FileCache::Watch& watch) { return resolve(relative, watch); });
+}
+
+FileCache::Result StaticDirectory::resolve(std::string_view relative, FileCache::Watch& watch) const {
+    FileCache::Result result;
+    std::string normalized;
+    result.status = normalize(relative, options_.dotfiles, normalized);
+    if (result.status != StaticLookup::Found) return result;
+
+    // The entry is invalidated by changes to its name in the directory
+    // holding it (for a directory request: to the index in the directory).
+    // Watched before anything is opened.
+    const std::size_t slash = normalized.find_last_of('/');
+    if (slash == std::string::npos) {
+        watch.add(watch_root_, normalized);
+    } else {
+        watch.add(watch_root_ + "/" + normalized.substr(0, slash), normalized.substr(slash + 1));
+    }
+
+    int fd = open_beneath(normalized);
+    if (fd < 0) {
+        result.status = lookup_error(errno, root_, normalized);
+        return result;
+    }
+    std::string_view name = normalized;
+    std::string path = normalized; // Of the file actually served, for its sidecars
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISDIR(st.st_mode)) {
+        const Utils::FileHandle dir(fd);
+        if (!relative.empty() && relative.back() != '/') {
+            result.status = StaticLookup::Directory;
+            return result;
+        }
+        if (options_.index.empty()) {
+            result.status = StaticLookup::NotFound;
+            return result;
+        }
+        watch.add(normalized.empty() ? watch_root_ : watch_root_ + "/" + normalized, options_.index);
+        fd = ::openat(dir.fd(), options_.index.c_str(), kFileFlags);
+        if (fd < 0) {
+            result.status = lookup_error(errno, root_, normalized + "/" + options_.index);
+            return result;
+        }
+        name = options_.index;
+        path = normalized.empty() ? options_.index : normalized + "/" + options_.index;
+    }
+    const std::string_view content_type = Http::mime_type(name);
+    Http::FileSidecars sidecars;
+    if (options_.precompressed && Http::is_compressible_type(content_type)) {
+        // Resolved like the file itself: a symlinked sidecar is not followed.
+        sidecars.gzip_fd = open_beneath(path + ".gz");
+        sidecars.brotli_fd = open_beneath(path + ".br");
+    }
+    // Non-regular files (FIFOs, devices) are refused here. Small files are only
+    // read into memory when the result is going to be cached.
+    result.file = Http::FileEntry::from_fd(fd, content_type, cache_ ? options_.cache.memory_max_file : 0,
+                                           sidecars);
+    result.status = result.file ? StaticLookup::Found : StaticLookup::NotFound;
+    return result;
+}
+
+void StaticDirectory::serve(const Http::HttpRequest& req, std::string_view relative,
+                            Http::HttpResponse& res) const {
+    // "/static" (the mount point itself) behaves like a directory without its
+    // trailing slash.
+    FileCache::Result found;
+    if (relative.empty() && req.path().back() != '/') found.status = StaticLookup::Directory;
+    else found = open(relative);
+    switch (found.status) {
+        case StaticLookup::Found:
+            res.status(Http::HttpStatus::OK).file(std::move(found.file));
+            if (!options_.cache_control.empty()) res.header("Cache-Control", options_.cache_control);
+            return;
+        case StaticLookup::Directory: {
+            // Redirect so relative links inside the index resolve against the
+            // directory.
+            std::string location(req.path());
+            location += '/';
+            res.status(Http::HttpStatus::MOVED_PERMANENTLY).header("Location", location).text("Moved Permanently");
+            return;
+        }
+        case StaticLookup::Forbidden:
+            res.status(Http::HttpStatus::FORBIDDEN).text("Forbidden");
+            return;
+        case StaticLookup::NotFound:
+            res.status(Http::HttpStatus::NOT_FOUND).text("Not Found");
+            return;
+    }
+}
+
+} // namespace Server
+} // namespace Oreshnek
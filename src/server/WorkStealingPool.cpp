@@ -0,0 +1,364 @@
+// oreshnek/src/server/WorkStealingPool.cpp
+#include "oreshnek/server/WorkStealingPool.h"
+#include "oreshnek/utils/Logger.h"
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+namespace Oreshnek {
+namespace Server {
+
+namespace {
+thread_local const WorkStealingPool* t_pool = nullptr;
+thread_local int t_worker_index = -1;
+
+constexpr std::size_t kCacheLine = 64;
+constexpr std::size_t kInitialDequeCapacity = 256;
+constexpr int kPauseRounds = 64; // Searches with a CPU pause between them...
+constexpr int kYieldRounds = 16; // ...then with a yield, before parking
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+std::size_t round_up_pow2(std::size_t n) {
+    std::size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// xorshift64: picks the first steal victim.
+inline std::uint64_t next_random(std::uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+}  // namespace
+
+// Chase–Lev work-stealing deque (Lê et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", PPoPP'13), with the fences folded into
+// seq_cst accesses. Only the owning worker pushes and pops; any thread steals.
+// A grown ring replaces the current one, but retired rings are kept until the
+// pool is destroyed, since a thief may still be reading one.
+struct WorkStealingPool::Worker {
+    struct Ring {
+        explicit Ring(std::size_t capacity)
+            : mask(capacity - 1), slots(new std::atomic<WorkItem*>[capacity]) {}
+        WorkItem* get(std::int64_t i) const {
+            return slots[static_cast<std::size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+        void put(std::int64_t i, WorkItem* item) {
+            slots[static_cast<std::size_t>(i) & mask].store(item, std::memory_order_relaxed);
+        }
+        std::size_t mask;
+        std::unique_ptr<std::atomic<WorkItem*>[]> slots;
+    };
+
+    Worker() {
+        rings.push_back(std::make_unique<Ring>(kInitialDequeCapacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(WorkItem* item) {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_acquire);
+        Ring* r = ring.load(std::memory_order_relaxed);
+        if (b - t > static_cast<std::int64_t>(r->mask)) r = grow(r, t, b);
+        r->put(b, item);
+        // seq_cst (not just release): a worker about to park must either see
+        // this item or be seen asleep by submit() (see run_worker).
+        bottom.store(b + 1, std::memory_order_seq_cst);
+    }
+
+    WorkItem* pop() {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) { // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        WorkItem* item = r->get(b);
+        if (t == b) { // The last item: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    WorkItem* steal() {
+        std::int64_t t = top.load(std::memory_order_seq_cst);
+        const std::int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b) return nullptr;
+        WorkItem* item = ring.load(std::memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr; // Lost to the owner or another thief
+        }
+        return item;
+    }
+
+    std::size_t size() const {
+        const std::int64_t n = bottom.load(std::memory_order_seq_cst) - top.load(std::memory_order_seq_cst);
+        return n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+
+    Ring* grow(Ring* old, std::int64_t t, std::int64_t b) {
+        auto bigger = std::make_unique<Ring>((old->mask + 1) * 2);
+        for (std::int64_t i = t; i < b; ++i) bigger->put(i, old->get(i));
+        Ring* r = bigger.get();
+        rings.push_back(std::move(bigger));
+        ring.store(r, std::memory_order_release);
+        return r;
+    }
+
+    alignas(kCacheLine) std::atomic<std::int64_t> top{0};
+    alignas(kCacheLine) std::atomic<std::int64_t> bottom{0};
+    std::atomic<Ring*> ring{nullptr};
+    std::vector<std::unique_ptr<Ring>> rings; // Owner only
+};
+
+// Bounded MPMC queue (Vyukov): producers and consumers each claim a slot with
+// one CAS and hand it over through the slot's sequence number. When the ring is
+// full, items go to a locked overflow list, and keep going there until it has
+// drained, so the queue stays FIFO.
+class WorkStealingPool::InjectionQueue {
+public:
+    explicit InjectionQueue(std::size_t capacity)
+        : mask_(round_up_pow2(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (std::size_t i = 0; i <= mask_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    void push(WorkItem* item) {
+        if (overflow_size_.load(std::memory_order_acquire) == 0 && try_push(item)) return;
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        overflow_.push_back(item);
+        overflow_size_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    WorkItem* pop() {
+        if (WorkItem* item = try_pop()) return item;
+        if (overflow_size_.load(std::memory_order_acquire) == 0) return nullptr;
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        if (overflow_.empty()) return nullptr;
+        WorkItem* item = overflow_.front();
+        overflow_.pop_front();
+        overflow_size_.fetch_sub(1, std::memory_order_release);
+        return item;
+    }
+
+    std::size_t size() const {
+        const std::size_t enq = enqueue_pos_.load(std::memory_order_seq_cst);
+        const std::size_t deq = dequeue_pos_.load(std::memory_order_seq_cst);
+        return (enq > deq ? enq - deq : 0) + overflow_size_.load(std::memory_order_seq_cst);
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        WorkItem* item;
+    };
+
+    bool try_push(WorkItem* item) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                // seq_cst claim: pairs with the parking check in run_worker.
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst,
+                                                       std::memory_order_relaxed)) {
+                    cell.item = item;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    WorkItem* try_pop() {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed,
+                                                       std::memory_order_relaxed)) {
+                    WorkItem* item = cell.item;
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return item;
+                }
+            } else if (diff < 0) {
+                return nullptr; // Empty (or the producer has not published yet)
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(kCacheLine) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(kCacheLine) std::atomic<std::size_t> dequeue_pos_{0};
+    alignas(kCacheLine) std::atomic<std::size_t> overflow_size_{0};
+    std::mutex overflow_mutex_;
+    std::deque<WorkItem*> overflow_;
+};
+
+void WorkStealingPool::run_task(WorkItem* item) {
+    std::unique_ptr<WorkItem> task(item);
+    try {
+        (*task)();
+    } catch (const std::exception& e) {
+        ORE_LOG(ERROR) << "Uncaught exception in pool task: " << e.what();
+    } catch (...) {
+        ORE_LOG(ERROR) << "Uncaught non-standard exception in pool task";
+    }
+}
+
+int WorkStealingPool::current_worker_index() {
+    return t_worker_index;
+}
+
+WorkStealingPool::WorkStealingPool(std::size_t threads, std::size_t injection_capacity)
+    : injection_(std::make_unique<InjectionQueue>(injection_capacity)) {
+    if (threads == 0) {
+        threads = 1; // At least one thread
+    }
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) workers_.push_back(std::make_unique<Worker>());
+    threads_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i] { run_worker(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    shutdown();
+}
+
+void WorkStealingPool::submit(WorkItem* item) {
+    std::unique_ptr<WorkItem> owned(item);
+    if (stop_.load(std::memory_order_acquire)) {
+        throw std::runtime_error("post on stopped WorkStealingPool");
+    }
+    if (t_pool == this) {
+        workers_[static_cast<std::size_t>(t_worker_index)]->push(owned.release());
+    } else {
+        injection_->push(owned.release());
+    }
+    // Only pay for a wake-up when a worker is actually parked; spinning workers
+    // pick the task up on their own.
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) wake_one();
+}
+
+void WorkStealingPool::wake_one() {
+    wake_epoch_.fetch_add(1, std::memory_order_release);
+    wake_epoch_.notify_one();
+}
+
+WorkItem* WorkStealingPool::find_work(std::size_t index, std::uint64_t& rng) {
+    if (WorkItem* item = workers_[index]->pop()) return item;
+    if (WorkItem* item = injection_->pop()) return item;
+    const std::size_t n = workers_.size();
+    if (n > 1) {
+        const std::size_t start = static_cast<std::size_t>(next_random(rng) % n);
+        for (std::size_t k = 0; k < n; ++k) {
+            const std::size_t victim = (start + k) % n;
+            if (victim == index) continue;
+            if (WorkItem* item = workers_[victim]->steal()) {
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return item;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool WorkStealingPool::has_work() const {
+    if (injection_->size() > 0) return true;
+    for (const auto& worker : workers_) {
+        if (worker->size() > 0) return true;
+    }
+    return false;
+}
+
+std::size_t WorkStealingPool::queue_depth() const {
+    std::size_t depth = injection_->size();
+    for (const auto& worker : workers_) depth += worker->size();
+    return depth;
+}
+
+void WorkStealingPool::run_worker(std::size_t index) {
+    t_pool = this;
+    t_worker_index = static_cast<int>(index);
+    std::uint64_t rng = 0x9E3779B97F4A7C15ull * (index + 1);
+
+    for (;;) {
+        WorkItem* item = find_work(index, rng);
+        for (int round = 0; !item && round < kPauseRounds + kYieldRounds; ++round) {
+            if (round < kPauseRounds) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+            item = find_work(index, rng);
+        }
+
+        if (!item) {
+            if (stop_.load(std::memory_order_acquire)) {
+                if (has_work()) continue; // Drain before exiting
+                return;
+            }
+            // Park. Announcing ourselves before the last look pairs with
+            // submit(), which publishes its task before checking sleepers_:
+            // either it sees us asleep and bumps the epoch, or we see its task.
+            const std::uint32_t epoch = wake_epoch_.load(std::memory_order_acquire);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            if (!has_work() && !stop_.load(std::memory_order_seq_cst)) {
+                wake_epoch_.wait(epoch, std::memory_order_acquire);
+            }
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        run_task(item);
+    }
+}
+
+void WorkStealingPool::shutdown() {
+    if (stop_.exchange(true, std::memory_order_seq_cst)) return;
+    wake_epoch_.fetch_add(1, std::memory_order_release);
+    wake_epoch_.notify_all(); // Wake up all parked workers
+
+    for (std::thread& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join(); // Each drains the queues before exiting
+        }
+    }
+    // A post() that raced with stop_ may have landed after the workers left.
+    while (WorkItem* item = injection_->pop()) run_task(item);
+    for (const auto& worker : workers_) {
+        while (WorkItem* item = worker->steal()) run_task(item);
+    }
+    ORE_LOG(INFO) << "WorkStealingPool shutdown complete.";
+}
+
+} // namespace Server
+} // namespace Oreshnek
@@ -0,0 +1,55 @@
+// oreshnek/src/utils/Hash.cpp
+#include "oreshnek/utils/Hash.h"
+
+#include <cstring>
+
+namespace Oreshnek {
+namespace Utils {
+
+namespace {
+constexpr std::uint64_t kP0 = 0xa0761d6478bd642fULL;
+constexpr std::uint64_t kP1 = 0xe7037ed1a0b428dbULL;
+constexpr std::uint64_t kP2 = 0x8ebc6af09c88c6e3ULL;
+constexpr std::uint64_t kP3 = 0x589965cc75374cc3ULL;
+
+__extension__ typedef unsigned __int128 u128; // GCC/Clang builtin
+
+// 64x64 -> 128-bit multiply, folded.
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+    const u128 r = static_cast<u128>(a) * b;
+    return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+}
+
+inline std::uint64_t read64(const unsigned char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+} // namespace
+
+std::uint64_t hash64(std::string_view data, std::uint64_t seed) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    std::size_t n = data.size();
+    std::uint64_t a = seed ^ kP0;
+    std::uint64_t b = seed ^ kP2;
+
+    // Two independent lanes per 32 bytes keep the multiplier busy.
+    while (n >= 32) {
+        a = mix(read64(p) ^ kP1, read64(p + 8) ^ a);
+        b = mix(read64(p + 16) ^ kP3, read64(p + 24) ^ b);
+        p += 32;
+        n -= 32;
+    }
+    std::uint64_t h = a ^ b;
+    while (n >= 8) {
+        h = mix(read64(p) ^ kP1, h ^ kP0);
+        p += 8;
+        n -= 8;
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, p, n);
+    return mix(kP1 ^ static_cast<std::uint64_t>(data.size()), mix(tail ^ kP2, h ^ kP3));
+}
+
+}  // namespace Utils
+}  // namespace Oreshnek
@@ -0,0 +1,19 @@
+// oreshnek/src/utils/StringUtil.cpp
+#include "oreshnek/utils/StringUtil.h"
+#include <strings.h> // For strncasecmp
+
+namespace Oreshnek {
+namespace Utils {
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+}  // namespace Utils
+}  // namespace Oreshnek
@@ -0,0 +1,44 @@
+// oreshnek/src/utils/TimeUtil.cpp
+#include "oreshnek/utils/TimeUtil.h"
+
+#include <cstdio>
+#include <ctime>
+
+namespace Oreshnek {
+namespace Utils {
+
+namespace {
+// IMF-fixdate of `t` into `buf` with fixed English names (strftime's %a/%b
+// follow LC_TIME and can change the length); returns the length written.
+std::size_t format_http_date(std::time_t t, char* buf, std::size_t size) {
+    static const char* kDays[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char* kMonths[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    struct tm tm{};
+    gmtime_r(&t, &tm);
+    const int n = std::snprintf(buf, size, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                                kDays[tm.tm_wday], tm.tm_mday, kMonths[tm.tm_mon], tm.tm_year + 1900,
+                                tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return n > 0 ? static_cast<std::size_t>(n) : 0;
+}
+}  // namespace
+
+std::string_view http_date_now() {
+    thread_local time_t cached_at = static_cast<time_t>(-1);
+    thread_local char cached[40];
+    thread_local std::size_t cached_len = 0;
+    const time_t now = time(nullptr);
+    if (now != cached_at) {
+        cached_len = format_http_date(now, cached, sizeof(cached));
+        cached_at = now;
+    }
+    return std::string_view(cached, cached_len);
+}
+
+std::string http_date(std::time_t t) {
+    char buf[40];
+    return std::string(buf, format_http_date(t, buf, sizeof(buf)));
+}
+
+}  // namespace Utils
+}  // namespace Oreshnek
@@ -0,0 +1,119 @@
+// tests/TestClient.h
+//
+// Minimal blocking HTTP/1.1 client for the server tests: writes raw requests
+// to 127.0.0.1:<port> and reads each response by its Content-Length (no body
+// after a HEAD), so keep-alive and pipelined exchanges stay in step.
+
+#ifndef ORESHNEK_TESTS_TESTCLIENT_H
+#define ORESHNEK_TESTS_TESTCLIENT_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+class TestClient {
+public:
+    struct Response {
+        int status = 0;      // 0: no response
+        std::string headers; // Raw header block, lowercased for matching
+        std::string body;
+
+        bool has(const std::string& needle) const { return headers.find(needle) != std::string::npos; }
+        // Value of header `name` (lowercase), or "" if absent.
+        std::string header(const std::string& name) const {
+            size_t p = headers.find(name + ": ");
+            if (p == std::string::npos) return "";
+            p += name.size() + 2;
+            return headers.substr(p, headers.find("\r\n", p) - p);
+        }
+    };
+
+    explicit TestClient(int port, int timeout_sec = 8) : port_(port), timeout_sec_(timeout_sec) {}
+
+    static std::string request(const std::string& method, const std::string& target,
+                               const std::string& extra_headers = "") {
+        return method + " " + target + " HTTP/1.1\r\nHost: x\r\n" + extra_headers + "\r\n";
+    }
+
+    // `requests` sent back to back on one connection; one response read per
+    // request (stops at the first without a status line).
+    std::vector<Response> exchange(const std::vector<std::string>& requests) const {
+        std::vector<Response> out;
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return out;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port_));
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return out;
+        }
+        timeval tv{timeout_sec_, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        std::string all;
+        for (const std::string& request : requests) all += request;
+        ::send(fd, all.data(), all.size(), 0);
+
+        std::string raw;
+        char buf[8192];
+        for (const std::string& request : requests) {
+            const bool head = request.rfind("HEAD ", 0) == 0;
+            Response r;
+            size_t hdr_end = std::string::npos;
+            long clen = 0;
+            for (;;) {
+                if (hdr_end == std::string::npos) {
+                    hdr_end = raw.find("\r\n\r\n");
+                    if (hdr_end != std::string::npos) {
+                        r.headers = raw.substr(0, hdr_end + 2);
+                        for (char& c : r.headers) c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+                        if (r.headers.size() > 12) r.status = std::atoi(r.headers.c_str() + 9);
+                        clen = head ? 0 : std::max(0L, content_length_of(r.headers));
+                    }
+                }
+                if (hdr_end != std::string::npos && raw.size() >= hdr_end + 4 + static_cast<size_t>(clen)) {
+                    r.body = raw.substr(hdr_end + 4, static_cast<size_t>(clen));
+                    raw.erase(0, hdr_end + 4 + static_cast<size_t>(clen));
+                    break;
+                }
+                ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) break;
+                raw.append(buf, static_cast<size_t>(n));
+            }
+            out.push_back(r);
+            if (r.status == 0) break;
+        }
+        ::close(fd);
+        return out;
+    }
+
+    // One request -> one response, on its own connection.
+    Response round_trip(const std::string& request) const {
+        std::vector<Response> out = exchange({request});
+        return out.empty() ? Response{} : out[0];
+    }
+
+    Response get(const std::string& target, const std::string& extra_headers = "") const {
+        return round_trip(request("GET", target, extra_headers));
+    }
+
+private:
+    static long content_length_of(const std::string& headers_lower) {
+        size_t p = headers_lower.find("content-length:");
+        if (p == std::string::npos) return -1;
+        return std::strtol(headers_lower.c_str() + p + 15, nullptr, 10);
+    }
+
+    int port_;
+    int timeout_sec_;
+};
+
+#endif // ORESHNEK_TESTS_TESTCLIENT_H
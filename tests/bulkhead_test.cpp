@@ -0,0 +1,226 @@
+// tests/bulkhead_test.cpp
+//
+// Bulkheads: a saturated pool (its one worker blocked, its queue full) sheds
+// its own routes with 503 while the default pool keeps serving the rest;
+// queued requests run once the worker frees; DropOldest answers the
+// longest-waiting request instead of the newcomer; max_queue_wait sheds a
+// request that waited too long; a coroutine route's continuations run on its
+// pool; per-pool metrics are rendered; routes naming an unknown pool are
+// refused.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/Bulkhead.h"
+#include "oreshnek/server/Task.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include "TestClient.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18103;
+
+using Resp = TestClient::Response;
+const TestClient client(kPort);
+
+// Handlers of a pool block until their gate opens.
+struct Gate {
+    std::atomic<bool> open{false};
+    void wait() const {
+        while (!open.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+};
+
+// Until `stats` has `running` handlers on workers and `waiting` queued.
+bool wait_for_pool(const Server::Metrics::PoolStats& stats, int64_t running, int64_t waiting) {
+    for (int i = 0; i < 500 && (stats.running.load() != running || stats.waiting.load() != waiting); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return stats.running.load() == running && stats.waiting.load() == waiting;
+}
+
+} // namespace
+
+int main() {
+    Server::Server server(2);
+
+    Server::BulkheadOptions db;
+    db.threads = 1;
+    db.max_queue = 1;
+    server.add_bulkhead("db", db);
+    Server::BulkheadOptions batch = db;
+    batch.shed = Server::ShedPolicy::DropOldest;
+    server.add_bulkhead("batch", batch);
+    Server::BulkheadOptions report = db;
+    report.max_queue = 4;
+    report.max_queue_wait = std::chrono::milliseconds(100);
+    server.add_bulkhead("report", report);
+    server.add_bulkhead("async", db);
+
+    {
+        bool threw = false;
+        try {
+            server.add_bulkhead("db", db);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "config: duplicate pool name refused");
+        threw = false;
+        Server::RouteOptions nowhere;
+        nowhere.pool = "nope";
+        try {
+            server.get("/nowhere", [](const Http::HttpRequest&, Http::HttpResponse&) {}, nowhere);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "config: route on an unknown pool refused");
+    }
+
+    Gate db_gate, batch_gate, report_gate;
+    auto blocking = [](Gate& gate) {
+        return [&gate](const Http::HttpRequest& req, Http::HttpResponse& res) {
+            gate.wait();
+            res.status(Http::HttpStatus::OK).text(std::string(req.param("id").value_or("?")));
+        };
+    };
+    auto on_pool = [](const char* name) {
+        Server::RouteOptions options;
+        options.pool = name;
+        return options;
+    };
+    server.get("/db/:id", blocking(db_gate), on_pool("db"));
+    server.get("/batch/:id", blocking(batch_gate), on_pool("batch"));
+    server.get("/report/:id", blocking(report_gate), on_pool("report"));
+    // One thread in "async": every step of the coroutine runs on it.
+    Server::CoroutineScheduler& scheduler = server.scheduler();
+    server.get("/async", [&scheduler](const Http::HttpRequest&, Http::HttpResponse& res) -> Server::Task<void> {
+        const std::thread::id started = std::this_thread::get_id();
+        co_await scheduler.sleep_for(std::chrono::milliseconds(20));
+        const std::thread::id slept = std::this_thread::get_id();
+        co_await scheduler.offload([] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+        const bool same = slept == started && std::this_thread::get_id() == started;
+        res.status(Http::HttpStatus::OK).text(same ? "same" : "moved");
+    }, on_pool("async"));
+    server.get("/health", [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).text("ok");
+    });
+
+    const Server::Metrics& m = server.metrics();
+    const Server::Metrics::PoolStats* db_stats = m.pool("db");
+    const Server::Metrics::PoolStats* batch_stats = m.pool("batch");
+    const Server::Metrics::PoolStats* report_stats = m.pool("report");
+    const Server::Metrics::PoolStats* default_stats = m.pool("default");
+    if (!db_stats || !batch_stats || !report_stats || !default_stats) {
+        std::cerr << "[FATAL] pool stats missing\n";
+        return 1;
+    }
+
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // 1) RejectNew: one running, one queued, the third is shed; the default
+    //    pool is untouched throughout.
+    {
+        Resp a, b;
+        std::thread ta([&a] { a = client.get("/db/a"); });
+        check(wait_for_pool(*db_stats, 1, 0), "reject: first request running");
+        std::thread tb([&b] { b = client.get("/db/b"); });
+        check(wait_for_pool(*db_stats, 1, 1), "reject: second request queued");
+        check(client.get("/db/c").status == 503, "reject: full pool sheds the newcomer");
+        for (int i = 0; i < 5; ++i) {
+            Resp health = client.get("/health");
+            check(health.status == 200 && health.body == "ok", "isolation: default pool still serves");
+        }
+        db_gate.open = true;
+        ta.join();
+        tb.join();
+        check(a.status == 200 && a.body == "a", "reject: running request answered");
+        check(b.status == 200 && b.body == "b", "reject: queued request ran once a worker freed");
+        check(db_stats->shed.load() == 1 && default_stats->shed.load() == 0, "reject: shed counted on its pool");
+    }
+
+    // 2) DropOldest: the queued request is shed, the newcomer takes its place.
+    {
+        Resp a, b, c;
+        std::thread ta([&a] { a = client.get("/batch/a"); });
+        check(wait_for_pool(*batch_stats, 1, 0), "drop oldest: first request running");
+        std::thread tb([&b] { b = client.get("/batch/b"); });
+        check(wait_for_pool(*batch_stats, 1, 1), "drop oldest: second request queued");
+        std::thread tc([&c] { c = client.get("/batch/c"); });
+        tb.join();
+        check(b.status == 503, "drop oldest: longest-waiting request shed");
+        check(wait_for_pool(*batch_stats, 1, 1), "drop oldest: newcomer queued");
+        batch_gate.open = true;
+        ta.join();
+        tc.join();
+        check(a.status == 200 && c.status == 200 && c.body == "c", "drop oldest: newcomer ran");
+        check(batch_stats->shed.load() == 1, "drop oldest: shed counted");
+    }
+
+    // 3) max_queue_wait: a request queued past it is shed, not run.
+    {
+        Resp a, b;
+        std::thread ta([&a] { a = client.get("/report/a"); });
+        check(wait_for_pool(*report_stats, 1, 0), "queue wait: first request running");
+        std::thread tb([&b] { b = client.get("/report/b"); });
+        check(wait_for_pool(*report_stats, 1, 1), "queue wait: second request queued");
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        report_gate.open = true;
+        ta.join();
+        tb.join();
+        check(a.status == 200, "queue wait: running request answered");
+        check(b.status == 503, "queue wait: expired request shed");
+        check(report_stats->shed.load() == 1 && report_stats->waiting.load() == 0, "queue wait: shed counted");
+    }
+
+    // 4) A coroutine route resumes on its own pool, never on a default worker.
+    {
+        for (int i = 0; i < 3; ++i) {
+            Resp r = client.get("/async");
+            check(r.status == 200 && r.body == "same", "coroutine: resumed on its bulkhead's worker");
+        }
+    }
+
+    // 5) Metrics: every pool labelled, the finished handlers observed.
+    {
+        check(wait_for_pool(*db_stats, 0, 0) && db_stats->admitted.load() == 0, "metrics: db pool idle again");
+        check(db_stats->latency_count.load() == 2, "metrics: db latency observed per handler");
+        const std::string text = m.render();
+        check(text.find("oreshnek_pool_threads{pool=\"db\"} 1") != std::string::npos, "metrics: threads");
+        check(text.find("oreshnek_pool_threads{pool=\"default\"} 2") != std::string::npos, "metrics: default pool");
+        check(text.find("oreshnek_pool_in_flight{pool=\"db\"} 0") != std::string::npos, "metrics: in flight");
+        check(text.find("oreshnek_pool_queue_depth{pool=\"db\"} 0") != std::string::npos, "metrics: queue depth");
+        check(text.find("oreshnek_pool_shed_total{pool=\"batch\"} 1") != std::string::npos, "metrics: shed");
+        check(text.find("oreshnek_pool_latency_seconds_count{pool=\"db\"} 2") != std::string::npos,
+              "metrics: latency histogram");
+    }
+
+    server.request_stop();
+    loop.join();
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] bulkhead tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,223 @@
+// tests/coalesce_test.cpp
+//
+// Single-flight: identical concurrent GETs on a coalescing route run the
+// handler once and all get its response (HEAD included); distinct queries,
+// Authorization and routes without the option run on their own; a handler
+// error is shared; a response setting a cookie is not; followers of a flight that outlives coalesce_timeout get a
+// 504 while the leader still gets its response.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/RequestCoalescer.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include "TestClient.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18099;
+
+using Resp = TestClient::Response;
+const TestClient client(kPort);
+
+// `requests[i]` sent concurrently, each on its own connection.
+std::vector<Resp> concurrently(const std::vector<std::string>& requests) {
+    std::vector<Resp> out(requests.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        threads.emplace_back([&out, &requests, i] { out[i] = client.round_trip(requests[i]); });
+    }
+    for (auto& t : threads) t.join();
+    return out;
+}
+
+std::string get(const std::string& target, const std::string& extra_headers = "") {
+    return TestClient::request("GET", target, extra_headers);
+}
+
+void test_keys() {
+    Server::RouteOptions on;
+    on.coalesce = true;
+    on.coalesce_vary = {"Accept-Language"};
+
+    auto make = [](const std::string& raw_path, Http::HttpMethod method) {
+        Http::HttpRequest req;
+        req.method_ = method;
+        req.path_ = raw_path;
+        req.make_owned(raw_path.data(), raw_path.size());
+        return req;
+    };
+    Http::HttpRequest a = make("/v", Http::HttpMethod::GET);
+    Http::HttpRequest head = make("/v", Http::HttpMethod::HEAD);
+    Http::HttpRequest post = make("/v", Http::HttpMethod::POST);
+    check(!Server::RequestCoalescer::key(a, on).empty(), "key: GET coalesced");
+    check(Server::RequestCoalescer::key(a, on) == Server::RequestCoalescer::key(head, on), "key: HEAD shares GET");
+    check(Server::RequestCoalescer::key(post, on).empty(), "key: POST never coalesced");
+    check(Server::RequestCoalescer::key(a, Server::RouteOptions{}).empty(), "key: off unless the route opts in");
+
+    Server::RequestCoalescer coalescer;
+    const auto now = std::chrono::steady_clock::now();
+    check(!coalescer.join("k", {}), "join: nothing in flight");
+    const std::uint64_t id = coalescer.lead("k", now + std::chrono::seconds(1));
+    check(coalescer.join("k", {}) && coalescer.join("k", {}) && coalescer.waiting() == 2, "join: followers queued");
+    check(coalescer.expire(now).empty(), "expire: not yet");
+    check(coalescer.complete(id).size() == 2 && coalescer.waiting() == 0 && coalescer.size() == 0,
+          "complete: waiters handed back");
+    check(coalescer.complete(id).empty(), "complete: once");
+    coalescer.lead("k", now);
+    coalescer.join("k", {});
+    check(coalescer.expire(now + std::chrono::milliseconds(1)).size() == 1 && !coalescer.join("k", {}),
+          "expire: flight ended, key free");
+}
+
+} // namespace
+
+int main() {
+    test_keys();
+
+    std::atomic<int> live_calls{0};
+    std::atomic<int> plain_calls{0};
+    std::atomic<int> fail_calls{0};
+    std::atomic<int> slow_calls{0};
+    std::atomic<int> session_calls{0};
+
+    Server::Server server(4);
+    Server::RouteOptions coalesce;
+    coalesce.coalesce = true;
+    server.get("/live/:id", [&](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        const int n = ++live_calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        res.status(Http::HttpStatus::OK)
+            .text("live " + std::string(req.param("id").value_or("")) + " q=" +
+                  std::string(req.query("q").value_or("")) + " #" + std::to_string(n));
+    }, coalesce);
+    server.get("/plain", [&](const Http::HttpRequest&, Http::HttpResponse& res) {
+        ++plain_calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        res.status(Http::HttpStatus::OK).text("plain");
+    });
+    server.get("/fail", [&](const Http::HttpRequest&, Http::HttpResponse&) {
+        ++fail_calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        throw std::runtime_error("backend down");
+    }, coalesce);
+    server.get("/session", [&](const Http::HttpRequest&, Http::HttpResponse& res) {
+        const int n = ++session_calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        res.status(Http::HttpStatus::OK)
+            .header("Set-Cookie", "sid=" + std::to_string(n))
+            .text("session #" + std::to_string(n));
+    }, coalesce);
+    Server::RouteOptions short_wait = coalesce;
+    short_wait.coalesce_timeout = std::chrono::milliseconds(100);
+    server.get("/slow", [&](const Http::HttpRequest&, Http::HttpResponse& res) {
+        ++slow_calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+        res.status(Http::HttpStatus::OK).text("slow");
+    }, short_wait);
+
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // 1) Eight identical requests (two of them HEAD): one handler run, one body.
+    {
+        std::vector<std::string> reqs(8, get("/live/7"));
+        reqs[6] = TestClient::request("HEAD", "/live/7");
+        reqs[7] = reqs[6];
+        std::vector<Resp> out = concurrently(reqs);
+        check(live_calls == 1, "single flight: handler ran once");
+        bool same = true;
+        for (int i = 0; i < 6; ++i) same = same && out[i].status == 200 && out[i].body == "live 7 q= #1";
+        check(same, "single flight: every GET got the leader's body");
+        check(out[6].status == 200 && out[6].body.empty() && out[6].has("content-length: 12"),
+              "single flight: HEAD follower gets the headers");
+    }
+
+    // 2) Different queries are different flights; the query order is not.
+    {
+        live_calls = 0;
+        std::vector<Resp> out = concurrently({get("/live/1?q=a&r=1"), get("/live/1?r=1&q=a"), get("/live/1?q=b")});
+        check(live_calls == 2, "key: two distinct queries, two runs");
+        check(out[0].body == out[1].body, "key: reordered query shares the flight");
+        check(out[2].body.find("q=b") != std::string::npos, "key: other query has its own response");
+    }
+
+    // 3) Requests that always run on their own.
+    {
+        live_calls = 0;
+        concurrently({get("/live/2", "Authorization: Bearer a\r\n"), get("/live/2", "Authorization: Bearer b\r\n")});
+        check(live_calls == 2, "bypass: Authorization is never coalesced");
+        concurrently({get("/plain"), get("/plain"), get("/plain")});
+        check(plain_calls == 3, "bypass: routes without the option");
+    }
+
+    // 4) A failing handler's 500 is shared, not retried per waiter.
+    {
+        std::vector<Resp> out = concurrently({get("/fail"), get("/fail"), get("/fail"), get("/fail")});
+        bool all_500 = true;
+        for (const Resp& r : out) all_500 = all_500 && r.status == 500;
+        check(all_500 && fail_calls == 1, "errors: one run, every waiter gets the 500");
+    }
+
+    // 5) A response setting a cookie is the leader's alone: followers run the
+    //    handler themselves and get their own cookie and body.
+    {
+        std::vector<Resp> out = concurrently({get("/session"), get("/session"), get("/session")});
+        bool own = true;
+        for (const Resp& r : out) {
+            const std::string sid = r.header("set-cookie");
+            own = own && r.status == 200 && sid.rfind("sid=", 0) == 0 && r.body == "session #" + sid.substr(4);
+        }
+        check(own && session_calls == 3, "private: every request got its own cookie and body");
+        check(out[0].body != out[1].body && out[1].body != out[2].body && out[0].body != out[2].body,
+              "private: no body shared");
+        check(server.metrics().coalesce_redispatched.load() >= 2, "private: followers redispatched");
+    }
+
+    // 6) Followers give up after coalesce_timeout (504); the leader does not.
+    {
+        std::vector<Resp> out = concurrently({get("/slow"), get("/slow"), get("/slow")});
+        int ok = 0;
+        int timed_out = 0;
+        for (const Resp& r : out) {
+            if (r.status == 200 && r.body == "slow") ++ok;
+            if (r.status == 504) ++timed_out;
+        }
+        check(slow_calls == 1 && ok == 1 && timed_out == 2, "timeout: followers 504, leader 200");
+    }
+
+    const Server::Metrics& m = server.metrics();
+    check(m.coalesce_followers.load() >= 7 + 1 + 3 + 2 && m.coalesce_leaders.load() >= 1 + 2 + 1 + 1 + 1,
+          "metrics: leaders and followers counted");
+    check(m.coalesce_timeouts.load() == 2 && m.coalesce_waiting.load() == 0, "metrics: timeouts and waiting");
+    check(m.render().find("oreshnek_coalesce_ratio ") != std::string::npos, "metrics: ratio rendered");
+
+    server.request_stop();
+    loop.join();
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] coalesce tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -2,7 +2,10 @@
 //
 // Fase 7 tests for response compression: gzip/brotli negotiation via
 // Accept-Encoding, the size threshold, and that file responses are never
-// compressed (so sendfile / video bytes are untouched).
+// compressed (so sendfile / video bytes are untouched). Also covers JSON format
+// negotiation (MessagePack/CBOR via Accept), which must not be gzip'd. Plus the
+// reusable per-thread contexts, the incremental StreamCompressor and the
+// compressed-response cache and the adaptive level controller.
 
 #include "oreshnek/server/Server.h"
 #include "oreshnek/http/Compression.h"
@@ -109,6 +112,129 @@ std::string gunzip(const std::string& in) {
     return ret == Z_STREAM_END ? out : std::string();
 }
 
+void test_contexts() {
+    std::string big;
+    for (int i = 0; i < 500; ++i) big += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\"},";
+
+    // The per-thread context is reset between calls, including level changes.
+    std::string out;
+    bool ok = true;
+    for (int level : {6, 1, 9, 6}) {
+        ok = ok && Http::compress(Http::Encoding::Gzip, big, out, level) && gunzip(out) == big;
+    }
+    check(ok, "contexts: reused gzip context round-trips across levels");
+    const std::size_t capacity = out.capacity();
+    Http::compress(Http::Encoding::Gzip, big, out, 6);
+    check(out.capacity() == capacity, "contexts: output buffer reused");
+    check(!Http::compress(Http::Encoding::None, big, out, 0), "contexts: identity is not a coding");
+    if (!Http::zstd_available()) {
+        check(!Http::compress(Http::Encoding::Zstd, big, out, 3) && Http::zstd_compress(big).empty(),
+              "contexts: zstd reports unavailable");
+    }
+
+    // Streaming: a sync flush makes everything so far decodable on its own.
+    Http::StreamCompressor stream;
+    std::string chunked;
+    check(stream.begin(Http::Encoding::Gzip, 6), "stream: begin");
+    stream.write(big.substr(0, 1000), chunked, /*flush=*/true);
+    const std::size_t first = chunked.size();
+    stream.write(big.substr(1000), chunked);
+    check(stream.finish(chunked) && gunzip(chunked) == big, "stream: pieces decode to the whole");
+    check(first > 0 && first < chunked.size(), "stream: flush emitted output early");
+    std::string again;
+    check(stream.begin(Http::Encoding::Gzip, 1) && stream.write(big, again) && stream.finish(again) &&
+          gunzip(again) == big, "stream: instance reusable after finish");
+
+    if (Http::brotli_available()) {
+        std::string br;
+        for (int i = 0; i < 3; ++i) {
+            br.clear();
+            ok = stream.begin(Http::Encoding::Brotli, 5) && stream.write(big, br, true) && stream.finish(br);
+        }
+        check(ok && !br.empty() && br.size() < big.size(), "stream: brotli");
+        const std::string one_shot = Http::brotli_compress(big);
+        check(!one_shot.empty() && one_shot.size() <= br.size(), "stream: brotli one-shot (unflushed) is no larger");
+    }
+}
+
+void test_cache() {
+    Server::Metrics metrics;
+    Server::CompressionCacheOptions options;
+    options.max_bytes = 64 * 1024;
+    options.shards = 1;
+    Server::CompressionCache cache(options, &metrics);
+
+    const std::string body(4000, 'a');
+    const std::string encoded = Http::gzip_compress(body);
+    std::string out = "previous";
+    const auto cost = std::chrono::microseconds(250);
+    check(!cache.find(Http::Encoding::Gzip, 6, body, out), "cache: cold miss");
+    cache.insert(Http::Encoding::Gzip, 6, body, encoded, cost);
+    check(cache.size() == 0, "cache: first sighting only recorded");
+    cache.insert(Http::Encoding::Gzip, 6, body, encoded, cost);
+    check(cache.size() == 1, "cache: admitted on repeat");
+    check(cache.find(Http::Encoding::Gzip, 6, body, out) && out == encoded, "cache: hit returns the encoding");
+    check(!cache.find(Http::Encoding::Gzip, 1, body, out), "cache: level is part of the key");
+    check(!cache.find(Http::Encoding::Brotli, 6, body, out), "cache: coding is part of the key");
+    std::string other = body;
+    other[1234] = 'b';
+    check(!cache.find(Http::Encoding::Gzip, 6, other, out), "cache: different body misses");
+    check(metrics.compression_cache_hits.load() == 1 && metrics.compression_cache_misses.load() == 4,
+          "cache: hit/miss counters");
+    check(metrics.compression_cache_saved_ns.load() == 250000, "cache: saved time credited on hit");
+    check(metrics.compression_cache_bytes.load() == static_cast<int64_t>(cache.memory_bytes()),
+          "cache: bytes gauge");
+
+    // Byte budget: distinct bodies push the oldest out.
+    for (int i = 0; i < 40; ++i) {
+        const std::string b = std::to_string(i) + std::string(4000, 'q');
+        cache.insert(Http::Encoding::Gzip, 6, b, "x", cost);
+        cache.insert(Http::Encoding::Gzip, 6, b, "x", cost);
+    }
+    check(cache.memory_bytes() <= options.max_bytes, "cache: stays within the byte budget");
+    check(metrics.compression_cache_evictions.load() > 0, "cache: evictions counted");
+    check(!cache.find(Http::Encoding::Gzip, 6, body, out), "cache: LRU entry evicted");
+    check(!cache.find(Http::Encoding::Gzip, 6, std::string(100000, 'z'), out), "cache: oversized body bypasses");
+    cache.clear();
+    check(cache.size() == 0 && metrics.compression_cache_bytes.load() == 0, "cache: clear releases bytes");
+}
+
+void test_controller() {
+    Server::Metrics metrics;
+    Server::WorkStealingPool pool(2);
+    Server::CompressionControllerOptions options;
+    options.interval = std::chrono::milliseconds(0); // Re-evaluate on every call
+    Server::Metrics::PoolStats& stats = metrics.add_pool("default", pool.size());
+    Server::CompressionController controller(options, pool, stats, metrics);
+    using Tier = Server::CompressionTier;
+
+    check(controller.target(0.5, 0.0, Tier::Normal) == Tier::Normal, "controller: moderate load stays normal");
+    check(controller.target(0.8, 0.0, Tier::Normal) == Tier::Busy, "controller: busy load");
+    check(controller.target(3.0, 0.0, Tier::Idle) == Tier::Saturated, "controller: raising is immediate");
+    check(controller.target(0.0, 0.0, Tier::Saturated) == Tier::Busy, "controller: relaxing is one step");
+    check(controller.target(0.5, 0.9, Tier::Normal) == Tier::Busy, "controller: compression CPU share backs off");
+    check(Server::CompressionController::level_for(Tier::Idle, Http::Encoding::Gzip) == 9 &&
+          Server::CompressionController::level_for(Tier::Normal, Http::Encoding::Brotli) == 5 &&
+          Server::CompressionController::level_for(Tier::Busy, Http::Encoding::Zstd) == 1,
+          "controller: level table");
+
+    // Live inputs: handlers in flight elsewhere (a bulkhead) do not count.
+    metrics.workers_in_flight.store(10);
+    controller.level(Http::Encoding::Gzip, 1000);
+    check(controller.tier() != Tier::Saturated && controller.tier() != Tier::Busy,
+          "controller: other pools' handlers ignored");
+    // This pool's handlers running well past its size.
+    stats.running.store(10);
+    check(controller.level(Http::Encoding::Gzip, 1000) == 1, "controller: saturated uses the fastest level");
+    check(controller.level(Http::Encoding::Gzip, 1024 * 1024) == -1, "controller: saturated skips large bodies");
+    check(metrics.compression_skipped_total.load() == 1 && metrics.compression_tier.load() == 3 &&
+          metrics.compression_level_gzip.load() == 1, "controller: tier and levels published");
+    stats.running.store(0);
+    for (int i = 0; i < 3; ++i) controller.level(Http::Encoding::Gzip, 1000);
+    check(controller.tier() == Tier::Idle && controller.level(Http::Encoding::Brotli, 1000) == 7,
+          "controller: idle after the load is gone");
+}
+
 std::string get(const std::string& path, const std::string& accept_encoding) {
     std::string req = "GET " + path + " HTTP/1.1\r\nHost: x\r\nConnection: close\r\n";
     if (!accept_encoding.empty()) req += "Accept-Encoding: " + accept_encoding + "\r\n";
@@ -118,6 +244,10 @@ std::string get(const std::string& path, const std::string& accept_encoding) {
 }  // namespace
 
 int main() {
+    test_contexts();
+    test_cache();
+    test_controller();
+
     // A highly compressible text body well above the threshold.
     std::string big;
     for (int i = 0; i < 200; ++i) big += "the quick brown fox jumps over the lazy dog. ";
@@ -127,6 +257,7 @@ int main() {
 
     Server::Server server(2);
     server.enable_compression(/*min_bytes=*/32, /*allow_brotli=*/true);
+    server.enable_compression_cache();
     server.get("/big", [&big](const Http::HttpRequest&, Http::HttpResponse& res) {
         res.status(Http::HttpStatus::OK).text(big);
     });
@@ -137,6 +268,16 @@ int main() {
         res.status(Http::HttpStatus::OK).file(file_path, "text/plain"); // compressible type, but a file
     });
 
+    nlohmann::json data = nlohmann::json::array();
+    for (int i = 0; i < 50; ++i) data.push_back({{"id", i}, {"name", "item number " + std::to_string(i)}});
+    server.enable_binary_json();
+    server.get("/data", [&data](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).json(data);
+    });
+    server.post("/echo", [](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).json(req.json());
+    });
+
     if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
     std::thread loop([&server] { server.run(); });
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
@@ -163,6 +304,7 @@ int main() {
     {
         Resp r = round_trip(get("/big", ""));
         check(!r.has("content-encoding:"), "identity: no Content-Encoding");
+        check(r.has("vary: accept-encoding"), "identity: Vary still present (compressible body)");
         check(r.body == big, "identity: body is the original");
     }
 
@@ -186,6 +328,54 @@ int main() {
         check(!r.has("content-encoding:"), "q=0: refusal honoured (not compressed)");
     }
 
+    // 7) Binary JSON negotiated -> MessagePack, never gzip'd, Vary: Accept.
+    {
+        Resp r = round_trip("GET /data HTTP/1.1\r\nHost: x\r\nConnection: close\r\n"
+                            "Accept: application/msgpack, application/json;q=0.5\r\n"
+                            "Accept-Encoding: gzip\r\n\r\n");
+        check(r.has("content-type: application/msgpack"), "msgpack: Content-Type");
+        check(!r.has("content-encoding:"), "msgpack: binary body not compressed");
+        check(r.has("vary: accept"), "msgpack: Vary: Accept");
+        check(nlohmann::json::from_msgpack(r.body, true, false) == data, "msgpack: decodes to the data");
+    }
+
+    // 8) JSON stays the default and is still compressed; Vary lists both.
+    {
+        Resp r = round_trip(get("/data", "gzip"));
+        check(r.has("content-type: application/json"), "json: default format");
+        check(r.has("content-encoding: gzip") && r.has("vary: accept, accept-encoding"),
+              "json: compressed with merged Vary");
+        check(nlohmann::json::parse(gunzip(r.body), nullptr, false) == data, "json: round-trips");
+    }
+
+    // 9) CBOR request body decoded by HttpRequest::json(), CBOR response.
+    {
+        const nlohmann::json doc = {{"user", "ana"}, {"tags", {1, 2, 3}}};
+        std::string body;
+        nlohmann::json::to_cbor(doc, body);
+        std::string req = "POST /echo HTTP/1.1\r\nHost: x\r\nConnection: close\r\n"
+                          "Content-Type: application/cbor\r\nAccept: application/cbor\r\n"
+                          "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        Resp r = round_trip(req);
+        check(r.has("content-type: application/cbor"), "cbor: Content-Type");
+        check(nlohmann::json::from_cbor(r.body, true, false) == doc, "cbor: request/response round-trip");
+    }
+
+    // 10) Repeated identical bodies are served from the compressed-response
+    // cache and still decode. Test 1 was the body's first sighting, so the first
+    // request here admits it and the rest hit.
+    {
+        const uint64_t hits = server.metrics().compression_cache_hits.load();
+        for (int i = 0; i < 4; ++i) {
+            Resp r = round_trip(get("/big", "gzip"));
+            check(r.has("content-encoding: gzip") && gunzip(r.body) == big, "cache: cached gzip round-trips");
+        }
+        check(server.metrics().compression_cache_hits.load() >= hits + 3, "cache: repeat requests hit");
+        check(server.metrics().compression_cache_saved_ns.load() > 0, "cache: saved CPU time recorded");
+        check(server.metrics().compression_bytes_in.load() > server.metrics().compression_bytes_out.load() &&
+              server.metrics().compression_bytes_out.load() > 0, "metrics: compression savings recorded");
+    }
+
     server.request_stop();
     loop.join();
     ::unlink(file_path.c_str());
@@ -0,0 +1,193 @@
+// tests/coroutine_test.cpp
+//
+// Coroutine handlers: a single worker serves many concurrent requests that
+// co_await timers or blocking calls, since a suspended handler holds no
+// worker; nested Task<T> results and exceptions propagate; the file and
+// database adapters (AsyncDatabase over SQLite) resume with their results; an
+// exception escaping the handler is a 500; headers set by a middleware (CORS)
+// survive the suspensions.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/Middleware.h"
+#include "oreshnek/server/Task.h"
+#include "oreshnek/platform/AsyncDatabase.h"
+#include "oreshnek/platform/SqliteBackend.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include "TestClient.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+using namespace std::chrono_literals;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18102;
+
+using Resp = TestClient::Response;
+const TestClient client(kPort, 10);
+
+// `n` concurrent requests for `target`; returns them and the wall time taken.
+std::vector<Resp> concurrently(const std::string& target, int n, std::chrono::milliseconds& took) {
+    std::vector<Resp> out(static_cast<size_t>(n));
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) {
+        threads.emplace_back([&out, &target, i] { out[static_cast<size_t>(i)] = client.get(target); });
+    }
+    for (auto& t : threads) t.join();
+    took = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    return out;
+}
+
+Server::Task<int> twice_later(Server::CoroutineScheduler& scheduler, int value) {
+    co_await scheduler.sleep_for(10ms);
+    co_return 2 * value;
+}
+
+Server::Task<int> fails_later(Server::CoroutineScheduler& scheduler) {
+    co_await scheduler.sleep_for(10ms);
+    throw std::runtime_error("nested failure");
+}
+
+} // namespace
+
+int main() {
+    const std::string db_path = "/tmp/oreshnek_coroutine_" + std::to_string(::getpid()) + ".db";
+    const std::string file_path = db_path + ".txt";
+    std::ofstream(file_path) << "file contents";
+
+    Platform::SqliteBackend sqlite(db_path, 2, 1000);
+    sqlite.exec("CREATE TABLE t (id INTEGER PRIMARY KEY, name TEXT)");
+    sqlite.exec("INSERT INTO t (name) VALUES (?)", {std::string("alpha")});
+
+    Server::Server server(1); // One worker for everything
+    server.enable_coroutines(16);
+    server.use(Server::Middlewares::cors("*"));
+    Server::CoroutineScheduler& scheduler = server.scheduler();
+    Platform::AsyncDatabase<Platform::SqliteBackend> db(sqlite, scheduler);
+    std::atomic<int> finished{0};
+
+    server.get("/sleep", [&](const Http::HttpRequest&, Http::HttpResponse& res) -> Server::Task<void> {
+        co_await scheduler.sleep_for(300ms);
+        co_await scheduler.sleep_for(0ms); // Ready at once: no suspension
+        ++finished;
+        res.status(Http::HttpStatus::OK).text("slept");
+    });
+    server.get("/blocking", [&](const Http::HttpRequest&, Http::HttpResponse& res) -> Server::Task<void> {
+        const int v = co_await scheduler.offload([] {
+            std::this_thread::sleep_for(300ms); // A slow synchronous client
+            return 7;
+        });
+        res.status(Http::HttpStatus::OK).text("blocking " + std::to_string(v));
+    });
+    server.get("/nested/:n", [&](const Http::HttpRequest& req, Http::HttpResponse& res) -> Server::Task<void> {
+        const int n = std::atoi(std::string(req.param("n").value_or("0")).c_str());
+        const int doubled = co_await twice_later(scheduler, n);
+        std::string caught;
+        try {
+            co_await fails_later(scheduler);
+        } catch (const std::runtime_error& e) {
+            caught = e.what();
+        }
+        res.status(Http::HttpStatus::OK).text(std::to_string(doubled) + " " + caught);
+    });
+    server.get("/file", [&](const Http::HttpRequest&, Http::HttpResponse& res) -> Server::Task<void> {
+        std::optional<std::string> contents = co_await scheduler.read_file(file_path);
+        std::optional<std::string> missing = co_await scheduler.read_file(file_path + ".missing");
+        res.status(Http::HttpStatus::OK).text(contents.value_or("?") + (missing ? " found" : " missing"));
+    });
+    server.get("/db", [&](const Http::HttpRequest&, Http::HttpResponse& res) -> Server::Task<void> {
+        Platform::SqlParams params{std::string("beta")};
+        Platform::SqlResult inserted = co_await db.exec("INSERT INTO t (name) VALUES (?)", std::move(params));
+        Platform::SqlResult rows = co_await db.query("SELECT name FROM t ORDER BY id");
+        std::string names;
+        for (std::size_t i = 0; i < rows.row_count(); ++i) names += std::string(rows.text(i, 0)) + ",";
+        res.status(Http::HttpStatus::OK).text(std::to_string(inserted.affected) + " " + names);
+    });
+    server.get("/throw", [&](const Http::HttpRequest&, Http::HttpResponse&) -> Server::Task<void> {
+        co_await scheduler.sleep_for(10ms);
+        throw std::runtime_error("handler failed");
+    });
+    server.get("/plain", [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).text("plain");
+    });
+
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(200ms);
+
+    // 1) Thirty 300 ms sleeps on one worker overlap instead of queuing (9 s).
+    {
+        std::chrono::milliseconds took{};
+        std::vector<Resp> out = concurrently("/sleep", 30, took);
+        bool all = true;
+        for (const Resp& r : out) all = all && r.status == 200 && r.body == "slept";
+        check(all && finished == 30, "timers: every request answered");
+        check(took < 2500ms, "timers: suspended handlers hold no worker (" + std::to_string(took.count()) + " ms)");
+    }
+
+    // 2) Blocking calls run on the blocking pool, not the worker.
+    {
+        std::chrono::milliseconds took{};
+        std::vector<Resp> out = concurrently("/blocking", 8, took);
+        bool all = true;
+        for (const Resp& r : out) all = all && r.status == 200 && r.body == "blocking 7";
+        check(all, "offload: result delivered");
+        check(took < 2000ms, "offload: calls overlap (" + std::to_string(took.count()) + " ms)");
+        check(client.get("/plain").body == "plain", "offload: plain handlers unaffected");
+    }
+
+    // 3) Nested tasks, adapters, errors.
+    check(client.get("/nested/21").body == "42 nested failure", "nested: value and exception propagate");
+    check(client.get("/file").body == "file contents missing", "read_file: contents and missing file");
+    check(client.get("/db").body == "1 alpha,beta,", "database: exec and query through the blocking pool");
+    check(client.get("/throw").status == 500, "errors: escaping exception is a 500");
+
+    // 4) What the middlewares set is kept across suspensions, and on a 500.
+    check(client.get("/nested/21").header("access-control-allow-origin") == "*",
+          "middleware: CORS header survives the suspensions");
+    check(client.get("/throw").has("access-control-allow-origin: *"), "middleware: CORS header kept on the 500");
+
+    const Server::Metrics& m = server.metrics();
+    check(m.coroutine_resumes.load() >= 30 + 8 && m.coroutines_suspended.load() == 0,
+          "metrics: resumptions counted, none suspended");
+    check(m.deferred_pending.load() == 0, "metrics: every deferred request answered");
+    check(m.render().find("oreshnek_coroutine_resumes_total ") != std::string::npos, "metrics: rendered");
+
+    server.request_stop();
+    loop.join();
+    server.stop();
+    std::remove(db_path.c_str());
+    std::remove((db_path + "-wal").c_str());
+    std::remove((db_path + "-shm").c_str());
+    std::remove(file_path.c_str());
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] coroutine tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,191 @@
+// tests/deferred_test.cpp
+//
+// Deferred responses: handlers that park their request return at once, so a
+// single worker under max_concurrent_handlers = 1 keeps serving other routes
+// while several requests wait; any thread completes them (once); a handle
+// dropped unanswered is a 500; one never completed hits the handler timeout
+// (504); defer() outside a handler throws. Headers a middleware set before the
+// handler deferred are kept on the completed response.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/DeferredResponse.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include "TestClient.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18101;
+
+using Resp = TestClient::Response;
+const TestClient client(kPort);
+
+// Requests parked by /poll, completed by the test.
+std::mutex g_mutex;
+std::vector<Server::DeferredResponse> g_parked;
+
+std::size_t parked() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_parked.size();
+}
+
+// Until `n` requests are parked and their handlers have returned.
+bool wait_for_parked(const Server::Server& server, std::size_t n) {
+    for (int i = 0; i < 200 && (parked() < n || server.metrics().workers_in_flight.load() != 0); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return parked() >= n && server.metrics().workers_in_flight.load() == 0;
+}
+
+} // namespace
+
+int main() {
+    Server::Server server(1);
+    Server::Server::Settings settings;
+    settings.max_concurrent_handlers = 1;
+    settings.handler_timeout_sec = 1;
+    server.configure(settings);
+    server.use([](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.header("X-Served-By", "middleware");
+        return true;
+    });
+
+    server.get("/poll/:id", [&server](const Http::HttpRequest&, Http::HttpResponse& res) {
+        Server::DeferredResponse deferred = server.defer(res);
+        res.status(Http::HttpStatus::OK).text("ignored");
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_parked.push_back(std::move(deferred));
+    });
+    server.get("/drop", [&server](const Http::HttpRequest&, Http::HttpResponse& res) { server.defer(res); });
+    server.get("/now", [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).text("now");
+    });
+
+    {
+        Http::HttpResponse res;
+        bool threw = false;
+        try {
+            server.defer(res);
+        } catch (const std::logic_error&) {
+            threw = true;
+        }
+        check(threw, "defer: outside a handler throws");
+    }
+
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // 1) Three parked requests hold no worker: another route is still served.
+    {
+        std::vector<Resp> out(3);
+        std::vector<std::thread> clients;
+        // One at a time: a handler still running (before it returns) is in
+        // flight and would get the next request shed.
+        for (int i = 0; i < 3; ++i) {
+            clients.emplace_back([&out, i] { out[static_cast<size_t>(i)] = client.get("/poll/" + std::to_string(i)); });
+            check(wait_for_parked(server, static_cast<std::size_t>(i) + 1), "park: request deferred");
+        }
+        const Server::Metrics& m = server.metrics();
+        check(m.workers_in_flight.load() == 0 && m.deferred_pending.load() == 3, "park: not in workers_in_flight");
+        Resp now = client.get("/now");
+        check(now.status == 200 && now.body == "now", "park: other requests still served");
+
+        // Completed concurrently, from threads that are not workers.
+        std::vector<Server::DeferredResponse> parked_now;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            parked_now.swap(g_parked);
+        }
+        std::vector<std::thread> completers;
+        for (auto& deferred : parked_now) {
+            completers.emplace_back([deferred]() mutable {
+                const std::string id(deferred.request().param("id").value_or("?"));
+                deferred.complete([&id](Http::HttpResponse& res) {
+                    res.status(Http::HttpStatus::OK).text("done " + id);
+                });
+            });
+        }
+        for (auto& t : completers) t.join();
+        for (auto& t : clients) t.join();
+        for (int i = 0; i < 3; ++i) {
+            check(out[static_cast<size_t>(i)].status == 200 &&
+                      out[static_cast<size_t>(i)].body == "done " + std::to_string(i),
+                  "complete: response " + std::to_string(i) + " delivered");
+            check(out[static_cast<size_t>(i)].header("x-served-by") == "middleware",
+                  "complete: middleware header kept on response " + std::to_string(i));
+        }
+        check(parked_now[0].completed() &&
+                  !parked_now[0].complete([](Http::HttpResponse& res) { res.status(Http::HttpStatus::OK); }),
+              "complete: only once");
+        check(server.metrics().deferred_pending.load() == 0, "complete: none pending");
+    }
+
+    // 2) An exception while filling is a 500; so is an abandoned handle.
+    {
+        std::thread waiter([] {
+            Resp r = client.get("/poll/x");
+            check(r.status == 500 && r.has("x-served-by: middleware"), "complete: throwing fill is a 500");
+        });
+        check(wait_for_parked(server, 1), "park: fourth request");
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_parked.back().complete([](Http::HttpResponse&) { throw std::runtime_error("downstream failed"); });
+            g_parked.clear();
+        }
+        waiter.join();
+        check(client.get("/drop").status == 500, "abandon: dropped handle is a 500");
+    }
+
+    // 3) Never completed: the handler timeout still applies.
+    {
+        // /drop answered from inside its handler; let that handler return
+        // before the next request, or it is shed.
+        check(wait_for_parked(server, 0), "abandon: handler returned");
+        const auto start = std::chrono::steady_clock::now();
+        std::thread waiter([] {
+            Resp r = client.get("/poll/late");
+            check(r.status == 504, "timeout: 504");
+        });
+        check(wait_for_parked(server, 1), "park: late request");
+        waiter.join();
+        check(std::chrono::steady_clock::now() - start < std::chrono::seconds(5), "timeout: within the deadline");
+        std::lock_guard<std::mutex> lock(g_mutex);
+        check(g_parked.back().complete([](Http::HttpResponse& res) { res.status(Http::HttpStatus::OK); }),
+              "timeout: late completion is accepted and dropped");
+        g_parked.clear();
+    }
+    check(client.get("/now").status == 200, "server still healthy");
+    check(server.metrics().deferred_total.load() == 6, "metrics: deferred counted");
+    check(server.metrics().render().find("oreshnek_deferred_pending 0") != std::string::npos, "metrics: rendered");
+
+    server.request_stop();
+    loop.join();
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] deferred tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
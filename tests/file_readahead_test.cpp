@@ -0,0 +1,119 @@
+// tests/file_readahead_test.cpp
+//
+// Sequential-stream detection for file bodies: consecutive ranges of one file
+// on a connection (or one long body) become a stream that gets readahead
+// hints as it advances; a jump elsewhere ends it; pages behind a large file
+// are dropped only while a single connection streams it; entries opened
+// separately for the same file are the same stream.
+
+#include "oreshnek/server/FileReadahead.h"
+#include "oreshnek/server/Metrics.h"
+#include "oreshnek/http/FileEntry.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr off_t kKiB = 1024;
+constexpr off_t kFileSize = 4 * 1024 * kKiB;
+constexpr off_t kChunk = 256 * kKiB; // A player's range request
+
+std::shared_ptr<const Http::FileEntry> open_entry(const std::string& path) {
+    return Http::FileEntry::open(path, "video/mp4");
+}
+
+} // namespace
+
+int main() {
+    const std::string path = "/tmp/oreshnek_readahead_" + std::to_string(::getpid()) + ".mp4";
+    {
+        std::ofstream out(path, std::ios::binary);
+        const std::string block(static_cast<size_t>(kKiB), 'v');
+        for (off_t i = 0; i < kFileSize / kKiB; ++i) out << block;
+    }
+
+    Server::FileReadaheadOptions options;
+    options.window = static_cast<std::size_t>(128 * kKiB);
+    options.slack = static_cast<std::size_t>(16 * kKiB);
+    options.drop_behind_min_bytes = static_cast<std::size_t>(kFileSize);
+
+    // 1) The first range is not a stream yet; the next contiguous one is.
+    {
+        Server::Metrics metrics;
+        Server::FileReadahead readahead(options, &metrics);
+        auto entry = open_entry(path);
+        readahead.start(7, entry, 0, kChunk);
+        check(readahead.sequential() == 0 && metrics.readahead_hints.load() == 0, "detect: one range is not a stream");
+        readahead.advance(7, kChunk);
+        readahead.start(7, entry, kChunk, kChunk);
+        check(readahead.sequential() == 1 && metrics.readahead_streams.load() == 1, "detect: contiguous ranges");
+        check(metrics.readahead_hints.load() == 1 && metrics.readahead_bytes.load() == 128 * kKiB,
+              "hint: one window ahead on start");
+
+        // Hints follow the sender: re-issued once half the window is sent, and
+        // never past the next range's first window.
+        for (off_t sent = kChunk; sent <= 2 * kChunk; sent += 16 * kKiB) readahead.advance(7, sent);
+        check(metrics.readahead_hints.load() > 1, "hint: re-issued as the body advances");
+        check(metrics.readahead_bytes.load() <= static_cast<uint64_t>(kChunk + 128 * kKiB),
+              "hint: bounded by the range end plus one window");
+
+        // Drop-behind: a window back from the sender, only for the sole reader.
+        check(metrics.readahead_dropped_bytes.load() == static_cast<uint64_t>(2 * kChunk - 128 * kKiB - kChunk),
+              "drop: pages a window behind the sender");
+        auto other = open_entry(path); // A second viewer, on its own entry
+        readahead.start(9, other, 2 * kChunk, 8 * kChunk);
+        check(readahead.sequential() == 2, "detect: long body is a stream at once");
+        const uint64_t dropped = metrics.readahead_dropped_bytes.load();
+        readahead.start(7, entry, 2 * kChunk, kChunk);
+        readahead.advance(7, 3 * kChunk);
+        check(metrics.readahead_dropped_bytes.load() == dropped, "drop: not while another connection streams it");
+
+        // A jump elsewhere ends the stream; closing the connection too.
+        readahead.start(7, entry, kFileSize - kChunk, kChunk);
+        check(readahead.sequential() == 1, "detect: a seek ends the stream");
+        readahead.forget(9);
+        check(readahead.sequential() == 0 && metrics.readahead_active.load() == 0, "forget: released");
+        check(metrics.render().find("oreshnek_readahead_hints_total ") != std::string::npos &&
+                  metrics.render().find("oreshnek_file_send_seconds_total ") != std::string::npos,
+              "metrics: rendered");
+    }
+
+    // 2) Without drop_behind_min_bytes nothing is ever dropped; entries opened
+    // per request for the same file still form one stream.
+    {
+        Server::Metrics metrics;
+        options.drop_behind_min_bytes = 0;
+        Server::FileReadahead readahead(options, &metrics);
+        for (off_t offset = 0; offset < kFileSize; offset += kChunk) {
+            readahead.start(3, open_entry(path), offset, kChunk);
+            for (off_t sent = offset; sent <= offset + kChunk; sent += 16 * kKiB) readahead.advance(3, sent);
+        }
+        check(readahead.sequential() == 1 && metrics.readahead_streams.load() == 1, "identity: by device and inode");
+        check(metrics.readahead_dropped_bytes.load() == 0, "drop: disabled");
+        check(metrics.readahead_bytes.load() == static_cast<uint64_t>(kFileSize - kChunk),
+              "hint: every byte after the first range, once");
+    }
+
+    std::remove(path.c_str());
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] file readahead tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,188 @@
+// tests/hls_test.cpp
+//
+// HLS origin: playlists served from memory (content-hash ETag, gzip variant),
+// segments and parts from the directory; an LL-HLS blocking playlist reload
+// waits without a worker and is answered as soon as the packager renames the
+// next playlist into place; a position too far ahead is a 400 and one the
+// playlist never reaches a 503 after the block timeout; a polled origin
+// forgets a playlist deleted from disk.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/HlsOrigin.h"
+
+#include "TestClient.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18100;
+constexpr int kFirst = 10;    // EXT-X-MEDIA-SEQUENCE
+constexpr int kSegments = 30; // So the playlist is worth compressing
+
+using Resp = TestClient::Response;
+const TestClient client(kPort, 5);
+
+// A live playlist with `segments` complete segments and `parts` parts of the
+// next one, written the way packagers do: to a temporary name, then renamed.
+void write_playlist(const std::string& dir, int segments, int parts) {
+    std::string text = "#EXTM3U\n#EXT-X-VERSION:9\n#EXT-X-TARGETDURATION:1\n#EXT-X-PART-INF:PART-TARGET=0.2\n"
+                       "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(kFirst) + "\n";
+    for (int i = 0; i < segments; ++i) {
+        text += "#EXTINF:1.000,\nseg" + std::to_string(kFirst + i) + ".ts\n";
+    }
+    for (int p = 0; p < parts; ++p) {
+        text += "#EXT-X-PART:DURATION=0.2,URI=\"seg" + std::to_string(kFirst + segments) + "." +
+                std::to_string(p) + ".ts\"\n";
+    }
+    const std::string tmp = dir + "/.stream.m3u8.tmp";
+    std::ofstream(tmp, std::ios::binary) << text;
+    std::rename(tmp.c_str(), (dir + "/stream.m3u8").c_str());
+}
+
+std::string next_msn(int offset, int part = -1) {
+    std::string target = "/hls/live/stream.m3u8?_HLS_msn=" + std::to_string(kFirst + kSegments + offset);
+    if (part >= 0) target += "&_HLS_part=" + std::to_string(part);
+    return target;
+}
+
+} // namespace
+
+int main() {
+    const std::string root = "/tmp/oreshnek_hls_" + std::to_string(::getpid());
+    const std::string live = root + "/live";
+    std::filesystem::create_directories(live);
+    std::ofstream(live + "/seg10.ts", std::ios::binary) << std::string(4096, 'T');
+    write_playlist(live, kSegments, 2);
+
+    // Playlist parsing, without a server.
+    {
+        Server::HlsOrigin origin(root);
+        using R = Server::HlsOrigin::Readiness;
+        const int last = kFirst + kSegments - 1;
+        check(origin.playlists() == 1, "load: playlist found under a subdirectory");
+        check(origin.ready("live/stream.m3u8", {last, -1}) == R::Ready, "ready: last segment");
+        check(origin.ready("live/stream.m3u8", {last + 1, 1}) == R::Ready, "ready: part already there");
+        check(origin.ready("live/stream.m3u8", {last + 1, 2}) == R::Wait, "wait: next part");
+        check(origin.ready("live/stream.m3u8", {last + 1, -1}) == R::Wait, "wait: next segment");
+        check(origin.ready("live/stream.m3u8", {last + 3, -1}) == R::Invalid, "invalid: too far ahead");
+        check(origin.ready("live/other.m3u8", {0, -1}) == R::Unknown, "unknown: no such playlist");
+    }
+
+    // Without inotify the rescan also drops playlists no longer on disk.
+    {
+        const std::string gone = root + "/gone";
+        std::filesystem::create_directories(gone);
+        write_playlist(gone, 1, 0);
+        Server::HlsOptions polled;
+        polled.inotify = false;
+        Server::HlsOrigin origin(root, polled);
+        using R = Server::HlsOrigin::Readiness;
+        check(origin.watch_fd() < 0 && origin.playlists() == 2, "polled: both playlists loaded");
+        std::filesystem::remove_all(gone);
+        const Server::HlsOrigin::Reload reload = origin.collect(std::chrono::steady_clock::now());
+        check(reload.rescan, "polled: collect() asks for a rescan");
+        const std::vector<std::string> changed = origin.apply(reload);
+        check(changed == std::vector<std::string>{"gone/stream.m3u8"}, "polled: deleted playlist reported");
+        check(origin.playlists() == 1 && origin.ready("gone/stream.m3u8", {0, -1}) == R::Unknown,
+              "polled: deleted playlist forgotten");
+        check(origin.ready("live/stream.m3u8", {kFirst, -1}) == R::Ready, "polled: the other one kept");
+    }
+
+    Server::Server server(2);
+    Server::HlsOptions options;
+    options.block_timeout = std::chrono::milliseconds(300);
+    server.mount_hls("/hls", root, options);
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // 1) Plain playlist and segment requests.
+    Resp playlist = client.get("/hls/live/stream.m3u8");
+    check(playlist.status == 200 && playlist.body.find("seg39.ts") != std::string::npos, "playlist: served");
+    check(playlist.has("cache-control: no-cache") && playlist.has("application/vnd.apple.mpegurl"),
+          "playlist: no-cache, HLS content type");
+    const std::string etag = playlist.header("etag");
+    check(etag.size() == 18, "playlist: content-hash ETag");
+    check(client.get("/hls/live/stream.m3u8", "If-None-Match: " + etag + "\r\n").status == 304, "playlist: 304");
+    Resp gz = client.get("/hls/live/stream.m3u8", "Accept-Encoding: gzip\r\n");
+    check(gz.has("content-encoding: gzip") && gz.body.size() < playlist.body.size(), "playlist: gzip variant");
+    Resp segment = client.get("/hls/live/seg10.ts");
+    check(segment.status == 200 && segment.body.size() == 4096 && segment.has("max-age=86400"),
+          "segment: served with the long Cache-Control");
+    check(client.get("/hls/live/seg99.ts").status == 404, "segment: missing one is a 404");
+
+    // 2) Blocking reloads the playlist already satisfies, or never can.
+    Resp now = client.get(next_msn(-1));
+    check(now.status == 200 && now.has("max-age=30"), "blocking: satisfied at once, cacheable");
+    check(client.get(next_msn(0, 1)).status == 200, "blocking: existing part");
+    check(client.get(next_msn(5)).status == 400, "blocking: too far ahead is a 400");
+    check(client.get("/hls/live/stream.m3u8?_HLS_msn=x").status == 400, "blocking: malformed is a 400");
+
+    // 3) A reload waiting for the next segment is answered when it appears.
+    {
+        std::atomic<bool> done{false};
+        Resp waited;
+        std::chrono::steady_clock::time_point answered;
+        std::thread waiter([&] {
+            waited = client.get(next_msn(0));
+            answered = std::chrono::steady_clock::now();
+            done = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        check(!done && server.metrics().hls_waiting.load() == 1, "blocking: parked without a worker");
+        const auto written = std::chrono::steady_clock::now();
+        write_playlist(live, kSegments + 1, 0);
+        waiter.join();
+        check(waited.status == 200 && waited.body.find("seg40.ts") != std::string::npos,
+              "blocking: answered with the new playlist");
+        check(answered - written < std::chrono::milliseconds(500), "blocking: answered on the reload");
+        check(waited.header("etag") != etag, "blocking: new version, new ETag");
+    }
+
+    // 4) One the packager never reaches gives up after the block timeout.
+    {
+        const auto start = std::chrono::steady_clock::now();
+        Resp late = client.get(next_msn(2));
+        check(late.status == 503 && late.has("retry-after"), "timeout: 503");
+        check(std::chrono::steady_clock::now() - start < std::chrono::seconds(3), "timeout: bounded wait");
+    }
+
+    const Server::Metrics& m = server.metrics();
+    check(m.hls_blocked.load() == 2 && m.hls_block_timeouts.load() == 1 && m.hls_waiting.load() == 0,
+          "metrics: blocked, timed out, none waiting");
+    check(m.hls_playlist_reloads.load() >= 2, "metrics: reloads counted");
+    check(m.render().find("oreshnek_hls_blocked_total ") != std::string::npos, "metrics: rendered");
+
+    server.request_stop();
+    loop.join();
+    std::filesystem::remove_all(root);
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] hls tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,210 @@
+// tests/http_test.cpp
+//
+// Unit tests for HttpResponse: inline header storage, serialization (implied
+// defaults, Content-Length derived from the body), the move-only body hand-off,
+// the per-worker response pool and the pre-serialized canned responses; and
+// HttpRequest's case-insensitive header lookup and owning copy.
+
+#include "oreshnek/http/CannedResponse.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+#include "oreshnek/utils/TimeUtil.h"
+
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+bool has(const std::string& haystack, const std::string& needle) {
+    return haystack.find(needle) != std::string::npos;
+}
+
+void test_header_list() {
+    Http::HeaderList h;
+    h.set("Content-Type", "text/plain");
+    h.set("content-type", "application/json"); // case-insensitive replace
+    check(h.size() == 1, "headers: replace is case-insensitive");
+    check(h.find("CONTENT-TYPE") && *h.find("CONTENT-TYPE") == "application/json",
+          "headers: lookup is case-insensitive");
+
+    // Spill past the inline slots and back.
+    for (size_t i = 0; i < Http::HeaderList::kInline + 4; ++i) {
+        h.set("X-H" + std::to_string(i), std::to_string(i));
+    }
+    check(h.size() == Http::HeaderList::kInline + 5, "headers: overflow beyond inline slots");
+    check(h.find("X-H14") && *h.find("X-H14") == "14", "headers: overflow entry readable");
+    check(h.remove("X-H0"), "headers: remove existing");
+    check(!h.remove("X-H0"), "headers: remove missing is a no-op");
+    check(h.find("X-H15") && *h.find("X-H15") == "15", "headers: order kept after remove");
+    h.clear();
+    check(h.empty() && !h.contains("Content-Type"), "headers: clear");
+}
+
+void test_request_header() {
+    Http::HttpRequest req;
+    req.headers_["accept-encoding"] = "gzip";
+    req.headers_["X-Trace"] = "abc";
+    check(req.header("accept-encoding") == std::optional<std::string_view>("gzip"), "request: exact header name");
+    check(req.header("Accept-Encoding") == std::optional<std::string_view>("gzip"), "request: header name any case");
+    check(req.header("X-TRACE") == std::optional<std::string_view>("abc"), "request: header name upper case");
+    check(!req.header("Accept"), "request: missing header");
+}
+
+void test_request_owned_params() {
+    // The event loop matches the route (filling path_params_) on views into
+    // the read buffer, then takes the owning copy: the values must follow.
+    std::string buffer = "GET /users/42 HTTP/1.1";
+    Http::HttpRequest req;
+    req.path_ = std::string_view(buffer).substr(4, 9);
+    req.path_params_.push("id", req.path_.substr(7));
+    req.make_owned(buffer.data(), buffer.size());
+    buffer.assign(buffer.size(), 'x');
+    check(req.path() == "/users/42", "request: owned path");
+    check(req.param("id") == std::optional<std::string_view>("42"), "request: path param survives make_owned");
+    Http::HttpRequest moved(std::move(req));
+    check(moved.param("id") == std::optional<std::string_view>("42"), "request: path param survives a move");
+}
+
+void test_serialization() {
+    Http::HttpResponse res;
+    res.status(Http::HttpStatus::OK).text("hello");
+    std::string head = res.build_headers_string();
+    check(head.rfind("HTTP/1.1 200 OK\r\n", 0) == 0, "serialize: status line");
+    check(has(head, "\r\nDate: "), "serialize: Date header");
+    check(has(head, "\r\nServer: Oreshnek/1.0.0\r\n"), "serialize: implied Server");
+    check(has(head, "\r\nConnection: keep-alive\r\n"), "serialize: implied Connection");
+    check(has(head, "\r\nContent-Length: 5\r\n"), "serialize: Content-Length from body");
+    check(head.size() >= 4 && head.compare(head.size() - 4, 4, "\r\n\r\n") == 0,
+          "serialize: header block terminated");
+
+    // A handler-supplied default replaces the implied one.
+    res.header("Connection", "close");
+    head = res.build_headers_string();
+    check(has(head, "Connection: close") && !has(head, "keep-alive"),
+          "serialize: explicit Connection overrides default");
+
+    // Replacing the body keeps Content-Length consistent.
+    res.header("Content-Length", "999");
+    res.body(std::string("0123456789"));
+    check(res.content_length() == 10, "serialize: body() drops a stale Content-Length");
+
+    // 204 must not carry a Content-Length.
+    Http::HttpResponse empty;
+    empty.status(Http::HttpStatus::NO_CONTENT);
+    check(!has(empty.build_headers_string(), "Content-Length"), "serialize: no CL on 204");
+
+    // File responses derive the length from the range.
+    Http::HttpResponse file;
+    file.file("/nonexistent/oreshnek-test-file", "text/plain");
+    file.set_file_range(10, 20);
+    check(file.content_length() == 20, "serialize: file Content-Length follows range");
+}
+
+void test_move_only_body() {
+    static_assert(!std::is_copy_constructible_v<Http::HttpResponse>, "response is move-only");
+    static_assert(std::is_nothrow_move_constructible_v<Http::HttpResponse>, "noexcept move");
+
+    std::string big(100000, 'x');
+    const char* data = big.data();
+    Http::HttpResponse res;
+    res.body(std::move(big));
+    std::string out = res.take_body();
+    check(out.data() == data, "body: take_body() moves the buffer (no copy)");
+    check(res.get_body_string().empty(), "body: response left empty after take_body()");
+}
+
+void test_pool() {
+    Http::HttpResponsePool pool(2);
+    Http::HttpResponse* first = nullptr;
+    {
+        auto r = pool.acquire();
+        first = r.get();
+        r->status(Http::HttpStatus::NOT_FOUND).header("X-Test", "1").text("gone");
+        r->set_head_only(true);
+    }
+    check(pool.idle() == 1, "pool: released response is parked");
+    {
+        auto r = pool.acquire();
+        check(r.get() == first, "pool: response is recycled");
+        check(r->get_status() == Http::HttpStatus::OK, "pool: status reset");
+        check(r->get_headers().empty(), "pool: headers reset");
+        check(r->get_body_string().empty() && !r->head_only(), "pool: body/flags reset");
+    }
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        auto c = pool.acquire();
+    }
+    check(pool.idle() == 2, "pool: idle count bounded by max_idle");
+}
+
+std::string join(const std::array<std::string_view, 3>& parts) {
+    std::string out;
+    for (const auto& p : parts) out.append(p);
+    return out;
+}
+
+void test_canned() {
+    Http::CannedResponseRegistry registry;
+    const Http::CannedResponse* c429 = registry.find(Http::HttpStatus::TOO_MANY_REQUESTS);
+    check(c429 != nullptr, "canned: 429 registered by default");
+    check(registry.find(Http::HttpStatus::OK) == nullptr, "canned: unknown status is nullptr");
+
+    const std::string date = "Sun, 06 Nov 1994 08:49:37 GMT";
+    check(date.size() == Utils::kHttpDateLen, "canned: test date is fixed width");
+    const std::string full = join(c429->segments(date, false));
+    check(full.rfind("HTTP/1.1 429 Too Many Requests\r\n", 0) == 0, "canned: status line");
+    check(has(full, "\r\nDate: " + date + "\r\n"), "canned: Date spliced in");
+    check(has(full, "\r\nRetry-After: 1\r\n"), "canned: Retry-After");
+    check(full.size() == c429->size(false), "canned: size matches segments");
+    check(full.compare(full.size() - 29, 29, R"({"error":"Too Many Requests"})") == 0,
+          "canned: JSON body");
+
+    const std::string head = join(c429->segments(date, true));
+    check(head.size() == c429->size(true) && !has(head, "error") &&
+          head.compare(head.size() - 4, 4, "\r\n\r\n") == 0,
+          "canned: HEAD drops the body");
+
+    check(registry.find(Http::HttpStatus::REQUEST_TIMEOUT)->closes_connection() &&
+          registry.find(Http::HttpStatus::GATEWAY_TIMEOUT)->closes_connection() &&
+          !c429->closes_connection(),
+          "canned: timeouts close the connection");
+
+    // Applications can replace an entry; the registry keeps addresses stable.
+    Http::HttpResponse page;
+    page.status(Http::HttpStatus::NOT_FOUND).html("<h1>nope</h1>");
+    registry.set(page);
+    const std::string html = join(registry.find(Http::HttpStatus::NOT_FOUND)->segments(date, false));
+    check(has(html, "Content-Type: text/html") && has(html, "<h1>nope</h1>"),
+          "canned: custom 404 replaces the default");
+    check(registry.find(Http::HttpStatus::TOO_MANY_REQUESTS) == c429,
+          "canned: entries keep their address");
+}
+}  // namespace
+
+int main() {
+    test_header_list();
+    test_request_header();
+    test_request_owned_params();
+    test_serialization();
+    test_move_only_body();
+    test_pool();
+    test_canned();
+
+    if (g_failures == 0) {
+        std::cout << "[OK] all http tests passed" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
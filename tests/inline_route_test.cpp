@@ -0,0 +1,248 @@
+// tests/inline_route_test.cpp
+//
+// Inline routes: the middlewares and the handler run on the event-loop thread
+// (no worker), with path parameters and the query read from the connection's
+// buffer; HEAD, pipelined requests and handler exceptions behave as on a
+// worker. A route that keeps overrunning its budget is demoted to the
+// workers; compressing its response does not count against the budget. An
+// inline handler may defer, and a coroutine route may be inline
+// (answered once it finishes on the workers). Inline routes cannot coalesce
+// or use a bulkhead.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/Task.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include "TestClient.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18104;
+
+using Resp = TestClient::Response;
+const TestClient client(kPort);
+
+// The thread the last handler ran on.
+std::mutex g_mutex;
+std::thread::id g_handler_thread;
+
+void record_thread() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_handler_thread = std::this_thread::get_id();
+}
+
+std::thread::id handler_thread() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_handler_thread;
+}
+
+// Deferred by the inline /later route, completed by the test.
+std::vector<Server::DeferredResponse> g_parked;
+
+std::size_t parked() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_parked.size();
+}
+
+} // namespace
+
+int main() {
+    Server::Server server(2);
+    std::atomic<int> middleware_runs{0};
+    server.use([&middleware_runs](const Http::HttpRequest&, Http::HttpResponse&) {
+        middleware_runs.fetch_add(1);
+        return true;
+    });
+
+    Server::RouteOptions fast;
+    fast.inline_ = true;
+    fast.inline_budget = std::chrono::milliseconds(500); // Sanitizer builds are slow
+    server.get("/hello/:name", [](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        record_thread();
+        res.status(Http::HttpStatus::OK)
+            .text("hello " + std::string(req.param("name").value_or("?")) + " " +
+                  std::string(req.query("lang").value_or("-")));
+    }, fast);
+    server.get("/boom", [](const Http::HttpRequest&, Http::HttpResponse&) {
+        throw std::runtime_error("inline handler failed");
+    }, fast);
+    Server::RouteOptions slow = fast;
+    slow.inline_budget = std::chrono::milliseconds(1);
+    server.get("/slow", [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        record_thread();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        res.status(Http::HttpStatus::OK).text("slow");
+    }, slow);
+    server.get("/later/:id", [&server](const Http::HttpRequest&, Http::HttpResponse& res) {
+        record_thread();
+        Server::DeferredResponse deferred = server.defer(res);
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_parked.push_back(std::move(deferred));
+    }, fast);
+    server.get("/co/:n", [&server](const Http::HttpRequest& req, Http::HttpResponse& res) -> Server::Task<void> {
+        record_thread();
+        auto nap = server.scheduler().sleep_for(std::chrono::milliseconds(10));
+        co_await nap;
+        res.status(Http::HttpStatus::OK).text("co " + std::string(req.param("n").value_or("?")));
+    }, fast);
+    // Instant handler, large compressible body: gzip takes longer than the
+    // budget, which only covers the handler.
+    std::string report;
+    for (unsigned x = 1; report.size() < 2 * 1024 * 1024;) {
+        x = x * 1103515245u + 12345u;
+        report += "row " + std::to_string(x % 100000) + " value " + std::to_string((x >> 8) % 977) + "\n";
+    }
+    Server::RouteOptions tight = fast;
+    tight.inline_budget = std::chrono::milliseconds(5);
+    server.get("/report", [&report](const Http::HttpRequest&, Http::HttpResponse& res) {
+        record_thread();
+        res.status(Http::HttpStatus::OK).text(report);
+    }, tight);
+    server.enable_compression(/*min_bytes=*/1024, /*allow_brotli=*/false, /*allow_zstd=*/false);
+    server.get("/worker", [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        record_thread();
+        res.status(Http::HttpStatus::OK).text("worker");
+    });
+
+    {
+        Server::RouteOptions bad = fast;
+        bad.coalesce = true;
+        bool threw = false;
+        try {
+            server.get("/bad", [](const Http::HttpRequest&, Http::HttpResponse&) {}, bad);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "config: inline + coalesce refused");
+        threw = false;
+        try {
+            server.enable_metrics("/metrics", bad);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "config: enable_metrics options validated like any route");
+    }
+
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    const std::thread::id loop_id = loop.get_id();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const Server::Metrics& m = server.metrics();
+    const Server::Metrics::PoolStats* default_pool = m.pool("default");
+    if (default_pool == nullptr) { std::cerr << "[FATAL] default pool stats missing\n"; return 1; }
+
+    // 1) Inline: on the event loop, views read before the buffer is consumed,
+    //    middlewares included, no worker involved.
+    {
+        Resp r = client.get("/hello/bob?lang=es");
+        check(r.status == 200 && r.body == "hello bob es", "inline: params and query");
+        check(handler_thread() == loop_id, "inline: ran on the event loop");
+        check(middleware_runs.load() == 1, "inline: middleware ran");
+        check(m.inline_requests.load() == 1 && default_pool->latency_count.load() == 0, "inline: no worker used");
+
+        std::vector<Resp> pipelined =
+            client.exchange({TestClient::request("GET", "/hello/a"), TestClient::request("HEAD", "/hello/b"),
+                             TestClient::request("GET", "/hello/c"), TestClient::request("GET", "/worker")});
+        check(pipelined.size() == 4, "pipelined: every response read");
+        if (pipelined.size() == 4) {
+            check(pipelined[0].status == 200 && pipelined[0].body == "hello a -", "pipelined: first");
+            check(pipelined[1].status == 200 && pipelined[1].body.empty(), "pipelined: HEAD without body");
+            check(pipelined[2].status == 200 && pipelined[2].body == "hello c -", "pipelined: third");
+            check(pipelined[3].status == 200 && pipelined[3].body == "worker", "pipelined: worker route after");
+        }
+        check(handler_thread() != loop_id, "worker route: not on the event loop");
+        check(m.inline_requests.load() == 4, "inline: counted");
+    }
+
+    // 2) A throwing inline handler is a 500; the loop keeps serving.
+    check(client.get("/boom").status == 500, "exception: 500");
+    check(client.get("/hello/x").status == 200, "exception: loop still serving");
+
+    // 3) Deferred from an inline run: the request outlives the read buffer, the
+    //    response comes later and in order with the next pipelined one.
+    {
+        Resp r;
+        std::thread waiter([&r] { r = client.get("/later/bob?x=1"); });
+        for (int i = 0; i < 500 && parked() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        check(parked() == 1 && handler_thread() == loop_id, "defer: inline handler parked its request");
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            for (Server::DeferredResponse& deferred : g_parked) {
+                deferred.complete([&deferred](Http::HttpResponse& res) {
+                    res.status(Http::HttpStatus::OK)
+                        .text("later " + std::string(deferred.request().param("id").value_or("?")) + " " +
+                              std::string(deferred.request().query("x").value_or("-")));
+                });
+            }
+            g_parked.clear();
+        }
+        waiter.join();
+        check(r.status == 200 && r.body == "later bob 1", "defer: completed with the owned request, got " + r.body);
+
+        std::vector<Resp> pipelined =
+            client.exchange({TestClient::request("GET", "/co/7"), TestClient::request("GET", "/hello/z")});
+        check(pipelined.size() == 2 && pipelined[0].status == 200 && pipelined[0].body == "co 7",
+              "coroutine: inline route answered after its suspension");
+        check(pipelined.size() == 2 && pipelined[1].body == "hello z -", "coroutine: next pipelined request after");
+        check(server.metrics().deferred_pending.load() == 0, "defer: none pending");
+    }
+
+    // 4) Compressing the response does not count against the budget.
+    {
+        for (int i = 0; i < 4; ++i) {
+            Resp r = client.get("/report", "Accept-Encoding: gzip\r\n");
+            check(r.status == 200 && r.has("content-encoding: gzip") && r.body.size() < report.size() / 2,
+                  "compressed: answered gzipped");
+            check(handler_thread() == loop_id, "compressed: ran inline");
+        }
+        check(m.inline_overruns.load() == 0 && m.inline_demoted_routes.load() == 0,
+              "compressed: no overrun, not demoted");
+    }
+
+    // 5) Safety net: three overruns demote the route to the workers.
+    {
+        for (int i = 0; i < 3; ++i) {
+            Resp r = client.get("/slow");
+            check(r.status == 200 && r.body == "slow", "overrun: still answered");
+            check(handler_thread() == loop_id, "overrun: ran inline before demotion");
+        }
+        check(m.inline_overruns.load() == 3 && m.inline_demoted_routes.load() == 1, "overrun: route demoted");
+        Resp r = client.get("/slow");
+        check(r.status == 200 && r.body == "slow", "demoted: still answered");
+        check(handler_thread() != loop_id, "demoted: runs on a worker");
+        check(client.get("/hello/y").status == 200 && handler_thread() == loop_id, "demoted: other routes stay inline");
+        check(m.render().find("oreshnek_inline_demoted_routes 1") != std::string::npos, "metrics: rendered");
+    }
+
+    server.request_stop();
+    loop.join();
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] inline route tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
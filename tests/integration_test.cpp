@@ -294,6 +294,65 @@ void test_file_range() {
           "file_range2: body == last 5 bytes");
 }
 
+// Several ranges: multipart/byteranges with one part per (merged) range, in
+// request order, and the same connection stays usable afterwards; too many
+// ranges -> full 200.
+void test_file_multi_range() {
+    Client c;
+    check(c.connect(), "multi_range: connect");
+    check(c.send_all(make_request("GET", "/file", "", "Range: bytes=50000-50009, 0-4,3-9, -5\r\n")),
+          "multi_range: send");
+    Client::Response resp;
+    check(c.read_response(resp), "multi_range: read");
+    check(resp.status == 206, "multi_range: status 206, got " + std::to_string(resp.status));
+    const std::string type = extract_header(resp.headers, "content-type");
+    const std::string marker = "boundary=";
+    const size_t b = type.find(marker);
+    check(type.rfind("multipart/byteranges", 0) == 0 && b != std::string::npos, "multi_range: multipart type");
+    const std::string boundary = b == std::string::npos ? "" : type.substr(b + marker.size());
+    const size_t size = g_file_content.size();
+    const std::string expected =
+        "--" + boundary + "\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes 50000-50009/" +
+        std::to_string(size) + "\r\n\r\n" + g_file_content.substr(50000, 10) +
+        "\r\n--" + boundary + "\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes 0-9/" +
+        std::to_string(size) + "\r\n\r\n" + g_file_content.substr(0, 10) +
+        "\r\n--" + boundary + "\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes " +
+        std::to_string(size - 5) + "-" + std::to_string(size - 1) + "/" + std::to_string(size) + "\r\n\r\n" +
+        g_file_content.substr(size - 5) + "\r\n--" + boundary + "--\r\n";
+    check(resp.body == expected, "multi_range: request order, overlaps merged in place, framing exact");
+
+    // Ranges that do not overlap keep the order they were asked in.
+    Client::Response r1;
+    check(c.send_all(make_request("GET", "/file", "", "Range: bytes=-3,0-9\r\n")), "multi_range: send reversed");
+    check(c.read_response(r1), "multi_range: read reversed");
+    const size_t tail = r1.body.find("Content-Range: bytes " + std::to_string(size - 3) + "-");
+    const size_t head = r1.body.find("Content-Range: bytes 0-9/");
+    check(r1.status == 206 && tail != std::string::npos && head != std::string::npos && tail < head,
+          "multi_range: non-overlapping ranges in request order");
+
+    // Adjacent ranges merge into a single plain 206.
+    Client::Response r2;
+    check(c.send_all(make_request("GET", "/file", "", "Range: bytes=10-19,20-29\r\n")), "multi_range: send adjacent");
+    check(c.read_response(r2), "multi_range: read adjacent");
+    check(r2.status == 206 && r2.has_header("content-range: bytes 10-29/") && r2.body == g_file_content.substr(10, 20),
+          "multi_range: adjacent ranges merged");
+
+    // Over the cap: the Range header is ignored.
+    std::string many = "Range: bytes=0-0";
+    for (int i = 1; i <= 16; ++i) many += "," + std::to_string(i * 100) + "-" + std::to_string(i * 100);
+    Client::Response r3;
+    check(c.send_all(make_request("GET", "/file", "", many + "\r\n")), "multi_range: send many");
+    check(c.read_response(r3), "multi_range: read many");
+    check(r3.status == 200 && r3.body.size() == size, "multi_range: too many ranges -> full body");
+
+    // None satisfiable -> 416.
+    Client::Response r4;
+    check(c.send_all(make_request("GET", "/file", "", "Range: bytes=900000-,999999-1000000\r\n")),
+          "multi_range: send unsatisfiable");
+    check(c.read_response(r4), "multi_range: read unsatisfiable");
+    check(r4.status == 416, "multi_range: unsatisfiable -> 416");
+}
+
 void test_head() {
     Client c;
     check(c.connect(), "head: connect");
@@ -392,6 +451,69 @@ void test_conditional_get() {
     check(r3.body.size() == g_file_content.size(), "cond: 200 returns the full body");
 }
 
+// enable_auto_etag(): string responses get a body-hash ETag and revalidate to
+// 304; a handler-supplied version ETag skips building the body.
+std::atomic<int> g_version_builds{0};
+
+void test_conditional_string() {
+    Client c;
+    check(c.connect(), "etag: connect");
+
+    Client::Response r1;
+    check(c.send_all(make_request("GET", "/catalog")), "etag: send GET");
+    check(c.read_response(r1), "etag: read GET");
+    const std::string etag = extract_header(r1.headers, "etag");
+    check(r1.status == 200 && etag.size() == 18 && etag.front() == '"', "etag: strong hash ETag, got " + etag);
+
+    Client::Response r2;
+    check(c.send_all(make_request("GET", "/catalog", "", "If-None-Match: \"x\", W/" + etag + "\r\n")),
+          "etag: send If-None-Match");
+    check(c.read_response(r2), "etag: read revalidation");
+    check(r2.status == 304 && r2.body.empty(), "etag: list with a weak match revalidates to 304");
+    check(!r2.has_header("Content-Length:") && extract_header(r2.headers, "etag") == etag,
+          "etag: 304 carries the ETag and no Content-Length");
+
+    Client::Response r3;
+    check(c.send_all(make_request("GET", "/catalog", "", "If-None-Match: \"nope\"\r\n")), "etag: send stale");
+    check(c.read_response(r3), "etag: read full");
+    check(r3.status == 200 && r3.body == "[\"a\",\"b\"]", "etag: non-matching ETag returns the body");
+
+    Client::Response r4;
+    check(c.send_all(make_request("GET", "/versioned", "", "If-None-Match: \"v3\"\r\n")), "etag: send version");
+    check(c.read_response(r4), "etag: read version");
+    check(r4.status == 304 && g_version_builds == 0, "etag: version ETag answered without building the body");
+    Client::Response r5;
+    check(c.send_all(make_request("GET", "/versioned")), "etag: send unconditional");
+    check(c.read_response(r5), "etag: read unconditional");
+    check(r5.status == 200 && extract_header(r5.headers, "etag") == "\"v3\"" && g_version_builds == 1,
+          "etag: handler ETag kept on the 200");
+}
+
+// A compressed 200 carries a weak ETag and Vary: Accept-Encoding; the 304
+// that revalidates it carries the same (RFC 9110 §15.4.5).
+void test_conditional_compressed() {
+    Client c;
+    check(c.connect(), "etag+gzip: connect");
+
+    Client::Response r1;
+    check(c.send_all(make_request("GET", "/feed", "", "Accept-Encoding: gzip\r\n")), "etag+gzip: send GET");
+    check(c.read_response(r1), "etag+gzip: read GET");
+    const std::string etag = extract_header(r1.headers, "etag");
+    check(r1.status == 200 && extract_header(r1.headers, "content-encoding") == "gzip", "etag+gzip: compressed 200");
+    check(etag.rfind("W/\"", 0) == 0, "etag+gzip: weak ETag on the compressed 200, got " + etag);
+    check(extract_header(r1.headers, "vary").find("Accept-Encoding") != std::string::npos,
+          "etag+gzip: 200 varies on Accept-Encoding");
+
+    Client::Response r2;
+    check(c.send_all(make_request("GET", "/feed", "", "Accept-Encoding: gzip\r\nIf-None-Match: " + etag + "\r\n")),
+          "etag+gzip: send If-None-Match");
+    check(c.read_response(r2), "etag+gzip: read revalidation");
+    check(r2.status == 304 && r2.body.empty(), "etag+gzip: revalidates to 304");
+    check(extract_header(r2.headers, "etag") == etag, "etag+gzip: 304 has the 200's weak ETag");
+    check(extract_header(r2.headers, "vary").find("Accept-Encoding") != std::string::npos,
+          "etag+gzip: 304 varies on Accept-Encoding");
+}
+
 }  // namespace
 
 int main() {
@@ -417,6 +539,25 @@ int main() {
     server.get("/file", [](const Http::HttpRequest&, Http::HttpResponse& res) {
         res.status(Http::HttpStatus::OK).file(g_file_path, "application/octet-stream");
     });
+    server.enable_auto_etag();
+    server.enable_compression(256, /*allow_brotli=*/false, /*allow_zstd=*/false);
+    server.get("/catalog", [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).header("Content-Type", "application/json").body("[\"a\",\"b\"]");
+    });
+    server.get("/feed", [](const Http::HttpRequest&, Http::HttpResponse& res) {
+        std::string feed = "[";
+        for (int i = 0; i < 64; ++i) feed += (i ? ",\"item " : "\"item ") + std::to_string(i) + "\"";
+        res.status(Http::HttpStatus::OK).header("Content-Type", "application/json").body(feed + "]");
+    });
+    server.get("/versioned", [](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        const std::string etag = "\"v3\"";
+        if (req.if_none_match(etag)) {
+            res.not_modified(etag);
+            return;
+        }
+        ++g_version_builds;
+        res.status(Http::HttpStatus::OK).header("ETag", etag).text("version 3");
+    });
 
     if (!server.listen(kHost, kPort)) {
         std::cerr << "[FATAL] server failed to listen on " << kHost << ":" << kPort << std::endl;
@@ -433,10 +574,13 @@ int main() {
     test_concurrency();
     test_file_full();
     test_file_range();
+    test_file_multi_range();
     test_head();
     test_chunked();
     test_expect_continue();
     test_conditional_get();
+    test_conditional_string();
+    test_conditional_compressed();
 
     // Correct shutdown contract: signal the loop, then join its thread. run()
     // tears down its own connections/fds; the Server destructor stops the pool.
@@ -0,0 +1,261 @@
+// tests/json_test.cpp
+//
+// Unit tests for the streaming JsonWriter (separators, escaping including the
+// word-at-a-time fast path, number formatting, misuse detection, the
+// HttpResponse::json(JsonWriter&&) hand-off) and the lazy JsonDocument reader
+// (validation, zero-copy strings, lookups, iteration). Both are cross-checked
+// against nlohmann::json. Also Accept-based JSON/MessagePack/CBOR negotiation.
+
+#include "oreshnek/http/HttpResponse.h"
+#include "oreshnek/http/JsonReader.h"
+#include "oreshnek/http/JsonWriter.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+void test_structure() {
+    Http::JsonWriter w;
+    w.begin_object()
+     .member("a", 1)
+     .key("list").begin_array().value(1).value("two").null().value(true).end_array()
+     .key("empty").begin_object().end_object()
+     .key("none").begin_array().end_array()
+     .end_object();
+    check(w.complete(), "structure: document complete");
+    check(w.str() == R"({"a":1,"list":[1,"two",null,true],"empty":{},"none":[]})",
+          "structure: separators");
+}
+
+void test_escaping() {
+    // Long enough to exercise the 8-byte path with escapes at word boundaries.
+    std::string s = "plain ascii text \"quoted\" back\\slash\n\t\r\b\f";
+    s.push_back('\x01');
+    s += "tail after control chars, UTF-8 \xC3\xB1 stays raw";
+    Http::JsonWriter w;
+    w.value(s);
+    auto parsed = nlohmann::json::parse(w.str());
+    check(parsed.get<std::string>() == s, "escape: round-trips through nlohmann");
+    check(w.str().find("\\u0001") != std::string::npos, "escape: control char as \\u00XX");
+
+    for (std::size_t len = 0; len < 40; ++len) {
+        std::string t(len, 'x');
+        if (len > 0) t[len - 1] = '"';
+        std::string out;
+        Http::JsonWriter::append_escaped(out, t);
+        if (nlohmann::json::parse(out).get<std::string>() != t) {
+            check(false, "escape: trailing quote at length " + std::to_string(len));
+        }
+    }
+}
+
+void test_numbers() {
+    Http::JsonWriter w;
+    w.begin_array()
+     .value(std::numeric_limits<std::int64_t>::min())
+     .value(std::numeric_limits<std::uint64_t>::max())
+     .value(0.1)
+     .value(-2.5e300)
+     .value(std::numeric_limits<double>::quiet_NaN())
+     .end_array();
+    auto parsed = nlohmann::json::parse(w.str());
+    check(parsed[0].get<std::int64_t>() == std::numeric_limits<std::int64_t>::min(), "numbers: int64 min");
+    check(parsed[1].get<std::uint64_t>() == std::numeric_limits<std::uint64_t>::max(), "numbers: uint64 max");
+    check(parsed[2].get<double>() == 0.1, "numbers: shortest round-trip double");
+    check(parsed[3].get<double>() == -2.5e300, "numbers: large double");
+    check(parsed[4].is_null(), "numbers: NaN becomes null");
+}
+
+void test_misuse() {
+    auto throws = [](auto fn) {
+        try { fn(); } catch (const std::logic_error&) { return true; }
+        return false;
+    };
+    check(throws([] { Http::JsonWriter w; w.begin_object().value(1); }), "misuse: value without key");
+    check(throws([] { Http::JsonWriter w; w.begin_array().key("k"); }), "misuse: key in array");
+    check(throws([] { Http::JsonWriter w; w.begin_array().end_object(); }), "misuse: mismatched close");
+    check(throws([] { Http::JsonWriter w; w.value(1).value(2); }), "misuse: two top-level values");
+    check(throws([] {
+        Http::JsonWriter w;
+        for (int i = 0; i <= Http::JsonWriter::kMaxDepth; ++i) w.begin_array();
+    }), "misuse: nesting limit");
+
+    Http::HttpResponse res;
+    Http::JsonWriter partial;
+    partial.begin_object();
+    check(throws([&] { res.json(std::move(partial)); }), "misuse: incomplete document rejected");
+}
+
+void test_response_handoff() {
+    Http::JsonWriter w(4096);
+    w.begin_object().member("ok", true).end_object();
+    const char* data = w.str().data();
+    Http::HttpResponse res;
+    res.json(std::move(w));
+    check(res.get_body_string() == R"({"ok":true})", "response: body set");
+    check(res.get_body_string().data() == data, "response: buffer moved, not copied");
+    check(res.get_header("Content-Type") == std::optional<std::string_view>("application/json"),
+          "response: content type");
+    check(w.str().empty() && !w.complete(), "response: writer left empty");
+
+    // A negotiated binary format is honoured: the document is transcoded.
+    Http::JsonWriter cbor;
+    cbor.begin_object().member("ok", true).member("n", 7).end_object();
+    Http::HttpResponse binary;
+    binary.set_json_format(Http::BodyFormat::Cbor);
+    binary.json(std::move(cbor));
+    check(binary.get_header("Content-Type") == std::optional<std::string_view>("application/cbor") &&
+          binary.get_header("Vary") == std::optional<std::string_view>("Accept"),
+          "response: negotiated writer headers");
+    check(nlohmann::json::from_cbor(binary.get_body_string()) == nlohmann::json{{"ok", true}, {"n", 7}},
+          "response: writer transcoded to CBOR");
+}
+
+void test_reader_access() {
+    const std::string text = R"( {"user": {"name": "ana", "age": 31, "tags": ["a", "b\n", 3.5]},
+        "ok": true, "none": null, "big": 1e400, "esc\u0041": "caf\u00e9 \ud83d\ude00"} )";
+    Http::JsonDocument doc(text);
+    check(doc.valid(), "reader: valid document (" + doc.error() + ")");
+    Http::JsonValue root = doc.root();
+    check(root.is_object() && root.size() == 5, "reader: root object with 5 members");
+
+    auto name = root["user"]["name"].get_string_view();
+    check(name && *name == "ana", "reader: nested string");
+    check(name && name->data() >= text.data() && name->data() < text.data() + text.size(),
+          "reader: unescaped string is a view into the text");
+    check(root["user"]["age"].get_int() == 31, "reader: integer");
+    check(!root["user"]["tags"][2].get_int() && root["user"]["tags"][2].get_double() == 3.5,
+          "reader: fractional number is not an int");
+    check(!root["user"]["tags"][1].get_string_view(), "reader: escaped string has no view");
+    check(root["user"]["tags"][1].get_string() == std::optional<std::string>("b\n"),
+          "reader: escaped string unescaped");
+    check(root["ok"].get_bool() == true && root["none"].is_null(), "reader: literals");
+    check(!root["missing"]["deeper"][3] && !root["missing"].get_string(),
+          "reader: missing values chain safely");
+    check(!root["user"]["tags"][3], "reader: index out of range");
+
+    std::string scratch;
+    auto emoji = root["escA"].get_string(scratch); // The key is written "esc\u0041"
+    check(emoji && *emoji == "caf\xC3\xA9 \xF0\x9F\x98\x80", "reader: \\u escapes and surrogates");
+
+    std::vector<std::string> keys;
+    for (auto it = root.begin(); it != root.end(); ++it) keys.emplace_back(it.key());
+    check(keys.size() == 5 && keys[0] == "user" && keys[4] == "esc\\u0041",
+          "reader: object iteration in order (raw keys)");
+    int elements = 0;
+    for (Http::JsonValue v : root["user"]["tags"]) elements += v ? 1 : 0;
+    check(elements == 3, "reader: array iteration");
+    check(root["user"]["tags"].raw() == R"(["a", "b\n", 3.5])", "reader: raw container text");
+
+    // Values survive moving the document.
+    Http::JsonDocument moved = std::move(doc);
+    check(root["user"]["age"].get_int() == 31, "reader: values survive a document move");
+}
+
+void test_reader_validation() {
+    const std::vector<std::string> cases = {
+        "{}", "[]", "0", "-0.5e+3", "\"x\"", "[1,[2,[3]]]", "{\"a\":{\"b\":[]}}", " true ",
+        "", " ", "{", "}", "[1,]", "{\"a\"}", "{\"a\":1,}", "{1:2}", "[1 2]", "01", "1.", "-",
+        ".5", "1e", "tru", "nul", "\"abc", "\"a\\x\"", "\"\\u12\"", "\"a\tb\"", "[1]]",
+        "{\"a\":1}x", "[}", "{]", "[\"\\\"\"]"};
+    for (const std::string& text : cases) {
+        const bool ours = Http::JsonDocument(text).valid();
+        const bool theirs = nlohmann::json::accept(text);
+        if (ours != theirs) {
+            check(false, "validation: disagrees with nlohmann on '" + text + "'");
+        }
+    }
+
+    Http::JsonDocument bad("{\"a\": [1, 2}");
+    check(!bad.valid() && !bad.root() && bad.error().find("offset") != std::string::npos,
+          "validation: error message with offset");
+
+    std::string deep(Http::JsonDocument::kMaxDepth + 1, '[');
+    deep += std::string(Http::JsonDocument::kMaxDepth + 1, ']');
+    check(!Http::JsonDocument(deep).valid(), "validation: nesting limit");
+}
+
+void test_reader_roundtrip() {
+    // Writer output read back by the reader.
+    Http::JsonWriter w;
+    w.begin_object().key("items").begin_array();
+    for (int i = 0; i < 100; ++i) {
+        w.begin_object().member("id", i).member("name", "item \"" + std::to_string(i) + "\"").end_object();
+    }
+    w.end_array().end_object();
+    Http::JsonDocument doc(w.str());
+    check(doc.valid() && doc.root()["items"].size() == 100, "roundtrip: array size");
+    check(doc.root()["items"][57]["id"].get_int() == 57, "roundtrip: indexed element");
+    check(doc.root()["items"][99]["name"].get_string() == std::optional<std::string>("item \"99\""),
+          "roundtrip: escaped string");
+}
+
+void test_negotiation() {
+    using Http::BodyFormat;
+    using Http::negotiate_body_format;
+    check(negotiate_body_format(std::nullopt) == BodyFormat::Json, "negotiate: no Accept -> JSON");
+    check(negotiate_body_format("*/*") == BodyFormat::Json, "negotiate: wildcard -> JSON");
+    check(negotiate_body_format("application/msgpack") == BodyFormat::MsgPack, "negotiate: msgpack");
+    check(negotiate_body_format("application/json, application/cbor") == BodyFormat::Json,
+          "negotiate: tie keeps JSON");
+    check(negotiate_body_format("application/json;q=0.8, application/cbor") == BodyFormat::Cbor,
+          "negotiate: higher q wins");
+    check(negotiate_body_format("application/x-msgpack; q=0.9, */*;q=0.1") == BodyFormat::MsgPack,
+          "negotiate: msgpack alias beats wildcard");
+    check(negotiate_body_format("application/msgpack;q=0") == BodyFormat::Json, "negotiate: q=0 refusal");
+    check(Http::body_format_from_content_type("Application/CBOR; charset=x") == BodyFormat::Cbor,
+          "negotiate: Content-Type parameters and case");
+
+    Http::HttpResponse res;
+    res.set_json_format(BodyFormat::MsgPack);
+    res.json({{"a", 1}});
+    check(res.get_header("Content-Type") == std::optional<std::string_view>("application/msgpack") &&
+          res.get_header("Vary") == std::optional<std::string_view>("Accept"),
+          "negotiate: response headers");
+    check(nlohmann::json::from_msgpack(res.get_body_string()) == nlohmann::json{{"a", 1}},
+          "negotiate: MessagePack body");
+
+    // A Vary set earlier (e.g. by a middleware) is extended, not replaced.
+    Http::HttpResponse varied;
+    varied.header("Vary", "Origin, Accept-Encoding");
+    varied.set_json_format(BodyFormat::Cbor);
+    varied.json({{"a", 1}}).json({{"a", 2}});
+    check(varied.get_header("Vary") == std::optional<std::string_view>("Origin, Accept-Encoding, Accept"),
+          "negotiate: Accept added to an existing Vary once");
+}
+}  // namespace
+
+int main() {
+    test_structure();
+    test_escaping();
+    test_numbers();
+    test_misuse();
+    test_response_handoff();
+    test_reader_access();
+    test_reader_validation();
+    test_reader_roundtrip();
+    test_negotiation();
+
+    if (g_failures == 0) {
+        std::cout << "[OK] all json tests passed" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
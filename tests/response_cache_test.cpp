@@ -0,0 +1,216 @@
+// tests/response_cache_test.cpp
+//
+// Response cache: responses stored from the handler's Cache-Control are served
+// again without running the handler (normalized query, HEAD from the GET
+// entry), Vary splits variants (compressed and identity bodies side by side),
+// non-cacheable responses and requests bypass it, stale-while-revalidate
+// serves the old body while one background refresh replaces it (also for a
+// coroutine handler, whose refresh completes later), and the byte budget is
+// enforced.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/ResponseCache.h"
+#include "oreshnek/server/Task.h"
+#include "oreshnek/http/HttpRequest.h"
+#include "oreshnek/http/HttpResponse.h"
+
+#include "TestClient.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18098;
+
+using Resp = TestClient::Response;
+const TestClient client(kPort, 2);
+
+void test_budget() {
+    Server::Metrics metrics;
+    Server::ResponseCacheOptions options;
+    options.max_bytes = 16 * 1024;
+    options.shards = 1;
+    Server::ResponseCache cache(options, &metrics);
+
+    Http::HttpResponse res;
+    res.status(Http::HttpStatus::OK).text(std::string(1000, 'x'));
+    res.header("Cache-Control", "max-age=60");
+    for (int i = 0; i < 50; ++i) {
+        Http::HttpRequest req;
+        req.method_ = Http::HttpMethod::GET;
+        const std::string path = "/item/" + std::to_string(i);
+        req.path_ = path;
+        req.make_owned(path.data(), path.size());
+        check(cache.store(req, res), "budget: stored");
+    }
+    check(cache.memory_bytes() <= options.max_bytes, "budget: within max_bytes");
+    check(cache.size() < 50 && metrics.response_cache_evictions.load() > 0, "budget: evicted LRU entries");
+    check(metrics.response_cache_bytes.load() == static_cast<int64_t>(cache.memory_bytes()), "budget: gauge");
+
+    Http::HttpRequest post;
+    post.method_ = Http::HttpMethod::POST;
+    check(!cache.store(post, res), "budget: POST never stored");
+    cache.clear();
+    check(metrics.response_cache_bytes.load() == 0, "budget: clear releases bytes");
+}
+
+} // namespace
+
+int main() {
+    test_budget();
+
+    std::atomic<int> videos_calls{0};
+    std::atomic<int> nostore_calls{0};
+    std::atomic<int> vary_calls{0};
+    std::atomic<int> swr_calls{0};
+    std::atomic<int> page_calls{0};
+    std::atomic<int> coro_calls{0};
+
+    Server::Server server(2);
+    server.enable_response_cache();
+    server.enable_compression(256, /*allow_brotli=*/false, /*allow_zstd=*/false);
+    server.get("/videos", [&](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        const int n = ++videos_calls;
+        res.status(Http::HttpStatus::OK)
+            .text("videos " + std::string(req.query("category").value_or("")) + " #" + std::to_string(n));
+        res.header("Cache-Control", "public, max-age=60");
+    });
+    server.get("/nostore", [&](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).text("fresh #" + std::to_string(++nostore_calls));
+        res.header("Cache-Control", "no-store");
+    });
+    server.get("/vary", [&](const Http::HttpRequest& req, Http::HttpResponse& res) {
+        ++vary_calls;
+        res.status(Http::HttpStatus::OK).text("lang=" + std::string(req.header("Accept-Language").value_or("none")));
+        res.header("Cache-Control", "max-age=60").header("Vary", "Accept-Language");
+    });
+    server.get("/page", [&](const Http::HttpRequest&, Http::HttpResponse& res) {
+        ++page_calls;
+        res.status(Http::HttpStatus::OK).text(std::string(1024, 'p'));
+        res.header("Cache-Control", "max-age=60");
+    });
+    server.get("/swr", [&](const Http::HttpRequest&, Http::HttpResponse& res) {
+        res.status(Http::HttpStatus::OK).text("version " + std::to_string(++swr_calls));
+        res.header("Cache-Control", "max-age=1, stale-while-revalidate=30");
+    });
+
+    Server::CoroutineScheduler& scheduler = server.scheduler();
+    server.get("/swr-coro", [&](const Http::HttpRequest&, Http::HttpResponse& res) -> Server::Task<void> {
+        const int n = ++coro_calls;
+        co_await scheduler.sleep_for(std::chrono::milliseconds(10));
+        res.status(Http::HttpStatus::OK).text("version " + std::to_string(n));
+        res.header("Cache-Control", "max-age=1, stale-while-revalidate=30");
+    });
+
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // 1) Stored on the first request; the same query in another order hits.
+    {
+        Resp a = client.get("/videos?category=music&page=2");
+        Resp b = client.get("/videos?page=2&category=music");
+        check(a.body == "videos music #1", "store: first response from the handler");
+        check(b.body == a.body && videos_calls == 1, "hit: normalized query served from the cache");
+        check(b.has("cache-control: public, max-age=60"), "hit: headers preserved");
+        Resp other = client.get("/videos?category=news");
+        check(other.body == "videos news #2", "key: different query is a different entry");
+        Resp head = client.round_trip(TestClient::request("HEAD", "/videos?category=news"));
+        check(head.has("content-length: 14") && videos_calls == 2, "hit: HEAD served from the GET entry");
+    }
+
+    // 2) Requests that must reach the handler.
+    {
+        client.get("/videos?category=music&page=2", "Cache-Control: no-cache\r\n");
+        check(videos_calls == 3, "bypass: request no-cache reaches the handler");
+        client.get("/videos?category=music&page=2", "Authorization: Bearer t\r\n");
+        check(videos_calls == 4, "bypass: Authorization reaches the handler");
+        client.get("/nostore");
+        Resp r = client.get("/nostore");
+        check(r.body == "fresh #2", "bypass: no-store is never cached");
+    }
+
+    // 3) Vary: one variant per Accept-Language value.
+    {
+        Resp es = client.get("/vary", "Accept-Language: es\r\n");
+        Resp en = client.get("/vary", "Accept-Language: en\r\n");
+        Resp es2 = client.get("/vary", "accept-language: es\r\n");
+        check(es.body == "lang=es" && en.body == "lang=en", "vary: variants differ");
+        check(es2.body == "lang=es" && vary_calls == 2, "vary: matching variant hit (header name case-insensitive)");
+    }
+
+    // 4) An eligible body varies on Accept-Encoding even when sent as is, so
+    // the identity and gzip variants are both kept.
+    {
+        Resp gz = client.get("/page", "Accept-Encoding: gzip\r\n");
+        Resp plain = client.get("/page");
+        Resp gz2 = client.get("/page", "Accept-Encoding: gzip\r\n");
+        Resp plain2 = client.get("/page");
+        check(gz.has("content-encoding: gzip") && gz2.has("content-encoding: gzip"), "encoding: gzip variant");
+        check(plain.body.size() == 1024 && plain.has("vary: accept-encoding"), "encoding: identity varies too");
+        check(plain2.body.size() == 1024 && !plain2.has("content-encoding:"), "encoding: identity variant hit");
+        check(page_calls == 2, "encoding: one handler run per variant");
+    }
+
+    // 5) stale-while-revalidate: the expired entry is still served while a
+    // single background refresh replaces it.
+    {
+        check(client.get("/swr").body == "version 1", "swr: first response");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        Resp stale = client.get("/swr");
+        check(stale.body == "version 1", "swr: stale body served");
+        std::string body;
+        for (int i = 0; i < 50 && body != "version 2"; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            body = client.get("/swr").body;
+        }
+        check(body == "version 2", "swr: refreshed in the background");
+        check(swr_calls == 2, "swr: exactly one revalidation");
+        check(server.metrics().response_cache_revalidations.load() == 1, "swr: revalidation counted");
+    }
+
+    // 6) The same for a coroutine handler: its refresh is a deferred response,
+    // completed into the cache after the handler has returned.
+    {
+        check(client.get("/swr-coro").body == "version 1", "swr coroutine: first response");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        check(client.get("/swr-coro").body == "version 1", "swr coroutine: stale body served");
+        std::string body;
+        for (int i = 0; i < 50 && body != "version 2"; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            body = client.get("/swr-coro").body;
+        }
+        check(body == "version 2", "swr coroutine: refreshed in the background");
+        check(coro_calls == 2, "swr coroutine: exactly one revalidation");
+    }
+
+    const Server::Metrics& m = server.metrics();
+    check(m.response_cache_hits.load() >= 4 && m.response_cache_stale_hits.load() >= 1 &&
+          m.response_cache_misses.load() > 0 && m.response_cache_stores.load() >= 5,
+          "metrics: lookups and stores counted");
+    check(m.response_cache_bytes.load() > 0, "metrics: bytes gauge");
+
+    server.request_stop();
+    loop.join();
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] response cache tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,159 @@
+// tests/router_test.cpp
+//
+// Unit tests for the compiled Router: byte-level prefix sharing, static-over-
+// param precedence with backtracking, inline parameter capture, `*rest`
+// catch-alls, trailing slashes, per-method handlers and the freeze() contract.
+
+#include "oreshnek/server/Router.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+// Each handler writes its tag into the response body so tests can tell which
+// route matched.
+Server::RouteHandler tag(const std::string& name) {
+    return [name](const Http::HttpRequest&, Http::HttpResponse& res) { res.text(name); };
+}
+
+std::string which(const Server::Router& router, Http::HttpMethod method, std::string_view path,
+                  Http::PathParams& params) {
+    const Server::RouteHandler* h = router.match(method, path, params);
+    if (h == nullptr) return "<none>";
+    Http::HttpRequest req;
+    Http::HttpResponse res;
+    (*h)(req, res);
+    return res.get_body_string();
+}
+
+void test_matching() {
+    using Http::HttpMethod;
+    Server::Router router;
+    router.add_route(HttpMethod::GET, "/", tag("root"));
+    router.add_route(HttpMethod::GET, "/api/v1/users", tag("users"));
+    router.add_route(HttpMethod::GET, "/api/v1/users/new", tag("users-new"));
+    router.add_route(HttpMethod::GET, "/api/v1/users/:id", tag("user"));
+    router.add_route(HttpMethod::GET, "/api/v1/users/:id/posts/:post", tag("user-post"));
+    router.add_route(HttpMethod::GET, "/api/v1/users/new/:step/confirm", tag("wizard"));
+    router.add_route(HttpMethod::GET, "/api/v1/videos/", tag("videos")); // trailing '/' dropped
+    router.add_route(HttpMethod::POST, "/api/v1/users", tag("create-user"));
+    router.add_route(HttpMethod::GET, "/api/v1/user-stats", tag("user-stats"));
+    router.freeze();
+    check(router.frozen() && router.route_count() == 9, "router: nine routes compiled");
+
+    Http::PathParams p;
+    check(which(router, HttpMethod::GET, "/", p) == "root", "match: root");
+    check(which(router, HttpMethod::GET, "/api/v1/users", p) == "users", "match: static");
+    check(which(router, HttpMethod::GET, "/api/v1/user-stats", p) == "user-stats",
+          "match: shared byte prefix across segments");
+    check(which(router, HttpMethod::GET, "/api/v1/users/new", p) == "users-new" && p.empty(),
+          "match: static wins over param");
+    check(which(router, HttpMethod::GET, "/api/v1/users/42", p) == "user" && p.find("id") == "42",
+          "match: param captured");
+    check(which(router, HttpMethod::GET, "/api/v1/users/newbie", p) == "user" && p.find("id") == "newbie",
+          "match: static prefix dead-end backtracks to param");
+    check(which(router, HttpMethod::GET, "/api/v1/users/new/posts/7", p) == "user-post" &&
+          p.find("id") == "new" && p.find("post") == "7" && p.size() == 2,
+          "match: backtracking through a static branch");
+    check(which(router, HttpMethod::GET, "/api/v1/users/new/2/confirm", p) == "wizard" &&
+          p.find("step") == "2" && p.size() == 1,
+          "match: static then param");
+    check(which(router, HttpMethod::GET, "/api/v1/users/", p) == "users", "match: trailing slash tolerated");
+    check(which(router, HttpMethod::GET, "/api/v1/videos", p) == "videos", "match: route trailing slash");
+    check(which(router, HttpMethod::POST, "/api/v1/users", p) == "create-user", "match: per-method handler");
+    check(which(router, HttpMethod::DELETE, "/api/v1/users", p) == "<none>", "match: unregistered method");
+    check(which(router, HttpMethod::GET, "/api/v1/users/42/posts", p) == "<none>" && p.empty(),
+          "match: miss leaves no params behind");
+    check(which(router, HttpMethod::GET, "/api/v1/users//posts/1", p) == "<none>", "match: empty param");
+    check(which(router, HttpMethod::GET, "/api/v1/use", p) == "<none>", "match: partial edge");
+    check(which(router, HttpMethod::GET, "relative", p) == "<none>", "match: path without '/'");
+}
+
+void test_catch_all() {
+    using Http::HttpMethod;
+    Server::Router router;
+    router.add_route(HttpMethod::GET, "/static/*path", tag("static"));
+    router.add_route(HttpMethod::GET, "/static/special.css", tag("special"));
+    router.add_route(HttpMethod::GET, "/files/:bucket/*key", tag("object"));
+    router.freeze();
+
+    Http::PathParams p;
+    check(which(router, HttpMethod::GET, "/static/css/app.css", p) == "static" &&
+          p.find("path") == "css/app.css",
+          "catch-all: captures the rest, slashes included");
+    check(which(router, HttpMethod::GET, "/static/special.css", p) == "special" && p.empty(),
+          "catch-all: static route wins");
+    check(which(router, HttpMethod::GET, "/static/special.css/map", p) == "static" &&
+          p.find("path") == "special.css/map",
+          "catch-all: static dead-end falls back to the catch-all");
+    check(which(router, HttpMethod::GET, "/static/", p) == "static" && p.find("path") == "",
+          "catch-all: empty remainder");
+    check(which(router, HttpMethod::GET, "/static", p) == "<none>", "catch-all: needs its separator");
+    check(which(router, HttpMethod::GET, "/files/b1/a/b/c.txt", p) == "object" &&
+          p.find("bucket") == "b1" && p.find("key") == "a/b/c.txt",
+          "catch-all: after a param");
+    check(which(router, HttpMethod::GET, "/files/b1", p) == "<none>" && p.empty(),
+          "catch-all: param alone does not match");
+    check(which(router, HttpMethod::POST, "/static/x", p) == "<none>", "catch-all: per method");
+}
+
+void test_contract() {
+    using Http::HttpMethod;
+    auto throws_logic = [](auto fn) {
+        try { fn(); } catch (const std::logic_error&) { return true; }
+        return false;
+    };
+    auto throws_runtime = [](auto fn) {
+        try { fn(); } catch (const std::runtime_error&) { return true; }
+        return false;
+    };
+
+    Server::Router router;
+    Http::PathParams p;
+    check(throws_logic([&] { router.match(HttpMethod::GET, "/", p); }), "contract: match before freeze");
+    check(throws_runtime([&] { router.add_route(HttpMethod::GET, "nope", tag("x")); }),
+          "contract: path must start with '/'");
+    check(throws_runtime([&] { router.add_route(HttpMethod::GET, "/a/:", tag("x")); }),
+          "contract: empty param name");
+    check(throws_runtime([&] { router.add_route(HttpMethod::GET, "/a/*", tag("x")); }),
+          "contract: empty catch-all name");
+    check(throws_runtime([&] { router.add_route(HttpMethod::GET, "/a/*rest/b", tag("x")); }),
+          "contract: catch-all must be last");
+    check(throws_runtime([&] {
+        router.add_route(HttpMethod::GET, "/:a/:b/:c/:d/:e/:f/:g/:h/:i", tag("x"));
+    }), "contract: too many params");
+
+    router.add_route(HttpMethod::GET, "/dup", tag("first"));
+    router.add_route(HttpMethod::GET, "/dup", tag("second"));
+    router.freeze();
+    router.freeze(); // Idempotent
+    check(router.route_count() == 1 && which(router, HttpMethod::GET, "/dup", p) == "second",
+          "contract: re-registration replaces");
+    check(throws_logic([&] { router.add_route(HttpMethod::GET, "/late", tag("x")); }),
+          "contract: add after freeze");
+}
+}  // namespace
+
+int main() {
+    test_matching();
+    test_catch_all();
+    test_contract();
+
+    if (g_failures == 0) {
+        std::cout << "[OK] all router tests passed" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,377 @@
+// tests/static_test.cpp
+//
+// End-to-end tests for Server::mount_static(): nested paths and MIME types,
+// index files and directory redirects, traversal (plain and percent-encoded),
+// symlinks out of the root, dotfiles and special files, plus the Range / HEAD /
+// conditional-GET semantics the server applies to every file response. Also the
+// open-file cache: hits, negative entries, LRU bound, TTL and inotify
+// invalidation (watches removed with their last entry), single-flight loads,
+// small files served from memory with precompressed variants under a byte
+// budget, and precompressed .gz / .br sidecar files.
+
+#include "oreshnek/server/Server.h"
+#include "oreshnek/server/StaticFiles.h"
+#include "oreshnek/server/FileCache.h"
+#include "oreshnek/server/Metrics.h"
+#include "oreshnek/http/Compression.h"
+#include "oreshnek/http/MimeTypes.h"
+
+#include "TestClient.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+constexpr int kPort = 18105;
+
+using Resp = TestClient::Response;
+const TestClient client(kPort);
+
+void write_file(const std::filesystem::path& path, const std::string& content) {
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+// gunzip via zlib (gzip wrapper: windowBits 15+16).
+std::string gunzip(std::string_view in) {
+    z_stream zs{};
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) return {};
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+    std::string out;
+    char buf[16384];
+    int ret;
+    do {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof(buf);
+        ret = inflate(&zs, Z_NO_FLUSH);
+        out.append(buf, sizeof(buf) - zs.avail_out);
+    } while (ret == Z_OK);
+    inflateEnd(&zs);
+    return ret == Z_STREAM_END ? out : std::string();
+}
+
+std::string stylesheet() {
+    std::string s;
+    for (int i = 0; i < 200; ++i) s += ".item-" + std::to_string(i) + " { margin: 0 auto; padding: 4px; }\n";
+    return s;
+}
+
+void test_mime_types() {
+    check(Http::mime_type("a/b/app.CSS") == "text/css; charset=utf-8", "mime: case-insensitive extension");
+    check(Http::mime_type("video/seg.m4s") == "video/iso.segment", "mime: media segment");
+    check(Http::mime_type("dir.d/README") == "application/octet-stream", "mime: dot in a directory name");
+    check(Http::mime_type("archive.") == "application/octet-stream", "mime: empty extension");
+}
+void test_file_cache(const std::filesystem::path& dir) {
+    Server::Metrics metrics;
+    Server::FileCacheOptions options;
+    options.inotify = false; // TTL only
+    options.ttl = std::chrono::milliseconds(100);
+    options.max_entries = 2;
+    Server::FileCache cache(options, &metrics);
+
+    const std::string a = (dir / "a.txt").string();
+    write_file(a, "one");
+    auto first = cache.open(a);
+    check(first && first->size == 3 && first->content_type == "text/plain; charset=utf-8" &&
+          first->etag.size() > 2 && first->last_modified.size() == 29,
+          "cache: entry carries size, MIME type and validators");
+    check(cache.open(a) == first, "cache: hit returns the same open file");
+    check(metrics.file_cache_hits == 1 && metrics.file_cache_misses == 1, "cache: hit/miss counters");
+
+    const std::string missing = (dir / "missing.txt").string();
+    check(!cache.open(missing) && !cache.open(missing) && metrics.file_cache_negative_hits == 1,
+          "cache: negative entry");
+
+    write_file(dir / "b.txt", "b");
+    cache.open((dir / "b.txt").string());
+    check(cache.size() == 2 && metrics.file_cache_evictions == 1, "cache: LRU bound");
+
+    write_file(a, "three!");
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    auto refreshed = cache.open(a);
+    check(refreshed && refreshed->size == 6, "cache: TTL expiry reopens the file");
+    check(first->size == 3 && first->file.fd() >= 0, "cache: old entry stays valid for its holders");
+}
+
+void test_watch_release(const std::filesystem::path& dir) {
+    Server::FileCacheOptions options;
+    options.max_entries = 2;
+    Server::FileCache cache(options);
+    std::vector<std::string> files;
+    for (const char* sub : {"w1", "w2", "w3"}) {
+        std::filesystem::create_directories(dir / sub);
+        files.push_back((dir / sub / "f.txt").string());
+        write_file(files.back(), sub);
+    }
+    cache.open(files[0]);
+    cache.open(files[1]);
+    if (cache.watches() == 0) return; // No inotify here: TTL only
+    check(cache.watches() == 2, "watch: one per directory");
+    cache.open(files[2]);
+    check(cache.size() == 2 && cache.watches() == 2, "watch: removed with its directory's last entry");
+    write_file(files[2], "changed");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto reopened = cache.open(files[2]);
+    check(reopened && reopened->size == 7, "watch: a directory past the first max_entries is still watched");
+    cache.clear();
+    check(cache.watches() == 0, "watch: clear() removes them all");
+}
+
+void test_single_flight(const std::filesystem::path& dir) {
+    Server::Metrics metrics;
+    Server::FileCacheOptions options;
+    options.inotify = false;
+    Server::FileCache cache(options, &metrics);
+    const std::string path = (dir / "a.txt").string();
+
+    // Concurrent misses on one key run the loader once and share its result.
+    std::atomic<int> loads{0};
+    auto slow_load = [&](Server::FileCache::Watch&) {
+        loads.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        Server::FileCache::Result result;
+        result.file = Http::FileEntry::open(path, "text/plain");
+        result.status = Server::StaticLookup::Found;
+        return result;
+    };
+    std::vector<std::shared_ptr<const Http::FileEntry>> got(4);
+    std::vector<std::thread> threads;
+    for (auto& slot : got) {
+        threads.emplace_back([&cache, &slow_load, &slot] { slot = cache.get("k", slow_load).file; });
+    }
+    for (auto& t : threads) t.join();
+    bool same = got[0] != nullptr;
+    for (const auto& f : got) same = same && f == got[0];
+    check(loads == 1 && same, "single-flight: concurrent misses share one load");
+    check(metrics.file_cache_misses == 1 && metrics.file_cache_hits == 3, "single-flight: waiters count as hits");
+
+    // A loader that throws does not leave the key stuck.
+    bool threw = false;
+    try {
+        cache.get("t", [](Server::FileCache::Watch&) -> Server::FileCache::Result { throw std::runtime_error("load"); });
+    } catch (const std::runtime_error&) { threw = true; }
+    check(threw && cache.get("t", slow_load).file != nullptr, "single-flight: failed load is retried");
+}
+
+void test_memory_entries(const std::filesystem::path& dir) {
+    const std::string css = stylesheet();
+    write_file(dir / "m.css", css);
+    auto entry = Http::FileEntry::open((dir / "m.css").string(), "text/css", 64 * 1024);
+    check(entry && entry->in_memory && entry->contents == css, "memory: small file read into memory");
+    check(entry && !entry->gzip.empty() && entry->gzip.size() < css.size() && gunzip(entry->gzip) == css,
+          "memory: gzip variant decodes to the original");
+    check(entry && entry->etag_gzip.size() > entry->etag.size() &&
+          entry->etag_gzip.compare(entry->etag_gzip.size() - 4, 4, "-gz\"") == 0,
+          "memory: variant has its own ETag");
+    if (Http::brotli_available()) {
+        check(entry && !entry->brotli.empty() && entry->brotli.size() < css.size(), "memory: brotli variant");
+    }
+    auto binary = Http::FileEntry::open((dir / "m.css").string(), "image/png", 64 * 1024);
+    check(binary && binary->in_memory && !binary->has_variants(), "memory: no variants for binary types");
+    auto large = Http::FileEntry::open((dir / "m.css").string(), "text/css", 1024);
+    check(large && !large->in_memory && large->contents.empty(), "memory: file over the limit stays on disk");
+
+    Server::Metrics metrics;
+    Server::FileCacheOptions options;
+    options.inotify = false;
+    options.memory_budget = entry ? entry->memory_bytes() + entry->memory_bytes() / 2 : 0;
+    Server::FileCache cache(options, &metrics);
+    write_file(dir / "n.css", css);
+    cache.open((dir / "m.css").string());
+    check(cache.memory_bytes() == (entry ? entry->memory_bytes() : 0) &&
+          metrics.file_cache_memory_bytes == static_cast<int64_t>(cache.memory_bytes()),
+          "memory: bytes accounted and published");
+    cache.open((dir / "n.css").string());
+    check(cache.size() == 1 && metrics.file_cache_evictions == 1 &&
+          cache.memory_bytes() <= options.memory_budget, "memory: byte budget evicts LRU entries");
+    cache.clear();
+    check(metrics.file_cache_memory_bytes == 0, "memory: gauge cleared");
+}
+}  // namespace
+
+int main() {
+    namespace fs = std::filesystem;
+    test_mime_types();
+
+    const fs::path base = fs::temp_directory_path() / ("ore_static_test_" + std::to_string(::getpid()));
+    const fs::path root = base / "public";
+    fs::remove_all(base);
+    fs::create_directories(root / "css");
+    fs::create_directories(root / "docs");
+    const std::string css = "body { color: #333; }\n";
+    write_file(root / "index.html", "<h1>home</h1>");
+    write_file(root / "css" / "app.css", css);
+    write_file(root / "docs" / "index.html", "<h1>docs</h1>");
+    write_file(root / "my file.txt", "spaced");
+    const std::string sheet = stylesheet();
+    write_file(root / "css" / "site.css", sheet);
+    // Sidecars: fast gzip (distinguishable from the server's own level 6), and
+    // one left stale by an edit of its file.
+    fs::create_directories(root / "js");
+    const std::string script = "function f(x) { return x * 2; }\n" + sheet;
+    const std::string script_gz = Http::gzip_compress(script, 1);
+    write_file(root / "js" / "app.js", script);
+    write_file(root / "js" / "app.js.gz", script_gz);
+    write_file(root / "js" / "old.js", script);
+    write_file(root / "js" / "old.js.gz", script_gz);
+    fs::last_write_time(root / "js" / "old.js.gz", fs::last_write_time(root / "js" / "old.js") - std::chrono::hours(1));
+    write_file(root / ".env", "SECRET=1");
+    write_file(base / "secret.txt", "outside");
+    fs::create_symlink(base / "secret.txt", root / "link.txt");
+    fs::create_directory_symlink(base, root / "up");
+    ::mkfifo((root / "pipe").c_str(), 0600);
+
+    bool threw = false;
+    try { Server::StaticDirectory missing((base / "nope").string()); } catch (const std::runtime_error&) { threw = true; }
+    check(threw, "construct: missing root throws");
+    test_file_cache(base);
+    test_watch_release(base);
+    test_single_flight(base);
+    test_memory_entries(base);
+
+    Server::Server server(2);
+    server.mount_static("/static/", root.string());
+    Server::StaticOptions on_disk;
+    on_disk.cache.memory_max_file = 0; // Sidecars streamed with sendfile
+    server.mount_static("/disk/", root.string(), on_disk);
+    if (!server.listen("127.0.0.1", kPort)) { std::cerr << "[FATAL] listen\n"; return 1; }
+    std::thread loop([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Nested file, MIME type and cache headers.
+    Resp r = client.get("/static/css/app.css");
+    check(r.status == 200 && r.body == css, "file: nested path served");
+    check(r.has("content-type: text/css"), "file: MIME type from extension");
+    check(r.has("cache-control: public, max-age=3600") && r.has("etag: ") && r.has("last-modified: "),
+          "file: Cache-Control and validators");
+    const std::string etag = r.header("etag");
+
+    check(client.get("/static/my%20file.txt").body == "spaced", "file: percent-decoded name");
+
+    // Index files and directory redirects.
+    r = client.get("/static/");
+    check(r.status == 200 && r.body == "<h1>home</h1>" && r.has("content-type: text/html"),
+          "index: mount root");
+    r = client.get("/static");
+    check(r.status == 301 && r.header("location") == "/static/", "index: mount point redirects");
+    r = client.get("/static/docs");
+    check(r.status == 301 && r.header("location") == "/static/docs/", "index: directory redirects");
+    check(client.get("/static/docs/").body == "<h1>docs</h1>", "index: nested directory");
+
+    // Confinement.
+    check(client.get("/static/../secret.txt").status == 403, "confine: '..' refused");
+    check(client.get("/static/css/%2e%2e/%2E%2E/secret.txt").status == 403, "confine: encoded '..'");
+    check(client.get("/static/link.txt").status == 403, "confine: symlinked file refused");
+    check(client.get("/static/up/secret.txt").status == 403, "confine: symlinked directory refused");
+    check(client.get("/static/.env").status == 404, "confine: dotfile hidden");
+    check(client.get("/static/pipe").status == 404, "confine: FIFO is not served");
+    check(client.get("/static/missing.js").status == 404, "confine: missing file");
+    check(client.get("/static/a%00b").status == 404, "confine: NUL byte");
+
+    // Range, HEAD and conditional GET apply as for any file response.
+    r = client.get("/static/css/app.css", "Range: bytes=0-3\r\n");
+    check(r.status == 206 && r.body == css.substr(0, 4) && r.has("content-range: bytes 0-3/"),
+          "semantics: Range");
+    r = client.round_trip(TestClient::request("HEAD", "/static/css/app.css"));
+    check(r.status == 200 && r.body.empty() && r.has("content-length: " + std::to_string(css.size())),
+          "semantics: HEAD");
+    r = client.get("/static/css/app.css", "If-None-Match: " + etag + "\r\n");
+    check(!etag.empty() && r.status == 304 && r.body.empty(), "semantics: If-None-Match -> 304");
+
+    // Small files come from memory, precompressed when the client accepts it.
+    r = client.get("/static/css/site.css", "Accept-Encoding: gzip\r\n");
+    check(r.status == 200 && r.has("content-encoding: gzip") && gunzip(r.body) == sheet,
+          "memory: gzip variant served");
+    check(r.has("vary: accept-encoding"), "memory: Vary on the compressed response");
+    const std::string gz_etag = r.header("etag");
+    check(gz_etag.find("-gz") != std::string::npos, "memory: variant ETag");
+    r = client.get("/static/css/site.css", "Accept-Encoding: gzip\r\nIf-None-Match: " + gz_etag + "\r\n");
+    check(r.status == 304, "memory: variant ETag revalidates");
+    r = client.get("/static/css/site.css", "Accept-Encoding: gzip;q=0\r\nIf-None-Match: " + gz_etag + "\r\n");
+    check(r.status == 200 && r.body == sheet && !r.has("content-encoding"),
+          "memory: identity body (and ETag) when gzip is refused");
+    r = client.get("/static/css/site.css", "Accept-Encoding: gzip\r\nRange: bytes=10-19\r\n");
+    check(r.status == 206 && r.body == sheet.substr(10, 10) && !r.has("content-encoding"),
+          "memory: Range addresses the identity bytes");
+    r = client.get("/static/css/site.css", "Range: bytes=0-1,10-11\r\n");
+    check(r.status == 206 && r.has("content-type: multipart/byteranges; boundary=") &&
+              r.body.find("\r\n\r\n" + sheet.substr(0, 2) + "\r\n--") != std::string::npos &&
+              r.body.find("\r\n\r\n" + sheet.substr(10, 2) + "\r\n--") != std::string::npos,
+          "memory: multi-range parts sliced from the entry");
+    r = client.round_trip(TestClient::request("HEAD", "/static/css/site.css", "Accept-Encoding: gzip\r\n"));
+    check(r.status == 200 && r.body.empty() && r.has("content-encoding: gzip") &&
+          !r.has("content-length: " + std::to_string(sheet.size())),
+          "memory: HEAD describes the variant");
+    check(server.metrics().file_cache_memory_bytes > 0, "memory: gauge");
+
+    // Precompressed sidecars.
+    r = client.get("/disk/js/app.js", "Accept-Encoding: br, gzip\r\n");
+    check(r.status == 200 && r.has("content-encoding: gzip") && r.body == script_gz &&
+          r.has("vary: accept-encoding") && r.header("etag").find("-gz") != std::string::npos,
+          "sidecar: .gz streamed with its own ETag");
+    check(r.has("content-type: application/javascript"), "sidecar: Content-Type of the original");
+    r = client.get("/disk/js/app.js", "Accept-Encoding: br\r\n");
+    check(r.status == 200 && r.body == script && !r.has("content-encoding"), "sidecar: no .br -> identity");
+    r = client.get("/disk/js/old.js", "Accept-Encoding: gzip\r\n");
+    check(r.status == 200 && r.body == script && !r.has("content-encoding"), "sidecar: stale sidecar ignored");
+    r = client.get("/static/js/app.js", "Accept-Encoding: gzip\r\n");
+    check(r.status == 200 && r.body == script_gz, "sidecar: loaded as the in-memory variant");
+
+    // Repeat requests are cache hits; changes on disk are picked up (inotify).
+    check(server.metrics().file_cache_hits > 0, "cache: repeat requests hit the cache");
+    const std::string css2 = "body { color: #000; margin: 0; }\n";
+    write_file(root / "css" / "app.css", css2);
+    check(client.get("/static/later.js").status == 404, "cache: 404 before the file exists");
+    write_file(root / "later.js", "ok();");
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    r = client.get("/static/css/app.css");
+    check(r.body == css2 && r.header("etag") != etag, "cache: modified file invalidated");
+    check(client.get("/static/later.js").body == "ok();", "cache: negative entry invalidated");
+    check(server.metrics().file_cache_invalidations > 0, "cache: invalidations counted");
+    // A file being written next to cached ones leaves them cached.
+    client.get("/static/css/site.css");
+    const uint64_t invalidations = server.metrics().file_cache_invalidations;
+    const uint64_t hits = server.metrics().file_cache_hits;
+    for (int i = 0; i < 3; ++i) {
+        write_file(root / "css" / "build.log", std::string(static_cast<size_t>(i + 1), 'x'));
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        check(client.get("/static/css/site.css").status == 200, "cache: neighbour's entry still served");
+    }
+    check(server.metrics().file_cache_invalidations == invalidations &&
+              server.metrics().file_cache_hits == hits + 3,
+          "cache: a neighbour's writes invalidate nothing else");
+
+    server.request_stop();
+    loop.join();
+    fs::remove_all(base);
+
+    if (g_failures == 0) {
+        std::cout << "[OK] all static tests passed" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
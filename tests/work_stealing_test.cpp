@@ -0,0 +1,169 @@
+// tests/work_stealing_test.cpp
+//
+// WorkStealingPool: every task posted from outside (one or many producers) and
+// from inside the pool (recursive fan-out, spread by stealing) runs exactly
+// once; the injection queue stays FIFO across its overflow list; large
+// captures, throwing tasks, worker indices and shutdown draining behave.
+
+#include "oreshnek/server/WorkStealingPool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Oreshnek;
+
+namespace {
+int g_failures = 0;
+void check(bool cond, const std::string& msg) {
+    if (!cond) {
+        std::cerr << "[FAIL] " << msg << std::endl;
+        ++g_failures;
+    }
+}
+
+bool wait_for(const std::atomic<int>& counter, int expected) {
+    for (int i = 0; i < 1000 && counter.load() < expected; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return counter.load() == expected;
+}
+
+void fan_out(Server::WorkStealingPool& pool, std::atomic<int>& done, int depth) {
+    done.fetch_add(1);
+    if (depth == 0) return;
+    pool.post([&pool, &done, depth] { fan_out(pool, done, depth - 1); });
+    pool.post([&pool, &done, depth] { fan_out(pool, done, depth - 1); });
+}
+
+void test_external_producers() {
+    Server::WorkStealingPool pool(4);
+    std::atomic<int> done{0};
+    for (int i = 0; i < 50000; ++i) pool.post([&done] { done.fetch_add(1); });
+    check(wait_for(done, 50000), "single producer: every task ran");
+
+    done = 0;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p) {
+        producers.emplace_back([&pool, &done] {
+            for (int i = 0; i < 20000; ++i) pool.post([&done] { done.fetch_add(1); });
+        });
+    }
+    for (auto& t : producers) t.join();
+    check(wait_for(done, 80000), "many producers: every task ran");
+    check(pool.queue_depth() == 0, "queue depth back to zero");
+}
+
+void test_fan_out() {
+    Server::WorkStealingPool pool(4);
+    std::atomic<int> done{0};
+    pool.post([&pool, &done] { fan_out(pool, done, 14); });
+    check(wait_for(done, (1 << 15) - 1), "fan-out: every task ran");
+
+    // A worker fills its own deque and then blocks: only thieves can run them.
+    std::atomic<int> stolen{0};
+    std::atomic<bool> all_ran{false};
+    pool.post([&pool, &stolen, &all_ran] {
+        for (int i = 0; i < 100; ++i) pool.post([&stolen] { stolen.fetch_add(1); });
+        all_ran = wait_for(stolen, 100);
+    });
+    check(wait_for(stolen, 100), "steal: a blocked worker's tasks ran elsewhere");
+    for (int i = 0; i < 100 && !all_ran.load(); ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    check(all_ran.load() && pool.steals() >= 100, "steal: steals counted");
+}
+
+void test_fifo_overflow() {
+    Server::WorkStealingPool pool(1, 16); // Tiny injection ring: most go to overflow
+    std::atomic<bool> release{false};
+    std::atomic<int> done{0};
+    std::vector<int> order;
+    pool.post([&release, &done] {
+        done.fetch_add(1);
+        while (!release.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    check(wait_for(done, 1), "overflow: worker busy");
+    done = 0;
+    for (int i = 0; i < 1000; ++i) {
+        pool.post([&order, &done, i] {
+            order.push_back(i); // One worker: no race
+            done.fetch_add(1);
+        });
+    }
+    check(pool.queue_depth() == 1000, "overflow: queued tasks counted");
+    release = true;
+    check(wait_for(done, 1000), "overflow: every task ran");
+    check(std::is_sorted(order.begin(), order.end()), "overflow: injection order kept");
+}
+
+void test_items() {
+    Server::WorkStealingPool pool(2);
+    std::atomic<int> done{0};
+    std::array<std::uint64_t, 32> big{}; // Larger than the inline buffer
+    big[31] = 7;
+    pool.post([big, &done] { done.fetch_add(static_cast<int>(big[31])); });
+    check(wait_for(done, 7), "large capture runs from the heap");
+
+    done = 0;
+    pool.post([] { throw std::runtime_error("task failed"); });
+    pool.post([&done] { done.fetch_add(1); });
+    check(wait_for(done, 1), "a throwing task does not take its worker down");
+
+    std::mutex mutex;
+    std::vector<int> indices;
+    done = 0;
+    for (int i = 0; i < 64; ++i) {
+        pool.post([&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            indices.push_back(Server::WorkStealingPool::current_worker_index());
+            done.fetch_add(1);
+        });
+    }
+    check(wait_for(done, 64), "index tasks ran");
+    check(std::all_of(indices.begin(), indices.end(), [](int i) { return i == 0 || i == 1; }),
+          "worker index in [0, size())");
+    check(Server::WorkStealingPool::current_worker_index() == -1, "no index outside the pool");
+}
+
+void test_shutdown() {
+    Server::WorkStealingPool pool(2);
+    std::atomic<int> done{0};
+    for (int i = 0; i < 200; ++i) {
+        pool.post([&done] {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            done.fetch_add(1);
+        });
+    }
+    pool.shutdown();
+    check(done.load() == 200, "shutdown drains queued tasks");
+    bool threw = false;
+    try {
+        pool.post([] {});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "post after shutdown throws");
+}
+
+} // namespace
+
+int main() {
+    test_external_producers();
+    test_fan_out();
+    test_fifo_overflow();
+    test_items();
+    test_shutdown();
+
+    if (g_failures == 0) {
+        std::cout << "[PASS] work-stealing pool tests" << std::endl;
+        return 0;
+    }
+    std::cerr << "[FAILED] " << g_failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,182 @@
+// tools/precompress.cpp
+//
+// oreshnek_precompress: writes "<file>.gz" and "<file>.br" next to every
+// compressible file under a directory, at maximum quality (gzip -9, brotli 11),
+// for Server::mount_static() to serve as precompressed sidecars. Compression
+// happens once at deploy time, so it can afford the slowest settings.
+//
+// A sidecar is only written when it is smaller than the original, and is
+// skipped when it is already up to date (not older than the original). Stale
+// sidecars of files that no longer compress well are removed, as is the old
+// sidecar of a file whose new one cannot be written. A file that cannot be read
+// or a sidecar that cannot be written makes the tool exit 1.
+//
+// Usage: oreshnek_precompress [--force] [--min-size BYTES] DIR...
+
+#include "oreshnek/http/Compression.h"
+#include "oreshnek/http/MimeTypes.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+using namespace Oreshnek;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    bool force = false;
+    std::uintmax_t min_size = 256; // Below this the headers dominate anyway
+};
+
+struct Totals {
+    std::size_t files = 0;
+    std::size_t written = 0;
+    std::size_t up_to_date = 0;
+    std::size_t failed = 0; // Files not read, sidecars not written
+    std::uintmax_t original_bytes = 0;
+    std::uintmax_t gzip_bytes = 0;
+    std::uintmax_t brotli_bytes = 0;
+};
+
+bool has_suffix(const std::string& s, const char* suffix) {
+    const std::string_view sv(suffix);
+    return s.size() >= sv.size() && s.compare(s.size() - sv.size(), sv.size(), sv) == 0;
+}
+
+bool read_file(const fs::path& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+// Write through a temporary and rename, so the server never opens a half-written
+// sidecar.
+bool write_file(const fs::path& path, const std::string& data) {
+    fs::path tmp = path;
+    tmp += ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    out.close(); // Flushes: a full disk shows up here
+    std::error_code ec;
+    if (out) fs::rename(tmp, path, ec);
+    if (!out || ec) {
+        std::error_code ignored; // Not written, whatever the cleanup says
+        fs::remove(tmp, ignored);
+        return false;
+    }
+    return true;
+}
+
+bool up_to_date(const fs::path& sidecar, fs::file_time_type source_time) {
+    std::error_code ec;
+    const fs::file_time_type t = fs::last_write_time(sidecar, ec);
+    return !ec && t >= source_time;
+}
+
+// Produce one sidecar; returns its size (0 if none is kept).
+template <typename Compress>
+std::uintmax_t sidecar(const fs::path& file, const char* ext, const std::string& contents,
+                       fs::file_time_type mtime, const Options& options, Totals& totals, Compress&& compress) {
+    fs::path out = file;
+    out += ext;
+    std::error_code ec;
+    if (!options.force && up_to_date(out, mtime)) {
+        ++totals.up_to_date;
+        return fs::file_size(out, ec);
+    }
+    const std::string encoded = compress(contents);
+    if (encoded.empty() || encoded.size() >= contents.size()) {
+        fs::remove(out, ec); // Not worth it (or failed): make sure no stale copy is served
+        return 0;
+    }
+    if (!write_file(out, encoded)) {
+        std::fprintf(stderr, "cannot write %s\n", out.c_str());
+        ++totals.failed;
+        fs::remove(out, ec); // The old one no longer matches the file
+        return 0;
+    }
+    ++totals.written;
+    return encoded.size();
+}
+
+void process(const fs::path& file, const Options& options, Totals& totals) {
+    const std::string name = file.filename().string();
+    if (has_suffix(name, ".gz") || has_suffix(name, ".br") || has_suffix(name, ".tmp")) return;
+    if (!Http::is_compressible_type(Http::mime_type(name))) return;
+    std::error_code ec;
+    const std::uintmax_t size = fs::file_size(file, ec);
+    if (ec || size < options.min_size) return;
+    const fs::file_time_type mtime = fs::last_write_time(file, ec);
+    if (ec) return;
+
+    std::string contents;
+    if (!read_file(file, contents)) {
+        std::fprintf(stderr, "cannot read %s\n", file.c_str());
+        ++totals.failed;
+        return;
+    }
+    ++totals.files;
+    totals.original_bytes += contents.size();
+    totals.gzip_bytes += sidecar(file, ".gz", contents, mtime, options, totals,
+                                 [](const std::string& in) { return Http::gzip_compress(in, 9); });
+    if (Http::brotli_available()) {
+        totals.brotli_bytes += sidecar(file, ".br", contents, mtime, options, totals,
+                                       [](const std::string& in) { return Http::brotli_compress(in, 11); });
+    }
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: oreshnek_precompress [--force] [--min-size BYTES] DIR...\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<fs::path> dirs;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--force") {
+            options.force = true;
+        } else if (arg == "--min-size" && i + 1 < argc) {
+            options.min_size = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] == '-') {
+            return usage();
+        } else {
+            dirs.emplace_back(arg);
+        }
+    }
+    if (dirs.empty()) return usage();
+    if (!Http::brotli_available()) {
+        std::fprintf(stderr, "note: built without brotli; writing .gz sidecars only\n");
+    }
+
+    Totals totals;
+    for (const fs::path& dir : dirs) {
+        std::error_code ec;
+        // Symlinks are not followed: the server refuses to serve them anyway.
+        for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && !it->is_symlink(ec)) process(it->path(), options, totals);
+        }
+        if (ec) {
+            std::fprintf(stderr, "%s: %s\n", dir.c_str(), ec.message().c_str());
+            return 1;
+        }
+    }
+    std::printf("%zu files (%ju bytes): %zu sidecars written, %zu up to date, %zu failed; "
+                "gzip %ju bytes, brotli %ju bytes\n",
+                totals.files, totals.original_bytes, totals.written, totals.up_to_date, totals.failed,
+                totals.gzip_bytes, totals.brotli_bytes);
+    return totals.failed == 0 ? 0 : 1;
+}